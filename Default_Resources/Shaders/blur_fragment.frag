@@ -5,24 +5,31 @@ layout(location = 1) out vec4 outGlow;
 
 layout(binding = 0) uniform FragmentUniform
 {
-	vec2 direction;
 	vec2 resolution;
 } ubo;
 
 layout(binding = 2) uniform sampler2D colorSampler;
 layout(binding = 3) uniform sampler2D glowSampler;
+layout(binding = 4) uniform sampler2D filteredSampler;
+
+vec4 Sample(vec2 uv)
+{
+	vec2 halfSource = 0.5 / vec2(textureSize(filteredSampler, 0));
+	return texture(filteredSampler, clamp(uv, halfSource, 1.0 - halfSource));
+}
 
-const float offset[3] = float[](0.0, 1.3846153846, 3.2307692308);
-const float weight[3] = float[](0.2270270270, 0.3162162162, 0.0702702703);
- 
 void main()
 {
-	vec2 coords = vec2(gl_FragCoord);
-	outColor = texture(colorSampler, coords / ubo.resolution) * weight[0];
-	for (int i=1; i<3; i++)
-	{
-		outColor += texture(colorSampler, (coords + offset[i] * ubo.direction) / ubo.resolution) * weight[i];
-		outColor += texture(colorSampler, (coords - offset[i] * ubo.direction) / ubo.resolution) * weight[i];
-	}
-	outGlow = texelFetch(glowSampler, ivec2(coords), 0);
-}
\ No newline at end of file
+	vec2 uv = gl_FragCoord.xy / ubo.resolution;
+	vec2 halfTexel = 0.5 / ubo.resolution;
+	vec4 sum = Sample(uv + vec2(-halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv + vec2(-halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv + vec2(0.0, halfTexel.y * 2.0));
+	sum += Sample(uv + vec2(halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv + vec2(halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv + vec2(halfTexel.x, -halfTexel.y)) * 2.0;
+	sum += Sample(uv + vec2(0.0, -halfTexel.y * 2.0));
+	sum += Sample(uv + vec2(-halfTexel.x, -halfTexel.y)) * 2.0;
+	outColor = sum / 12.0;
+	outGlow = texelFetch(glowSampler, ivec2(gl_FragCoord.xy), 0);
+}
@@ -38,26 +38,47 @@ struct SpotLight
 	vec2 Angles;
 };
 
-const int MAX_DIR_LIGHT = 8;
-const int MAX_POINT_LIGHT = 64;
-const int MAX_SPOT_LIGHT = 64;
+struct LightCluster
+{
+	uint offset;
+	uint pointCount;
+	uint spotCount;
+	uint padding;
+};
+
+const uint CLUSTER_X = 16;
+const uint CLUSTER_Y = 9;
+const uint CLUSTER_Z = 24;
 
 layout(binding = 0) uniform FragmentUniform
 {
-	DirectionalLight dlights[MAX_DIR_LIGHT];
-	PointLight plights[MAX_POINT_LIGHT];
-	SpotLight slights[MAX_SPOT_LIGHT];
 	vec3 viewPos;
 	uint dCount;
+	vec3 viewDir;
+	uint clusterBase;
+	float sliceScale;
+	float sliceBias;
 	uint pCount;
 	uint sCount;
+	mat4 inverseViewProjection;
 } ubo;
 
+layout(std430, binding = 1) readonly buffer DirectionalLights { DirectionalLight dlights[]; };
+layout(std430, binding = 5) readonly buffer PointLights { PointLight plights[]; };
+layout(std430, binding = 6) readonly buffer SpotLights { SpotLight slights[]; };
+layout(std430, binding = 7) readonly buffer LightClusters { LightCluster clusters[]; };
+layout(std430, binding = 8) readonly buffer LightIndices { uint lightIndices[]; };
+
 layout(binding = 2) uniform sampler2D albedoSampler;
 layout(binding = 3) uniform sampler2D normalSampler;
 layout(binding = 4) uniform sampler2D positionSampler;
+layout(binding = 9) uniform sampler2D depthSampler;
 //layout(binding = 3) uniform sampler2DShadow shadowMap;
 
+// Set by the pipeline when the G-buffer uses the compact layout : the normal target holds an octahedral normal,
+// the position target holds the material parameters and positions are rebuilt from depth
+layout(constant_id = 0) const bool COMPACT_GBUFFER = false;
+
 vec3 view;
 vec3 pos;
 vec3 normal;
@@ -163,20 +184,47 @@ vec3 GetSpot(in SpotLight light)
 	return color;
 }
 
+vec3 OctDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+vec3 GetWorldPosition(ivec2 pixelPos)
+{
+	vec2 uv = (vec2(pixelPos) + 0.5) / vec2(textureSize(depthSampler, 0));
+	vec4 world = ubo.inverseViewProjection * vec4(uv * 2.0 - 1.0, texelFetch(depthSampler, pixelPos, 0).r, 1.0);
+	return world.xyz / world.w;
+}
+
+LightCluster GetCluster()
+{
+	vec2 tile = gl_FragCoord.xy * vec2(CLUSTER_X, CLUSTER_Y) / vec2(textureSize(albedoSampler, 0));
+	float depth = max(dot(pos - ubo.viewPos, ubo.viewDir), 0.0001);
+	uint slice = uint(clamp(floor(log(depth) * ubo.sliceScale + ubo.sliceBias), 0.0, float(CLUSTER_Z - 1)));
+	uvec2 xy = min(uvec2(tile), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+	return clusters[ubo.clusterBase + (slice * CLUSTER_Y + xy.y) * CLUSTER_X + xy.x];
+}
+
 vec3 GetLights()
 {
 	vec3 result = vec3(0);
 	for (uint i = 0; i < ubo.dCount; i++)
 	{
-		result += GetDirectional(ubo.dlights[i]);
+		result += GetDirectional(dlights[i]);
 	}
-	for (uint i = 0; i < ubo.pCount; i++)
+	LightCluster cluster = GetCluster();
+	uint index = cluster.offset;
+	for (uint i = 0; i < cluster.pointCount; i++)
 	{
-		result += GetPoint(ubo.plights[i]);
+		result += GetPoint(plights[lightIndices[index++]]);
 	}
-	for (uint i = 0; i < ubo.sCount; i++)
+	for (uint i = 0; i < cluster.spotCount; i++)
 	{
-		result += GetSpot(ubo.slights[i]);
+		result += GetSpot(slights[lightIndices[index++]]);
 	}
 	return result;
 }
@@ -186,16 +234,25 @@ void main()
 	ivec2 pixelPos = ivec2(gl_FragCoord.xy);
 	vec4 cInput = texelFetch(albedoSampler, pixelPos, 0);
 	vec4 nInput = texelFetch(normalSampler, pixelPos, 0);
-	if (nInput.w < 1.)
+	vec4 pInput = texelFetch(positionSampler, pixelPos, 0);
+	if ((COMPACT_GBUFFER ? pInput.w : nInput.w) < 1.)
 	{
 		outColor = cInput;
 		outSat = vec4(0);
 		return;
 	}
-	normal = normalize(nInput.xyz);
-	vec4 pInput = texelFetch(positionSampler, pixelPos, 0);
-	pos = pInput.xyz;
-	shininess = pInput.w;
+	if (COMPACT_GBUFFER)
+	{
+		normal = OctDecode(nInput.xy);
+		pos = GetWorldPosition(pixelPos);
+		shininess = exp2(pInput.x * 16.0);
+	}
+	else
+	{
+		normal = normalize(nInput.xyz);
+		pos = pInput.xyz;
+		shininess = pInput.w;
+	}
 	view = normalize(ubo.viewPos - pos);
 	
 	vec3 total = cInput.xyz * GetLights();
@@ -8,10 +8,12 @@ layout(location = 0) in VertexOutput
 	vec3 fragColor;
 	vec2 fragUV;
 } vOut;
+layout(location = 5) flat in uint vObjectID;
 
 layout(location = 0) out vec4 outColor;
 layout(location = 1) out vec4 outNormal;
 layout(location = 2) out vec4 outPosition;
+layout(location = 3) out uint outObjectID;
 
 layout(binding = 1) uniform FragmentUniform
 {
@@ -23,14 +25,26 @@ layout(binding = 2) uniform sampler2D texSampler;
 layout(binding = 3) uniform sampler2D normSampler;
 layout(binding = 4) uniform sampler2D heightSampler;
 
+// Set by the pipeline when the target framebuffer uses the compact G-buffer layout
+layout(constant_id = 0) const bool COMPACT_GBUFFER = false;
+
+vec2 OctEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.xy;
+}
+
 vec3 CalcBumpedNormal()
 {
     vec3 Normal = normalize(vOut.worldNormal);
     vec3 Tangent = normalize(vOut.worldTangent);
 	Tangent = normalize(Tangent - dot(Tangent, Normal) * Normal);
     vec3 Bitangent = -cross(Tangent, Normal);
-    vec3 BumpMapNormal = texture(normSampler, vOut.fragUV).xyz;
-    BumpMapNormal = 2.0 * BumpMapNormal - vec3(1.0, 1.0, 1.0);
+    // Normal maps may be stored as two channels, the third component is rebuilt from the unit length
+    vec3 BumpMapNormal;
+    BumpMapNormal.xy = 2.0 * texture(normSampler, vOut.fragUV).xy - vec2(1.0, 1.0);
+    BumpMapNormal.z = sqrt(max(1.0 - dot(BumpMapNormal.xy, BumpMapNormal.xy), 0.0));
     vec3 NewNormal;
     mat3 TBN = mat3(Tangent, Bitangent, Normal);
     NewNormal = TBN * BumpMapNormal;
@@ -45,6 +59,16 @@ void main()
 	if (tex.a < 0.1) discard;
 	vec3 col = tex.rgb * vOut.fragColor * ubo.matAmbient;
     outColor = vec4(col, tex.a);
-	outNormal = vec4(normal, 1);
-	outPosition = vec4(vOut.worldPos, ubo.matShininess);
+	outObjectID = vObjectID;
+	if (COMPACT_GBUFFER)
+	{
+		// Octahedral normal, shininess on a log scale and the lit flag, the position comes from the depth buffer
+		outNormal = vec4(OctEncode(normal), 0, 0);
+		outPosition = vec4(log2(max(ubo.matShininess, 1.0)) / 16.0, 0, 0, 1);
+	}
+	else
+	{
+		outNormal = vec4(normal, 1);
+		outPosition = vec4(vOut.worldPos, ubo.matShininess);
+	}
 }
\ No newline at end of file
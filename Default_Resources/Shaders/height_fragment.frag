@@ -25,6 +25,15 @@ layout(binding = 2) uniform sampler2D texSampler;
 layout(binding = 3) uniform sampler2D normSampler;
 layout(binding = 4) uniform sampler2D heightSampler;
 
+layout(constant_id = 0) const bool COMPACT_GBUFFER = false;
+
+vec2 OctEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.xy;
+}
+
 const float heightScale = 0.1;
 
 vec3 view;
@@ -78,8 +87,10 @@ vec3 CalcBumpedNormal(in vec2 texCoords)
     vec3 Tangent = normalize(vOut.worldTangent);
 	Tangent = normalize(Tangent - dot(Tangent, Normal) * Normal);
     vec3 Bitangent = -cross(Tangent, Normal);
-    vec3 BumpMapNormal = texture(normSampler, texCoords).xyz;
-    BumpMapNormal = 2.0 * BumpMapNormal - vec3(1.0, 1.0, 1.0);
+    // Normal maps may be stored as two channels, the third component is rebuilt from the unit length
+    vec3 BumpMapNormal;
+    BumpMapNormal.xy = 2.0 * texture(normSampler, texCoords).xy - vec2(1.0, 1.0);
+    BumpMapNormal.z = sqrt(max(1.0 - dot(BumpMapNormal.xy, BumpMapNormal.xy), 0.0));
     vec3 NewNormal;
     mat3 TBN = mat3(Tangent, Bitangent, Normal);
     NewNormal = TBN * BumpMapNormal;
@@ -99,6 +110,15 @@ void main()
 	if (color.a < 0.1) discard;
 	vec3 col = color.rgb * vOut.fragColor * ubo.matAmbient;
 	outColor = vec4(col, 1.0);
-	outNormal = vec4(CalcBumpedNormal(texCoords), 1);
-	outPosition = vec4(vOut.worldPos, ubo.matShininess);
+	vec3 normal = CalcBumpedNormal(texCoords);
+	if (COMPACT_GBUFFER)
+	{
+		outNormal = vec4(OctEncode(normal), 0, 0);
+		outPosition = vec4(log2(max(ubo.matShininess, 1.0)) / 16.0, 0, 0, 1);
+	}
+	else
+	{
+		outNormal = vec4(normal, 1);
+		outPosition = vec4(vOut.worldPos, ubo.matShininess);
+	}
 }
\ No newline at end of file
@@ -0,0 +1,59 @@
+#version 450
+
+struct IndirectObject
+{
+	mat4 model;
+	vec4 boundsCenter;
+	vec4 boundsExtent;
+	uint indexCount;
+	uint firstIndex;
+	int vertexOffset;
+	uint batch;
+	uint batchSlot;
+	uint flags;
+	uint cone;
+	float radius;
+	uint objectID;
+};
+
+layout(std430, binding = 0) readonly buffer ObjectBuffer
+{
+	IndirectObject objects[];
+};
+
+layout(push_constant) uniform ViewConstants
+{
+	mat4 vp;
+} view;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inCoord;
+layout(location = 3) in vec3 inNormal;
+layout(location = 4) in vec3 inTangent;
+
+layout(location = 0) out VertexOutput
+{
+	vec3 worldPos;
+	vec3 worldNormal;
+	vec3 worldTangent;
+	vec3 fragColor;
+	vec2 fragUV;
+} vOut;
+layout(location = 5) flat out uint vObjectID;
+
+void main()
+{
+	// firstInstance of each command is the index of its object
+	mat4 model = objects[gl_InstanceIndex].model;
+	vec4 worldPos = model * vec4(inPosition, 1);
+	gl_Position = view.vp * worldPos;
+	vOut.worldPos = vec3(worldPos);
+	vOut.fragColor = inColor;
+	vOut.fragUV = inCoord;
+
+	mat3 md = mat3(model);
+	vOut.worldNormal = md * inNormal;
+	vOut.worldTangent = md * inTangent;
+	vObjectID = objects[gl_InstanceIndex].objectID;
+}
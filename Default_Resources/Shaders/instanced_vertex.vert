@@ -0,0 +1,34 @@
+#version 450
+
+layout(binding = 0) uniform VertexUniform
+{
+    mat4 model;
+    mat4 mvp;
+} ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+layout(location = 2) in vec2 inCoord;
+layout(location = 3) in vec3 inNormal;
+layout(location = 4) in vec3 inTangent;
+layout(location = 5) in mat4 instanceModel;
+
+layout(location = 0) out VertexOutput
+{
+	vec3 worldPos;
+	vec3 worldNormal;
+	vec3 worldTangent;
+	vec3 fragColor;
+	vec2 fragUV;
+} vOut;
+
+void main()
+{
+	vec4 worldPos = instanceModel * vec4(inPosition, 1);
+    gl_Position = ubo.mvp * worldPos;
+	vOut.worldPos = worldPos.xyz;
+	vOut.worldNormal = mat3(instanceModel) * inNormal;
+	vOut.worldTangent = mat3(instanceModel) * inTangent;
+    vOut.fragColor = inColor;
+	vOut.fragUV = inCoord;
+}
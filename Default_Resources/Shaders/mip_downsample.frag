@@ -0,0 +1,29 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform FragmentUniform
+{
+	vec2 texelSize;
+	vec2 sourceTexelSize;
+} ubo;
+
+layout(binding = 2) uniform sampler2D sourceSampler;
+
+vec4 Sample(vec2 uv)
+{
+	return texture(sourceSampler, clamp(uv, ubo.sourceTexelSize * 0.5, 1.0 - ubo.sourceTexelSize * 0.5));
+}
+
+// Dual filter downsample : the center and four diagonal bilinear taps cover a 4x4 texels footprint of the source
+void main()
+{
+	vec2 uv = gl_FragCoord.xy * ubo.texelSize;
+	vec2 halfTexel = ubo.texelSize * 0.5;
+	vec4 sum = Sample(uv) * 4.0;
+	sum += Sample(uv - halfTexel);
+	sum += Sample(uv + halfTexel);
+	sum += Sample(uv + vec2(halfTexel.x, -halfTexel.y));
+	sum += Sample(uv - vec2(halfTexel.x, -halfTexel.y));
+	outColor = sum / 8.0;
+}
@@ -0,0 +1,32 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform FragmentUniform
+{
+	vec2 texelSize;
+	vec2 sourceTexelSize;
+} ubo;
+
+layout(binding = 2) uniform sampler2D sourceSampler;
+
+vec4 Sample(vec2 uv)
+{
+	return texture(sourceSampler, clamp(uv, ubo.sourceTexelSize * 0.5, 1.0 - ubo.sourceTexelSize * 0.5));
+}
+
+// Dual filter upsample : a tent of eight bilinear taps around the pixel in the lower level
+void main()
+{
+	vec2 uv = gl_FragCoord.xy * ubo.texelSize;
+	vec2 halfTexel = ubo.texelSize * 0.5;
+	vec4 sum = Sample(uv + vec2(-halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv + vec2(-halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv + vec2(0.0, halfTexel.y * 2.0));
+	sum += Sample(uv + vec2(halfTexel.x, halfTexel.y)) * 2.0;
+	sum += Sample(uv + vec2(halfTexel.x * 2.0, 0.0));
+	sum += Sample(uv + vec2(halfTexel.x, -halfTexel.y)) * 2.0;
+	sum += Sample(uv + vec2(0.0, -halfTexel.y * 2.0));
+	sum += Sample(uv + vec2(-halfTexel.x, -halfTexel.y)) * 2.0;
+	outColor = sum / 12.0;
+}
@@ -0,0 +1,44 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outGlow;
+
+// Operations of Renderer::Uniform::PixelOperation, each fused sequence is its own pipeline
+const uint PIXEL_NONE = 0;
+const uint PIXEL_GAMMA_CORRECTION = 1;
+
+layout(constant_id = 1) const uint stage0 = PIXEL_NONE;
+layout(constant_id = 2) const uint stage1 = PIXEL_NONE;
+layout(constant_id = 3) const uint stage2 = PIXEL_NONE;
+layout(constant_id = 4) const uint stage3 = PIXEL_NONE;
+
+layout(push_constant) uniform PixelStages
+{
+	vec4 params[4];
+} stages;
+
+layout(binding = 2) uniform sampler2D colorSampler;
+layout(binding = 3) uniform sampler2D glowSampler;
+
+vec4 ApplyStage(uint operation, vec4 color, vec4 glow, vec4 params)
+{
+	if (operation == PIXEL_GAMMA_CORRECTION)
+	{
+		// exposure tone mapping then gamma correction, params = (exposure, gamma)
+		vec3 mapped = vec3(1.0) - exp(-(color.rgb + glow.rgb) * params.x);
+		return vec4(pow(mapped, vec3(1.0 / params.y)), 1.0);
+	}
+	return color;
+}
+
+void main()
+{
+	ivec2 pixelPos = ivec2(gl_FragCoord.xy);
+	outGlow = texelFetch(glowSampler, pixelPos, 0);
+	vec4 color = texelFetch(colorSampler, pixelPos, 0);
+	color = ApplyStage(stage0, color, outGlow, stages.params[0]);
+	color = ApplyStage(stage1, color, outGlow, stages.params[1]);
+	color = ApplyStage(stage2, color, outGlow, stages.params[2]);
+	color = ApplyStage(stage3, color, outGlow, stages.params[3]);
+	outColor = color;
+}
@@ -0,0 +1,13 @@
+#version 450
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec4 outSat;
+
+layout(binding = 2) uniform sampler2D albedoSampler;
+
+// Runs on the pixels the sky marked in the stencil instead of the light shader, the sky is not lit
+void main()
+{
+	outColor = texelFetch(albedoSampler, ivec2(gl_FragCoord.xy), 0);
+	outSat = vec4(0);
+}
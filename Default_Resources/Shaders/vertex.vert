@@ -4,6 +4,8 @@ layout(binding = 0) uniform VertexUniform
 {
     mat4 model;
     mat4 mvp;
+    vec3 cameraPos;
+    uint objectID;
 } ubo;
 
 layout(location = 0) in vec3 inPosition;
@@ -20,6 +22,7 @@ layout(location = 0) out VertexOutput
 	vec3 fragColor;
 	vec2 fragUV;
 } vOut;
+layout(location = 5) flat out uint vObjectID;
 
 void main()
 {
@@ -31,4 +34,5 @@ void main()
 	mat3 md = mat3(ubo.model);
 	vOut.worldNormal = md * inNormal;
 	vOut.worldTangent = md * inTangent;
+	vObjectID = ubo.objectID;
 }
@@ -2,10 +2,41 @@
 
 layout(location = 0) out vec4 outColor;
 
+// The last per-pixel post-process stages are folded into the blit, see post_pixel.frag
+const uint PIXEL_NONE = 0;
+const uint PIXEL_GAMMA_CORRECTION = 1;
+
+layout(constant_id = 1) const uint stage0 = PIXEL_NONE;
+layout(constant_id = 2) const uint stage1 = PIXEL_NONE;
+layout(constant_id = 3) const uint stage2 = PIXEL_NONE;
+layout(constant_id = 4) const uint stage3 = PIXEL_NONE;
+
+layout(push_constant) uniform PixelStages
+{
+	vec4 params[4];
+} stages;
+
 layout(binding = 0) uniform sampler2D colorSampler;
+layout(binding = 1) uniform sampler2D glowSampler;
+
+vec4 ApplyStage(uint operation, vec4 color, vec4 glow, vec4 params)
+{
+	if (operation == PIXEL_GAMMA_CORRECTION)
+	{
+		vec3 mapped = vec3(1.0) - exp(-(color.rgb + glow.rgb) * params.x);
+		return vec4(pow(mapped, vec3(1.0 / params.y)), 1.0);
+	}
+	return color;
+}
 
 void main()
 {
 	ivec2 pixelPos = ivec2(gl_FragCoord.xy);
     outColor = texelFetch(colorSampler, pixelPos, 0);
+	if (stage0 == PIXEL_NONE) return;
+	vec4 glow = texelFetch(glowSampler, pixelPos, 0);
+	outColor = ApplyStage(stage0, outColor, glow, stages.params[0]);
+	outColor = ApplyStage(stage1, outColor, glow, stages.params[1]);
+	outColor = ApplyStage(stage2, outColor, glow, stages.params[2]);
+	outColor = ApplyStage(stage3, outColor, glow, stages.params[3]);
 }
\ No newline at end of file
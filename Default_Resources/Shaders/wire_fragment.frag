@@ -23,10 +23,13 @@ layout(binding = 2) uniform sampler2D texSampler;
 layout(binding = 3) uniform sampler2D normSampler;
 layout(binding = 4) uniform sampler2D heightSampler;
 
+layout(constant_id = 0) const bool COMPACT_GBUFFER = false;
+
 void main()
 {
 	vec3 col = vOut.fragColor * ubo.matAmbient;
     outColor = vec4(col, 1.0);
 	outNormal = vec4(0, 0, 0, 0);
-	outPosition = vec4(vOut.worldPos, ubo.matShininess);
+	// Wires are unlit, the compact layout reads the lit flag from the material target
+	outPosition = COMPACT_GBUFFER ? vec4(0) : vec4(vOut.worldPos, ubo.matShininess);
 }
\ No newline at end of file
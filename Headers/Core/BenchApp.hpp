@@ -0,0 +1,34 @@
+#pragma once
+
+#include "App.hpp"
+
+namespace Core
+{
+	// Renders a cached scene without a window along a fixed camera path and reports the cost of each frame
+	class BenchApp final : public App
+	{
+	public :
+		BenchApp() = default;
+		~BenchApp() = default;
+
+		void Init() override;
+		void Run() override;
+		void Destroy() override;
+
+		u32 frameCount = 600;
+		// Frames excluded from the report, the first ones compile pipelines and fill the caches
+		u32 warmupFrames = 10;
+		// The output image is hashed every captureInterval frames and on the last one, 0 disables captures
+		u32 captureInterval = 60;
+		// 0 renders the default scene of the project settings
+		u64 sceneHash = 0;
+		// Zero keeps the resolution of the project settings
+		Maths::IVec2 resolution;
+		// The camera circles once around the origin over the run, looking at it
+		f32 orbitRadius = 10.0f;
+		f32 orbitHeight = 3.0f;
+
+	private:
+		void DefaultSamplerLoaded() override {}; //Nothing
+	};
+}
@@ -28,6 +28,9 @@ namespace Core::Scene::Components::Lights
 
 		static Renderer::VulkanRenderer* renderer;
 
+		// Distance at which the attenuation drops under the visible threshold
+		static f32 GetAttenuationRadius(f32 linear, f32 quadratic);
+
 		friend Renderer::VulkanRenderer;
 	};
 
@@ -29,6 +29,9 @@ namespace Core::Scene::Components::Lights
 		Maths::Vec3 Position = Maths::Vec3(0);
 		f32 Quadratic = 0.12f;
 		f32 Linear = 0.05f;
+		f32 Radius = 0.0f;
+
+		void UpdateRadius();
 
 		friend Renderer::VulkanRenderer;
 	};
@@ -32,6 +32,12 @@ namespace Core::Scene::Components::Lights
 		f32 Linear = 0.05f;
 		f32 Angle = 1.0f; // Angle is in radians
 		f32 Ratio = 0.05f; // Ratio between inner angle / outer angle : ratio of 0 is inner = outer
+		f32 Radius = 0.0f;
+		// Sphere enclosing the lit cone, centered at Position + Direction * BoundOffset
+		f32 BoundOffset = 0.0f;
+		f32 BoundRadius = 0.0f;
+
+		void UpdateBounds();
 
 		friend Renderer::VulkanRenderer;
 	};
@@ -39,9 +39,16 @@ namespace Core::Scene::Components
 		bool useCulling = true;
 		bool hideSecond = false;
 		bool hideFirst = false;
+	protected:
+		// Vertices written by the skinning pass for the mesh, drawn instead of its own when not null
+		virtual const Renderer::SkinnedVertexBuffer* GetSkinnedVertices(u64 index) const { return nullptr; }
+		// Shader, culling, materials and meshes settings, below the model selection
+		void RenderMeshGui();
 	private:
 
 		///Reference to the model used by the object, can be null.
 		Resources::Model* mUsedModel = nullptr;
+		///Level of detail of each mesh in the main view, other views switch relative to it.
+		std::vector<u32> mLodLevels;
 	};
 }
\ No newline at end of file
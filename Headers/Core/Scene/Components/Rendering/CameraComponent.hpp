@@ -17,6 +17,13 @@ namespace Core::Scene
 
 	namespace Components::Rendering
 	{
+		enum class CameraRefreshMode : u8
+		{
+			EVERY_FRAME = 0,
+			INTERVAL,
+			ON_DEMAND,
+		};
+
 		class NAT_API CameraComponent : public IComponent
 		{
 		public:
@@ -29,6 +36,13 @@ namespace Core::Scene
 			void Render(const Maths::Mat4& mvp, const Maths::Mat4& vp, const Maths::Mat4& modelOverride, const Maths::Frustum& cameraFrustum, LowRenderer::RenderPassType pass) override;
 
 			Maths::Mat4 GetVPMatrix() const;
+			// Called once per frame before the secondary passes, true if the camera wants a new image. Views no drawn
+			// texture sampled are culled by the frame graph afterwards
+			bool ShouldRefresh();
+			bool IsRenderedWhenHidden() const { return renderWhenHidden || refreshRequested; }
+			void OnRefreshed();
+			void RequestRefresh() { refreshRequested = true; }
+			u32 GetFramesSinceRefresh() const { return framesSinceRefresh; }
 
 			void RenderGui() override;
 
@@ -42,9 +56,15 @@ namespace Core::Scene
 		public:
 			LowRenderer::FrameBuffer* frameBuffer = nullptr;
 			LowRenderer::Rendering::Camera camera;
+			CameraRefreshMode refreshMode = CameraRefreshMode::EVERY_FRAME;
+			u32 refreshInterval = 2;
+			// By default nothing is rendered while no drawn texture sampled the framebuffer during the last frame
+			bool renderWhenHidden = false;
 
 		private:
 			Maths::IVec2 tmpResolution;
+			u32 framesSinceRefresh = 0;
+			bool refreshRequested = true;
 			static SceneManager* scenes;
 			static Resources::ShaderProgram* boxShader;
 		};
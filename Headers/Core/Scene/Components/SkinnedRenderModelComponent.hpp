@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include "RenderModelComponent.hpp"
+
+#include "Resources/SkinnedModel.hpp"
+
+namespace Renderer
+{
+	class VulkanRenderer;
+}
+
+namespace Core::Scene::Components
+{
+	// Model moved by the animations of a SkinnedModel. The meshes are skinned once per frame before the views, which all
+	// draw the same skinned vertices
+	class NAT_API SkinnedRenderModelComponent : public RenderModelComponent
+	{
+	public:
+		SkinnedRenderModelComponent();
+		~SkinnedRenderModelComponent() override = default;
+
+		void UseSkinnedModel(Resources::SkinnedModel* pModel);
+
+		void Update() override;
+		void DataUpdate() override;
+		IComponent* CreateCopy() override;
+
+		void RenderGui() override;
+
+		ComponentType GetType() override;
+		void Serialize(Core::Serialization::Serializer& sr) const override;
+		void Deserialize(Core::Serialization::Deserializer& dr) override;
+		const char* GetName() override { return "Skinned Model"; }
+		void Delete() override;
+
+		// Evaluates the pose and the bone matrices of the meshes, only touches this component
+		void UpdatePose();
+		// Records the skinning of the meshes, between VulkanRenderer::BeginSkinning and EndSkinning
+		void Skin(Renderer::VulkanRenderer& renderer);
+
+		u32 animation = 0;
+		// Seconds, the animation loops over its duration
+		f32 time = 0.0f;
+		f32 speed = 1.0f;
+		bool playing = true;
+	protected:
+		const Renderer::SkinnedVertexBuffer* GetSkinnedVertices(u64 index) const override;
+	private:
+		Resources::SkinnedModel* mUsedSkinnedModel = nullptr;
+		std::vector<Maths::Mat4> mPose;
+		// One matrix per bone of each mesh, empty for the meshes that are not skinned
+		std::vector<std::vector<Maths::Mat4>> mBoneMatrices;
+		std::vector<Renderer::SkinnedVertexBuffer> mSkinnedVertices;
+	};
+}
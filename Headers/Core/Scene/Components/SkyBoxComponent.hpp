@@ -10,6 +10,11 @@ namespace Resources
 	class CubeMap;
 }
 
+namespace LowRenderer::Rendering
+{
+	class Camera;
+}
+
 namespace Core::Scene::Components
 {
 	class NAT_API SkyBoxComponent : public IComponent
@@ -18,7 +23,9 @@ namespace Core::Scene::Components
 		SkyBoxComponent();
 		~SkyBoxComponent() override = default;
 
-		void Render(const Maths::Mat4& mvp, const Maths::Mat4& vp, const Maths::Mat4& modelOverride, const Maths::Frustum& cameraFrustum, LowRenderer::RenderPassType pass) override;
+		// Nothing is drawn with the scene, the sky is drawn by the scene manager once the view is done and picked where
+		// no object was drawn
+		void DataUpdate() override;
 		IComponent* CreateCopy() override;
 
 		virtual void RenderGui() override;
@@ -28,6 +35,8 @@ namespace Core::Scene::Components
 		virtual void Deserialize(Core::Serialization::Deserializer& dr) override;
 		const char* GetName() override { return "SkyBox"; }
 		virtual void Delete() override;
+		// Draws the sky where nothing covered the view, stencilValue being the portal level it is seen from
+		void DrawSky(const LowRenderer::Rendering::Camera& camera, u8 stencilValue);
 
 		Resources::CubeMap* cubeMap = nullptr;
 		Resources::ShaderProgram* skyShader = nullptr;
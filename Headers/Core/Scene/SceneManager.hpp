@@ -6,6 +6,8 @@
 #include "LowRenderer/Rendering/FlyingCamera.hpp"
 #include "Components/Rendering/CameraComponent.hpp"
 #include "Components/Rendering/PortalBaseComponent.hpp"
+#include "Components/SkyBoxComponent.hpp"
+#include "Components/SkinnedRenderModelComponent.hpp"
 #include "LowRenderer/PostProcess/PostProcessManager.hpp"
 #include "Wrappers/PhysicsEngine/IPhysicsEngine.hpp"
 
@@ -65,10 +67,14 @@ namespace Core
 			void Init();
 			void Render();
 			void Update(Maths::IVec2 resolution, Wrappers::IPhysicsEngine* pPhysicEngine);
+			// Refreshes the scene data without simulating it and places the main camera, nothing is read from the window
+			void UpdateScripted(Maths::IVec2 resolution, Maths::Vec3 position, Maths::Vec3 focus);
 			void Clean();
 
 			void PushRenderCamera(Components::Rendering::CameraComponent* component);
 			void PushPortalObject(Components::Rendering::PortalBaseComponent* component);
+			void PushSkyBox(Components::SkyBoxComponent* component);
+			void PushSkinnedModel(Components::SkinnedRenderModelComponent* component);
 			bool IsPlaying() const;
 			bool HasUnsavedScenes() const;
 
@@ -90,7 +96,12 @@ namespace Core
 			LowRenderer::Rendering::Camera* currentCamera = nullptr;
 			u64 selectedScene = ~0;
 			u8 maxPortalRecurrence = 2;
-			u64 maxPortalCount = 128;
+			// Portals covering less than this fraction of the screen are not rendered
+			f32 minPortalCoverage = 0.0005f;
+			// Screen area all the portal views of a camera may cover together, in full screens
+			f32 portalCoverageBudget = 4.0f;
+			// Milliseconds of recording the render cameras may take per frame, at least one due camera is always drawn
+			f64 secondaryCameraBudget = 2.0;
 			u64 drawnPortals = 0;
 			u8 drawnRecurrence = 0;
 			LowRenderer::PostProcess::PostProcessManager postManager;
@@ -99,19 +110,29 @@ namespace Core
 			PlayMode playMode = PlayMode::EDITION;
 			std::vector<Components::Rendering::CameraComponent*> registeredCameras;
 			std::vector<Components::Rendering::PortalBaseComponent*> registeredPortals;
+			std::vector<Components::SkyBoxComponent*> registeredSkyBoxes;
+			std::vector<Components::SkinnedRenderModelComponent*> registeredSkinnedModels;
 			std::vector<SceneSaveData> savedSceneData;
 			Renderer::VulkanRenderer* renderer = nullptr;
 			Wrappers::WindowManager* window = nullptr;
 			GameObject* clickedObject = nullptr;
 			bool clickScene = false;
-			bool clickSceneRendered = false;
+			bool clickPending = false;
 			bool mainCameraUpReset = false;
 			Maths::IVec2 clickedPos;
+			// Objects of the ids written by the main view, and the ones of the frame the last click was read from
 			std::vector<GameObject*> drawnObjects;
+			std::vector<GameObject*> pickedObjects;
+			// Picked where no object was drawn
+			GameObject* pickedSky = nullptr;
 			Maths::Vec3 clearColor;
 			static SceneManager* mInstance;
 
-			void RenderPortals(const LowRenderer::Rendering::Camera& cam, const Maths::Mat4& vp, const Maths::Mat4& m, Maths::Vec4 screenBounds, u64& drawnPortals, u8 recurrence);
+			void RenderPortals(const LowRenderer::Rendering::Camera& cam, const Maths::Mat4& vp, const Maths::Mat4& m, Maths::Vec4 screenBounds, u64& drawnPortals, f32& coverage, u8 recurrence);
+			// Drawn last in each view so only the pixels left uncovered shade it
+			void RenderSky(const LowRenderer::Rendering::Camera& cam, u8 stencilValue);
+			// Poses are evaluated on the worker threads, then every mesh is skinned once for all the views of the frame
+			void SkinModels();
 			bool ShouldRenderColliders();
 
 			friend Core::App;
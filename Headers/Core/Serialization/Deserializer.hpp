@@ -41,6 +41,7 @@ namespace Core::Serialization
 		bool Read(Maths::IVec2& in);
 		bool Read(Maths::IVec3& in);
 		bool Read(Maths::Quat& in);
+		bool Read(Maths::Mat4& in);
 		bool Read(Maths::AABB& in);
 		bool Read(Maths::Frustum& in);
 		bool Read(u8* dataIn, u64 dataSize);
@@ -42,6 +42,7 @@ namespace Core::Serialization
 		void Write(Maths::IVec2 in);
 		void Write(const Maths::IVec3& in);
 		void Write(const Maths::Quat& in);
+		void Write(const Maths::Mat4& in);
 		void Write(const Maths::AABB& in);
 		void Write(const Maths::Frustum& in);
 		void Write(const u8* dataIn, u64 dataSize);
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+#include "Types.hpp"
+
+#ifdef NAT_EngineDLL
+	#define NAT_API __declspec(dllexport)
+#else
+	#define NAT_API __declspec(dllimport)
+#endif // NAT_EngineDLL
+
+#pragma warning(disable:4251)
+
+namespace Core
+{
+	class NAT_API ThreadPool
+	{
+	public:
+		ThreadPool();
+		~ThreadPool();
+
+		// Starts the workers, a count of 0 uses the hardware concurrency minus the calling thread
+		void Init(u32 threadCount = 0);
+		void Destroy();
+		u32 GetThreadCount() const;
+
+		// Runs task(index) for every index in [0, count) on the workers and blocks until all of them are done
+		void ParallelFor(u32 count, const std::function<void(u32)>& task);
+	private:
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wakeCondition;
+		std::condition_variable doneCondition;
+		const std::function<void(u32)>* currentTask = nullptr;
+		u64 generation = 0;
+		u32 taskCount = 0;
+		u32 nextTask = 0;
+		u32 remainingTasks = 0;
+		bool stopping = false;
+
+		void WorkerLoop();
+	};
+}
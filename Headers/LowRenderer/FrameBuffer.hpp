@@ -12,6 +12,14 @@ namespace Renderer
 
 namespace LowRenderer
 {
+	// FULL keeps float albedo, normal and position targets, COMPACT stores sRGB albedo, octahedral normals and packed material
+	// parameters, the position being rebuilt from the depth buffer in the light pass
+	enum class GBufferLayout : u8
+	{
+		FULL = 0,
+		COMPACT,
+	};
+
 	class NAT_API FrameBuffer : public Resources::Texture
 	{
 	public:
@@ -32,6 +40,10 @@ namespace LowRenderer
 		void ResetBuffer();
 		void ToggleBuffer();
 		Maths::IVec2 GetResolution() const;
+		GBufferLayout GetGBufferLayout() const { return gbufferLayout; }
+		void SetGBufferLayout(GBufferLayout layout);
+		// True if the texture was fetched for drawing since the last call
+		bool TakeSampled();
 		Maths::Vec4 ClearColor = Maths::Vec4(0,0,0,1);
 	private:
 		Renderer::RendererFrameBuffer fb;
@@ -39,18 +51,27 @@ namespace LowRenderer
 		Renderer::RendererBuffer gb[3];
 		Renderer::RendererBuffer nb;
 		Renderer::RendererBuffer pb;
+		// Object ids of the geometry pass, only read back for the main frame buffer
+		Renderer::RendererBuffer ib;
 		Renderer::RendererDepthBuffer db;
 		Renderer::RendererFrameBuffer old_fb;
 		Renderer::RendererFrameBuffer old_lb[3];
 		Renderer::RendererBuffer old_gb[3];
 		Renderer::RendererBuffer old_nb;
 		Renderer::RendererBuffer old_pb;
+		Renderer::RendererBuffer old_ib;
 		Renderer::RendererDepthBuffer old_db;
 
+		GBufferLayout gbufferLayout = GBufferLayout::FULL;
 		u8 resize = 0;
 		u8 actualBuffer = 0;
+		mutable bool sampled = false;
 		static Renderer::VulkanRenderer* renderer;
 
+		// Hands the targets to the deferred deletion queue, which frees them once the frames using them completed
+		void RetireTargets();
+		void RetireOldTargets();
+
 		friend Core::App;
 		friend Renderer::VulkanRenderer;
 	};
@@ -21,14 +21,15 @@ namespace LowRenderer::PostProcess
 
 		EffectType GetType();
 		void Serialize(Core::Serialization::Serializer& sr);
-		void Deserialize(Core::Serialization::Deserializer& dr);
+		void Deserialize(Core::Serialization::Deserializer& dr, u8 version);
 
 		PostProcessEffect* CreateCopy() const override;
 
 	private:
-		u32 passCount = 6;
+		// Number of mip chain levels the bloom goes through
+		u32 radius = 5;
+		f32 intensity = 1.0f;
 		Maths::IVec2 bufferResolution;
-		bool vertical = false;
 	};
 
 }
\ No newline at end of file
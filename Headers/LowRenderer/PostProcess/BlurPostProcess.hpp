@@ -21,14 +21,14 @@ namespace LowRenderer::PostProcess
 
 		EffectType GetType();
 		void Serialize(Core::Serialization::Serializer& sr);
-		void Deserialize(Core::Serialization::Deserializer& dr);
+		void Deserialize(Core::Serialization::Deserializer& dr, u8 version);
 
 		PostProcessEffect* CreateCopy() const override;
 
 	private:
-		u32 passCount = 6;
+		// Number of mip chain levels the blur goes through
+		u32 radius = 5;
 		Maths::IVec2 bufferResolution;
-		bool vertical = false;
 	};
 
 }
\ No newline at end of file
@@ -17,11 +17,14 @@ namespace LowRenderer::PostProcess
 
 		void FillBuffer(void* dest) const override;
 
+		bool IsPerPixel() const override { return true; }
+		void AppendPixelStage(Renderer::Uniform::PixelStages& stages) const override;
+
 		const char* GetEffectName() const override { return "Gamma Correction"; }
 
 		EffectType GetType();
 		void Serialize(Core::Serialization::Serializer& sr);
-		void Deserialize(Core::Serialization::Deserializer& dr);
+		void Deserialize(Core::Serialization::Deserializer& dr, u8 version);
 
 		PostProcessEffect* CreateCopy() const override;
 
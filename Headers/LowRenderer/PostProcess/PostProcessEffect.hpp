@@ -12,6 +12,11 @@ namespace Resources
 namespace Renderer
 {
 	class VulkanRenderer;
+
+	namespace Uniform
+	{
+		struct PixelStages;
+	}
 }
 
 namespace Wrappers
@@ -46,13 +51,19 @@ namespace LowRenderer
 			virtual EffectType GetType() = 0;
 
 			virtual void Serialize(Core::Serialization::Serializer& sr) = 0;
-			virtual void Deserialize(Core::Serialization::Deserializer& dr) = 0;
+			// Version is the one of the layout the effect was written with, see PostProcessManager::Serialize
+			virtual void Deserialize(Core::Serialization::Deserializer& dr, u8 version) = 0;
 
 			virtual PostProcessEffect* CreateCopy() const = 0;
 
 			virtual const char* GetEffectName() const = 0;
 
 			virtual void FillBuffer(void* dest) const = 0;
+
+			// Effects that only read their own pixel are fused with their per-pixel neighbours into a single pass
+			virtual bool IsPerPixel() const { return false; }
+			virtual void AppendPixelStage(Renderer::Uniform::PixelStages& stages) const {}
+
 			Resources::ShaderProgram* GetShader() const;
 		protected:
 			Resources::ShaderProgram* shader = nullptr;
@@ -707,6 +707,9 @@ namespace Maths
         Vec4 left;
         Vec4 front;
         Vec4 back;
+
+        // Moves the side planes to the given rectangle of the screen, in normalized device coordinates of vp
+        void ClipToScreen(const Mat4& vp, const Vec4& screenBounds);
     };
 
     class NAT_API AABB
@@ -721,6 +724,8 @@ namespace Maths
 
         bool IsOnFrustum(const Frustum& camFrustum, const Maths::Mat4& transform) const;
         bool IsOnOrForwardPlane(const Vec4& plane) const;
+        // Largest side in pixels of the screen rectangle covered by the box, infinite when it crosses the camera plane
+        f32 GetScreenSize(const Mat4& mvp, Vec2 resolution) const;
     };
 
     namespace Util
@@ -781,6 +786,11 @@ namespace Maths
 
         inline NAT_API u64 ReadHex(const std::string& input);
 
+        // Converts to IEEE 754 half precision, rounding to nearest even
+        inline NAT_API u16 FloatToHalf(f32 in);
+
+        inline NAT_API f32 HalfToFloat(u16 in);
+
         void NAT_API GenerateSphere(s32 x, s32 y, std::vector<Vec3>* PosOut, std::vector<Vec3>* NormOut, std::vector<Vec2>* UVOut);
 
         void NAT_API GenerateCube(std::vector<Vec3>* PosOut, std::vector<Vec3>* NormOut, std::vector<Vec2>* UVOut);
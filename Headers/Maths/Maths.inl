@@ -1,4 +1,5 @@
 #include <cstdio>
+#include <cstring>
 
 #include "Maths.hpp"
 
@@ -1354,6 +1355,75 @@ namespace Maths
         return result;
     }
 
+    inline u16 Util::FloatToHalf(f32 in)
+    {
+        u32 bits;
+        memcpy(&bits, &in, sizeof(u32));
+        u32 sign = (bits >> 16) & 0x8000;
+        u32 rawExponent = (bits >> 23) & 0xff;
+        u32 mantissa = bits & 0x7fffff;
+        if (rawExponent == 0xff)
+            return static_cast<u16>(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+        s32 exponent = static_cast<s32>(rawExponent) - 127 + 15;
+        if (exponent >= 31)
+            return static_cast<u16>(sign | 0x7c00);
+        u32 half, rest, midpoint;
+        if (exponent <= 0)
+        {
+            // Subnormal half, or zero when too small
+            if (exponent < -10)
+                return static_cast<u16>(sign);
+            mantissa |= 0x800000;
+            u32 shift = static_cast<u32>(14 - exponent);
+            half = mantissa >> shift;
+            rest = mantissa & ((1u << shift) - 1);
+            midpoint = 1u << (shift - 1);
+        }
+        else
+        {
+            half = (static_cast<u32>(exponent) << 10) | (mantissa >> 13);
+            rest = mantissa & 0x1fff;
+            midpoint = 0x1000;
+        }
+        // A carry out of the mantissa correctly moves to the next exponent, up to infinity
+        if (rest > midpoint || (rest == midpoint && (half & 1)))
+            half++;
+        return static_cast<u16>(sign | half);
+    }
+
+    inline f32 Util::HalfToFloat(u16 in)
+    {
+        u32 sign = static_cast<u32>(in & 0x8000) << 16;
+        u32 exponent = (in >> 10) & 0x1f;
+        u32 mantissa = in & 0x3ff;
+        u32 bits;
+        if (exponent == 0x1f)
+        {
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else if (exponent)
+        {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        else if (mantissa)
+        {
+            exponent = 113;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+        else
+        {
+            bits = sign;
+        }
+        f32 result;
+        memcpy(&result, &bits, sizeof(f32));
+        return result;
+    }
+
 #pragma endregion
 
 }
\ No newline at end of file
@@ -26,6 +26,8 @@ namespace Renderer
 		Maths::IVec2 GetResolution() const { return resolution; }
 
 		RendererTexture texture;
+		// Layout left by the last pass or barrier touching the image, the light pass of a compact G-buffer samples it
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
 	private:
 		Maths::IVec2 resolution;
 	};
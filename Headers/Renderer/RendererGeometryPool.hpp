@@ -0,0 +1,53 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <mutex>
+
+#include "Core/Types.hpp"
+#include "RendererMesh.hpp"
+#include "RendererVertex.hpp"
+
+namespace Renderer
+{
+	class VulkanRenderer;
+
+	// Shared vertex and index buffers that static meshes are sub-allocated from, so that every GPU driven draw uses the same bindings
+	class NAT_API RendererGeometryPool
+	{
+	public:
+		RendererGeometryPool() = default;
+		~RendererGeometryPool() = default;
+
+		void CreatePool(VulkanRenderer& renderer, u32 vertexCapacity, u32 indexCapacity);
+		void DestroyPool(VkDevice& device);
+
+		bool Upload(VulkanRenderer& renderer, RendererMesh& mesh, const RendererVertex* pVertices, u32 vertexCount, const u32* pIndices, u32 indexCount);
+		// Ranges are handed back once the frames that may still read them are retired
+		void Release(VulkanRenderer& renderer, RendererMesh& mesh);
+
+		VkBuffer GetVertexBuffer() const { return vertices.handle; }
+		VkBuffer GetIndexBuffer() const { return indices.handle; }
+
+	private:
+		struct SharedBuffer
+		{
+			VkBuffer handle = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			u32 capacity = 0;
+			std::vector<GeometryRange> freeRanges;
+		};
+
+		SharedBuffer vertices;
+		SharedBuffer indices;
+		std::mutex poolMutex;
+
+		void CreateSharedBuffer(VulkanRenderer& renderer, SharedBuffer& buffer, u32 capacity, u64 elementSize, VkBufferUsageFlags usage);
+		bool Allocate(SharedBuffer& buffer, u32 count, GeometryRange& range);
+		void Grow(VulkanRenderer& renderer, SharedBuffer& buffer, u32 minCount, u64 elementSize, VkBufferUsageFlags usage);
+		void Free(SharedBuffer& buffer, GeometryRange range);
+		void Write(VulkanRenderer& renderer, SharedBuffer& buffer, const void* data, GeometryRange range, u64 elementSize);
+	};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+#include "Core/Types.hpp"
+#include "Maths/Maths.hpp"
+#include "RendererPipeline.hpp"
+
+namespace Renderer
+{
+	class VulkanRenderer;
+	class RendererDepthBuffer;
+
+	// Depth pyramid of the main frame buffer, each level keeps the farthest depth of the texels it covers
+	class NAT_API RendererHiZBuffer
+	{
+	public:
+		RendererHiZBuffer() = default;
+		~RendererHiZBuffer() = default;
+
+		// Recreates the pyramid if the depth buffer changed, returns true if it still holds the result of a previous build
+		bool Prepare(VulkanRenderer& renderer, RendererDepthBuffer& depth);
+		// Reduces the depth buffer into the pyramid, the depth buffer is left in shader read only layout
+		void Build(VulkanRenderer& renderer, VkCommandBuffer cmd, RendererDepthBuffer& depth, const RendererPipeline& reducePipeline);
+		void DestroyHiZBuffer(VulkanRenderer& renderer, bool deferred);
+
+		bool IsCreated() const { return image != VK_NULL_HANDLE; }
+		VkImageView GetImageView() const { return view; }
+		Maths::IVec2 GetResolution() const { return resolution; }
+		u32 GetMipCount() const { return mipCount; }
+		// Matrix the pyramid content was rendered with, only valid until the next Build call
+		const Maths::Mat4& GetViewProjection() const { return viewProjection; }
+		void SetViewProjection(const Maths::Mat4& vp) { viewProjection = vp; }
+
+	private:
+		VkImage image = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		std::vector<VkImageView> mipViews;
+		VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> reduceSets;
+		VkImage source = VK_NULL_HANDLE;
+		Maths::IVec2 sourceResolution;
+		Maths::IVec2 resolution;
+		u32 mipCount = 0;
+		bool initialized = false;
+		Maths::Mat4 viewProjection;
+
+		void CreateHiZBuffer(VulkanRenderer& renderer, RendererDepthBuffer& depth);
+	};
+}
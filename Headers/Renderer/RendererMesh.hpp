@@ -3,6 +3,7 @@
 #include "vulkan/vulkan_core.h"
 
 #include "IRendererResource.hpp"
+#include "RendererVertex.hpp"
 
 namespace Renderer
 {
@@ -16,6 +17,21 @@ namespace Renderer
 
 	typedef VertexBuffer IndiceBuffer;
 
+	// Vertices of a skinned mesh moved to the pose of one instance, written by the skinning pass of the frame and read
+	// by every view drawing the instance
+	struct SkinnedVertexBuffer
+	{
+		VertexBuffer buffer = {};
+		u32 vertexCount = 0;
+	};
+
+	// Element range inside one of the shared geometry buffers, count is 0 when not resident
+	struct GeometryRange
+	{
+		u32 offset	= 0;
+		u32 count	= 0;
+	};
+
 	//
 
 	class NAT_API RendererMesh : public IRendererResource
@@ -23,6 +39,23 @@ namespace Renderer
 	public:
 		VertexBuffer vertexBuffer = {};
 		IndiceBuffer indexBuffer = {};
+		// Bone indices and weights of skinned meshes, see Resources::SkinWeight
+		VertexBuffer skinBuffer = {};
+		GeometryRange sharedVertices = {};
+		GeometryRange sharedIndices = {};
+		VertexLayout vertexLayout = VertexLayout::FULL;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		// Restores the positions of packed vertices, center + pos * scale
+		Maths::Vec3 quantizationCenter;
+		f32 quantizationScale = 1.0f;
+
+		u32 GetIndexSize() const { return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(u16) : sizeof(u32); }
+		// Model or model view projection matrix to use for the vertices as stored in the vertex buffer
+		Maths::Mat4 Dequantize(const Maths::Mat4& matrix) const
+		{
+			if (vertexLayout != VertexLayout::PACKED) return matrix;
+			return matrix * Maths::Mat4::CreateTranslationMatrix(quantizationCenter) * Maths::Mat4::CreateScaleMatrix(Maths::Vec3(quantizationScale));
+		}
 	private :
 	};
 }
\ No newline at end of file
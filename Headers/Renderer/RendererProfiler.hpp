@@ -0,0 +1,122 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "Core/Types.hpp"
+
+// Scopes a frame can time, extra scopes are ignored
+#define PROFILER_MAX_SCOPES 256
+// Frames the average and maximum times of the profiler table are computed over
+#define PROFILER_HISTORY 64
+
+namespace Renderer
+{
+	class VulkanRenderer;
+
+	// Pipeline statistics of a scope, zero when the device cannot query them
+	struct ProfilerStatistics
+	{
+		u64 inputVertices = 0;
+		u64 inputPrimitives = 0;
+		u64 vertexInvocations = 0;
+		u64 clippedPrimitives = 0;
+		u64 fragmentInvocations = 0;
+		u64 computeInvocations = 0;
+	};
+
+	// Scopes of one frame with the same name and depth, in the order they were opened
+	struct ProfilerResult
+	{
+		std::string name;
+		u32 depth = 0;
+		u32 count = 0;
+		// Milliseconds, time is the one of the last read back frame
+		f64 time = 0;
+		f64 averageTime = 0;
+		f64 maxTime = 0;
+		bool hasStatistics = false;
+		ProfilerStatistics statistics;
+	};
+
+	// GPU timestamps and pipeline statistics of named scopes, read back once the frame slot is retired so the CPU never
+	// waits on the queries. A single statistics query can be active at once, nested scopes only get timestamps
+	class NAT_API RendererProfiler
+	{
+	public:
+		RendererProfiler() = default;
+		~RendererProfiler() = default;
+
+		void Create(VulkanRenderer& renderer);
+		void Destroy(VulkanRenderer& renderer);
+
+		// Reads back the scopes the frame slot recorded last time and resets its queries, cmd must be outside of a render pass
+		void BeginFrame(VkCommandBuffer cmd, u32 frame);
+		// Returns the scope opened, ~0u when the profiler is disabled or the frame is out of queries
+		u32 PushScope(const std::string& name, bool useStatistics);
+		// Returns the scope closed, ~0u when no scope was opened by the matching PushScope
+		u32 PopScope();
+		// Writes the begin or end timestamp of the scope, and starts or stops its statistics query
+		void WriteScope(VkCommandBuffer cmd, u32 scope, bool end);
+
+		// Takes effect at the next BeginFrame so scopes stay balanced within a frame
+		void SetEnabled(bool value) { requestEnabled = value; }
+		bool IsEnabled() const { return requestEnabled; }
+		bool IsSupported() const { return timestampPool != VK_NULL_HANDLE; }
+		bool HasStatistics() const { return statisticsPool != VK_NULL_HANDLE; }
+		VkQueryPipelineStatisticFlags GetStatisticFlags() const { return statisticsPool ? statisticFlags : 0; }
+		const std::vector<ProfilerResult>& GetResults() const { return results; }
+		// Writes the current results as comma separated values, returns false if the file cannot be opened
+		bool ExportCSV(const std::string& path) const;
+
+	private:
+		struct Scope
+		{
+			std::string name;
+			u32 depth = 0;
+			// Index of the statistics query of the frame, ~0u if the scope has none
+			u32 statistics = ~0u;
+		};
+
+		struct FrameScopes
+		{
+			std::vector<Scope> scopes;
+			u32 statisticsCount = 0;
+		};
+
+		struct History
+		{
+			f64 times[PROFILER_HISTORY] = {};
+			u32 cursor = 0;
+			u32 count = 0;
+		};
+
+		static constexpr VkQueryPipelineStatisticFlags statisticFlags = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT | VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+			VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+
+		VkDevice device = VK_NULL_HANDLE;
+		VkQueryPool timestampPool = VK_NULL_HANDLE;
+		VkQueryPool statisticsPool = VK_NULL_HANDLE;
+		// Nanoseconds per timestamp tick
+		f64 timestampPeriod = 1.0;
+		u64 timestampMask = ~0llu;
+		bool enabled = false;
+		bool requestEnabled = false;
+		u32 currentFrame = 0;
+		std::vector<FrameScopes> frames;
+		std::vector<u32> stack;
+		// Open scope holding the statistics query, ~0u if none
+		u32 statisticsScope = ~0u;
+		std::vector<u64> timestamps;
+		std::vector<ProfilerStatistics> statistics;
+		std::vector<ProfilerResult> results;
+		std::unordered_map<std::string, History> history;
+
+		void ReadResults(u32 frame);
+	};
+}
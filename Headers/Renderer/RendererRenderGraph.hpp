@@ -0,0 +1,131 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <functional>
+
+#include "Core/Types.hpp"
+#include "Maths/Maths.hpp"
+#include "RendererFrameBuffer.hpp"
+
+namespace Renderer
+{
+	class VulkanRenderer;
+
+	typedef u32 RenderGraphResource;
+
+	struct RenderGraphTextureDesc
+	{
+		Maths::IVec2 resolution;
+		VkFormat format = VK_FORMAT_UNDEFINED;
+	};
+
+	// Device memory shared by the transient textures of every render graph, a block is handed to another texture once
+	// the last pass using its previous one has run
+	class NAT_API RendererTransientPool
+	{
+	public:
+		RendererTransientPool() = default;
+		~RendererTransientPool() = default;
+
+		// Marks every block as free, the textures of the previous graph are dead once the next one starts
+		void BeginGraph();
+		// Returns the image of the description bound to a block free from firstPass to lastPass
+		u32 Acquire(VulkanRenderer& renderer, const RenderGraphTextureDesc& desc, u32 firstPass, u32 lastPass);
+		// Releases the blocks that have not been used for a few frames
+		void EndFrame(VulkanRenderer& renderer);
+		void DestroyPool(VulkanRenderer& renderer);
+
+		// Transient textures are written through a single color attachment pass, one per format
+		VkRenderPass GetRenderPass(VulkanRenderer& renderer, VkFormat format);
+		RendererFrameBuffer& GetFrameBuffer(u32 image) { return images[image].target; }
+		VkImageLayout& GetLayout(u32 image) { return images[image].layout; }
+
+	private:
+		struct TransientBlock
+		{
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize size = 0;
+			u32 memoryType = 0;
+			u32 unusedFrames = 0;
+			// Last pass of the current graph using the block, -1 when free
+			s32 busyUntil = -1;
+		};
+
+		struct TransientImage
+		{
+			RendererFrameBuffer target;
+			RenderGraphTextureDesc desc;
+			VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+			u32 block = 0;
+		};
+
+		u32 CreateImage(VulkanRenderer& renderer, const RenderGraphTextureDesc& desc, u32 firstPass);
+
+		std::vector<TransientBlock> blocks;
+		std::vector<TransientImage> images;
+		std::vector<std::pair<VkFormat, VkRenderPass>> renderPasses;
+	};
+
+	// Passes declared with the textures they read and write, run in declaration order. Passes whose results are never
+	// read are culled, transient textures are placed in the pool for their lifetime only and the layout transitions
+	// between their writers and readers are inserted before each pass.
+	// The frame graph of the renderer holds the geometry, shading and window passes of every view, their targets are
+	// imported since camera textures and editor views sample them after the frame. The bloom and blur mip chains are
+	// built through a graph of their own while a shading pass of the frame graph runs
+	class NAT_API RendererRenderGraph
+	{
+	public:
+		RendererRenderGraph() = default;
+		~RendererRenderGraph() = default;
+
+		void Reset();
+		RenderGraphResource CreateTexture(const RenderGraphTextureDesc& desc);
+		// Imported textures are synchronized by the render passes owning them, their writers are culled unless they are
+		// read or extracted
+		RenderGraphResource ImportTexture(const RendererTexture* texture, Maths::IVec2 resolution);
+		u32 AddPass(std::function<void()> execute);
+		void Read(u32 pass, RenderGraphResource resource);
+		void Write(u32 pass, RenderGraphResource resource);
+		// Keeps a transient texture alive and readable after the graph, until another graph runs on the same pool. An
+		// extracted imported texture keeps its writers
+		void Extract(RenderGraphResource resource);
+
+		void Execute(VulkanRenderer& renderer, RendererTransientPool& pool, VkCommandBuffer cmd);
+
+		// Only valid while the graph is executed, or afterwards for extracted textures
+		const RendererTexture* GetTexture(RenderGraphResource resource) const;
+		RendererFrameBuffer& GetFrameBuffer(RenderGraphResource resource);
+		Maths::IVec2 GetResolution(RenderGraphResource resource) const { return resources[resource].desc.resolution; }
+
+	private:
+		struct GraphResource
+		{
+			RenderGraphTextureDesc desc;
+			const RendererTexture* imported = nullptr;
+			std::vector<u32> writers;
+			u32 refCount = 0;
+			bool extracted = false;
+			u32 firstPass = ~0u;
+			u32 lastPass = 0;
+			u32 image = ~0u;
+		};
+
+		struct GraphPass
+		{
+			std::function<void()> execute;
+			std::vector<RenderGraphResource> reads;
+			std::vector<RenderGraphResource> writes;
+			u32 refCount = 0;
+		};
+
+		void Compile();
+		void TransitionResources(VkCommandBuffer cmd, const GraphPass& pass);
+
+		std::vector<GraphResource> resources;
+		std::vector<GraphPass> passes;
+		RendererTransientPool* pool = nullptr;
+	};
+}
@@ -47,4 +47,11 @@ namespace Renderer
 		GeometryRendererShader();
 		~GeometryRendererShader() = default;
 	};
+
+	class NAT_API ComputeRendererShader : public RendererShader
+	{
+	public:
+		ComputeRendererShader();
+		~ComputeRendererShader() = default;
+	};
 }
\ No newline at end of file
@@ -17,6 +17,11 @@ namespace Renderer
 		void DeleteShaderProgram(VkDevice& device);
 		
 		RendererPipeline pipeline = {};
+		// Same program built for the compact G-buffer render passes, only created for geometry and light targets
+		RendererPipeline compactPipeline = {};
+		// Same pipelines reading VertexLayout::PACKED vertices, only created for geometry and object targets
+		RendererPipeline packedPipeline = {};
+		RendererPipeline packedCompactPipeline = {};
 
 		const VertexRendererShader* vertex = nullptr;
 		const FragmentRendererShader* fragment = nullptr;
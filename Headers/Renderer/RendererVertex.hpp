@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <vector>
 
 #include "Maths/Maths.hpp"
 
@@ -10,6 +11,12 @@
 
 namespace Renderer
 {
+	enum class VertexLayout : u8
+	{
+		FULL = 0,
+		PACKED,
+	};
+
 	//TODO : Vertex : This is not a IRendererResource. We can move this to general types !
 	class NAT_API RendererVertex : IRendererResource
 	{
@@ -27,9 +34,24 @@ namespace Renderer
 		~RendererVertex() = default;
 		
 		//TODO : vertex : Move this to renderer
-		static VkVertexInputBindingDescription GetBindingDescription();
-		static std::array<VkVertexInputAttributeDescription, 5> GetAttributeDescriptions();
+		static VkVertexInputBindingDescription GetBindingDescription(VertexLayout layout = VertexLayout::FULL);
+		static std::array<VkVertexInputAttributeDescription, 5> GetAttributeDescriptions(VertexLayout layout = VertexLayout::FULL);
 	
 	private :
 	};
+
+	// Vertex of VertexLayout::PACKED, 24 bytes instead of 56. Every attribute is converted back to floats by the vertex
+	// input stage, so the same shaders read both layouts. Positions are snorm16 around the center of the mesh bounds
+	// with a single scale on all axes, which the model matrix applies back without bending normals
+	struct PackedVertex
+	{
+		s16 pos[4] = {};
+		u8 color[4] = {};
+		u16 uv[2] = {};
+		s8 normal[4] = {};
+		s8 tangent[4] = {};
+
+		// Original positions are center + pos * scale, with pos read as snorm
+		static void PackVertices(const std::vector<RendererVertex>& vertices, std::vector<PackedVertex>& output, Maths::Vec3& center, f32& scale);
+	};
 }
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "RendererUniformObject.hpp"
+#include "Maths/Maths.hpp"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+namespace Renderer::Uniform
+{
+	enum IndirectObjectFlags : u32
+	{
+		INDIRECT_NONE = 0,
+		INDIRECT_CULL = 1,
+		// Object is a meshlet, rejected when its normal cone faces away from the camera
+		INDIRECT_CONE = 2,
+	};
+
+	// Must match the std430 layout of IndirectObject in indirect_cull.comp and indirect_vertex.vert
+	struct IndirectObject
+	{
+		Maths::Mat4 model;
+		Maths::Vec4 boundsCenter;
+		Maths::Vec4 boundsExtent;
+		u32 indexCount = 0;
+		u32 firstIndex = 0;
+		s32 vertexOffset = 0;
+		u32 batch = 0;
+		u32 batchSlot = 0;
+		u32 flags = INDIRECT_NONE;
+		// Packed normal cone and bounding sphere radius of meshlets, see Resources::Meshlet
+		u32 cone = 0;
+		f32 radius = 0.0f;
+		// Written to the object id attachment, also pads the struct to the 128 bytes array stride of std430
+		u32 objectID = 0;
+	};
+
+	enum IndirectOcclusionFlags : u32
+	{
+		OCCLUSION_NONE = 0,
+		// Test the first phase against the pyramid built from the previous frame
+		OCCLUSION_PREVIOUS = 1,
+		// Re-test the objects rejected by the first phase against the pyramid of the current frame
+		OCCLUSION_TWO_PHASE = 2,
+	};
+
+	// Must match the std430 layout of CullPass in indirect_cull.comp
+	struct IndirectCullPass
+	{
+		Maths::Vec4 planes[6];
+		Maths::Mat4 previousViewProjection;
+		Maths::Mat4 viewProjection;
+		u32 objectBase = 0;
+		u32 objectCount = 0;
+		u32 compact = 0;
+		u32 occlusion = OCCLUSION_NONE;
+		u32 hizWidth = 0;
+		u32 hizHeight = 0;
+		u32 hizMips = 0;
+		u32 padding = 0;
+		// World position of the camera in xyz, w is 0 for orthographic projections which skip the cone test
+		Maths::Vec4 cameraPosition;
+	};
+
+	// Counters written by the cull shader for each pass, read back once the frame is retired
+	struct IndirectCullStats
+	{
+		u32 objects = 0;
+		u32 frustumCulled = 0;
+		u32 backfacing = 0;
+		u32 occluded = 0;
+		u32 redrawn = 0;
+	};
+
+	struct IndirectCullConstants
+	{
+		u32 pass = 0;
+		u32 phase = 0;
+		u32 commandBase = 0;
+		u32 countBase = 0;
+	};
+
+	struct HiZReduceConstants
+	{
+		Maths::IVec2 sourceSize;
+		Maths::IVec2 targetSize;
+	};
+
+	struct SkinningConstants
+	{
+		u32 vertexCount = 0;
+		// First bone matrix of the mesh in the matrix buffer of the frame
+		u32 matrixBase = 0;
+	};
+
+	class NAT_API RendererIndirectUniform : public RendererUniformObject
+	{
+	public:
+		RendererIndirectUniform() = default;
+
+		~RendererIndirectUniform() override = default;
+
+		// Draw set : object storage buffer, material uniform and textures.
+		// Cull set : objects, batch offsets, commands, counts, passes, visibility, stats and the depth pyramid.
+		// Reduce set : source depth and target pyramid level.
+		// Skin set : source vertices, skin weights, bone matrices and skinned vertices.
+		void CreateDescriptorSetLayout(VkDevice& device, VkPhysicalDevice& physicalDevice) override;
+
+		void DestroyDescriptorSetLayout(VkDevice& device) override;
+
+		VkDescriptorSetLayout& GetCullLayout() { return cullSetLayout; }
+		const VkDescriptorSetLayout& GetCullLayout() const { return cullSetLayout; }
+		VkDescriptorSetLayout& GetReduceLayout() { return reduceSetLayout; }
+		const VkDescriptorSetLayout& GetReduceLayout() const { return reduceSetLayout; }
+		VkDescriptorSetLayout& GetSkinLayout() { return skinSetLayout; }
+		const VkDescriptorSetLayout& GetSkinLayout() const { return skinSetLayout; }
+
+		u64 GetVertexBufSize() const override;
+		u64 GetFragmentBufSize() const override;
+	private:
+		VkDescriptorSetLayout cullSetLayout = {};
+		VkDescriptorSetLayout reduceSetLayout = {};
+		VkDescriptorSetLayout skinSetLayout = {};
+	};
+
+}
@@ -6,9 +6,11 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
-#define MAX_DIR_LIGHT 8
-#define MAX_POINT_LIGHT 64
-#define MAX_SPOT_LIGHT 64
+// Light clusters : screen tiles along x and y, exponential depth slices along z
+#define LIGHT_CLUSTER_X 16
+#define LIGHT_CLUSTER_Y 9
+#define LIGHT_CLUSTER_Z 24
+#define LIGHT_CLUSTER_COUNT (LIGHT_CLUSTER_X * LIGHT_CLUSTER_Y * LIGHT_CLUSTER_Z)
 
 namespace Renderer::Uniform
 {
@@ -49,15 +51,28 @@ namespace Renderer::Uniform
 		f32 padding[2];
 	};
 
+	// Range of the light index list used by one cluster, point lights first then spot lights
+	struct LightCluster
+	{
+		u32 offset;
+		u32 pointCount;
+		u32 spotCount;
+		u32 padding;
+	};
+
+	// Lights and cluster lists live in storage buffers, the uniform only holds what is needed to find the cluster of a fragment
 	struct LightFragmentUniform
 	{
-		DirectionalLight dlights[MAX_DIR_LIGHT];
-		PointLight plights[MAX_POINT_LIGHT];
-		SpotLight slights[MAX_SPOT_LIGHT];
 		Maths::Vec3 viewPos;
 		u32 dCount;
+		Maths::Vec3 viewDir;
+		u32 clusterBase;
+		f32 sliceScale;
+		f32 sliceBias;
 		u32 pCount;
 		u32 sCount;
+		// Only read with the compact G-buffer, which rebuilds positions from depth
+		Maths::Mat4 inverseViewProjection;
 	};
 
 	class NAT_API RendererLightUniform : public RendererUniformObject
@@ -13,6 +13,8 @@ namespace Renderer::Uniform
 		Maths::Mat4 model;
 		Maths::Mat4 mvp;
 		Maths::Vec3 cameraPos;
+		// Packed after cameraPos as in std140
+		u32 objectID = 0;
 	};
 
 	struct MainFragmentUniform
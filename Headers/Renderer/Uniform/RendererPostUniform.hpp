@@ -16,6 +16,46 @@ namespace Renderer::Uniform
 		u32 paramsD[4];
 	};
 
+	// Per-pixel operations consecutive post-process effects are fused into, values match post_pixel.frag
+	enum class PixelOperation : u32
+	{
+		NONE = 0,
+		GAMMA_CORRECTION,
+	};
+
+	constexpr u32 MAX_PIXEL_STAGES = 4;
+
+	// Pushed to the fragment stage, one parameter vector per stage
+	struct PixelStageConstants
+	{
+		Maths::Vec4 params[MAX_PIXEL_STAGES];
+	};
+
+	// The operations are specialization constants, each sequence is its own pipeline
+	struct PixelStages
+	{
+		PixelOperation operations[MAX_PIXEL_STAGES] = {};
+		PixelStageConstants constants;
+		u32 count = 0;
+
+		bool IsFull() const { return count == MAX_PIXEL_STAGES; }
+		void Push(PixelOperation operation, const Maths::Vec4& params)
+		{
+			operations[count] = operation;
+			constants.params[count] = params;
+			count++;
+		}
+		u32 GetKey() const
+		{
+			u32 key = 0;
+			for (u32 i = 0; i < count; i++)
+			{
+				key |= static_cast<u32>(operations[i]) << (i * 8);
+			}
+			return key;
+		}
+	};
+
 	class NAT_API RendererPostUniform : public RendererUniformObject
 	{
 	public:
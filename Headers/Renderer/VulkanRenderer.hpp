@@ -10,9 +10,15 @@
 #include <vector>
 #include <optional>
 #include <array>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
 
 #include "Maths/Maths.hpp"
 #include "Core/Types.hpp"
+#include "Core/ThreadPool.hpp"
 
 #include "Renderer/RendererFrameBuffer.hpp"
 #include "Renderer/RendererDepthBuffer.hpp"
@@ -25,9 +31,14 @@
 #include "Renderer/Uniform/RendererLightUniform.hpp"
 #include "Renderer/Uniform/RendererPostUniform.hpp"
 #include "Renderer/Uniform/RendererWindowUniform.hpp"
+#include "Renderer/Uniform/RendererIndirectUniform.hpp"
 #include "Renderer/RendererMesh.hpp"
 #include "Renderer/RendererFrameBuffer.hpp"
 #include "Renderer/RendererBuffer.hpp"
+#include "Renderer/RendererGeometryPool.hpp"
+#include "Renderer/RendererHiZBuffer.hpp"
+#include "Renderer/RendererProfiler.hpp"
+#include "Renderer/RendererRenderGraph.hpp"
 #include "Renderer/rendererImageView.hpp"
 
 #include "Core/Scene/Scene.hpp"
@@ -49,6 +60,7 @@ namespace Resources
 	class SkinnedModel;
 	class CubeMap;
 	class StaticCubeMap;
+	enum class TextureEncoding : u8;
 	class ShaderProgram;
 	class Material;
 }
@@ -70,8 +82,18 @@ namespace Core::Scene::Components
 	}
 }
 
-#define DESCRIPTOR_POOL_SIZE 16
-const s32 MAX_FRAMES_IN_FLIGHT = 1;
+// Minimum number of recorded commands given to each secondary command buffer
+#define RECORD_CHUNK_SIZE 64
+// Work group size of indirect_cull.comp
+#define INDIRECT_CULL_GROUP_SIZE 64
+#define INDIRECT_MAX_CULL_PASSES 64
+// Work group size of skinning.comp
+#define SKINNING_GROUP_SIZE 64
+// Deepest post-process mip chain, each level halves the resolution
+#define MIP_CHAIN_MAX_LEVELS 8
+// Stencil bit set by the sky, the light pass skips the pixels holding it. Portal levels use the bits below it
+#define SKY_STENCIL_BIT 0x80
+const s32 MAX_FRAMES_IN_FLIGHT = 2;
 //const u32 SHADOWMAP_RESOLUTION = 2048u;
 namespace Wrappers
 {
@@ -136,18 +158,27 @@ namespace Renderer
 		FrameDescriptorPool();
 		~FrameDescriptorPool();
 
-		void CreatePools(VulkanRenderer& renderer, u32 count = 1024, u32 uniformBuf = 2, u32 images = 3);
+		void CreatePools(VulkanRenderer& renderer, u32 count = 1024, u32 uniformBuf = 2, u32 images = 3, u32 storageBuf = 0);
 		void DestroyPools(VkDevice& device);
 
 		VkDescriptorSet GetNext(VulkanRenderer& renderer, Resources::ShaderVariant variant = Resources::ShaderVariant::Default);
+		VkDescriptorSet GetNext(VulkanRenderer& renderer, const VkDescriptorSetLayout& layout);
 		void UpdatePool(VkDevice& device, VulkanRenderer& renderer);
 		
 	private:
-		std::array<VkDescriptorPool, DESCRIPTOR_POOL_SIZE> framePool = {};
-		std::array<bool, DESCRIPTOR_POOL_SIZE> poolState = {};
+		// Every pool holds the same amount of sets, a new one is added once all of them are full and they are all
+		// reset together when the frame slot is reused
+		std::vector<VkDescriptorPool> framePools;
 		u32 currentPos = 0;
+		u32 setCount = 0;
+		u32 uniformCount = 0;
+		u32 imageCount = 0;
+		u32 storageCount = 0;
 	};
 
+	// Linear allocator over one persistently mapped buffer per frame, elements are a stride apart so they can be
+	// bound through dynamic offsets. Running out of space moves to a buffer twice as large, the old one is kept until
+	// the frame is retired
 	class NAT_API UniformBufferPool
 	{
 	public:
@@ -159,12 +190,20 @@ namespace Renderer
 
 		UniformElement GetNext();
 		void UpdatePool();
+		// Makes the elements written this frame visible to the device, only needed on non coherent memory
+		void Flush();
 
 	private:
-		std::array<UniformBufferObject, DESCRIPTOR_POOL_SIZE> framePool = {};
+		void CreateBlock(u64 count);
+		void FlushBlock(const UniformBufferObject& block, u64 size);
+
+		VulkanRenderer* renderer = nullptr;
+		UniformBufferObject block = {};
 		u64 currentPos = 0;
-		u64 bufferSize = 0;
-		u32 count = 0;
+		u64 stride = 0;
+		u64 count = 0;
+		u64 atomSize = 1;
+		bool coherent = true;
 	};
 
 	enum PipelineParams : u32
@@ -179,6 +218,14 @@ namespace Renderer
 		STENCIL = 64,
 		DEPTH_CLEAR = 128,
 		WINDOW = 256,
+		INDIRECT = 512,
+		COMPACT_GBUFFER = 1024,
+		MIP_CHAIN = 2048,
+		PIXEL_STAGES = 4096,
+		INSTANCED = 8192,
+		PACKED_VERTEX = 16384,
+		SKY_RESOLVE = 32768,
+		OBJECT_ID = 65536,
 	};
 
 	enum class NAT_API StencilState : u8
@@ -187,6 +234,150 @@ namespace Renderer
 		INCREMENT,
 		NO_DEPTH,
 		GREATER,
+		// Only where the depth is still cleared, marks the pixels with SKY_STENCIL_BIT
+		SKY,
+	};
+
+	enum class RecordedCommandType : u8
+	{
+		BIND = 0,
+		DRAW,
+		DRAW_INDEXED,
+		INDIRECT,
+		TIMESTAMP,
+	};
+
+	struct RecordedCommand
+	{
+		RecordedCommandType type = RecordedCommandType::DRAW;
+		const RendererPipeline* pipeline = nullptr;
+		// Pipeline bind state
+		LowRenderer::RenderPassType passParams = LowRenderer::RenderPassType::DEFAULT;
+		bool dynamicStencil = false;
+		StencilState stencilState = StencilState::DEFAULT;
+		u8 stencilValue = 0;
+		f32 lineWidth = 1.0f;
+		Maths::IVec2 viewport;
+		// Unset for the whole viewport, a set rectangle may be empty and then discards every draw
+		std::optional<VkRect2D> scissor;
+		// Draw state
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VkDeviceSize vertexOffset = 0;
+		VkDeviceSize indexOffset = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+		// Model matrices read per instance by the instanced pipelines
+		VkBuffer instanceBuffer = VK_NULL_HANDLE;
+		VkDeviceSize instanceOffset = 0;
+		u32 instanceCount = 1;
+		u32 count = 0;
+		// Culling phase drawn by an INDIRECT command
+		u32 indirectPhase = 0;
+		// A TIMESTAMP command opens or closes the profiler scope held in count
+		bool scopeEnd = false;
+		UniformElement uniform;
+		std::vector<const RendererTexture*> textures;
+	};
+
+	// Objects of one pass sharing a material, drawn with a single indirect call
+	struct IndirectBatch
+	{
+		const Resources::Material* material = nullptr;
+		u32 objectCount = 0;
+		u32 firstCommand = 0;
+		UniformElement uniform;
+		VkDescriptorSet descriptor = VK_NULL_HANDLE;
+	};
+
+	// Culling results of one GPU driven pass
+	struct CullingStats
+	{
+		LowRenderer::RenderPassType pass = LowRenderer::RenderPassType::DEFAULT;
+		bool occlusion = false;
+		Uniform::IndirectCullStats counts;
+	};
+
+	// Per frame arena of the GPU driven passes, every pass appends its objects and batches after the previous one
+	struct IndirectFrameData
+	{
+		VkBuffer objectBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory objectMemory = VK_NULL_HANDLE;
+		Uniform::IndirectObject* objects = nullptr;
+		VkBuffer commandBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory commandMemory = VK_NULL_HANDLE;
+		u32 objectCapacity = 0;
+		u32 objectCount = 0;
+		VkBuffer batchBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory batchMemory = VK_NULL_HANDLE;
+		u32* batchOffsets = nullptr;
+		VkBuffer countBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory countMemory = VK_NULL_HANDLE;
+		u32 batchCapacity = 0;
+		u32 batchCount = 0;
+		VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory visibilityMemory = VK_NULL_HANDLE;
+		VkBuffer passBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory passMemory = VK_NULL_HANDLE;
+		Uniform::IndirectCullPass* passes = nullptr;
+		VkBuffer statsBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory statsMemory = VK_NULL_HANDLE;
+		Uniform::IndirectCullStats* stats = nullptr;
+		std::vector<CullingStats> passInfo;
+	};
+
+	// Host visible storage buffer grown by doubling, the replaced buffer is kept alive until its frame is retired
+	struct LightStorageBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		void* data = nullptr;
+		u64 capacity = 0;
+	};
+
+	// Host visible geometry written by the CPU during the frame, rewound once the frame is retired. A full buffer is
+	// replaced by a larger one, the draws recorded earlier keep reading the old one until it is deleted
+	struct TransientGeometryBuffer
+	{
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		u8* data = nullptr;
+		u64 capacity = 0;
+		u64 used = 0;
+	};
+
+	// Per frame light data : the lights are uploaded once, every light pass appends its clusters and light indices
+	struct LightFrameData
+	{
+		LightStorageBuffer directionals;
+		LightStorageBuffer points;
+		LightStorageBuffer spots;
+		LightStorageBuffer clusters;
+		LightStorageBuffer indices;
+		u32 clusterCount = 0;
+		u32 indexCount = 0;
+		bool uploaded = false;
+	};
+
+	// Clusters touched by the bounding sphere of a light, bounds are inclusive
+	struct LightClusterRange
+	{
+		Maths::IVec3 min;
+		Maths::IVec3 max;
+	};
+
+	struct CommandRecorder
+	{
+		VkCommandPool pool = VK_NULL_HANDLE;
+		std::vector<VkCommandBuffer> buffers;
+		u32 usedBuffers = 0;
+		FrameDescriptorPool descriptors;
+	};
+
+	struct PendingDeletion
+	{
+		// Submission that must have completed before the deletion runs
+		u64 frame = 0;
+		std::function<void()> deletion;
 	};
 
 	class NAT_API VulkanRenderer
@@ -207,6 +398,7 @@ namespace Renderer
 		bool LoadSkinnedModel(Resources::SkinnedModel* p_model);
 		bool LoadTexture(Resources::StaticTexture* p_texture);
 		bool LoadCubeMap(Resources::StaticCubeMap* p_cubemap);
+		bool SupportsBlockCompression() const { return hasTextureCompressionBC; }
 		// TODO add support for more filtering & wrapping modes
 		void LoadTextureSampler(Resources::TextureSampler* sampler, bool linearFiltering = true, bool wrap = true);
 		std::string ReadTexture(const Resources::Texture* tex, Maths::IVec2 offset, Maths::IVec2 size, u64 pixelSize);
@@ -223,27 +415,79 @@ namespace Renderer
 		void EndFrame(Wrappers::Interfacing* pInterface);
 		void BeginPass(LowRenderer::FrameBuffer* fb = nullptr, LowRenderer::RenderPassType renderPass = LowRenderer::RenderPassType::DEFAULT);
 		void EndPass();
+		// Times the commands recorded until the matching EndProfileScope. Scopes opened inside a recorded pass are
+		// replayed with its commands and only get timestamps
+		void BeginProfileScope(const std::string& name, bool statistics = true);
+		void EndProfileScope();
+		RendererProfiler& GetProfiler() { return profiler; }
 		Maths::Vec3 GetClearColor();
 		void SetClearColor(Maths::Vec4 color);
 
 		void CreateFrameBuffer(RendererFrameBuffer& buf, const std::vector<RendererImageView>& attachments, Maths::IVec2 targetResolution, Maths::Vec4 clearColor, VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT, Resources::ShaderVariant variant = Resources::ShaderVariant::Default);
 		void CreateDepthBuffer(RendererDepthBuffer& db, Maths::IVec2 targetResolution);
 		void CreateBuffer(Renderer::RendererBuffer& b, Maths::IVec2 resolution, bool transitLayout = false);
+		// Creates the depth and G-buffer targets of the framebuffer and its geometry framebuffer, with the formats of its layout
+		void CreateGeometryBuffers(LowRenderer::FrameBuffer& frameBuffer, Maths::IVec2 resolution, bool transitDepth = false);
+		// Creates the light and post-process targets, the light one reads the stencil of the depth buffer to skip the sky
+		void CreateLightBuffers(LowRenderer::FrameBuffer& frameBuffer, Maths::IVec2 resolution);
 		void DeleteFrameBuffer(RendererFrameBuffer& buf);
 		void DeleteDepthBuffer(RendererDepthBuffer& buf);
 		void DeleteBuffer(RendererBuffer& buf);
 		void WaitForVSync();
 
 		void RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const Maths::Vec3& color = Maths::Vec3(1));
-		void RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const Resources::Material* mat);
+		// With cullMeshlets, the meshlets of the full resolution level out of view or facing away from the camera are skipped
+		void RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const Resources::Material* mat, u32 lod = 0, bool cullMeshlets = false);
 		void RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, std::vector<const RendererTexture*> textures, Resources::Material* materialOverride = Resources::Material::GetDefaultMaterial());
-		void RenderMeshObject(const Resources::Mesh* mesh, const Maths::Mat4& mvp, u32 objectID);
+		// Id written to the object id attachment by the next draws of shaders supporting it, 0 for none
+		void SetObjectID(u32 id) { objectID = id; }
 		void DrawVertices(u32 count, const Maths::Mat4& m, const Maths::Mat4& mvp);
 		void DrawVertices(u32 count, const Maths::Mat4& m, const Maths::Mat4& mvp, std::vector<const RendererTexture*> textures);
 		void DrawIndexedRenderMesh(const Renderer::RendererMesh* pRenderMesh, const Maths::Mat4& pModelMatrix, u32 pVertexCount, u32 pIndiceCount);
+		// Copies the geometry to the ring of the frame and draws it with the bound shader, without any device allocation
+		void DrawTransientGeometry(const RendererVertex* pVertices, u32 pVertexCount, const u32* pIndices, u32 pIndiceCount);
+		// Binds the wireframe pipeline drawing one instance per model matrix, built from the fragment stage of the first
+		// shader given. Returns false if it is not available
+		bool BindInstancedWireframe(const Resources::ShaderProgram* p_shader);
+		void DrawInstancedRenderMesh(const Renderer::RendererMesh* pRenderMesh, const Maths::Mat4* pModelMatrices, u32 pInstanceCount, u32 pVertexCount, u32 pIndiceCount);
+		// Skinning pass of the frame, recorded outside of any render pass before the views drawing the skinned meshes.
+		// Returns false when compute skinning is not available
+		bool BeginSkinning();
+		// Writes the vertices of the skinned mesh moved by one matrix per bone to output, which is created or resized as needed
+		void SkinMesh(const Resources::Mesh* mesh, const Maths::Mat4* matrices, u32 matrixCount, SkinnedVertexBuffer& output);
+		void EndSkinning();
+		void FreeSkinnedVertexBuffer(SkinnedVertexBuffer& buffer);
+		// Same as RenderMesh with the vertices written by SkinMesh, without meshlet culling
+		void RenderSkinnedMesh(const Resources::Mesh* mesh, const SkinnedVertexBuffer& vertices, const Maths::Mat4& m, const Maths::Mat4& mvp, const Resources::Material* mat, u32 lod = 0);
+		// Workers recording the passes, free to use outside of them
+		Core::ThreadPool& GetWorkerThreads() { return recordThreads; }
+		// Queues the mesh for GPU culling and indirect drawing with the default shader, returns false if it must go through RenderMesh instead
+		bool RenderMeshIndirect(Resources::Mesh* mesh, const Resources::Material* mat, const Maths::Mat4& m, const Maths::Mat4& vp, const Maths::Frustum& frustum, bool useCulling, u32 lod = 0);
+		// Results of the GPU driven passes of the last retired frame
+		const std::vector<CullingStats>& GetCullingStats() const { return cullingStats; }
 		void ApplyLightPass(const Resources::ShaderProgram* shader);
-		void ApplyPostProcess(const LowRenderer::PostProcess::PostProcessEffect* effect);
+		// The filtered texture is bound at binding 4, the current glow buffer is bound there when there is none
+		void ApplyPostProcess(const LowRenderer::PostProcess::PostProcessEffect* effect, const RendererTexture* filtered = nullptr);
+		// Downsamples the current color or glow buffer of the frame buffer through a chain of transient render graph
+		// textures and upsamples it back, returns the half resolution result to pass to ApplyPostProcess
+		const RendererTexture* FilterMipChain(LowRenderer::FrameBuffer* fb, bool glow, u32 levels);
+		// Runs the fused per-pixel stages over the current color and glow buffers in a single post pass
+		void ApplyPixelStages(const Uniform::PixelStages& stages);
+		bool CanFusePixelStages() const { return pixelStageShader.GetModule() != VK_NULL_HANDLE; }
+		// True when the main frame buffer is blitted to the window by RenderToWindow instead of being shown by the editor
+		bool PresentsMainFrameBuffer() const { return presentsMainFrameBuffer; }
+		// True when the window shader was built from its source, the SPIR-V of its asset ignores the stage constants
+		bool WindowHasPixelStages();
+		// Stages applied by the next RenderToWindow, they are reset once the frame is presented
+		void SetWindowPixelStages(const Uniform::PixelStages& stages) { windowPixelStages = stages; }
 		void RenderToWindow();
+		// Graph of the passes of the current frame, reset by BeginFrame
+		RendererRenderGraph& GetFrameGraph() { return frameGraph; }
+		// Imports the G-buffer or the light buffer of the frame buffer, the main one when null
+		RenderGraphResource ImportFrameBuffer(LowRenderer::FrameBuffer* fb, bool gBuffer);
+		// Blits the source to the window when the main frame buffer is presented, otherwise the editor samples it
+		void AddWindowPass(RenderGraphResource source);
+		void ExecuteFrameGraph();
 		void BindShader(const Resources::ShaderProgram* p_shader);
 		void UnLoadShader(Resources::Shader* p_shader);
 		void UnLoadShaderProgram(Resources::ShaderProgram* p_shader);
@@ -256,6 +500,8 @@ namespace Renderer
 
 		void FreeVertexBuffer(VertexBuffer& pBuffer);
 		void FreeIndiceBuffer(IndiceBuffer& pBuffer);
+		// Destruction is delayed until the GPU has retired the next submitted frame, the last one that can use the resource
+		void QueueDeletion(std::function<void()> deletion);
 
 		void WaitIdle();
 		void PrepareFrameBuffer(LowRenderer::FrameBuffer* fb);
@@ -267,20 +513,58 @@ namespace Renderer
 		f32 GetLineWidth() const { return currentWidth; }
 		void SetLineWidth(f32 newWidth) { currentWidth = Maths::Util::Clamp(newWidth, lineRange.x, lineRange.y); };
 		void SetStencilState(u8 compareValue, StencilState state);
+		// Limits the following draws of the pass to a rectangle of the screen, in normalized device coordinates
+		void SetScissor(const Maths::Vec4& screenBounds);
 
 		Renderer::VertexBuffer CreateVertexBuffer(const RendererVertex* pVertices, const unsigned int& pVerticesCount);
+		Renderer::VertexBuffer CreateVertexBuffer(const PackedVertex* pVertices, const unsigned int& pVerticesCount);
 		Renderer::IndiceBuffer CreateIndiceBuffer(const u32* pIndices, const unsigned int& pIndicesCount);
+		Renderer::IndiceBuffer CreateIndiceBuffer(const u16* pIndices, const unsigned int& pIndicesCount);
+		// Vertex layout of the meshes loaded afterwards, packed meshes are 24 bytes per vertex instead of 56
+		void SetPackedVertices(bool value) { packedVertices = value; }
+		bool UsesPackedVertices() const { return packedVertices; }
 
 		void InitRendererData();
 
 		LowRenderer::FrameBuffer GetMainColorBuffer() const;
 		LowRenderer::FrameBuffer GetMainLightBuffer() const;
-		LowRenderer::FrameBuffer GetMainObjectBuffer() const;
+		VkFormat GetHDRFormat() const { return hdrFormat; }
+		// Copies the object id of the pixel from the main geometry pass that just ended to the pick buffer
+		void PickObject(Maths::IVec2 pos);
+		// Returns true once the frame of the last pick has completed, index is 0 when no object was under the pixel
+		bool PollObjectPick(u32& index);
 		void ResetMainFB();
 		void ToggleMainFB();
+		LowRenderer::GBufferLayout GetMainGBufferLayout() const { return mainFB.GetGBufferLayout(); }
+		void SetMainGBufferLayout(LowRenderer::GBufferLayout layout);
+		// Called when a geometry shader keeps SPIR-V written for the full layout, compact frame buffers fall back to FULL
+		void DisableCompactGBuffer();
+		bool IsCompactGBufferEnabled() const { return compactGBufferEnabled; }
+
+		// Resolution of the frame buffer of the pass being recorded
+		Maths::IVec2 GetActiveResolution() const;
+
+		// CPU side cost of the last completed frame, times are in seconds
+		struct FrameStats
+		{
+			u32 drawCalls = 0;
+			u32 descriptorWrites = 0;
+			// From the end of the frame slot wait in BeginFrame to the end of the command buffer
+			f64 recordTime = 0;
+			// Queue submission and presentation
+			f64 submitTime = 0;
+		};
+		const FrameStats& GetFrameStats() const { return frameStats; }
+		// Headless only, copies the output image of the current frame to the capture buffer at EndFrame
+		void CaptureFrame() { captureRequested = true; }
+		// Waits for the captured frame and returns its BGRA8 pixels, false when no capture was requested
+		bool ReadCapturedFrame(std::vector<u8>& pixels);
 
 		Maths::Vec3 currentCameraPos;
+		f64 frameTime = 0;
 		bool enableValidationLayers = true;
+		// Renders into offscreen images instead of a window swap chain, set before PreInit
+		bool headless = false;
 
 		void SetCurrentCamera(const LowRenderer::Rendering::Camera* pCamera);
 
@@ -299,7 +583,14 @@ namespace Renderer
 		VkFormat swapChainImageFormat = {};
 		VkExtent2D swapChainExtent = {};
 		VkRenderPass geometryRenderPass = {};
-		VkRenderPass objectRenderPass = {};
+		// Same attachments as the geometry pass, loaded instead of cleared to resume it after the occlusion culling
+		VkRenderPass geometryLoadRenderPass = {};
+		// Geometry passes writing the compact G-buffer layout
+		VkRenderPass geometryCompactRenderPass = {};
+		VkRenderPass geometryCompactLoadRenderPass = {};
+		VkFormat compactNormalFormat = VK_FORMAT_R16G16_SNORM;
+		// Format of the light and post-process buffers
+		VkFormat hdrFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
 		VkRenderPass lightRenderPass = {};
 		VkRenderPass postRenderPass = {};
 		VkRenderPass windowRenderPass = {};
@@ -319,6 +610,76 @@ namespace Renderer
 		std::vector<FrameDescriptorPool> pdescriptorPools = {};
 		std::vector<UniformBufferPool> puniformPools = {};
 		std::vector<FrameDescriptorPool> wdescriptorPools = {};
+		std::vector<FrameDescriptorPool> idescriptorPools = {};
+		std::vector<FrameDescriptorPool> sdescriptorPools = {};
+		// Bone matrices of the meshes skinned in the frame, rewound once the frame is retired
+		std::vector<LightStorageBuffer> skinningMatrices = {};
+		u32 skinningMatrixCount = 0;
+		RendererPipeline skinPipeline;
+		ComputeRendererShader skinShader;
+		std::vector<IndirectFrameData> indirectFrames = {};
+		RendererGeometryPool geometryPool;
+		RendererPipeline indirectPipeline;
+		RendererPipeline indirectCompactPipeline;
+		RendererPipeline cullPipeline;
+		VertexRendererShader indirectVertex;
+		ComputeRendererShader cullShader;
+		std::vector<IndirectBatch> indirectBatches;
+		std::unordered_map<const Resources::Material*, u32> indirectBatchLookup;
+		Maths::Mat4 indirectViewProjection;
+		Maths::Frustum indirectFrustum;
+		u32 indirectObjectBase = 0;
+		u32 indirectBatchBase = 0;
+		bool indirectSupported = false;
+		bool hasDrawIndirectCount = false;
+		bool hasMultiDrawIndirect = false;
+		bool hasTextureCompressionBC = false;
+		bool hasPipelineStatistics = false;
+		RendererHiZBuffer hizBuffer;
+		RendererProfiler profiler;
+		RendererPipeline hizPipeline;
+		ComputeRendererShader hizShader;
+		RendererTransientPool transientPool;
+		RendererRenderGraph renderGraph;
+		RendererRenderGraph frameGraph;
+		// Set once the frame graph blitted the main frame buffer, EndFrame does it otherwise
+		bool windowDrawn = false;
+		u32 objectID = 0;
+		RendererPipeline mipDownPipeline;
+		RendererPipeline mipUpPipeline;
+		VertexRendererShader postVertex;
+		FragmentRendererShader mipDownShader;
+		FragmentRendererShader mipUpShader;
+		FragmentRendererShader pixelStageShader;
+		// Copies the sky into the light target where the light pipelines are masked out
+		RendererPipeline skyResolvePipeline;
+		FragmentRendererShader skyResolveShader;
+		std::vector<TransientGeometryBuffer> transientGeometry = {};
+		std::vector<u32> visibleMeshletIndices;
+		VertexRendererShader instancedVertex;
+		RendererPipeline instancedWirePipeline;
+		RendererPipeline instancedWireCompactPipeline;
+		std::unordered_map<u32, RendererPipeline> pixelStagePipelines;
+		std::unordered_map<u32, RendererPipeline> windowStagePipelines;
+		Uniform::PixelStages windowPixelStages;
+		Resources::ShaderProgram* windowProgram = nullptr;
+		bool presentsMainFrameBuffer = false;
+		VkDescriptorSet indirectCullDescriptor = VK_NULL_HANDLE;
+		u32 indirectCullPass = 0;
+		std::vector<CullingStats> cullingStats;
+		std::vector<LightFrameData> lightFrames = {};
+		std::vector<LightClusterRange> lightRanges;
+		std::vector<u32> lightClusterCursors;
+		std::vector<std::vector<CommandRecorder>> commandRecorders = {};
+		Core::ThreadPool recordThreads;
+		std::vector<RecordedCommand> recordedCommands;
+		bool recordingPass = false;
+		VkRenderPass* recordedRenderPass = nullptr;
+		std::vector<PendingDeletion> deletionQueue;
+		std::mutex deletionMutex;
+		// Frames are numbered from 1 as they are submitted, the fence of each slot signals its last submission
+		u64 submittedFrames = 0;
+		std::array<u64, MAX_FRAMES_IN_FLIGHT> frameSubmissions = {};
 		u32 currentFrame = 0;
 		u32 imageIndex = 0;
 		VkCommandBuffer activeCommandBuffer = {};
@@ -326,18 +687,42 @@ namespace Renderer
 		RendererFrameBuffer activeRendererFrameBuffer = {};
 		LowRenderer::RenderPassType activePassParams = LowRenderer::RenderPassType::DEFAULT;
 		const RendererPipeline* activePipeline = nullptr;
+		// Variants of the bound shader for each vertex layout, null when the shader has no packed variant
+		std::array<const RendererPipeline*, 2> activeLayoutPipelines = {};
+		VertexLayout boundVertexLayout = VertexLayout::FULL;
+		bool activeDynamicStencil = false;
+		bool packedVertices = true;
 		std::vector<Core::Scene::Components::Lights::DirectionalLightComponent*> dLights;
 		std::vector<Core::Scene::Components::Lights::PointLightComponent*> pLights;
 		std::vector<Core::Scene::Components::Lights::SpotLightComponent*> sLights;
 
 		LowRenderer::FrameBuffer mainFB;
 		LowRenderer::FrameBuffer swapBuffer;
-		RendererFrameBuffer objectFrameBuffer;
-		RendererFrameBuffer oldObjectBuffer;
+		VkBuffer pickBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory pickMemory = VK_NULL_HANDLE;
+		const u32* pickData = nullptr;
+		u32 pickFrame = 0;
+		bool pickPending = false;
+		bool pickReady = false;
+		// Headless output images, in place of the swap chain images
+		std::vector<VkDeviceMemory> offscreenMemory;
+		VkBuffer captureBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory captureMemory = VK_NULL_HANDLE;
+		const u8* captureData = nullptr;
+		u32 captureFrame = 0;
+		bool captureRequested = false;
+		bool capturePending = false;
+		bool captureReady = false;
+		FrameStats frameStats;
+		// Incremented by the record threads as well
+		std::atomic<u32> drawCallCount = 0;
+		std::atomic<u32> descriptorWriteCount = 0;
+		std::chrono::steady_clock::time_point frameBegin;
 		bool shouldDeleteOldFB = false;
 
 		bool shouldRecreate = false;
 		bool shouldRecreateFB = false;
+		bool compactGBufferEnabled = true;
 		bool targetVSync = true;
 
 		Maths::IVec2 targetResolution;
@@ -345,11 +730,13 @@ namespace Renderer
 		f32 currentWidth = 1.0f;
 		u8 stencilCompareValue = 0;
 		StencilState state = StencilState::DEFAULT;
+		std::optional<VkRect2D> activeScissor;
 
 		Uniform::RendererMainUniform mainUniform;
 		Uniform::RendererLightUniform lightUniform;
 		Uniform::RendererPostUniform postUniform;
 		Uniform::RendererWindowUniform windowUniform;
+		Uniform::RendererIndirectUniform indirectUniform;
 
 		void InitVulkan(GLFWwindow* window, Maths::IVec2 defaultResolution, bool defaultVSync, bool pInitEditor = false);
 		void CreateMainFrameBuffer();
@@ -359,44 +746,102 @@ namespace Renderer
 		void PickPhysicalDevice();
 		void CreateLogicalDevice();
 		void CreateSwapChain(VkExtent2D resolution, bool defaultVSync);
+		// Headless swap chain : one offscreen image per frame in flight and the buffer frames are captured to
+		void CreateOffscreenImages(VkExtent2D resolution);
+		void RecordFrameCapture();
 		void CreateImageViews();
-		bool CreateGraphicsPipeline(VkRenderPass& targetPass, const VertexRendererShader* vertex, const FragmentRendererShader* fragment, RendererPipeline& pipeline, PipelineParams params = (PipelineParams)0);
-		void CreateRenderPass(VkRenderPass& targetPass, VkImageLayout finalLayout, VkFormat format, u32 attachemntCount, bool hasDepth = true, bool hasStencil = false, bool clearBuffers = true);
+		bool CreateGraphicsPipeline(VkRenderPass& targetPass, const VertexRendererShader* vertex, const FragmentRendererShader* fragment, RendererPipeline& pipeline, PipelineParams params = (PipelineParams)0, const Uniform::PixelStages* stages = nullptr);
+		// Pipelines of fused pixel stages are built the first time a sequence of operations is used
+		const RendererPipeline* GetPixelStagePipeline(std::unordered_map<u32, RendererPipeline>& cache, VkRenderPass& targetPass, const VertexRendererShader* vertex, const FragmentRendererShader* fragment, PipelineParams params, const Uniform::PixelStages& stages);
+		void CreateRenderPass(VkRenderPass& targetPass, VkImageLayout finalLayout, VkFormat format, u32 attachemntCount, bool hasDepth = true, bool hasStencil = false, bool clearBuffers = true, bool readOnlyDepth = false);
+		void CreateRenderPass(VkRenderPass& targetPass, VkImageLayout finalLayout, const std::vector<VkFormat>& formats, bool hasDepth = true, bool hasStencil = false, bool clearBuffers = true, bool readOnlyDepth = false);
+		VkRenderPass& GetGeometryRenderPass(const LowRenderer::FrameBuffer* frameBuffer, bool load = false);
+		bool UsesCompactPipeline(const Resources::ShaderProgram* p_shader) const;
 		void CreateSCFramebuffers();
 		void CreateCommandPool(VkCommandPool* cmdPool, u32 familyIndex);
 		void CreateCommandBuffers();
 		void BeginCommandBuffer();
-		void BeginRenderPass(VkRenderPass& targetPass, LowRenderer::FrameBuffer* frameBuffer);	
-		void DrawIndexedMesh(const Resources::Mesh* mesh, VkDescriptorSet& meshDescriptor, UniformElement& uniform);
+		void SetRenderTarget(LowRenderer::FrameBuffer* frameBuffer);
+		void BeginRenderPass(VkRenderPass& targetPass, LowRenderer::FrameBuffer* frameBuffer);
+		void BeginActiveRenderPass(VkRenderPass& targetPass, VkSubpassContents contents);
+		// Draws the mesh from vertices instead of its own vertex buffer when given
+		void DrawIndexedMesh(const Resources::Mesh* mesh, const std::vector<const RendererTexture*>& textures, UniformElement& uniform, u32 lod = 0, VkBuffer vertices = VK_NULL_HANDLE);
+		// Draws the visible meshlets of the mesh from a compacted copy of their indices in the transient geometry ring
+		void DrawMeshlets(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const std::vector<const RendererTexture*>& textures, UniformElement& uniform);
+		void SubmitCommand(RecordedCommand&& command);
+		void ApplyPipelineState(VkCommandBuffer cmd, const RecordedCommand& state);
+		void RecordCommand(VkCommandBuffer cmd, FrameDescriptorPool& pool, const RecordedCommand& command);
+		void WriteProfileScope(u32 scope, bool end);
+		VkCommandBuffer RecordSecondaryCommands(CommandRecorder& recorder, u64 stateIndex, u64 begin, u64 end);
+		void FlushRecordedPass();
+		void CreateIndirectResources();
+		bool CreateComputePipeline(const ComputeRendererShader* compute, RendererPipeline& pipeline, const VkDescriptorSetLayout& layout, u32 pushConstantSize);
+		void ReserveIndirectObjects(IndirectFrameData& frame, u32 objectCount);
+		void ReserveIndirectBatches(IndirectFrameData& frame, u32 batchCount);
+		void DestroyIndirectFrame(IndirectFrameData& frame);
+		void PrepareIndirectCulling(bool occlusion);
+		void DispatchIndirectCulling(u32 phase);
+		RecordedCommand CreateIndirectCommand(u32 phase);
+		void RecordIndirectDraws(VkCommandBuffer cmd, const RecordedCommand& command);
+		void CreateCommandRecorders();
+		void CreateLightResources();
+		void CreateSkinningResources();
+		Resources::ShaderProgram* GetWindowProgram();
+		void CreatePostResources();
+		void CreatePickResources();
+		void CreateDebugDrawResources();
+		// Returns the offset of the data in the transient geometry buffer of the frame
+		VkDeviceSize WriteTransientGeometry(const void* data, u64 size);
+		RecordedCommand CreateDrawCommand(const Maths::Mat4& pModelMatrix);
+		void SubmitBind(bool dynamicStencil);
+		// Switches the bound shader to its variant for the layout, returns false when it has none
+		bool BindVertexLayout(VertexLayout layout);
+		// Uploads a mip chain encoded by the texture encoder as is, without any blit
+		bool LoadEncodedImage(RendererTexture& texture, const void* imageData, Resources::TextureEncoding encoding, Maths::IVec2 resolution, u32 mipLevels, bool cubeMap);
+		VkFormat GetTextureFormat(Resources::TextureEncoding encoding, bool isFloat) const;
+		void DrawMipChainPass(RendererFrameBuffer& target, const RendererTexture* source, Maths::IVec2 sourceResolution, const RendererPipeline& pipeline);
+		bool ReserveLightStorage(LightStorageBuffer& storage, u64 size);
+		void DestroyLightFrame(LightFrameData& frame);
+		void UploadLights(LightFrameData& frame);
+		void BuildLightClusters(LightFrameData& frame, Uniform::LightFragmentUniform& fragmentData);
+		bool GetLightClusterRange(const Maths::Vec3& center, f32 radius, const Maths::Mat4& view, const Maths::Mat4& projection, const Uniform::LightFragmentUniform& fragmentData, LightClusterRange& range);
 		void EndRenderPass();
+		void TransitionDepthBuffer(VkCommandBuffer cmd, RendererDepthBuffer& db, VkImageLayout newLayout);
 		void EndCommandBuffer();
 		void CreateSyncObjects();
+		void FlushDeletionQueue(u64 completedFrame);
 		void RecreateSwapChain(Wrappers::Interfacing* pInterface, VkExtent2D newRes, bool useVSync);
 		void CleanupSwapChain();
 		void EndSingleTimeCommands(VkCommandBuffer commandBuffer, const VkCommandPool& cmdPool, VkQueue& queue);
 		void UpdateUniformBuffer(UniformElement& element, const Resources::Material* mat, const Maths::Mat4& modelMatrix, const Maths::Mat4& mvp);
-		void UpdateUniformBuffer(UniformElement& element, const Maths::Mat4& mvp, u32 objectIndex);
 		void UpdateLightUniformBuffer(UniformElement& element);
 		void UpdatePostUniformBuffer(UniformElement& element, const LowRenderer::PostProcess::PostProcessEffect* effect);
 		void UpdateDescriptorSet(VkDescriptorSet& descriptor, VkBuffer& uniformBuff, Renderer::Uniform::RendererUniformObject* uniform, bool hasVertexInfo, const std::vector<const RendererTexture*> textures, const Resources::TextureSampler* sampler);
-		void UpdateDescriptorSet(VkDescriptorSet& descriptor, const RendererTexture* tex);
-		void UpdateLightDescriptorSet(VkDescriptorSet& descriptor, VkBuffer& uniformBuff, const RendererTexture& albedo, const RendererTexture& normal, const RendererTexture& position);
+		void UpdateDescriptorSet(VkDescriptorSet& descriptor, const RendererTexture* color, const RendererTexture* glow);
+		void UpdateIndirectDescriptorSet(VkDescriptorSet& descriptor, const IndirectFrameData& frame, VkBuffer& uniformBuff, const std::vector<const RendererTexture*>& textures);
+		void UpdateCullDescriptorSet(VkDescriptorSet& descriptor, const IndirectFrameData& frame);
+		void UpdateLightDescriptorSet(VkDescriptorSet& descriptor, const LightFrameData& frame, const RendererTexture* depth, VkImageLayout depthLayout);
 
 		void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
 		VkPhysicalDevice& GetPhysicalDevice() { return physicalDevice; }
 		void CreateImage(const Maths::IVec2& resolution, u32 mipLevel, VkImage& image, VkDeviceMemory& memory, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, bool isCubeMap = false);
 		void TransitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, u32 mipLevel, bool cubeMap = false);
 		void CopyBufferToImage(VkBuffer buffer, VkImage image, u32 width, u32 height, bool cubeMap = false);
+		void CopyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
 		void CopyImageToBuffer(VkBuffer buffer, VkImage image, Maths::IVec2 offset, Maths::IVec2 size);
 		void GenerateMipmaps(VkImage image, VkFormat imageFormat, Maths::IVec2 resolution, u32 mipLevels, bool cubeMap = false);
 		VkImageView CreateImageView(const VkImage& image, VkFormat format, VkImageAspectFlags aspectFlags, u32 mipLevel, bool cubeMap = false);
 		VkFormat FindDepthFormat();
-		void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+		void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+		// Device local buffer filled through a staging copy
+		Renderer::VertexBuffer CreateStaticBuffer(const void* pData, VkDeviceSize pSize, VkBufferUsageFlags pUsage);
 		void FlushMappedMemory(const VkDeviceMemory& mem, u64 offset, u64 size);
 		RendererImageView GetValidImage(const RendererTexture* tex);
 
-		bool CreateDescriptorPool(VkDescriptorPool& targetPool, u32 size = 1024, u32 uniformBuf = 2, u32 images = 3);
+		// Descriptor counts are given per set
+		bool CreateDescriptorPool(VkDescriptorPool& targetPool, u32 size = 1024, u32 uniformBuf = 2, u32 images = 3, u32 storageBuf = 0);
 		bool CreateDescriptorSet(VkDescriptorPool& targetPool, VkDescriptorSet& descriptor, Resources::ShaderVariant targetShader = Resources::ShaderVariant::Default);
+		bool CreateDescriptorSet(VkDescriptorPool& targetPool, VkDescriptorSet& descriptor, const VkDescriptorSetLayout& layout);
 
 		void SubmitCurrentCommandBuffer(void* buffer);
 
@@ -426,6 +871,10 @@ namespace Renderer
 		friend RendererTextureSampler;
 		friend RendererFrameBuffer;
 		friend RendererShaderProgram;
+		friend RendererGeometryPool;
+		friend RendererHiZBuffer;
+		friend RendererProfiler;
+		friend RendererTransientPool;
 		friend Wrappers::Interfacing;
 	};
 }
\ No newline at end of file
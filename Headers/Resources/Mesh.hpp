@@ -12,6 +12,44 @@
 
 namespace Resources
 {
+	// Range of the uploaded index buffer drawn for a level of detail, error is the largest distance between its
+	// surface and the full resolution one, relative to the largest side of the mesh bounds
+	struct MeshLod
+	{
+		u32 indexOffset = 0;
+		u32 indexCount = 0;
+		f32 error = 0.0f;
+	};
+
+	// Cluster of the full resolution indices, bounded by a sphere and by the cone of its triangle normals
+	struct Meshlet
+	{
+		Maths::Vec3 center;
+		f32 radius = 0.0f;
+		// Axis and cutoff of the normal cone as snorm8, see GetCone
+		u32 cone = 0;
+		u32 indexOffset = 0;
+		u32 indexCount = 0;
+
+		// Axis in xyz and cutoff in w. Every triangle faces away from a viewpoint p when
+		// dot(center - p, axis) >= cutoff * |center - p| + radius, a cutoff of 1 never culls
+		Maths::Vec4 GetCone() const;
+	};
+
+	// Four strongest bone influences of a vertex. Bones index Mesh::bones, weights are unorm8 and sum to 255
+	struct SkinWeight
+	{
+		u8 bones[4] = {};
+		u8 weights[4] = {};
+	};
+
+	// Bone a skinned mesh is bound to, offset moves the bind pose vertices into the space of the node
+	struct MeshBone
+	{
+		u32 node = 0;
+		Maths::Mat4 offset = Maths::Mat4(1);
+	};
+
 	class NAT_API Mesh : public IResource
 	{
 		//
@@ -28,8 +66,26 @@ namespace Resources
 
 		void UpdateVectors();
 
+		u32 GetLodCount() const { return static_cast<u32>(lods.size()); }
+		MeshLod GetLod(u32 level) const { return lods.empty() ? MeshLod{ 0, indiceCount, 0.0f } : lods[level < lods.size() ? level : lods.size() - 1]; }
+		// Coarsest level whose error stays under pixelError once the mesh covers screenSize pixels, levels coarser
+		// than the current one need a margin so a mesh at the threshold does not switch every frame
+		u32 SelectLod(f32 screenSize, u32 current, f32 pixelError = 1.0f) const;
+		// Full resolution indices followed by the simplified levels, as uploaded to the GPU
+		std::vector<u32> GetRenderIndices() const;
+		bool IsSkinned() const { return !skinWeights.empty(); }
+
 		std::vector<Renderer::RendererVertex> vertices;
 		std::vector<u32> indices;
+		// Simplified levels of detail, indexing the same vertices. Level 0 is always the full resolution indices
+		std::vector<u32> lodIndices;
+		std::vector<MeshLod> lods;
+		// Contiguous ranges covering the full resolution indices, empty for meshes too small to be worth splitting
+		std::vector<Meshlet> meshlets;
+		// One per vertex for meshes of a skinned model, empty otherwise
+		std::vector<SkinWeight> skinWeights;
+		// Nodes of the skeleton of the model, at most 256
+		std::vector<MeshBone> bones;
 		
 		Renderer::RendererMesh rendererMesh;
 		Maths::AABB aabb;
@@ -51,6 +51,7 @@ namespace Resources
 	class Material;
 	class Mesh;
 	class Model;
+	class SkinnedModel;
 	class ShaderProgram;
 	class FragmentShader;
 	class VertexShader;
@@ -93,6 +94,7 @@ namespace Resources
 		std::vector<Material*>& GetMaterialList();
 		std::vector<Mesh*>& GetMeshList();
 		std::vector<Model*>& GetModelList();
+		std::vector<SkinnedModel*>& GetSkinnedModelList();
 		std::vector<ShaderProgram*>& GetShaderProgramList();
 		std::vector<FragmentShader*>& GetFragmentShaderList();
 		std::vector<VertexShader*>& GetVertexShaderList();
@@ -114,6 +116,7 @@ namespace Resources
 		std::vector<Material*> materialCached;
 		std::vector<Mesh*> meshCached;
 		std::vector<Model*> modelCached;
+		std::vector<SkinnedModel*> skinnedModelCached;
 		std::vector<ShaderProgram*> shaderProgramCached;
 		std::vector<FragmentShader*> fragmentShaderCached;
 		std::vector<VertexShader*> vertexShaderCached;
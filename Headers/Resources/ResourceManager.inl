@@ -133,6 +133,12 @@ inline void Resources::ResourceManager::PushResource<Resources::Model>(Resources
     modelCached.push_back(res);
 }
 
+template<>
+inline void Resources::ResourceManager::PushResource<Resources::SkinnedModel>(Resources::SkinnedModel* res)
+{
+    skinnedModelCached.push_back(res);
+}
+
 template<>
 inline void Resources::ResourceManager::PushResource<Resources::Sound>(Resources::Sound* res)
 {
@@ -17,7 +17,13 @@ namespace Resources
 		virtual void Write(Core::Serialization::Serializer& sr) override;
 		void Load(Core::Serialization::Deserializer& dr) override;
 		virtual void WindowCreateResource(bool& open) override = 0;
+		// Rebuilds the shader from a GLSL file, the current SPIR-V is kept if it does not compile
+		bool LoadSource(const std::string& source);
+		// Updated engine GLSL file named after the resource, empty if there is none
+		std::string FindSource();
 		std::string shaderData;
+		// GLSL file the shader was last built from, empty when it only comes from its asset
+		std::string sourcePath;
 	};
 
 	class NAT_API FragmentShader : public Shader
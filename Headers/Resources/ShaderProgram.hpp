@@ -63,6 +63,8 @@ namespace Resources
 		const ShaderProgram* GetShader(ShaderVariant variant = ShaderVariant::Default) const;
 		ShaderVariant GetShaderType() const { return type; }
 		static ShaderProgram* GetDefaultShader();
+		// True when both stages were built from a source passing the object id to the id attachment
+		bool WritesObjectID() const { return writesObjectID; }
 		ObjectType GetType() override { return ObjectType::ShaderProgramType; }
 
 	private:
@@ -92,6 +94,7 @@ namespace Resources
 		ShaderProgram* shadowCubeVariant = nullptr;
 		ShaderProgram* objectVariant = nullptr;
 		ShaderProgram* haloVariant = nullptr;
+		bool writesObjectID = false;
 
 		static ShaderProgram* defaultShaderProgram;
 		friend Core::App;
@@ -1,19 +1,70 @@
 #pragma once
 
-#include "IResource.hpp"
+#include <string>
+#include <vector>
+
+#include "Resources/Model.hpp"
 
 namespace Resources
 {
-	class NAT_API SkinnedModel : public IResource
+	// Node of the hierarchy the bones are attached to, parents are stored before their children
+	struct SkeletonNode
+	{
+		std::string name;
+		s32 parent = -1;
+		// Transform relative to the parent when no animation channel moves the node
+		Maths::Mat4 local = Maths::Mat4(1);
+	};
+
+	struct VectorKey
+	{
+		f32 time = 0.0f;
+		Maths::Vec3 value;
+	};
+
+	struct QuatKey
+	{
+		f32 time = 0.0f;
+		Maths::Quat value;
+	};
+
+	// Keyframes of one node, sorted by time in seconds
+	struct AnimationChannel
+	{
+		u32 node = 0;
+		std::vector<VectorKey> positions;
+		std::vector<QuatKey> rotations;
+		std::vector<VectorKey> scales;
+	};
+
+	struct Animation
+	{
+		std::string name;
+		// Seconds
+		f32 duration = 0.0f;
+		std::vector<AnimationChannel> channels;
+	};
+
+	// Model whose meshes are bound to a skeleton, see Mesh::skinWeights
+	class NAT_API SkinnedModel : public Model
 	{
 	public:
 		SkinnedModel();
+		~SkinnedModel() override = default;
+
 		void DeleteData() override;
+		void Write(Core::Serialization::Serializer& sr) override;
+		void Load(Core::Serialization::Deserializer& dr) override;
 		void WindowCreateResource(bool& open) override;
-		~SkinnedModel() override;
+		ObjectType GetType() override { return ObjectType::SkinnedModelType; }
 
-	private:
+		// Transform of every node relative to the model at the time of the animation, which loops over its duration.
+		// An animation out of range gives the bind pose
+		void EvaluatePose(u32 animation, f32 time, std::vector<Maths::Mat4>& pose) const;
+		// Moves the bind pose vertices of the mesh to their place in the pose, one matrix per bone of the mesh
+		void GetBoneMatrices(const Mesh* mesh, const std::vector<Maths::Mat4>& pose, std::vector<Maths::Mat4>& matrices) const;
 
+		std::vector<SkeletonNode> nodes;
+		std::vector<Animation> animations;
 	};
-
-}
\ No newline at end of file
+}
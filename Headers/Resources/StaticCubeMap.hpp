@@ -4,6 +4,7 @@
 
 #include "Maths/Maths.hpp"
 
+#include "Texture.hpp"
 #include "CubeMap.hpp"
 
 namespace Core
@@ -26,6 +27,7 @@ namespace Resources
 
 		void* cubeMapData = nullptr;
 		bool isFloat = false;
+		TextureEncoding encoding = TextureEncoding::RAW;
 
 		static StaticCubeMap* GetDebugCubeMap();
 		static StaticCubeMap* GetDefaultCubeMap();
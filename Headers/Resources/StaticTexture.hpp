@@ -26,6 +26,7 @@ namespace Resources
 
 		void* textureData = nullptr;
 		bool isFloat = false;
+		TextureEncoding encoding = TextureEncoding::RAW;
 
 		static StaticTexture* GetDebugTexture();
 		static StaticTexture* GetDefaultTexture();
@@ -10,6 +10,19 @@
 
 namespace Resources
 {
+	// Raw data is the base level only, the mips being generated on upload. Encoded data holds every level of the chain one
+	// after the other, with the faces of cube maps one after the other in each level
+	enum class TextureEncoding : u8
+	{
+		RAW = 0,
+		BC1,
+		BC5,
+		BC7,
+		RGBA8,
+		RGBA16F,
+		RGB9E5,
+	};
+
 	class NAT_API Texture : public IResource
 	{
 	public:
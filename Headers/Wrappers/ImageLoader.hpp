@@ -12,6 +12,8 @@ namespace Wrappers
 		DEFAULT = 0,
 		SRGB,
 		SRGB_LINEAR,
+		// Tangent space normals, only their first two components are kept once encoded
+		NORMAL,
 	};
 	class NAT_API ImageLoader
 	{
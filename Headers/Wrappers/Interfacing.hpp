@@ -16,6 +16,7 @@
 #include "WindowManager.hpp"
 
 #include "Core/Scene/Components/RenderModelComponent.hpp"
+#include "Core/Scene/Components/SkinnedRenderModelComponent.hpp"
 #include "Core/Scene/Components/Lights/DirectionalLightComponent.hpp"
 #include "Core/Scene/Components/Lights/PointLightComponent.hpp"
 #include "Core/Scene/Components/Lights/SpotLightComponent.hpp"
@@ -225,6 +226,7 @@ namespace Wrappers
 		void GetModelList(Resources::Model& model, bool& open);
 		void GetModelListToRenderModelComponent(Core::Scene::Components::RenderModelComponent* model, bool& open);
 		bool ModelListCombo(Resources::Model** pOutSelectedModel, const char* id = "###ModelListCombo");
+		bool SkinnedModelListCombo(Resources::SkinnedModel** pOutSelectedModel, const char* id = "###SkinnedModelListCombo");
 		bool MaterialListCombo(Resources::Material** pOutSelectedMaterial, const char* id = "###MaterialListCombo");
 		bool MeshListCombo(Resources::Mesh** pOutSelectedMesh, const char* id = "###MeshListCombo");
 		bool SceneListCombo(Core::Scene::Scene** pOutSelectedScene, const char* id = "###SceneListCombo");
@@ -317,8 +319,9 @@ namespace Wrappers
 		Resources::Material** materialPopup = nullptr;
 		Resources::Mesh** meshPopup = nullptr;
 		
-		std::array<std::unique_ptr<Core::Scene::Components::IComponent>, 24> baseComponents = {
+		std::array<std::unique_ptr<Core::Scene::Components::IComponent>, 25> baseComponents = {
 			std::make_unique<Core::Scene::Components::RenderModelComponent>(),
+			std::make_unique<Core::Scene::Components::SkinnedRenderModelComponent>(),
 			std::make_unique<Core::Scene::Components::Lights::DirectionalLightComponent>(),
 			std::make_unique<Core::Scene::Components::Lights::PointLightComponent>(),
 			std::make_unique<Core::Scene::Components::Lights::SpotLightComponent>(),
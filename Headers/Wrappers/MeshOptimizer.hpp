@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "Core/Types.hpp"
+
+#include "Resources/Mesh.hpp"
+
+// Entries of the simulated post-transform vertex cache
+#define MESH_CACHE_SIZE 16
+
+namespace Wrappers
+{
+	struct VertexCacheStats
+	{
+		// Average cache miss ratio, transformed vertices per triangle
+		f32 acmr = 0.0f;
+		// Average transform to vertex ratio, transformed vertices per unique vertex
+		f32 atvr = 0.0f;
+	};
+
+	// Reorders the triangles and vertices of imported meshes for the GPU, without changing what is drawn
+	class NAT_API MeshOptimizer
+	{
+	public:
+		MeshOptimizer() = default;
+		~MeshOptimizer() = default;
+
+		// Reorders the triangles of every level of detail for the vertex cache, sorts clusters of the full resolution
+		// level so outward facing ones are drawn first, then renumbers vertices in the order they are first fetched.
+		// Meshlets are kept contiguous, only their order and the order of triangles inside them change
+		static void OptimizeMesh(Resources::Mesh* mesh);
+
+		// Tipsify reordering of the triangles of the range, clusterStarts receives the first index of each cluster
+		// that restarted from a dead end when given
+		static void OptimizeVertexCache(u32* indices, u32 indexCount, u32 vertexCount, std::vector<u32>* clusterStarts = nullptr);
+
+		// Simulates a FIFO cache of MESH_CACHE_SIZE entries over the indices
+		static VertexCacheStats AnalyzeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount);
+	};
+}
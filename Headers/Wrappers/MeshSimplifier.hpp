@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "Core/Types.hpp"
+
+#include "Resources/Mesh.hpp"
+
+namespace Wrappers
+{
+	// Quadric error edge collapse simplification. Vertices are only ever moved onto one of their neighbours, so every
+	// level of detail indexes the vertex buffer of the full resolution mesh
+	class NAT_API MeshSimplifier
+	{
+	public:
+		MeshSimplifier() = default;
+		~MeshSimplifier() = default;
+
+		// Fills the levels of detail of the mesh, each about half the triangles of the previous one, until the mesh
+		// stops getting simpler or the error grows past maxError, relative to the largest side of the mesh bounds
+		static void GenerateLods(Resources::Mesh* mesh, u32 maxLods = 4, f32 maxError = 0.05f);
+
+		// Collapses edges until at most targetIndexCount indices remain or no collapse stays under maxError, in
+		// units of the positions. Returns the largest error of the applied collapses
+		static f32 Simplify(const std::vector<Renderer::RendererVertex>& vertices, std::vector<u32>& indices, u32 targetIndexCount, f32 maxError);
+	};
+}
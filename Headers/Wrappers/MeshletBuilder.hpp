@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Core/Types.hpp"
+
+#include "Resources/Mesh.hpp"
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+// Fewer clusters than this are not worth the extra draws and tests
+#define MESHLET_MIN_COUNT 4
+
+namespace Wrappers
+{
+	// Splits the full resolution indices of a mesh into small clusters that can be culled on their own
+	class NAT_API MeshletBuilder
+	{
+	public:
+		MeshletBuilder() = default;
+		~MeshletBuilder() = default;
+
+		// Reorders the indices of the mesh so each meshlet is a contiguous range, growing clusters from neighbouring
+		// triangles that add the fewest new vertices. Meshes with only a few clusters worth of triangles are left whole
+		static void BuildMeshlets(Resources::Mesh* mesh);
+	};
+}
@@ -3,20 +3,32 @@
 #include "assimp/scene.h"
 
 #include "Resources/Model.hpp"
+#include "Resources/SkinnedModel.hpp"
 
 #include "Wrappers/ModelLoader/IModelLoader.hpp"
 #include "Renderer/VulkanRenderer.hpp"
 
+namespace Assimp
+{
+	class Importer;
+}
+
 namespace Wrappers::ModelLoader
 {
 	class NAT_API AssimpModelLoader : public IModelLoader
 	{
 	public:
 		static void ParseModel(const char* pModelFilePath, Resources::Model* pModelOutput);
+		// Creates a SkinnedModel if a mesh of the file has bones and a Model otherwise, nullptr if the file cannot be read
+		static Resources::Model* ImportModel(const char* pModelFilePath, const std::string& name);
 	private :
+		static const aiScene* ReadScene(Assimp::Importer& importer, const char* pModelFilePath);
 		static void ProcessAssimpScene(const aiScene* pScene, Resources::Model* pModelOutput, const std::string& path);
+		static void ReadSkeleton(const aiScene* pScene, Resources::SkinnedModel* pModelOutput, std::vector<u32>& meshNodes);
+		static void ReadAnimations(const aiScene* pScene, Resources::SkinnedModel* pModelOutput);
 		static void ReadMaterialProperties(Resources::Material*& modelMat, aiMaterial* matIn, const std::string& meshName, const std::string& path);
-		static void ReadMeshVertices(Resources::Mesh*& modelMesh, const aiMesh* meshIn);
+		static void ReadMeshVertices(Resources::Mesh*& modelMesh, const aiMesh* meshIn, const Resources::SkinnedModel* skeleton = nullptr, u32 meshNode = 0);
+		static void ReadSkinWeights(Resources::Mesh* modelMesh, const aiMesh* meshIn, const Resources::SkinnedModel* skeleton, u32 meshNode);
 		static void ReadTexture(Resources::StaticTexture*& tex, const std::string& folder, const char* path, bool isNormal = false);
 		static Resources::ResourceManager* resources;
 		static Renderer::VulkanRenderer* renderer;
@@ -103,6 +103,7 @@ namespace Wrappers::PhysicsEngine
 		
 		void DrawLines();
 		void DrawTriangles();
+		void DrawInstances(BatchImpl* pBatch, bool pInstanced);
 
 		void CleanBuffers();
 
@@ -119,10 +120,11 @@ namespace Wrappers::PhysicsEngine
 			JPH::Color  color;
 		};
 
-		Resources::Mesh* mLines = nullptr;
+		// Immediate geometry is rewritten into the renderer transient ring every frame
+		std::vector<Renderer::RendererVertex> mLines;
 		std::mutex		mLinesLock;
 
-		Resources::Mesh mTriangles;
+		std::vector<Renderer::RendererVertex> mTriangles;
 		std::mutex		mTrianglesLock;
 
 		Batch mEmptyBatch;
@@ -137,6 +139,7 @@ namespace Wrappers::PhysicsEngine
 		
 		std::mutex	mWireFrameLock;
 		InstanceMap mWireframeInstances;
+		std::vector<Maths::Mat4> mInstanceMatrices;
 
 		Renderer::VulkanRenderer* mRenderer = nullptr;
 	};
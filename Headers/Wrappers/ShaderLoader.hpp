@@ -13,5 +13,7 @@ namespace Wrappers
 		~ShaderLoader() = default;
 
 		static std::string LoadCompileShader(char const* filename);
+		// Loads the compiled shader from Cache/Shaders, compiling it again only if the source is newer
+		static std::string LoadCachedShader(char const* filename);
 	};
 }
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Core/Types.hpp"
+
+#include "Resources/StaticTexture.hpp"
+#include "Resources/StaticCubeMap.hpp"
+
+namespace Wrappers
+{
+	// Builds the mip chain of textures on the CPU and stores it in the format sampled by the GPU. Block compressed
+	// encodings cover 4x4 texels per block, laid out as the matching BCn Vulkan format
+	class NAT_API TextureEncoder
+	{
+	public:
+		TextureEncoder() = default;
+		~TextureEncoder() = default;
+
+		// Replaces the raw data of the texture by its encoded mip chain. LDR images use BC5 for normal maps, BC1 when
+		// opaque and BC7 otherwise, or RGBA8 without block compression. HDR images use RGB9E5 when opaque and positive,
+		// RGBA16F when in half range and are kept as they are otherwise
+		static bool EncodeTexture(Resources::StaticTexture* texture, bool normalMap, bool blockCompression);
+		static bool EncodeCubeMap(Resources::StaticCubeMap* cubeMap, bool blockCompression);
+
+		static bool IsBlockCompressed(Resources::TextureEncoding encoding);
+		// Size of a 4x4 block for block compressed encodings, of a texel otherwise
+		static u64 GetBlockSize(Resources::TextureEncoding encoding);
+		static u64 GetLevelSize(Resources::TextureEncoding encoding, Maths::IVec2 resolution, u32 level);
+		static u64 GetEncodedSize(Resources::TextureEncoding encoding, Maths::IVec2 resolution, u32 mipLevels, u32 layers = 1);
+
+		// Opaque RGB with 565 endpoints and 2 bit indices, 8 bytes
+		static void EncodeBC1Block(const u8* texels, u8* output);
+		// Red then green channel as two BC4 blocks of 8 bit endpoints and 3 bit indices, 16 bytes
+		static void EncodeBC5Block(const u8* texels, u8* output);
+		// Mode 6 only: a single RGBA subset of 7 bit endpoints with shared low bits and 4 bit indices, 16 bytes
+		static void EncodeBC7Block(const u8* texels, u8* output);
+		// Three 9 bit mantissas sharing a 5 bit exponent, negative values are clamped to 0
+		static u32 PackRGB9E5(const f32* color);
+	};
+}
@@ -103,6 +103,8 @@ namespace Wrappers
 		bool IsFullScreen() const { return isFullScreen; }
 		f64 GetWindowTime() const { return windowTime; }
 		f32 GetDeltaTime() const { return deltaTime; }
+		// Advances the time by a fixed step instead of reading the clock, for runs without a window
+		void StepTime(f32 delta) { deltaTime = delta; windowTime += delta; }
 		static void ExecuteCommand(const std::string& command, const std::string& args = "");
 		static s32 OpenPopup(const std::string& title, const std::string& message, PopupParam params);
 		static s32 OpenPopup(const std::string& title, const std::string& message, u32 params);
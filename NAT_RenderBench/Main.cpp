@@ -0,0 +1,52 @@
+#include "Core/BenchApp.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+#include "Core/Debugging/Log.hpp"
+
+#ifdef _WIN32
+#ifndef NDEBUG
+#include <crtdbg.h>
+#endif
+#endif
+
+/*
+* render_bench [-frames N] [-warmup N] [-capture N] [-scene HASH] [-resolution W H]
+* Runs from the project folder with the resources already cached, the scene hash is read in hexadecimal
+*/
+
+s32 main(s32 argc, char** argv)
+{
+#ifndef NDEBUG
+#ifdef _WIN32
+	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
+#endif
+#endif
+	Wrappers::PhysicsEngine::JoltPhysicsEngine::Register();
+
+	Core::Debugging::Log::SetVerbosity(DEBUG_LEVEL::LDEFAULT);
+	Core::Debugging::Log::OpenLogFile();
+	Core::BenchApp app;
+	for (s32 i = 1; i < argc; i++)
+	{
+		const bool hasValue = i + 1 < argc;
+		if (!strcmp(argv[i], "-frames") && hasValue) app.frameCount = static_cast<u32>(strtoul(argv[++i], nullptr, 10));
+		else if (!strcmp(argv[i], "-warmup") && hasValue) app.warmupFrames = static_cast<u32>(strtoul(argv[++i], nullptr, 10));
+		else if (!strcmp(argv[i], "-capture") && hasValue) app.captureInterval = static_cast<u32>(strtoul(argv[++i], nullptr, 10));
+		else if (!strcmp(argv[i], "-scene") && hasValue) app.sceneHash = Maths::Util::ReadHex(argv[++i]);
+		else if (!strcmp(argv[i], "-resolution") && i + 2 < argc)
+		{
+			app.resolution.x = atoi(argv[++i]);
+			app.resolution.y = atoi(argv[++i]);
+		}
+		else
+		{
+			LOG(DEBUG_LEVEL::LWARNING, "Unknown argument %s", argv[i]);
+		}
+	}
+	app.Init();
+	app.Run();
+	app.Destroy();
+	return Core::Debugging::Log::HasError() ? EXIT_FAILURE : EXIT_SUCCESS;
+}
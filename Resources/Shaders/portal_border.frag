@@ -24,6 +24,15 @@ layout(binding = 2) uniform sampler2D texSampler;
 layout(binding = 3) uniform sampler2D normSampler;
 layout(binding = 4) uniform sampler2D heightSampler;
 
+layout(constant_id = 0) const bool COMPACT_GBUFFER = false;
+
+vec2 OctEncode(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.xy;
+}
+
 // Adapted from this shader : 
 //  301's Fire Shader - Remix 3 by mu6k
 // https://www.shadertoy.com/view/4ttGWM
@@ -85,6 +94,14 @@ void main()
     color = color/(1.0+max(vec3(0),color));
 	if (length(color) < 0.6) discard;
 	outColor = vec4(color.x, color.y, color.z, 1.0);
-	outNormal = vec4(vOut.worldNormal, 1);
-	outPosition = vec4(vOut.worldPos, ubo.matShininess);
+	if (COMPACT_GBUFFER)
+	{
+		outNormal = vec4(OctEncode(normalize(vOut.worldNormal)), 0, 0);
+		outPosition = vec4(log2(max(ubo.matShininess, 1.0)) / 16.0, 0, 0, 1);
+	}
+	else
+	{
+		outNormal = vec4(vOut.worldNormal, 1);
+		outPosition = vec4(vOut.worldPos, ubo.matShininess);
+	}
 }
\ No newline at end of file
@@ -45,6 +45,18 @@ App::App() : soundEngine(), soundLoader(soundEngine.GetEngine())
 void Core::App::TakeScreenshot()
 {
 	LowRenderer::FrameBuffer fb = renderer.GetMainLightBuffer();
+	if (renderer.GetHDRFormat() == VK_FORMAT_R16G16B16A16_SFLOAT)
+	{
+		std::string raw = renderer.ReadTexture(&fb, Maths::IVec2(), fb.resolution, sizeof(u16) * 4);
+		const u16* halfs = reinterpret_cast<const u16*>(raw.data());
+		std::vector<f32> pixels(raw.size() / sizeof(u16));
+		for (u64 i = 0; i < pixels.size(); i++)
+		{
+			pixels[i] = Maths::Util::HalfToFloat(halfs[i]);
+		}
+		Wrappers::ImageLoader::WriteStbi("output.hdr", fb.resolution.x, fb.resolution.y, 4, pixels.data(), false);
+		return;
+	}
 	Wrappers::ImageLoader::WriteStbi("output.hdr", fb.resolution.x, fb.resolution.y, 4, reinterpret_cast<const f32*>(renderer.ReadTexture(&fb, Maths::IVec2(), fb.resolution, sizeof(f32) * 4).data()), false);
 }
 
@@ -117,6 +129,9 @@ bool App::LoadProjectSettings()
 		if (!size || size + dr.CursorPos() > dr.BufferSize()) return false;
 		postProcesssData.resize(size);
 		dr.Read(postProcesssData.data(), size);
+		// Missing in older settings files, the defaults are kept
+		dr.Read(sceneManager.secondaryCameraBudget);
+		dr.Read(sceneManager.portalCoverageBudget);
 		return fullScreen;
 	}
 	if (!defaultSceneHash) defaultSceneHash = 0x69;
@@ -133,6 +148,8 @@ void Core::App::SaveProjectSettings()
 	sceneManager.postManager.Serialize(sr2);
 	sr.Write(sr2.GetBufferSize());
 	sr.Write(sr2.GetBuffer(), sr2.GetBufferSize());
+	sr.Write(sceneManager.secondaryCameraBudget);
+	sr.Write(sceneManager.portalCoverageBudget);
 	FileManager::WriteFile("ProjectSettings.bin", sr.GetBuffer(), sr.GetBufferSize());
 }
 
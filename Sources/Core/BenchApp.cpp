@@ -0,0 +1,127 @@
+#include "Core/BenchApp.hpp"
+
+#include <algorithm>
+
+#include "Core/Debugging/Log.hpp"
+
+// Simulated time between two frames, in seconds
+#define BENCH_TIME_STEP (1 / 60.0f)
+
+namespace Core
+{
+	namespace
+	{
+		// FNV-1a, the hashes only need to match between runs
+		u64 HashPixels(const std::vector<u8>& pixels)
+		{
+			u64 result = 0xcbf29ce484222325llu;
+			for (auto value : pixels)
+			{
+				result ^= value;
+				result *= 0x100000001b3llu;
+			}
+			return result;
+		}
+	}
+
+	void BenchApp::Init()
+	{
+		CreateFolders();
+		LoadProjectSettings();
+		if (resolution.x > 0 && resolution.y > 0) defaultResolution = resolution;
+		renderer.headless = true;
+		renderer.enableValidationLayers = false;
+		renderer.PreInit();
+		renderer.SetClearColor(Maths::Vec4(powf(0.57f, 2.4f), powf(0.84f, 2.4f), powf(0.95f, 2.4f), 1.0f));
+		renderer.Init(nullptr, defaultResolution, false);
+		renderer.GetProfiler().SetEnabled(true);
+
+		physicsEngine.Init(&renderer);
+		sceneManager.postManager.Init();
+		LoadResourcesAlreadyCached();
+		Serialization::Deserializer dr(postProcesssData);
+		sceneManager.postManager.Deserialize(dr);
+		if (sceneHash) defaultSceneHash = sceneHash;
+		defaultScene = resourceManager.Get<Scene::Scene>(defaultSceneHash);
+		if (!defaultScene)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "Scene %s is not in the cache", Maths::Util::GetHex(defaultSceneHash).c_str());
+			throw std::runtime_error("Benchmark scene is not in the cache");
+		}
+		sceneManager.activeScenes.push_back(defaultScene->CreateCopy());
+		sceneManager.activeScenes.back()->Init();
+		sceneManager.activeScenes.back()->ForceUpdate();
+	}
+
+	void BenchApp::Run()
+	{
+		std::vector<Renderer::VulkanRenderer::FrameStats> frames;
+		frames.reserve(frameCount);
+		std::vector<u8> pixels;
+		for (u32 i = 0; i < frameCount; i++)
+		{
+			window.StepTime(BENCH_TIME_STEP);
+			const f32 angle = Maths::Util::ToRadians(360.0f * i / frameCount);
+			const Maths::Vec3 position = Maths::Vec3(cosf(angle) * orbitRadius, orbitHeight, sinf(angle) * orbitRadius);
+			sceneManager.UpdateScripted(defaultResolution, position, Maths::Vec3());
+
+			const bool capture = captureInterval && ((i + 1) % captureInterval == 0 || i + 1 == frameCount);
+			renderer.BeginFrame(nullptr);
+			if (capture) renderer.CaptureFrame();
+			sceneManager.Render();
+			renderer.EndFrame(nullptr);
+
+			if (i >= warmupFrames) frames.push_back(renderer.GetFrameStats());
+			if (capture && renderer.ReadCapturedFrame(pixels))
+			{
+				LOG_DEFAULT("Frame %u : image %s", i, Maths::Util::GetHex(HashPixels(pixels)).c_str());
+			}
+		}
+		renderer.WaitIdle();
+
+		if (frames.empty())
+		{
+			LOG(DEBUG_LEVEL::LWARNING, "No frame left to report after %u warmup frames", warmupFrames);
+			return;
+		}
+		f64 recordTime = 0;
+		f64 submitTime = 0;
+		f64 minRecord = frames.front().recordTime, maxRecord = minRecord;
+		f64 minSubmit = frames.front().submitTime, maxSubmit = minSubmit;
+		u64 drawCalls = 0;
+		u64 descriptorWrites = 0;
+		for (auto& frame : frames)
+		{
+			recordTime += frame.recordTime;
+			submitTime += frame.submitTime;
+			drawCalls += frame.drawCalls;
+			descriptorWrites += frame.descriptorWrites;
+			minRecord = std::min(minRecord, frame.recordTime);
+			maxRecord = std::max(maxRecord, frame.recordTime);
+			minSubmit = std::min(minSubmit, frame.submitTime);
+			maxSubmit = std::max(maxSubmit, frame.submitTime);
+		}
+		const f64 count = static_cast<f64>(frames.size());
+		LOG_DEFAULT("%u frames at %dx%d, %u warmup frames excluded", frameCount, defaultResolution.x, defaultResolution.y, warmupFrames);
+		LOG_DEFAULT("Record : avg %.3f ms, min %.3f ms, max %.3f ms", recordTime * 1000.0 / count, minRecord * 1000.0, maxRecord * 1000.0);
+		LOG_DEFAULT("Submit : avg %.3f ms, min %.3f ms, max %.3f ms", submitTime * 1000.0 / count, minSubmit * 1000.0, maxSubmit * 1000.0);
+		LOG_DEFAULT("Draw calls : avg %.1f, descriptor writes : avg %.1f", drawCalls / count, descriptorWrites / count);
+		// GPU times cover the last PROFILER_HISTORY frames read back
+		for (auto& result : renderer.GetProfiler().GetResults())
+		{
+			LOG_DEFAULT("%*s%s : avg %.3f ms, max %.3f ms", static_cast<s32>(result.depth * 2), "", result.name.c_str(), result.averageTime, result.maxTime);
+		}
+	}
+
+	void BenchApp::Destroy()
+	{
+		sceneManager.Clean();
+		renderer.WaitIdle();
+		resourceManager.DeleteAllResources();
+		renderer.CleanupBuffers();
+
+		physicsEngine.Release();
+
+		renderer.Cleanup();
+	}
+}
@@ -1,6 +1,7 @@
 #include "Core/Scene/Components/IComponent.hpp"
 
 #include "Core/Scene/Components/RenderModelComponent.hpp"
+#include "Core/Scene/Components/SkinnedRenderModelComponent.hpp"
 #include "Core/Scene/Components/Lights/DirectionalLightComponent.hpp"
 #include "Core/Scene/Components/Lights/PointLightComponent.hpp"
 #include "Core/Scene/Components/Lights/SpotLightComponent.hpp"
@@ -61,7 +62,7 @@ namespace Core::Scene::Components
         case ComponentType::RenderModel:
             return new RenderModelComponent();
         case ComponentType::SkinnedRenderModel:
-            return nullptr; // TODO
+            return new SkinnedRenderModelComponent();
         case ComponentType::PointLight:
             return new Lights::PointLightComponent();
         case ComponentType::SpotLight:
@@ -1,5 +1,7 @@
 #include "Core/Scene/Components/Lights/ILightComponent.hpp"
 
+#include <limits>
+
 #include "Core/App.hpp"
 
 using namespace Core::Scene::Components::Lights;
@@ -11,6 +13,14 @@ ILightComponent::ILightComponent() : IComponent()
 	renderer = &Core::App::GetInstance()->GetRenderer();
 }
 
+f32 ILightComponent::GetAttenuationRadius(f32 linear, f32 quadratic)
+{
+	const f32 threshold = 256.0f / 5.0f - 1.0f;
+	if (quadratic > 0.0f) return (-linear + sqrtf(linear * linear + 4 * quadratic * threshold)) / (2 * quadratic);
+	if (linear > 0.0f) return threshold / linear;
+	return std::numeric_limits<f32>::max();
+}
+
 void ILightComponent::RenderGui()
 {
 	interfaceGui->ColorEdit3("Ambient Light", AmbientColor);
@@ -7,13 +7,15 @@ using namespace Core::Scene::Components::Lights;
 
 PointLightComponent::PointLightComponent() : ILightComponent()
 {
+	UpdateRadius();
 }
 
 void PointLightComponent::RenderGui()
 {
 	ILightComponent::RenderGui();
-	interfaceGui->SliderFloat("Linear Attenuation", &Linear, 0.0f, 2.0f, false);
-	interfaceGui->SliderFloat("Quadratic Attenuation", &Quadratic, 0.0f, 2.0f, false);
+	bool changed = interfaceGui->SliderFloat("Linear Attenuation", &Linear, 0.0f, 2.0f, false);
+	changed |= interfaceGui->SliderFloat("Quadratic Attenuation", &Quadratic, 0.0f, 2.0f, false);
+	if (changed) UpdateRadius();
 }
 
 IComponent* PointLightComponent::CreateCopy()
@@ -44,4 +46,10 @@ void PointLightComponent::Deserialize(Serialization::Deserializer& dr)
 	ILightComponent::Deserialize(dr);
 	dr.Read(Linear);
 	dr.Read(Quadratic);
+	UpdateRadius();
+}
+
+void PointLightComponent::UpdateRadius()
+{
+	Radius = GetAttenuationRadius(Linear, Quadratic);
 }
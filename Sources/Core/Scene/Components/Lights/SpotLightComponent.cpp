@@ -7,15 +7,17 @@ using namespace Core::Scene::Components::Lights;
 
 SpotLightComponent::SpotLightComponent() : ILightComponent()
 {
+	UpdateBounds();
 }
 
 void SpotLightComponent::RenderGui()
 {
 	ILightComponent::RenderGui();
-	interfaceGui->SliderFloat("Linear Attenuation", &Linear, 0.0f, 5.0f, false);
-	interfaceGui->SliderFloat("Quadratic Attenuation", &Quadratic, 0.0f, 5.0f, false);
-	interfaceGui->SliderFloat("Angle", &Angle, 0.0f, (f32)M_PI, false);
+	bool changed = interfaceGui->SliderFloat("Linear Attenuation", &Linear, 0.0f, 5.0f, false);
+	changed |= interfaceGui->SliderFloat("Quadratic Attenuation", &Quadratic, 0.0f, 5.0f, false);
+	changed |= interfaceGui->SliderFloat("Angle", &Angle, 0.0f, (f32)M_PI, false);
 	interfaceGui->SliderFloat("Ratio", &Ratio, 0.0f, 1.0f, false);
+	if (changed) UpdateBounds();
 }
 
 IComponent* SpotLightComponent::CreateCopy()
@@ -51,4 +53,25 @@ void SpotLightComponent::Deserialize(Serialization::Deserializer& dr)
 	dr.Read(Quadratic);
 	dr.Read(Angle);
 	dr.Read(Ratio);
+	UpdateBounds();
+}
+
+void SpotLightComponent::UpdateBounds()
+{
+	Radius = GetAttenuationRadius(Linear, Quadratic);
+	if (Angle > (f32)M_PI_2)
+	{
+		BoundOffset = 0.0f;
+		BoundRadius = Radius;
+	}
+	else if (Angle > (f32)M_PI_4)
+	{
+		BoundOffset = Radius * cosf(Angle);
+		BoundRadius = Radius * sinf(Angle);
+	}
+	else
+	{
+		BoundOffset = Radius / (2.0f * cosf(Angle));
+		BoundRadius = BoundOffset;
+	}
 }
@@ -51,21 +51,27 @@ void RenderModelComponent::Render(const Maths::Mat4& mvp, const Maths::Mat4& vp,
 	if (!meshes.size() || (hideFirst && !(pass & LowRenderer::RenderPassType::SECONDARY)) || (hideSecond && (pass & LowRenderer::RenderPassType::SECONDARY))) return;
 	auto& renderer = App::GetInstance()->GetRenderer();
 	renderer.BindShader(shader);
-	if (pass == LowRenderer::RenderPassType::OBJECT)
-	{
-		for (auto& mesh : meshes)
-		{
-			if (!mesh) continue;
-			renderer.RenderMeshObject(mesh, mvp, SceneManager::GetInstance()->GetNextIndex(gameObject));
-		}
-	}
-	else if (pass & targetPass)
+	if (pass & targetPass)
 	{
+		mLodLevels.resize(meshes.size());
+		// Picking reads the ids of the main view, portals seen from it included
+		renderer.SetObjectID(pass & LowRenderer::RenderPassType::DEFAULT ? SceneManager::GetInstance()->GetNextIndex(gameObject) : 0);
+		Maths::IVec2 resolution = renderer.GetActiveResolution();
 		for (u64 i = 0; i < meshes.size(); ++i)
 		{
-			if (!meshes[i] || (useCulling && !meshes[i]->aabb.IsOnFrustum(cameraFrustum, gameObject->transform.GetGlobal()))) continue; // GET CULLED IDIOT
-			renderer.RenderMesh(meshes[i], gameObject->transform.GetGlobal(), mvp, materials[i]);
+			if (!meshes[i]) continue;
+			u32 lod = meshes[i]->SelectLod(meshes[i]->aabb.GetScreenSize(mvp, Maths::Vec2(static_cast<f32>(resolution.x), static_cast<f32>(resolution.y))), mLodLevels[i]);
+			if (pass == LowRenderer::RenderPassType::DEFAULT) mLodLevels[i] = lod;
+			const Renderer::SkinnedVertexBuffer* skinned = GetSkinnedVertices(i);
+			// Default shaded meshes are culled and drawn on the GPU when the pass allows it
+			if (!skinned && shader == Resources::ShaderProgram::GetDefaultShader() && renderer.RenderMeshIndirect(meshes[i], materials[i], gameObject->transform.GetGlobal(), vp, cameraFrustum, useCulling, lod)) continue;
+			if (useCulling && !meshes[i]->aabb.IsOnFrustum(cameraFrustum, gameObject->transform.GetGlobal())) continue; // GET CULLED IDIOT
+			if (skinned)
+				renderer.RenderSkinnedMesh(meshes[i], *skinned, gameObject->transform.GetGlobal(), mvp, materials[i], lod);
+			else
+				renderer.RenderMesh(meshes[i], gameObject->transform.GetGlobal(), mvp, materials[i], lod, useCulling);
 		}
+		renderer.SetObjectID(0);
 		if (interfaceGui->GetSelectedGameObject() != gameObject) return;
 		for (u64 i = 0; i < meshes.size(); ++i)
 		{
@@ -88,6 +94,11 @@ void RenderModelComponent::RenderGui()
 {
 	if (interfaceGui->ModelListCombo(&mUsedModel))
 		this->UseModel(mUsedModel);
+	RenderMeshGui();
+}
+
+void RenderModelComponent::RenderMeshGui()
+{
 	std::vector<Resources::ShaderVariant> filters = { Resources::ShaderVariant::Default , Resources::ShaderVariant::WireFrame };
 	
 	interfaceGui->Text("Shader :");
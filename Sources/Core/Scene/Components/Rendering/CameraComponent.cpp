@@ -1,11 +1,21 @@
 #include "Core/Scene/Components/Rendering/CameraComponent.hpp"
 
+#include <cstring>
+
 #include "Core/Scene/GameObject.hpp"
 #include "Core/App.hpp"
 
 using namespace Core::Scene::Components::Rendering;
 using namespace Core::Scene::Components;
 
+namespace
+{
+	// Written in place of the near plane of the first layout, which had no version. The low byte holds the version
+	// and the pattern is a NaN, so it can never be a valid near plane
+	constexpr u32 serializedVersionMarker = 0xFFFFFF00;
+	constexpr u8 serializedVersion = 1;
+}
+
 Core::Scene::SceneManager* CameraComponent::scenes = nullptr;
 Resources::ShaderProgram* CameraComponent::boxShader = nullptr;
 
@@ -19,6 +29,9 @@ CameraComponent::CameraComponent(const CameraComponent& other) : IComponent()
 	interfaceGui = &Core::App::GetInstance()->GetInterfacing();
 	frameBuffer = other.frameBuffer;
 	camera = other.camera;
+	refreshMode = other.refreshMode;
+	refreshInterval = other.refreshInterval;
+	renderWhenHidden = other.renderWhenHidden;
 }
 
 IComponent* CameraComponent::CreateCopy()
@@ -67,6 +80,27 @@ Maths::Mat4 CameraComponent::GetVPMatrix() const
 	return camera.GetProjectionMatrix() * camera.GetViewMatrix();
 }
 
+bool CameraComponent::ShouldRefresh()
+{
+	framesSinceRefresh++;
+	if (refreshRequested) return true;
+	switch (refreshMode)
+	{
+	case CameraRefreshMode::INTERVAL:
+		return framesSinceRefresh >= refreshInterval;
+	case CameraRefreshMode::ON_DEMAND:
+		return false;
+	default:
+		return true;
+	}
+}
+
+void CameraComponent::OnRefreshed()
+{
+	framesSinceRefresh = 0;
+	refreshRequested = false;
+}
+
 void CameraComponent::RenderGui()
 {
 	interfaceGui->Image(frameBuffer, Maths::Vec2(64,64));
@@ -80,11 +114,33 @@ void CameraComponent::RenderGui()
 		frameBuffer->ClearColor = clearColor;
 		frameBuffer->UpdateClearColor();
 	}
+	bool compact = frameBuffer->GetGBufferLayout() == LowRenderer::GBufferLayout::COMPACT;
+	if (interfaceGui->CheckBox("Compact G-Buffer", &compact))
+	{
+		frameBuffer->SetGBufferLayout(compact ? LowRenderer::GBufferLayout::COMPACT : LowRenderer::GBufferLayout::FULL);
+	}
 	interfaceGui->DragInt2("Framebuffer Resolution", &tmpResolution.x);
 	if (tmpResolution != frameBuffer->GetResolution() && interfaceGui->Button("Valid Changes"))
 	{
 		frameBuffer->Resize(tmpResolution);
+		RequestRefresh();
 	}
+	static const char* const refreshModes[] = { "Every frame", "Every N frames", "On demand" };
+	int mode = static_cast<int>(refreshMode);
+	if (interfaceGui->Combo("Refresh Mode", &mode, refreshModes, 3))
+	{
+		refreshMode = static_cast<CameraRefreshMode>(mode);
+	}
+	if (refreshMode == CameraRefreshMode::INTERVAL)
+	{
+		int interval = static_cast<int>(refreshInterval);
+		if (interfaceGui->DragInt("Refresh Interval", &interval, 0.1f, 1, 120)) refreshInterval = static_cast<u32>(interval);
+	}
+	else if (refreshMode == CameraRefreshMode::ON_DEMAND && interfaceGui->Button("Refresh"))
+	{
+		RequestRefresh();
+	}
+	interfaceGui->CheckBox("Render When Hidden", &renderWhenHidden);
 }
 
 ComponentType CameraComponent::GetType()
@@ -94,17 +150,43 @@ ComponentType CameraComponent::GetType()
 
 void CameraComponent::Serialize(Core::Serialization::Serializer& sr) const
 {
+	sr.Write(serializedVersionMarker | serializedVersion);
 	sr.Write(camera.nearPlane);
 	sr.Write(camera.farPlane);
 	sr.Write(camera.fov);
+	sr.Write(static_cast<u8>(refreshMode));
+	sr.Write(refreshInterval);
+	sr.Write(renderWhenHidden);
 	if (frameBuffer) sr.Write(frameBuffer->hash);
 }
 
 void CameraComponent::Deserialize(Core::Serialization::Deserializer& dr)
 {
-	dr.Read(camera.nearPlane);
+	u32 first = 0;
+	if (!dr.Read(first)) return;
+	u8 version = 0;
+	if ((first & serializedVersionMarker) == serializedVersionMarker)
+	{
+		version = static_cast<u8>(first & ~serializedVersionMarker);
+		dr.Read(camera.nearPlane);
+	}
+	else
+	{
+		std::memcpy(&camera.nearPlane, &first, sizeof(first));
+	}
 	dr.Read(camera.farPlane);
 	dr.Read(camera.fov);
+	if (version >= 1)
+	{
+		dr.Read(reinterpret_cast<u8&>(refreshMode));
+		dr.Read(refreshInterval);
+		dr.Read(renderWhenHidden);
+	}
+	else
+	{
+		// Scenes saved before the refresh policy existed rendered their cameras every frame, visible or not
+		renderWhenHidden = true;
+	}
 	u64 hash;
 	if (dr.Read(hash))
 	{
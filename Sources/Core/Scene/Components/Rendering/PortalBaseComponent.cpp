@@ -14,7 +14,7 @@ Resources::Mesh* PortalBaseComponent::boxMesh = nullptr;
 
 void PortalBaseComponent::Render(const Maths::Mat4& mvp, const Maths::Mat4& vp, const Maths::Mat4& modelOverride, const Maths::Frustum& cameraFrustum, LowRenderer::RenderPassType pass)
 {
-	if (!(pass & (LowRenderer::OBJECT | LowRenderer::DEFAULT)) || !portalShader) return;
+	if (!(pass & LowRenderer::DEFAULT) || !portalShader) return;
 	auto& renderer = App::GetInstance()->GetRenderer();
 	if (pass & LowRenderer::DEFAULT && interfaceGui->GetSelectedGameObject() == gameObject)
 	{
@@ -22,11 +22,6 @@ void PortalBaseComponent::Render(const Maths::Mat4& mvp, const Maths::Mat4& vp,
 		renderer.BindShader(boxShader);
 		renderer.RenderMesh(boxMesh, m, m);
 	}
-	else if (pass & LowRenderer::OBJECT && portalMesh)
-	{
-		renderer.BindShader(portalShader);
-		renderer.RenderMeshObject(portalMesh, mvp, SceneManager::GetInstance()->GetNextIndex(gameObject));
-	}
 }
 
 void PortalBaseComponent::Overwrite(const Maths::Mat4& mvp, Renderer::StencilState state, u8 value, const Maths::Vec3& color)
@@ -0,0 +1,141 @@
+#include "Core/App.hpp"
+
+#include "Resources/ResourceManager.hpp"
+#include "Resources/Mesh.hpp"
+#include "Core/Scene/Components/SkinnedRenderModelComponent.hpp"
+
+using namespace Core::Scene::Components;
+
+SkinnedRenderModelComponent::SkinnedRenderModelComponent() : RenderModelComponent()
+{
+}
+
+void SkinnedRenderModelComponent::UseSkinnedModel(Resources::SkinnedModel* pModel)
+{
+	mUsedSkinnedModel = pModel;
+	UseModel(pModel);
+	if (animation >= pModel->animations.size()) animation = 0;
+}
+
+void SkinnedRenderModelComponent::Update()
+{
+	if (playing) time += App::GetInstance()->GetWindow().GetDeltaTime() * speed;
+}
+
+void SkinnedRenderModelComponent::DataUpdate()
+{
+	if (mUsedSkinnedModel && HasMeshes()) SceneManager::GetInstance()->PushSkinnedModel(this);
+}
+
+void SkinnedRenderModelComponent::UpdatePose()
+{
+	mUsedSkinnedModel->EvaluatePose(animation, time, mPose);
+	mBoneMatrices.resize(meshes.size());
+	for (u64 i = 0; i < meshes.size(); i++)
+	{
+		if (meshes[i] && meshes[i]->IsSkinned())
+			mUsedSkinnedModel->GetBoneMatrices(meshes[i], mPose, mBoneMatrices[i]);
+		else
+			mBoneMatrices[i].clear();
+	}
+}
+
+void SkinnedRenderModelComponent::Skin(Renderer::VulkanRenderer& renderer)
+{
+	for (u64 i = meshes.size(); i < mSkinnedVertices.size(); i++)
+	{
+		renderer.FreeSkinnedVertexBuffer(mSkinnedVertices[i]);
+	}
+	mSkinnedVertices.resize(meshes.size());
+	for (u64 i = 0; i < meshes.size(); i++)
+	{
+		if (i >= mBoneMatrices.size() || mBoneMatrices[i].empty())
+		{
+			renderer.FreeSkinnedVertexBuffer(mSkinnedVertices[i]);
+			continue;
+		}
+		renderer.SkinMesh(meshes[i], mBoneMatrices[i].data(), static_cast<u32>(mBoneMatrices[i].size()), mSkinnedVertices[i]);
+	}
+}
+
+const Renderer::SkinnedVertexBuffer* SkinnedRenderModelComponent::GetSkinnedVertices(u64 index) const
+{
+	if (index >= mSkinnedVertices.size() || !mSkinnedVertices[index].buffer.handle) return nullptr;
+	return &mSkinnedVertices[index];
+}
+
+IComponent* SkinnedRenderModelComponent::CreateCopy()
+{
+	SkinnedRenderModelComponent* copy = new SkinnedRenderModelComponent(*this);
+	// Each instance is skinned into its own buffers
+	copy->mSkinnedVertices.clear();
+	return copy;
+}
+
+void SkinnedRenderModelComponent::RenderGui()
+{
+	Resources::SkinnedModel* selected = mUsedSkinnedModel;
+	if (interfaceGui->SkinnedModelListCombo(&selected) && selected)
+		UseSkinnedModel(selected);
+	if (mUsedSkinnedModel && !mUsedSkinnedModel->animations.empty())
+	{
+		auto& animations = mUsedSkinnedModel->animations;
+		if (animation >= animations.size()) animation = 0;
+		if (interfaceGui->BeginCombo("Animation", animations[animation].name.c_str(), 0))
+		{
+			for (u64 i = 0; i < animations.size(); i++)
+			{
+				interfaceGui->PushId(static_cast<s32>(i));
+				if (interfaceGui->Selectable(animations[i].name.c_str())) animation = static_cast<u32>(i);
+				interfaceGui->PopId();
+			}
+			interfaceGui->EndCombo();
+		}
+		interfaceGui->CheckBox("Playing", &playing);
+		interfaceGui->DragFloat("Speed", &speed, 0.01f);
+		interfaceGui->DragFloat("Time", &time, 0.01f);
+	}
+	interfaceGui->Separator();
+	RenderMeshGui();
+}
+
+ComponentType SkinnedRenderModelComponent::GetType()
+{
+	return ComponentType::SkinnedRenderModel;
+}
+
+void SkinnedRenderModelComponent::Serialize(Core::Serialization::Serializer& sr) const
+{
+	sr.Write(mUsedSkinnedModel ? mUsedSkinnedModel->hash : (u64)0);
+	RenderModelComponent::Serialize(sr);
+	sr.Write(animation);
+	sr.Write(time);
+	sr.Write(speed);
+	sr.Write(static_cast<u8>(playing));
+}
+
+void SkinnedRenderModelComponent::Deserialize(Core::Serialization::Deserializer& dr)
+{
+	u64 hash = 0;
+	dr.Read(hash);
+	if (hash) mUsedSkinnedModel = App::GetInstance()->GetResources().Get<Resources::SkinnedModel>(hash);
+	RenderModelComponent::Deserialize(dr);
+	dr.Read(animation);
+	dr.Read(time);
+	dr.Read(speed);
+	u8 value = 1;
+	dr.Read(value);
+	playing = value;
+}
+
+void SkinnedRenderModelComponent::Delete()
+{
+	auto& renderer = App::GetInstance()->GetRenderer();
+	for (auto& vertices : mSkinnedVertices)
+	{
+		renderer.FreeSkinnedVertexBuffer(vertices);
+	}
+	mSkinnedVertices.clear();
+	if (mUsedSkinnedModel) App::GetInstance()->GetResources().Release(mUsedSkinnedModel);
+	RenderModelComponent::Delete();
+}
@@ -13,37 +13,37 @@ SkyBoxComponent::SkyBoxComponent() : IComponent()
 {
 }
 
-void SkyBoxComponent::Render(const Maths::Mat4& mvp, const Maths::Mat4& vp, const Maths::Mat4& modelOverride, const Maths::Frustum& cameraFrustum, LowRenderer::RenderPassType pass)
+void SkyBoxComponent::DataUpdate()
+{
+	SceneManager::GetInstance()->PushSkyBox(this);
+}
+
+void SkyBoxComponent::DrawSky(const LowRenderer::Rendering::Camera& camera, u8 stencilValue)
 {
 	if (!boxMesh)
 	{
 		boxMesh = App::GetInstance()->GetResources().Get<Resources::Mesh>(0x31);
 	}
-	if (!cubeMap || !skyShader) return;
+	if (!cubeMap || !skyShader || !boxMesh) return;
 	auto& renderer = App::GetInstance()->GetRenderer();
+	// The box is projected on the far plane, the depth test leaves only the pixels no geometry covered
+	renderer.SetStencilState(stencilValue, Renderer::StencilState::SKY);
 	renderer.BindShader(skyShader);
-	auto mainCam = SceneManager::GetInstance()->currentCamera;
-	Maths::Mat4 matrix = mainCam->GetViewMatrix();
+	Maths::Mat4 matrix = camera.GetViewMatrix();
 	Maths::Vec4 pos = Maths::Vec4(0,0,0,1);
 	for (u8 i = 0; i < 4; i++)
 	{
 		matrix.at(3, i) = pos[i];
 	}
-	matrix = mainCam->GetProjectionMatrix() * matrix;
-	if (pass & LowRenderer::RenderPassType::OBJECT)
-	{
-		renderer.RenderMeshObject(boxMesh, matrix, SceneManager::GetInstance()->GetNextIndex(gameObject));
-	}
-	else
-	{
-		std::vector<const Renderer::RendererTexture*> textures;
-		textures.push_back(&cubeMap->GetRendererTexture());
-		textures.push_back(&Resources::StaticTexture::GetDefaultNormal()->GetRendererTexture());
-		textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
-		Resources::Material mat;
-		*reinterpret_cast<f64*>(&mat.ambientColor.x) = App::GetInstance()->GetWindow().GetWindowTime();
-		renderer.RenderMesh(boxMesh, modelOverride * gameObject->transform.GetGlobal(), matrix, textures, &mat);
-	}
+	matrix = camera.GetProjectionMatrix() * matrix;
+	std::vector<const Renderer::RendererTexture*> textures;
+	textures.push_back(&cubeMap->GetRendererTexture());
+	textures.push_back(&Resources::StaticTexture::GetDefaultNormal()->GetRendererTexture());
+	textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
+	Resources::Material mat;
+	*reinterpret_cast<f64*>(&mat.ambientColor.x) = App::GetInstance()->GetWindow().GetWindowTime();
+	renderer.RenderMesh(boxMesh, gameObject->transform.GetGlobal(), matrix, textures, &mat);
+	renderer.SetStencilState(stencilValue, Renderer::StencilState::DEFAULT);
 }
 
 IComponent* SkyBoxComponent::CreateCopy()
@@ -1,4 +1,7 @@
 #include "Core/Scene/SceneManager.hpp"
+
+#include <algorithm>
+
 #include "Core/App.hpp"
 #include "Core/FileManager.hpp"
 #include "LowRenderer/RenderPassType.hpp"
@@ -93,93 +96,152 @@ namespace Core::Scene
 	{
 		drawnPortals = 0;
 		drawnRecurrence = 0;
-		if (clickScene)
+		SkinModels();
+		if (clickPending)
 		{
-			if (clickSceneRendered)
+			u32 result = 0;
+			if (renderer->PollObjectPick(result))
 			{
-				clickScene = false;
-				clickSceneRendered = false;
-				const std::string res = renderer->ReadTexture(&renderer->GetMainObjectBuffer(), clickedPos, Maths::IVec2(1, 1), sizeof(u32));
-				u32 result;
-				std::copy(res.data(), res.data() + 4, reinterpret_cast<char*>(&result));
-				if (result && result <= drawnObjects.size())
+				clickPending = false;
+				if (result && result <= pickedObjects.size())
 				{
-					clickedObject = drawnObjects[result - 1];
+					clickedObject = pickedObjects[result - 1];
 				}
 				else
 				{
-					clickedObject = nullptr;
+					clickedObject = pickedSky;
 				}
 			}
-			else
+		}
+		Renderer::RendererRenderGraph& graph = renderer->GetFrameGraph();
+		std::vector<Components::Rendering::CameraComponent*> dueCameras;
+		std::vector<Renderer::RenderGraphResource> sampledViews;
+		for (auto& camera : registeredCameras)
+		{
+			if (camera->ShouldRefresh()) dueCameras.push_back(camera);
+			// Only the last frame counts when the camera is due again
+			else camera->frameBuffer->TakeSampled();
+		}
+		// The stalest views go first, the ones left over by the time budget are first in line next frame
+		std::stable_sort(dueCameras.begin(), dueCameras.end(), [](const Components::Rendering::CameraComponent* a, const Components::Rendering::CameraComponent* b) { return a->GetFramesSinceRefresh() > b->GetFramesSinceRefresh(); });
+		// The budget is checked when the passes run, culled cameras do not take any of it
+		f64 secondaryStart = 0.0;
+		u64 renderedCameras = 0;
+		std::vector<u8> skippedCameras(dueCameras.size(), 0);
+		for (u64 i = 0; i < dueCameras.size(); i++)
+		{
+			Components::Rendering::CameraComponent* camera = dueCameras[i];
+			Renderer::RenderGraphResource gBuffer = renderer->ImportFrameBuffer(camera->frameBuffer, true);
+			Renderer::RenderGraphResource view = renderer->ImportFrameBuffer(camera->frameBuffer, false);
+			u32 geometry = graph.AddPass([this, camera, i, &secondaryStart, &renderedCameras, &skippedCameras]()
 			{
-				clickSceneRendered = true;
-				currentCamera = &mainCamera;
-
-				renderer->SetCurrentCamera(&mainCamera);
-				Maths::Frustum frustum = mainCamera.CreateFrustumFromCamera();
-
-				renderer->BeginPass(nullptr, LowRenderer::RenderPassType::OBJECT);
+				if (!renderedCameras) secondaryStart = glfwGetTime();
+				else if ((glfwGetTime() - secondaryStart) * 1000.0 > secondaryCameraBudget)
+				{
+					skippedCameras[i] = 1;
+					return;
+				}
+				renderer->SetStencilState(0, Renderer::StencilState::DEFAULT);
+				renderer->currentCameraPos = camera->camera.position;
+				currentCamera = &camera->camera;
+				clearColor = camera->frameBuffer->ClearColor.GetVector();
+				renderer->SetCurrentCamera(&camera->camera);
+
+				// Statistics are left to the passes of the camera
+				renderer->BeginProfileScope("Camera " + camera->gameObject->name, false);
+				renderer->BeginPass(camera->frameBuffer, LowRenderer::RenderPassType::SECONDARY);
 				Maths::Mat4 vp = currentCamera->GetProjectionMatrix() * currentCamera->GetViewMatrix();
+				Maths::Frustum frustum = currentCamera->CreateFrustumFromCamera();
 				for (auto& scene : activeScenes)
 				{
-					scene->Render(vp, Maths::Mat4(1), frustum, LowRenderer::RenderPassType::OBJECT);
+					scene->Render(vp, Maths::Mat4(1), frustum, LowRenderer::RenderPassType::SECONDARY);
 				}
-
+				u64 counter = 0;
+				f32 coverage = 0.0f;
+				RenderPortals(*currentCamera, vp, Maths::Mat4(1), Maths::Vec4(-1.0f, -1.0f, 1.0f, 1.0f), counter, coverage, 0);
+				drawnPortals += counter;
+				RenderSky(*currentCamera, 0);
 				renderer->EndPass();
-			}
+			});
+			graph.Write(geometry, gBuffer);
+			u32 shading = graph.AddPass([this, camera, i, &renderedCameras, &skippedCameras]()
+			{
+				if (skippedCameras[i]) return;
+				postManager.ApplyEffects(camera->frameBuffer);
+				renderer->EndProfileScope();
+				camera->OnRefreshed();
+				renderedCameras++;
+			});
+			graph.Read(shading, gBuffer);
+			graph.Write(shading, view);
+			// Views no drawn texture sampled during the last frame are culled, unless they are kept up to date anyway
+			if (camera->frameBuffer->TakeSampled()) sampledViews.push_back(view);
+			else if (camera->IsRenderedWhenHidden()) graph.Extract(view);
 		}
-		for (auto& camera : registeredCameras)
+
+		Renderer::RenderGraphResource mainGBuffer = renderer->ImportFrameBuffer(nullptr, true);
+		Renderer::RenderGraphResource mainView = renderer->ImportFrameBuffer(nullptr, false);
+		u32 mainGeometry = graph.AddPass([this]()
 		{
 			renderer->SetStencilState(0, Renderer::StencilState::DEFAULT);
-			renderer->currentCameraPos = camera->camera.position;
-			currentCamera = &camera->camera;
-			clearColor = camera->frameBuffer->ClearColor.GetVector();
-			renderer->SetCurrentCamera(&camera->camera);
-
-			renderer->BeginPass(camera->frameBuffer, LowRenderer::RenderPassType::SECONDARY);
+			renderer->currentCameraPos = mainCamera.position;
+			currentCamera = &mainCamera;
+			clearColor = renderer->GetClearColor();
+			renderer->SetCurrentCamera(&mainCamera);
+			drawnObjects.clear();
+
+			renderer->BeginProfileScope("Main camera", false);
+			renderer->BeginPass();
 			Maths::Mat4 vp = currentCamera->GetProjectionMatrix() * currentCamera->GetViewMatrix();
 			Maths::Frustum frustum = currentCamera->CreateFrustumFromCamera();
 			for (auto& scene : activeScenes)
 			{
-				scene->Render(vp, Maths::Mat4(1), frustum, LowRenderer::RenderPassType::SECONDARY);
+				scene->Render(vp, Maths::Mat4(1), frustum, LowRenderer::RenderPassType::DEFAULT);
 			}
+
+			Resources::ShaderProgram* wire = App::GetInstance()->GetResources().Get<Resources::ShaderProgram>(0x29);
+			renderer->BindShader(wire);
+
+			if (ShouldRenderColliders())
+				Core::App::GetInstance()->GetPhysicsEngine().EditorRenderColliders();		
+			else
+				Core::App::GetInstance()->GetPhysicsEngine().EditorClearDrawList();
+
 			u64 counter = 0;
-			RenderPortals(*currentCamera, vp, Maths::Mat4(1), Maths::Vec4(-1.0f, -1.0f, 1.0f, 1.0f), counter, 0);
+			f32 coverage = 0.0f;
+			RenderPortals(*currentCamera, vp, Maths::Mat4(1), Maths::Vec4(-1.0f, -1.0f, 1.0f, 1.0f), counter, coverage, 0);
 			drawnPortals += counter;
+			RenderSky(*currentCamera, 0);
+
 			renderer->EndPass();
-			postManager.ApplyEffects(camera->frameBuffer);
-		}
-		renderer->SetStencilState(0, Renderer::StencilState::DEFAULT);
-		renderer->currentCameraPos = mainCamera.position;
-		currentCamera = &mainCamera;
-		clearColor = renderer->GetClearColor();
-		renderer->SetCurrentCamera(&mainCamera);
-
-		renderer->BeginPass();
-		Maths::Mat4 vp = currentCamera->GetProjectionMatrix() * currentCamera->GetViewMatrix();
-		Maths::Frustum frustum = currentCamera->CreateFrustumFromCamera();
-		for (auto& scene : activeScenes)
+			// Ids refer to the objects drawn this frame, a new pick waits for the previous one to be resolved
+			if (clickScene && !clickPending)
+			{
+				clickScene = false;
+				clickPending = true;
+				renderer->PickObject(clickedPos);
+				pickedObjects = drawnObjects;
+				pickedSky = registeredSkyBoxes.empty() ? nullptr : registeredSkyBoxes.front()->gameObject;
+			}
+		});
+		for (Renderer::RenderGraphResource view : sampledViews)
 		{
-			scene->Render(vp, Maths::Mat4(1), frustum, LowRenderer::RenderPassType::DEFAULT);
+			graph.Read(mainGeometry, view);
 		}
-
-		Resources::ShaderProgram* wire = App::GetInstance()->GetResources().Get<Resources::ShaderProgram>(0x29);
-		renderer->BindShader(wire);
-
-		if (ShouldRenderColliders())
-			Core::App::GetInstance()->GetPhysicsEngine().EditorRenderColliders();		
-		else
-			Core::App::GetInstance()->GetPhysicsEngine().EditorClearDrawList();
-
-		u64 counter = 0;
-		RenderPortals(*currentCamera, vp, Maths::Mat4(1), Maths::Vec4(-1.0f, -1.0f, 1.0f, 1.0f), counter, 0);
-		drawnPortals += counter;
-
-		renderer->EndPass();
-		postManager.ApplyEffects(nullptr);
+		graph.Write(mainGeometry, mainGBuffer);
+		u32 mainShading = graph.AddPass([this]()
+		{
+			postManager.ApplyEffects(nullptr);
+			renderer->EndProfileScope();
+		});
+		graph.Read(mainShading, mainGBuffer);
+		graph.Write(mainShading, mainView);
+		renderer->AddWindowPass(mainView);
+		renderer->ExecuteFrameGraph();
 		registeredCameras.clear();
 		registeredPortals.clear();
+		registeredSkyBoxes.clear();
+		registeredSkinnedModels.clear();
 	}
 
 	///Init all the scenes loaded in the manager
@@ -242,6 +304,18 @@ void SceneManager::Update(Maths::IVec2 resolution, Wrappers::IPhysicsEngine* phy
 	}
 }
 
+	void SceneManager::UpdateScripted(Maths::IVec2 resolution, Maths::Vec3 position, Maths::Vec3 focus)
+	{
+		if (!renderer) renderer = &Core::App::GetInstance()->GetRenderer();
+		renderer->ClearLights();
+		for (auto& scene : activeScenes)
+		{
+			scene->DataUpdate(true);
+		}
+		mainCamera.up = Maths::Vec3(0, 1, 0);
+		mainCamera.Update(resolution, position, focus);
+	}
+
 	///Clean all scenes currently loaded in the manager
 	void SceneManager::Clean()
 	{
@@ -263,6 +337,43 @@ void SceneManager::Update(Maths::IVec2 resolution, Wrappers::IPhysicsEngine* phy
 		registeredPortals.push_back(component);
 	}
 
+	void SceneManager::PushSkyBox(Components::SkyBoxComponent* component)
+	{
+		registeredSkyBoxes.push_back(component);
+	}
+
+	void SceneManager::PushSkinnedModel(Components::SkinnedRenderModelComponent* component)
+	{
+		registeredSkinnedModels.push_back(component);
+	}
+
+	void SceneManager::SkinModels()
+	{
+		if (registeredSkinnedModels.empty()) return;
+		renderer->GetWorkerThreads().ParallelFor(static_cast<u32>(registeredSkinnedModels.size()), [&](u32 index)
+		{
+			registeredSkinnedModels[index]->UpdatePose();
+		});
+		renderer->BeginProfileScope("Skinning");
+		if (renderer->BeginSkinning())
+		{
+			for (auto& model : registeredSkinnedModels)
+			{
+				model->Skin(*renderer);
+			}
+			renderer->EndSkinning();
+		}
+		renderer->EndProfileScope();
+	}
+
+	void SceneManager::RenderSky(const LowRenderer::Rendering::Camera& cam, u8 stencilValue)
+	{
+		if (registeredSkyBoxes.empty()) return;
+		renderer->BeginProfileScope("Sky");
+		registeredSkyBoxes.front()->DrawSky(cam, stencilValue);
+		renderer->EndProfileScope();
+	}
+
 	PlayMode SceneManager::GetPlayMode() const
 	{
 		return playMode;
@@ -291,7 +402,6 @@ void SceneManager::Update(Maths::IVec2 resolution, Wrappers::IPhysicsEngine* phy
 	{
 		clickScene = true;
 		clickedPos = pos;
-		drawnObjects.clear();
 	}
 
 	void SceneManager::ConfigurePostProcesses()
@@ -371,25 +481,41 @@ void SceneManager::Update(Maths::IVec2 resolution, Wrappers::IPhysicsEngine* phy
 		return savedScenes;
 	}
 
-	void SceneManager::RenderPortals(const LowRenderer::Rendering::Camera& cam, const Maths::Mat4& vp, const Maths::Mat4& m, Maths::Vec4 screenBounds, u64& drawnPortals, u8 recurrence)
+	void SceneManager::RenderPortals(const LowRenderer::Rendering::Camera& cam, const Maths::Mat4& vp, const Maths::Mat4& m, Maths::Vec4 screenBounds, u64& drawnPortals, f32& coverage, u8 recurrence)
 	{
 		if (drawnRecurrence < recurrence) drawnRecurrence = recurrence;
+		struct VisiblePortal
+		{
+			Components::Rendering::PortalBaseComponent* portal;
+			Maths::Mat4 mvp;
+			Maths::Vec4 bounds;
+			f32 area;
+		};
+		std::vector<VisiblePortal> visible;
 		for (auto& portal : registeredPortals)
 		{
-			if (drawnPortals >= maxPortalCount)
-			{
-				return;
-			}
 			if (!portal->IsVisibleOnScreen(&cam)) continue;
 			Maths::Mat4 mvp = vp * portal->gameObject->transform.GetGlobal();
-			Maths::Vec4 bounds = portal->GetScreenCovering(mvp);
-			bounds = bounds.Clip(screenBounds);
-			Maths::Vec2 area = Maths::Vec2(bounds.z - bounds.x, bounds.w - bounds.y);
-			if (area.x <= 0.0f || area.y <= 0.0f) continue;
+			Maths::Vec4 bounds = portal->GetScreenCovering(mvp).Clip(screenBounds);
+			// Fraction of the screen covered, normalized device coordinates span 2 units on each axis
+			f32 area = (bounds.z - bounds.x) * (bounds.w - bounds.y) * 0.25f;
+			if (bounds.z <= bounds.x || bounds.w <= bounds.y || area < minPortalCoverage) continue;
+			visible.push_back({ portal, mvp, bounds, area });
+		}
+		// The largest views get the budget first
+		std::sort(visible.begin(), visible.end(), [](const VisiblePortal& a, const VisiblePortal& b) { return a.area > b.area; });
+		for (auto& view : visible)
+		{
+			if (coverage + view.area > portalCoverageBudget) continue;
+			coverage += view.area;
+			auto portal = view.portal;
+			const Maths::Mat4& mvp = view.mvp;
 			Maths::Vec4 nearPlane;
 			Maths::Mat4 model = m;
 			LowRenderer::Rendering::Camera cam2 = portal->UpdateCamera(cam, model, nearPlane);
 			++drawnPortals;
+			// Indirect draws of the pass are replayed before any of its other commands, they are not part of the portal time
+			renderer->BeginProfileScope("Portal level " + std::to_string(recurrence + 1));
 			portal->Overwrite(mvp, Renderer::StencilState::INCREMENT, recurrence, clearColor);
 			portal->Overwrite(mvp, Renderer::StencilState::NO_DEPTH, recurrence + 1, clearColor);
 			Maths::Mat4 vp2;
@@ -405,7 +531,10 @@ void SceneManager::Update(Maths::IVec2 resolution, Wrappers::IPhysicsEngine* phy
 			currentCamera = &cam2;
 			renderer->SetCurrentCamera(&cam2);
 			renderer->SetStencilState(recurrence + 1, Renderer::StencilState::DEFAULT);
+			// The view can only show through the portal rectangle, anything outside of it is clipped before the stencil test
+			renderer->SetScissor(view.bounds);
 			Maths::Frustum frustum = cam2.CreateFrustumFromCamera();
+			frustum.ClipToScreen(vp2, view.bounds);
 			for (auto& scene : activeScenes)
 			{
 				scene->Render(vp2, model, frustum, static_cast<LowRenderer::RenderPassType>(LowRenderer::RenderPassType::DEFAULT | LowRenderer::RenderPassType::SECONDARY));
@@ -414,9 +543,12 @@ void SceneManager::Update(Maths::IVec2 resolution, Wrappers::IPhysicsEngine* phy
 			renderer->SetCurrentCamera(oldCam);
 			if (recurrence < maxPortalRecurrence)
 			{
-				RenderPortals(cam2, vp2, model, bounds, drawnPortals, recurrence + 1);
+				RenderPortals(cam2, vp2, model, view.bounds, drawnPortals, coverage, recurrence + 1);
 			}
+			RenderSky(cam2, recurrence + 1);
+			renderer->SetScissor(screenBounds);
 			portal->Overwrite(mvp, Renderer::StencilState::GREATER, recurrence, clearColor);
+			renderer->EndProfileScope();
 		}
 	}
 }
\ No newline at end of file
@@ -141,6 +141,15 @@ bool Deserializer::Read(Maths::Quat& in)
 	return Read(in.v.x) && Read(in.v.y) && Read(in.v.z) && Read(in.a);
 }
 
+bool Deserializer::Read(Maths::Mat4& in)
+{
+	for (f32& value : in.content)
+	{
+		if (!Read(value)) return false;
+	}
+	return true;
+}
+
 bool Deserializer::Read(Maths::AABB& in)
 {
 	return Read(in.center) && Read(in.size);
@@ -136,6 +136,14 @@ void Serializer::Write(const Maths::Quat& in)
 	Write(in.a);
 }
 
+void Serializer::Write(const Maths::Mat4& in)
+{
+	for (f32 value : in.content)
+	{
+		Write(value);
+	}
+}
+
 void Serializer::Write(const Maths::AABB& in)
 {
 	Write(in.center);
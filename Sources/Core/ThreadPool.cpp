@@ -0,0 +1,90 @@
+#include "Core/ThreadPool.hpp"
+
+using namespace Core;
+
+ThreadPool::ThreadPool()
+{
+}
+
+ThreadPool::~ThreadPool()
+{
+	Destroy();
+}
+
+void ThreadPool::Init(u32 threadCount)
+{
+	Destroy();
+	if (!threadCount)
+	{
+		u32 hardware = std::thread::hardware_concurrency();
+		threadCount = hardware > 1 ? hardware - 1 : 1;
+	}
+	stopping = false;
+	workers.reserve(threadCount);
+	for (u32 i = 0; i < threadCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+void ThreadPool::Destroy()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+	for (auto& worker : workers)
+	{
+		if (worker.joinable()) worker.join();
+	}
+	workers.clear();
+}
+
+u32 ThreadPool::GetThreadCount() const
+{
+	return static_cast<u32>(workers.size());
+}
+
+void ThreadPool::ParallelFor(u32 count, const std::function<void(u32)>& task)
+{
+	if (!count) return;
+	if (workers.empty() || count == 1)
+	{
+		for (u32 i = 0; i < count; i++)
+		{
+			task(i);
+		}
+		return;
+	}
+	std::unique_lock lock(mutex);
+	currentTask = &task;
+	taskCount = count;
+	nextTask = 0;
+	remainingTasks = count;
+	++generation;
+	wakeCondition.notify_all();
+	doneCondition.wait(lock, [this]() { return remainingTasks == 0; });
+	currentTask = nullptr;
+}
+
+void ThreadPool::WorkerLoop()
+{
+	u64 seenGeneration = 0;
+	std::unique_lock lock(mutex);
+	while (true)
+	{
+		wakeCondition.wait(lock, [this, &seenGeneration]() { return stopping || generation != seenGeneration; });
+		if (stopping) return;
+		seenGeneration = generation;
+		while (nextTask < taskCount)
+		{
+			u32 index = nextTask++;
+			const std::function<void(u32)>* task = currentTask;
+			lock.unlock();
+			(*task)(index);
+			lock.lock();
+			if (--remainingTasks == 0) doneCondition.notify_all();
+		}
+	}
+}
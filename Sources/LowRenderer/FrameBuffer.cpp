@@ -1,6 +1,7 @@
 #include "LowRenderer/FrameBuffer.hpp"
 
 #include "Core/App.hpp"
+#include "Core/Debugging/Log.hpp"
 
 using namespace LowRenderer;
 
@@ -14,21 +15,8 @@ void FrameBuffer::CreateFrameBuffer(const Maths::IVec2 resolutionIn)
 {
 	resolution = resolutionIn;
 	if (!renderer) renderer = &Core::App::GetInstance()->GetRenderer();
-	renderer->CreateDepthBuffer(db, resolution);
-	renderer->CreateBuffer(nb, resolution);
-	renderer->CreateBuffer(pb, resolution);
-	std::vector<Renderer::RendererImageView> vec;
-	vec.push_back(db.GetDepthImageView());
-	vec.push_back(nb.GetImageView());
-	vec.push_back(pb.GetImageView());
-	renderer->CreateFrameBuffer(fb, vec, resolution, ClearColor);
-	for (u8 i = 0; i < 3; i++)
-	{
-		renderer->CreateBuffer(gb[i], resolution, true);
-		vec.clear();
-		vec.push_back(gb[i].GetImageView());
-		renderer->CreateFrameBuffer(lb[i], vec, resolution, Maths::Vec4(), VK_FORMAT_R32G32B32A32_SFLOAT, Resources::ShaderVariant::Light);
-	}
+	renderer->CreateGeometryBuffers(*this, resolution);
+	renderer->CreateLightBuffers(*this, resolution);
 }
 
 FrameBuffer::~FrameBuffer()
@@ -40,92 +28,95 @@ void FrameBuffer::Write(Core::Serialization::Serializer& sr)
 	sr.Write(static_cast<u8>(Resources::ObjectType::FrameBufferType));
 	Resources::Texture::Write(sr);
 	sr.Write(ClearColor);
+	sr.Write(static_cast<u8>(gbufferLayout));
 }
 
 void FrameBuffer::Load(Core::Serialization::Deserializer& dr)
 {
 	Resources::Texture::Load(dr);
 	dr.Read(ClearColor);
+	u8 layout;
+	if (dr.Read(layout)) gbufferLayout = static_cast<GBufferLayout>(layout);
+	if (!renderer) renderer = &Core::App::GetInstance()->GetRenderer();
+	if (!renderer->IsCompactGBufferEnabled()) gbufferLayout = GBufferLayout::FULL;
 	CreateFrameBuffer(resolution);
 	isLoaded = true;
 }
 
 void FrameBuffer::DeleteData()
+{
+	RetireTargets();
+	if (resize) RetireOldTargets();
+}
+
+void FrameBuffer::RetireTargets()
 {
 	renderer->DeleteFrameBuffer(fb);
 	renderer->DeleteBuffer(nb);
 	renderer->DeleteBuffer(pb);
+	renderer->DeleteBuffer(ib);
 	for (u8 i = 0; i < 3; i++)
 	{
 		renderer->DeleteFrameBuffer(lb[i]);
 		renderer->DeleteBuffer(gb[i]);
 	}
 	renderer->DeleteDepthBuffer(db);
-	if (resize)
+}
+
+void FrameBuffer::RetireOldTargets()
+{
+	renderer->DeleteFrameBuffer(old_fb);
+	renderer->DeleteDepthBuffer(old_db);
+	renderer->DeleteBuffer(old_nb);
+	renderer->DeleteBuffer(old_pb);
+	renderer->DeleteBuffer(old_ib);
+	for (u8 i = 0; i < 3; i++)
 	{
-		renderer->DeleteFrameBuffer(old_fb);
-		renderer->DeleteDepthBuffer(old_db);
-		renderer->DeleteBuffer(old_nb);
-		renderer->DeleteBuffer(old_pb);
-		for (u8 i = 0; i < 3; i++)
-		{
-			renderer->DeleteFrameBuffer(old_lb[i]);
-			renderer->DeleteBuffer(old_gb[i]);
-		}
+		renderer->DeleteFrameBuffer(old_lb[i]);
+		renderer->DeleteBuffer(old_gb[i]);
 	}
 }
 
 const Renderer::RendererImageView& FrameBuffer::GetImageView() const
 {
+	sampled = true;
 	return lb[actualBuffer].rendererTex.imageView;
 }
 
 const Renderer::RendererTexture& FrameBuffer::GetRendererTexture() const
 {
+	sampled = true;
 	return lb[actualBuffer].rendererTex;
 }
 
+bool FrameBuffer::TakeSampled()
+{
+	bool result = sampled;
+	sampled = false;
+	return result;
+}
+
 void FrameBuffer::Resize(Maths::IVec2 resolution)
 {
 	old_fb = fb;
 	old_db = db;
 	old_nb = nb;
 	old_pb = pb;
-	renderer->CreateDepthBuffer(db, resolution);
-	renderer->CreateBuffer(nb, resolution);
-	renderer->CreateBuffer(pb, resolution);
-	std::vector<Renderer::RendererImageView> vec;
-	vec.push_back(db.GetDepthImageView());
-	vec.push_back(nb.GetImageView());
-	vec.push_back(pb.GetImageView());
-	renderer->CreateFrameBuffer(fb, vec, resolution, ClearColor);
+	old_ib = ib;
+	renderer->CreateGeometryBuffers(*this, resolution);
 	for (u8 i = 0; i < 3; i++)
 	{
 		old_gb[i] = gb[i];
 		old_lb[i] = lb[i];
-		renderer->CreateBuffer(gb[i], resolution, true);
-		vec.clear();
-		vec.push_back(gb[i].GetImageView());
-		renderer->CreateFrameBuffer(lb[i], vec, resolution, Maths::Vec4(), VK_FORMAT_R32G32B32A32_SFLOAT, Resources::ShaderVariant::Light);
 	}
+	renderer->CreateLightBuffers(*this, resolution);
 	
 	resize = 5;
 }
 
 void LowRenderer::FrameBuffer::Update()
 {
-	if (resize == 1)
-	{
-		renderer->DeleteFrameBuffer(old_fb);
-		renderer->DeleteDepthBuffer(old_db);
-		renderer->DeleteBuffer(old_nb);
-		for (u8 i = 0; i < 3; i++)
-		{
-			renderer->DeleteFrameBuffer(old_lb[i]);
-			renderer->DeleteBuffer(old_gb[i]);
-		}
-		renderer->DeleteBuffer(old_pb);
-	}
+	if (resize == 1) RetireOldTargets();
 	if (resize) resize--;
 }
 
@@ -145,6 +136,26 @@ void LowRenderer::FrameBuffer::ToggleBuffer()
 	else actualBuffer = 1;
 }
 
+void LowRenderer::FrameBuffer::SetGBufferLayout(GBufferLayout layout)
+{
+	if (gbufferLayout == layout) return;
+	if (!renderer) renderer = &Core::App::GetInstance()->GetRenderer();
+	if (layout == GBufferLayout::COMPACT && !renderer->IsCompactGBufferEnabled())
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "The geometry shaders were not rebuilt for the compact G-buffer, keeping the full layout");
+		return;
+	}
+	gbufferLayout = layout;
+	if (!fb.buffer) return;
+	// The light pass reads the old targets of a resize with the new layout, a pending resize is retired along with them
+	if (resize) RetireOldTargets();
+	resize = 0;
+	Maths::IVec2 res = GetResolution();
+	RetireTargets();
+	renderer->CreateGeometryBuffers(*this, res);
+	renderer->CreateLightBuffers(*this, res);
+}
+
 Maths::IVec2 FrameBuffer::GetResolution() const
 {
 	return lb[actualBuffer].GetResolution();
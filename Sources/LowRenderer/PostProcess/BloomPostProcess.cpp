@@ -12,42 +12,28 @@ BloomPostProcess::BloomPostProcess() : PostProcessEffect()
 
 void BloomPostProcess::ApplyPass(Renderer::VulkanRenderer* renderer, LowRenderer::FrameBuffer* fb)
 {
-	vertical = false;
 	if (fb)	bufferResolution = fb->GetResolution();
 	else bufferResolution = renderer->GetMainLightBuffer().resolution;
-	for (u32 i = 0; i < passCount; i++)
-	{
-		renderer->BeginPass(fb, LowRenderer::RenderPassType::POST);
-		renderer->ApplyPostProcess(this);
-		renderer->EndPass();
-		if (fb)	fb->ToggleBuffer();
-		else renderer->ToggleMainFB();
-		vertical = !vertical;
-	}
+	const Renderer::RendererTexture* filtered = renderer->FilterMipChain(fb, true, radius);
+	renderer->BeginPass(fb, LowRenderer::RenderPassType::POST);
+	renderer->ApplyPostProcess(this, filtered);
+	renderer->EndPass();
+	if (fb)	fb->ToggleBuffer();
+	else renderer->ToggleMainFB();
 }
 
 void BloomPostProcess::Configure()
 {
-	guiInterface->SliderInt("Number of passes", reinterpret_cast<int*>(&passCount), 2, 32);
+	guiInterface->SliderInt("Radius", reinterpret_cast<int*>(&radius), 1, MIP_CHAIN_MAX_LEVELS);
+	guiInterface->SliderFloat("Intensity", &intensity, 0.0f, 8.0f, false);
 }
 
 void BloomPostProcess::FillBuffer(void* dest) const
 {
 	f32* buf = reinterpret_cast<f32*>(dest);
-	if (vertical)
-	{
-		buf[0] = 0.0f;
-		buf[1] = 1.0f;
-		buf[2] = static_cast<f32>(bufferResolution.x);
-		buf[3] = static_cast<f32>(bufferResolution.y);
-	}
-	else
-	{
-		buf[0] = 1.0f;
-		buf[1] = 0.0f;
-		buf[2] = static_cast<f32>(bufferResolution.x);
-		buf[3] = static_cast<f32>(bufferResolution.y);
-	}
+	buf[0] = static_cast<f32>(bufferResolution.x);
+	buf[1] = static_cast<f32>(bufferResolution.y);
+	buf[2] = intensity;
 }
 
 EffectType BloomPostProcess::GetType()
@@ -57,12 +43,16 @@ EffectType BloomPostProcess::GetType()
 
 void BloomPostProcess::Serialize(Core::Serialization::Serializer& sr)
 {
-	sr.Write(passCount);
+	sr.Write(radius);
+	sr.Write(intensity);
 }
 
-void BloomPostProcess::Deserialize(Core::Serialization::Deserializer& dr)
+void BloomPostProcess::Deserialize(Core::Serialization::Deserializer& dr, u8 version)
 {
-	dr.Read(passCount);
+	dr.Read(radius);
+	// The first layout stored a number of blur passes and no intensity
+	if (version == 0) radius = Maths::Util::IClamp(static_cast<s32>(radius), 1, MIP_CHAIN_MAX_LEVELS);
+	else dr.Read(intensity);
 }
 
 PostProcessEffect* BloomPostProcess::CreateCopy() const
@@ -12,43 +12,26 @@ BlurPostProcess::BlurPostProcess() : PostProcessEffect()
 
 void BlurPostProcess::ApplyPass(Renderer::VulkanRenderer* renderer, LowRenderer::FrameBuffer* fb)
 {
-	vertical = false;
 	if (fb)	bufferResolution = fb->GetResolution();
 	else bufferResolution = renderer->GetMainLightBuffer().resolution;
-	for (u32 i = 0; i < passCount; i++)
-	{
-		renderer->BeginPass(fb, LowRenderer::RenderPassType::POST);
-		renderer->ApplyPostProcess(this);
-
-		renderer->EndPass();
-		if (fb)	fb->ToggleBuffer();
-		else renderer->ToggleMainFB();
-		vertical = !vertical;
-	}
+	const Renderer::RendererTexture* filtered = renderer->FilterMipChain(fb, false, radius);
+	renderer->BeginPass(fb, LowRenderer::RenderPassType::POST);
+	renderer->ApplyPostProcess(this, filtered);
+	renderer->EndPass();
+	if (fb)	fb->ToggleBuffer();
+	else renderer->ToggleMainFB();
 }
 
 void BlurPostProcess::Configure()
 {
-	guiInterface->SliderInt("Number of passes", reinterpret_cast<int*>(&passCount), 2, 32);
+	guiInterface->SliderInt("Radius", reinterpret_cast<int*>(&radius), 1, MIP_CHAIN_MAX_LEVELS);
 }
 
 void BlurPostProcess::FillBuffer(void* dest) const
 {
 	f32* buf = reinterpret_cast<f32*>(dest);
-	if (vertical)
-	{
-		buf[0] = 0.0f;
-		buf[1] = 1.0f;
-		buf[2] = static_cast<f32>(bufferResolution.x);
-		buf[3] = static_cast<f32>(bufferResolution.y);
-	}
-	else
-	{
-		buf[0] = 1.0f;
-		buf[1] = 0.0f;
-		buf[2] = static_cast<f32>(bufferResolution.x);
-		buf[3] = static_cast<f32>(bufferResolution.y);
-	}
+	buf[0] = static_cast<f32>(bufferResolution.x);
+	buf[1] = static_cast<f32>(bufferResolution.y);
 }
 
 EffectType BlurPostProcess::GetType()
@@ -58,12 +41,14 @@ EffectType BlurPostProcess::GetType()
 
 void BlurPostProcess::Serialize(Core::Serialization::Serializer& sr)
 {
-	sr.Write(passCount);
+	sr.Write(radius);
 }
 
-void BlurPostProcess::Deserialize(Core::Serialization::Deserializer& dr)
+void BlurPostProcess::Deserialize(Core::Serialization::Deserializer& dr, u8 version)
 {
-	dr.Read(passCount);
+	dr.Read(radius);
+	// The first layout stored a number of blur passes in its place
+	if (version == 0) radius = Maths::Util::IClamp(static_cast<s32>(radius), 1, MIP_CHAIN_MAX_LEVELS);
 }
 
 PostProcessEffect* BlurPostProcess::CreateCopy() const
@@ -32,6 +32,11 @@ void GammaCorrectionPostProcess::FillBuffer(void* dest) const
 	buf[1] = gamma;
 }
 
+void GammaCorrectionPostProcess::AppendPixelStage(Renderer::Uniform::PixelStages& stages) const
+{
+	stages.Push(Renderer::Uniform::PixelOperation::GAMMA_CORRECTION, Maths::Vec4(exposure, gamma, 0.0f, 0.0f));
+}
+
 EffectType GammaCorrectionPostProcess::GetType()
 {
 	return EffectType::GAMMA_CORRECTION;
@@ -43,7 +48,7 @@ void GammaCorrectionPostProcess::Serialize(Core::Serialization::Serializer& sr)
 	sr.Write(gamma);
 }
 
-void GammaCorrectionPostProcess::Deserialize(Core::Serialization::Deserializer& dr)
+void GammaCorrectionPostProcess::Deserialize(Core::Serialization::Deserializer& dr, u8)
 {
 	dr.Read(exposure);
 	dr.Read(gamma);
@@ -7,6 +7,13 @@
 
 using namespace LowRenderer::PostProcess;
 
+namespace
+{
+	// Written in place of the effect count of the first layout, which had no version. The low byte holds the version
+	constexpr u64 serializedVersionMarker = 0xFFFFFFFFFFFFFF00;
+	constexpr u8 serializedVersion = 1;
+}
+
 PostProcessManager::~PostProcessManager()
 {
 	for (auto& pass : effects)
@@ -28,9 +35,35 @@ void PostProcessManager::ApplyEffects(LowRenderer::FrameBuffer* fb)
 	renderer->BeginPass(fb, LowRenderer::RenderPassType::LIGHT);
 	renderer->ApplyLightPass(lightShader);
 	renderer->EndPass();
-	for (auto& pass : effects)
+	bool fuse = renderer->CanFusePixelStages();
+	u64 index = 0;
+	while (index < effects.size())
 	{
-		pass->ApplyPass(renderer, fb);
+		if (!fuse || !effects[index]->IsPerPixel())
+		{
+			renderer->BeginProfileScope(effects[index]->GetEffectName());
+			effects[index++]->ApplyPass(renderer, fb);
+			renderer->EndProfileScope();
+			continue;
+		}
+		Renderer::Uniform::PixelStages stages;
+		while (index < effects.size() && effects[index]->IsPerPixel() && !stages.IsFull())
+		{
+			effects[index++]->AppendPixelStage(stages);
+		}
+		// The last per-pixel stages of the main frame buffer are applied while blitting it to the window
+		if (!fb && index == effects.size() && renderer->PresentsMainFrameBuffer() && renderer->WindowHasPixelStages())
+		{
+			renderer->SetWindowPixelStages(stages);
+			break;
+		}
+		renderer->BeginProfileScope("Pixel stages");
+		renderer->BeginPass(fb, LowRenderer::RenderPassType::POST);
+		renderer->ApplyPixelStages(stages);
+		renderer->EndPass();
+		renderer->EndProfileScope();
+		if (fb)	fb->ToggleBuffer();
+		else renderer->ToggleMainFB();
 	}
 }
 
@@ -105,6 +138,7 @@ void PostProcessManager::Init()
 
 void PostProcessManager::Serialize(Core::Serialization::Serializer& sr)
 {
+	sr.Write(serializedVersionMarker | serializedVersion);
 	sr.Write(effects.size());
 	for (u64 i = 0; i < effects.size(); ++i)
 	{
@@ -117,6 +151,12 @@ void PostProcessManager::Deserialize(Core::Serialization::Deserializer& dr)
 {
 	u64 size = 0;
 	if (!dr.Read(size)) return;
+	u8 version = 0;
+	if ((size & serializedVersionMarker) == serializedVersionMarker)
+	{
+		version = static_cast<u8>(size & ~serializedVersionMarker);
+		if (!dr.Read(size)) return;
+	}
 	effects.reserve(size);
 	EffectType type;
 	for (u64 i = 0; i < size; ++i)
@@ -137,6 +177,6 @@ void PostProcessManager::Deserialize(Core::Serialization::Deserializer& dr)
 			LOG(DEBUG_LEVEL::LERROR, "Unknown post process effect type %d !", type);
 			return;
 		}
-		effects.back()->Deserialize(dr);
+		effects.back()->Deserialize(dr, version);
 	}
 }
@@ -1,6 +1,7 @@
 #include "Maths/Maths.hpp"
 
 #include <cstdio>
+#include <algorithm>
 
 // Since we are using Vulkan, we need to invert the projection matrixes
 #define INVERTED_PROJECTION
@@ -1099,6 +1100,40 @@ namespace Maths
             globalAABB.IsOnOrForwardPlane(camFrustum.back));
     }
 
+    f32 AABB::GetScreenSize(const Mat4& mvp, Vec2 resolution) const
+    {
+        Vec2 low(INFINITY, INFINITY);
+        Vec2 high(-INFINITY, -INFINITY);
+        for (u8 i = 0; i < 8; i++)
+        {
+            Vec3 corner = center + Vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f) * size;
+            Vec4 clip = mvp * Vec4(corner, 1.0f);
+            if (clip.w <= 1e-5f) return INFINITY;
+            Vec2 ndc(clip.x / clip.w, clip.y / clip.w);
+            low = Vec2(std::min(low.x, ndc.x), std::min(low.y, ndc.y));
+            high = Vec2(std::max(high.x, ndc.x), std::max(high.y, ndc.y));
+        }
+        return std::max((high.x - low.x) * resolution.x, (high.y - low.y) * resolution.y) * 0.5f;
+    }
+
+    void Frustum::ClipToScreen(const Mat4& vp, const Vec4& screenBounds)
+    {
+        // Rows of the view projection, a visible point satisfies bounds.x * w <= x <= bounds.z * w
+        Vec4 rows[4];
+        for (u8 i = 0; i < 4; i++)
+        {
+            rows[i] = Vec4(vp.content[i], vp.content[4 + i], vp.content[8 + i], vp.content[12 + i]);
+        }
+        Vec4* planes[4] = { &left, &right, &bottom, &top };
+        Vec4 sides[4] = { rows[0] - rows[3] * screenBounds.x, rows[3] * screenBounds.z - rows[0], rows[1] - rows[3] * screenBounds.y, rows[3] * screenBounds.w - rows[1] };
+        for (u8 i = 0; i < 4; i++)
+        {
+            f32 length = sides[i].GetVector().GetLength();
+            if (length <= 0.0f) continue;
+            *planes[i] = Vec4(sides[i].GetVector() / length, -sides[i].w / length);
+        }
+    }
+
     bool AABB::IsOnOrForwardPlane(const Vec4& plane) const
     {
         const float r = size.x * std::abs(plane.x) +
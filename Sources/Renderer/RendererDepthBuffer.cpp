@@ -9,9 +9,13 @@ namespace Renderer
 		resolution = Maths::IVec2(Maths::Util::MaxI(width, 1), Maths::Util::MaxI(height, 1));
 		VulkanRenderer& instance =  Core::App::GetInstance()->GetRenderer();
 		VkFormat depthFormat = instance.FindDepthFormat();
-		instance.CreateImage(resolution, 1, texture.textureImage, texture.textureImageMemory, depthFormat, VK_IMAGE_TILING_OPTIMAL, transitLayout ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		instance.CreateImage(resolution, 1, texture.textureImage, texture.textureImageMemory, depthFormat, VK_IMAGE_TILING_OPTIMAL, transitLayout ? VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 		texture.imageView.imageView = instance.CreateImageView(texture.textureImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-		if (transitLayout) instance.TransitionImageLayout(texture.textureImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+		if (transitLayout)
+		{
+			instance.TransitionImageLayout(texture.textureImage, depthFormat, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+			layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+		}
 	}
 
 	void RendererDepthBuffer::DeleteDepthBuffer(VkDevice& device)
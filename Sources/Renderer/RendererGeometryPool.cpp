@@ -0,0 +1,156 @@
+#include "Renderer/RendererGeometryPool.hpp"
+
+#include <cstring>
+
+#include "Core/Debugging/Log.hpp"
+#include "Renderer/VulkanRenderer.hpp"
+
+using namespace Renderer;
+
+void RendererGeometryPool::CreatePool(VulkanRenderer& renderer, u32 vertexCapacity, u32 indexCapacity)
+{
+	CreateSharedBuffer(renderer, vertices, vertexCapacity, sizeof(RendererVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+	CreateSharedBuffer(renderer, indices, indexCapacity, sizeof(u32), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+void RendererGeometryPool::DestroyPool(VkDevice& device)
+{
+	for (SharedBuffer* buffer : { &vertices, &indices })
+	{
+		vkDestroyBuffer(device, buffer->handle, nullptr);
+		vkFreeMemory(device, buffer->memory, nullptr);
+		*buffer = SharedBuffer();
+	}
+}
+
+bool RendererGeometryPool::Upload(VulkanRenderer& renderer, RendererMesh& mesh, const RendererVertex* pVertices, u32 vertexCount, const u32* pIndices, u32 indexCount)
+{
+	if (!vertexCount || !indexCount) return false;
+	std::lock_guard lock(poolMutex);
+	if (mesh.sharedVertices.count) return true;
+
+	GeometryRange vertexRange;
+	GeometryRange indexRange;
+	if (!Allocate(vertices, vertexCount, vertexRange))
+	{
+		Grow(renderer, vertices, vertexCount, sizeof(RendererVertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+		Allocate(vertices, vertexCount, vertexRange);
+	}
+	if (!Allocate(indices, indexCount, indexRange))
+	{
+		Grow(renderer, indices, indexCount, sizeof(u32), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+		Allocate(indices, indexCount, indexRange);
+	}
+	Write(renderer, vertices, pVertices, vertexRange, sizeof(RendererVertex));
+	Write(renderer, indices, pIndices, indexRange, sizeof(u32));
+
+	mesh.sharedVertices = vertexRange;
+	mesh.sharedIndices = indexRange;
+	return true;
+}
+
+void RendererGeometryPool::Release(VulkanRenderer& renderer, RendererMesh& mesh)
+{
+	if (!mesh.sharedVertices.count) return;
+	GeometryRange vertexRange = mesh.sharedVertices;
+	GeometryRange indexRange = mesh.sharedIndices;
+	renderer.QueueDeletion([this, vertexRange, indexRange]()
+	{
+		std::lock_guard lock(poolMutex);
+		Free(vertices, vertexRange);
+		Free(indices, indexRange);
+	});
+	mesh.sharedVertices = GeometryRange();
+	mesh.sharedIndices = GeometryRange();
+}
+
+void RendererGeometryPool::CreateSharedBuffer(VulkanRenderer& renderer, SharedBuffer& buffer, u32 capacity, u64 elementSize, VkBufferUsageFlags usage)
+{
+	renderer.CreateBuffer(capacity * elementSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer.handle, buffer.memory);
+	buffer.capacity = capacity;
+	buffer.freeRanges.clear();
+	buffer.freeRanges.push_back({ 0, capacity });
+}
+
+bool RendererGeometryPool::Allocate(SharedBuffer& buffer, u32 count, GeometryRange& range)
+{
+	// First fit, ranges are kept sorted by offset
+	for (auto it = buffer.freeRanges.begin(); it != buffer.freeRanges.end(); ++it)
+	{
+		if (it->count < count) continue;
+		range = { it->offset, count };
+		it->offset += count;
+		it->count -= count;
+		if (!it->count) buffer.freeRanges.erase(it);
+		return true;
+	}
+	return false;
+}
+
+void RendererGeometryPool::Grow(VulkanRenderer& renderer, SharedBuffer& buffer, u32 minCount, u64 elementSize, VkBufferUsageFlags usage)
+{
+	u32 capacity = buffer.capacity ? buffer.capacity : 1;
+	while (capacity - buffer.capacity < minCount) capacity *= 2;
+
+	SharedBuffer grown;
+	CreateSharedBuffer(renderer, grown, capacity, elementSize, usage);
+	if (buffer.capacity)
+	{
+		renderer.CopyBuffer(buffer.handle, grown.handle, buffer.capacity * elementSize);
+	}
+	grown.freeRanges = buffer.freeRanges;
+	Free(grown, { buffer.capacity, capacity - buffer.capacity });
+
+	// Commands already recorded this frame still point at the old buffer
+	VkBuffer oldHandle = buffer.handle;
+	VkDeviceMemory oldMemory = buffer.memory;
+	VkDevice device = renderer.device;
+	renderer.QueueDeletion([device, oldHandle, oldMemory]()
+	{
+		vkDestroyBuffer(device, oldHandle, nullptr);
+		vkFreeMemory(device, oldMemory, nullptr);
+	});
+	buffer = std::move(grown);
+	LOG(DEBUG_LEVEL::LINFO, "Shared geometry buffer grown to %u elements", capacity);
+}
+
+void RendererGeometryPool::Free(SharedBuffer& buffer, GeometryRange range)
+{
+	auto it = buffer.freeRanges.begin();
+	while (it != buffer.freeRanges.end() && it->offset < range.offset) ++it;
+	it = buffer.freeRanges.insert(it, range);
+	// Merge with the following then the preceding range
+	auto next = it + 1;
+	if (next != buffer.freeRanges.end() && it->offset + it->count == next->offset)
+	{
+		it->count += next->count;
+		it = buffer.freeRanges.erase(next) - 1;
+	}
+	if (it != buffer.freeRanges.begin())
+	{
+		auto previous = it - 1;
+		if (previous->offset + previous->count == it->offset)
+		{
+			previous->count += it->count;
+			buffer.freeRanges.erase(it);
+		}
+	}
+}
+
+void RendererGeometryPool::Write(VulkanRenderer& renderer, SharedBuffer& buffer, const void* data, GeometryRange range, u64 elementSize)
+{
+	VkDeviceSize size = range.count * elementSize;
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
+	renderer.CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+
+	void* mapped;
+	vkMapMemory(renderer.device, stagingBufferMemory, 0, size, 0, &mapped);
+	std::memcpy(mapped, data, size);
+	vkUnmapMemory(renderer.device, stagingBufferMemory);
+
+	renderer.CopyBuffer(stagingBuffer, buffer.handle, size, 0, range.offset * elementSize);
+
+	vkDestroyBuffer(renderer.device, stagingBuffer, nullptr);
+	vkFreeMemory(renderer.device, stagingBufferMemory, nullptr);
+}
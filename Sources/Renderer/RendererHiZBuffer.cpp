@@ -0,0 +1,204 @@
+#include "Renderer/RendererHiZBuffer.hpp"
+
+#include <array>
+#include <cmath>
+
+#include "Core/Debugging/Log.hpp"
+#include "Renderer/VulkanRenderer.hpp"
+#include "Renderer/RendererDepthBuffer.hpp"
+#include "Resources/TextureSampler.hpp"
+
+using namespace Renderer;
+
+bool RendererHiZBuffer::Prepare(VulkanRenderer& renderer, RendererDepthBuffer& depth)
+{
+	Maths::IVec2 depthResolution = depth.GetResolution();
+	if (!IsCreated() || source != depth.texture.textureImage || sourceResolution.x != depthResolution.x || sourceResolution.y != depthResolution.y)
+	{
+		DestroyHiZBuffer(renderer, true);
+		CreateHiZBuffer(renderer, depth);
+	}
+	return initialized;
+}
+
+void RendererHiZBuffer::Build(VulkanRenderer& renderer, VkCommandBuffer cmd, RendererDepthBuffer& depth, const RendererPipeline& reducePipeline)
+{
+	Prepare(renderer, depth);
+
+	std::array<VkImageMemoryBarrier, 2> barriers = {};
+	for (auto& barrier : barriers)
+	{
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.subresourceRange.baseMipLevel = 0;
+		barrier.subresourceRange.baseArrayLayer = 0;
+		barrier.subresourceRange.layerCount = 1;
+	}
+	barriers[0].image = source;
+	barriers[0].oldLayout = depth.layout;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	depth.layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barriers[0].subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	barriers[0].subresourceRange.levelCount = 1;
+
+	// The pyramid stays in general layout, the previous culling dispatch must be done reading it
+	barriers[1].image = image;
+	barriers[1].oldLayout = initialized ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barriers[1].srcAccessMask = initialized ? VK_ACCESS_SHADER_READ_BIT : 0;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barriers[1].subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barriers[1].subresourceRange.levelCount = mipCount;
+	initialized = true;
+
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, static_cast<u32>(barriers.size()), barriers.data());
+
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline.pipeline);
+	Uniform::HiZReduceConstants constants;
+	constants.targetSize = sourceResolution;
+	for (u32 i = 0; i < mipCount; i++)
+	{
+		constants.sourceSize = constants.targetSize;
+		constants.targetSize = Maths::IVec2(Maths::Util::MaxI(resolution.x >> i, 1), Maths::Util::MaxI(resolution.y >> i, 1));
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, reducePipeline.pipelineLayout, 0, 1, &reduceSets[i], 0, nullptr);
+		vkCmdPushConstants(cmd, reducePipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Uniform::HiZReduceConstants), &constants);
+		vkCmdDispatch(cmd, (constants.targetSize.x + 7) / 8, (constants.targetSize.y + 7) / 8, 1);
+
+		VkMemoryBarrier levelBarrier{};
+		levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &levelBarrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+void RendererHiZBuffer::CreateHiZBuffer(VulkanRenderer& renderer, RendererDepthBuffer& depth)
+{
+	source = depth.texture.textureImage;
+	sourceResolution = depth.GetResolution();
+	resolution = Maths::IVec2(Maths::Util::MaxI((sourceResolution.x + 1) / 2, 1), Maths::Util::MaxI((sourceResolution.y + 1) / 2, 1));
+	mipCount = static_cast<u32>(std::floor(std::log2(static_cast<f32>(Maths::Util::MaxI(resolution.x, resolution.y))))) + 1;
+	initialized = false;
+
+	renderer.CreateImage(resolution, mipCount, image, memory, VK_FORMAT_R32_SFLOAT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	view = renderer.CreateImageView(image, VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, mipCount);
+	mipViews.resize(mipCount);
+	for (u32 i = 0; i < mipCount; i++)
+	{
+		VkImageViewCreateInfo viewInfo{};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = VK_FORMAT_R32_SFLOAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = i;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+		if (vkCreateImageView(renderer.device, &viewInfo, nullptr, &mipViews[i]) != VK_SUCCESS)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "Failed to create depth pyramid image view!");
+			throw std::runtime_error("Failed to create depth pyramid image view!");
+		}
+	}
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = mipCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	poolSizes[1].descriptorCount = mipCount;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = static_cast<u32>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+	poolInfo.maxSets = mipCount;
+	if (vkCreateDescriptorPool(renderer.device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to create depth pyramid descriptor pool!");
+		throw std::runtime_error("Failed to create depth pyramid descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(mipCount, renderer.indirectUniform.GetReduceLayout());
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = mipCount;
+	allocInfo.pSetLayouts = layouts.data();
+	reduceSets.resize(mipCount);
+	if (vkAllocateDescriptorSets(renderer.device, &allocInfo, reduceSets.data()) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to allocate depth pyramid descriptor sets!");
+		throw std::runtime_error("Failed to allocate depth pyramid descriptor sets!");
+	}
+
+	// Level 0 reads the depth buffer, every other level reads the one above it
+	VkSampler sampler = Resources::TextureSampler::GetDefaultSampler()->renderSampler.GetSampler();
+	for (u32 i = 0; i < mipCount; i++)
+	{
+		VkDescriptorImageInfo sourceInfo{};
+		sourceInfo.sampler = sampler;
+		sourceInfo.imageView = i ? mipViews[i - 1] : depth.GetDepthImageView().imageView;
+		sourceInfo.imageLayout = i ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		VkDescriptorImageInfo targetInfo{};
+		targetInfo.imageView = mipViews[i];
+		targetInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+		for (u32 j = 0; j < descriptorWrites.size(); j++)
+		{
+			descriptorWrites[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			descriptorWrites[j].dstSet = reduceSets[i];
+			descriptorWrites[j].dstBinding = j;
+			descriptorWrites[j].dstArrayElement = 0;
+			descriptorWrites[j].descriptorCount = 1;
+		}
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[0].pImageInfo = &sourceInfo;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+		descriptorWrites[1].pImageInfo = &targetInfo;
+		vkUpdateDescriptorSets(renderer.device, static_cast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+		renderer.descriptorWriteCount += static_cast<u32>(descriptorWrites.size());
+	}
+	LOG(DEBUG_LEVEL::LINFO, "Created depth pyramid of %dx%d with %u levels", resolution.x, resolution.y, mipCount);
+}
+
+void RendererHiZBuffer::DestroyHiZBuffer(VulkanRenderer& renderer, bool deferred)
+{
+	if (!IsCreated()) return;
+	VkImage oldImage = image;
+	VkDeviceMemory oldMemory = memory;
+	VkImageView oldView = view;
+	std::vector<VkImageView> oldMipViews = mipViews;
+	VkDescriptorPool oldPool = descriptorPool;
+	VkDevice device = renderer.device;
+	auto release = [device, oldImage, oldMemory, oldView, oldMipViews, oldPool]()
+	{
+		vkDestroyDescriptorPool(device, oldPool, nullptr);
+		for (VkImageView mipView : oldMipViews)
+		{
+			vkDestroyImageView(device, mipView, nullptr);
+		}
+		vkDestroyImageView(device, oldView, nullptr);
+		vkDestroyImage(device, oldImage, nullptr);
+		vkFreeMemory(device, oldMemory, nullptr);
+	};
+	if (deferred)
+		renderer.QueueDeletion(release);
+	else
+		release();
+
+	image = VK_NULL_HANDLE;
+	memory = VK_NULL_HANDLE;
+	view = VK_NULL_HANDLE;
+	mipViews.clear();
+	descriptorPool = VK_NULL_HANDLE;
+	reduceSets.clear();
+	source = VK_NULL_HANDLE;
+	mipCount = 0;
+	initialized = false;
+}
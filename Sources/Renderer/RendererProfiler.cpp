@@ -0,0 +1,206 @@
+#include "Renderer/RendererProfiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "Core/Debugging/Log.hpp"
+#include "Renderer/VulkanRenderer.hpp"
+
+using namespace Renderer;
+
+void RendererProfiler::Create(VulkanRenderer& renderer)
+{
+	device = renderer.device;
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(renderer.physicalDevice, &properties);
+	u32 familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer.physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(renderer.physicalDevice, &familyCount, families.data());
+	const u32 validBits = families[renderer.GetGraphicsQueueIndex()].timestampValidBits;
+	if (!validBits)
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "The graphics queue does not support timestamps, the GPU profiler is disabled");
+		return;
+	}
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0llu : (1llu << validBits) - 1;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = PROFILER_MAX_SCOPES * 2 * MAX_FRAMES_IN_FLIGHT;
+	if (vkCreateQueryPool(device, &poolInfo, nullptr, &timestampPool) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Failed to create timestamp query pool, the GPU profiler is disabled");
+		timestampPool = VK_NULL_HANDLE;
+		return;
+	}
+	if (renderer.hasPipelineStatistics)
+	{
+		poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+		poolInfo.queryCount = PROFILER_MAX_SCOPES * MAX_FRAMES_IN_FLIGHT;
+		poolInfo.pipelineStatistics = statisticFlags;
+		if (vkCreateQueryPool(device, &poolInfo, nullptr, &statisticsPool) != VK_SUCCESS)
+		{
+			LOG(DEBUG_LEVEL::LWARNING, "Failed to create pipeline statistics query pool");
+			statisticsPool = VK_NULL_HANDLE;
+		}
+	}
+	frames.resize(MAX_FRAMES_IN_FLIGHT);
+}
+
+void RendererProfiler::Destroy(VulkanRenderer& renderer)
+{
+	if (timestampPool) vkDestroyQueryPool(renderer.device, timestampPool, nullptr);
+	if (statisticsPool) vkDestroyQueryPool(renderer.device, statisticsPool, nullptr);
+	timestampPool = VK_NULL_HANDLE;
+	statisticsPool = VK_NULL_HANDLE;
+	frames.clear();
+}
+
+void RendererProfiler::BeginFrame(VkCommandBuffer cmd, u32 frame)
+{
+	if (!IsSupported()) return;
+	currentFrame = frame;
+	FrameScopes& scopes = frames[frame];
+	if (!scopes.scopes.empty()) ReadResults(frame);
+	scopes.scopes.clear();
+	scopes.statisticsCount = 0;
+	stack.clear();
+	statisticsScope = ~0u;
+	enabled = requestEnabled;
+	if (!enabled) return;
+
+	vkCmdResetQueryPool(cmd, timestampPool, frame * PROFILER_MAX_SCOPES * 2, PROFILER_MAX_SCOPES * 2);
+	if (statisticsPool) vkCmdResetQueryPool(cmd, statisticsPool, frame * PROFILER_MAX_SCOPES, PROFILER_MAX_SCOPES);
+}
+
+u32 RendererProfiler::PushScope(const std::string& name, bool useStatistics)
+{
+	if (!enabled) return ~0u;
+	FrameScopes& frame = frames[currentFrame];
+	if (frame.scopes.size() >= PROFILER_MAX_SCOPES)
+	{
+		stack.push_back(~0u);
+		return ~0u;
+	}
+	const u32 index = static_cast<u32>(frame.scopes.size());
+	Scope scope;
+	scope.name = name;
+	scope.depth = static_cast<u32>(stack.size());
+	if (useStatistics && statisticsPool && statisticsScope == ~0u)
+	{
+		scope.statistics = frame.statisticsCount++;
+		statisticsScope = index;
+	}
+	frame.scopes.push_back(std::move(scope));
+	stack.push_back(index);
+	return index;
+}
+
+u32 RendererProfiler::PopScope()
+{
+	if (!enabled || stack.empty()) return ~0u;
+	const u32 scope = stack.back();
+	stack.pop_back();
+	if (scope == statisticsScope) statisticsScope = ~0u;
+	return scope;
+}
+
+void RendererProfiler::WriteScope(VkCommandBuffer cmd, u32 scope, bool end)
+{
+	if (scope == ~0u) return;
+	const u32 statisticsQuery = frames[currentFrame].scopes[scope].statistics;
+	const u32 query = (currentFrame * PROFILER_MAX_SCOPES + scope) * 2;
+	if (!end)
+	{
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampPool, query);
+		if (statisticsQuery != ~0u) vkCmdBeginQuery(cmd, statisticsPool, currentFrame * PROFILER_MAX_SCOPES + statisticsQuery, 0);
+	}
+	else
+	{
+		if (statisticsQuery != ~0u) vkCmdEndQuery(cmd, statisticsPool, currentFrame * PROFILER_MAX_SCOPES + statisticsQuery);
+		vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampPool, query + 1);
+	}
+}
+
+void RendererProfiler::ReadResults(u32 frameIndex)
+{
+	// The fence of the frame slot was waited, so the queries are available and this does not block
+	const FrameScopes& frame = frames[frameIndex];
+	const u32 scopeCount = static_cast<u32>(frame.scopes.size());
+	timestamps.resize(scopeCount * 2);
+	if (vkGetQueryPoolResults(device, timestampPool, frameIndex * PROFILER_MAX_SCOPES * 2, scopeCount * 2, timestamps.size() * sizeof(u64), timestamps.data(), sizeof(u64), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+	statistics.resize(frame.statisticsCount);
+	if (frame.statisticsCount && vkGetQueryPoolResults(device, statisticsPool, frameIndex * PROFILER_MAX_SCOPES, frame.statisticsCount, statistics.size() * sizeof(ProfilerStatistics), statistics.data(), sizeof(ProfilerStatistics), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+		return;
+
+	results.clear();
+	for (u32 i = 0; i < scopeCount; i++)
+	{
+		const Scope& scope = frame.scopes[i];
+		auto result = std::find_if(results.begin(), results.end(), [&scope](const ProfilerResult& r) { return r.depth == scope.depth && r.name == scope.name; });
+		if (result == results.end())
+		{
+			results.emplace_back();
+			result = results.end() - 1;
+			result->name = scope.name;
+			result->depth = scope.depth;
+		}
+		result->count++;
+		result->time += ((timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask) * timestampPeriod / 1000000.0;
+		if (scope.statistics == ~0u) continue;
+		const ProfilerStatistics& values = statistics[scope.statistics];
+		result->hasStatistics = true;
+		result->statistics.inputVertices += values.inputVertices;
+		result->statistics.inputPrimitives += values.inputPrimitives;
+		result->statistics.vertexInvocations += values.vertexInvocations;
+		result->statistics.clippedPrimitives += values.clippedPrimitives;
+		result->statistics.fragmentInvocations += values.fragmentInvocations;
+		result->statistics.computeInvocations += values.computeInvocations;
+	}
+	for (auto& result : results)
+	{
+		History& entry = history[std::to_string(result.depth) + '/' + result.name];
+		entry.times[entry.cursor] = result.time;
+		entry.cursor = (entry.cursor + 1) % PROFILER_HISTORY;
+		entry.count = std::min(entry.count + 1, static_cast<u32>(PROFILER_HISTORY));
+		for (u32 i = 0; i < entry.count; i++)
+		{
+			result.averageTime += entry.times[i];
+			result.maxTime = std::max(result.maxTime, entry.times[i]);
+		}
+		result.averageTime /= entry.count;
+	}
+}
+
+bool RendererProfiler::ExportCSV(const std::string& path) const
+{
+	std::ofstream out(path, std::ios::out | std::ios::trunc);
+	if (!out.is_open())
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not open %s", path.c_str());
+		return false;
+	}
+	out << "Scope,Depth,Count,Last ms,Average ms,Max ms,Input vertices,Input primitives,Vertex invocations,Clipped primitives,Fragment invocations,Compute invocations\n";
+	for (auto& result : results)
+	{
+		std::string name = result.name;
+		for (u64 i = name.find('"'); i != std::string::npos; i = name.find('"', i + 2)) name.insert(i, 1, '"');
+		out << '"' << name << "\"," << result.depth << ',' << result.count << ',' << result.time << ',' << result.averageTime << ',' << result.maxTime;
+		if (result.hasStatistics)
+		{
+			const ProfilerStatistics& s = result.statistics;
+			out << ',' << s.inputVertices << ',' << s.inputPrimitives << ',' << s.vertexInvocations << ',' << s.clippedPrimitives << ',' << s.fragmentInvocations << ',' << s.computeInvocations;
+		}
+		else
+		{
+			out << ",,,,,,";
+		}
+		out << '\n';
+	}
+	LOG(DEBUG_LEVEL::LINFO, "Exported GPU profile to %s", path.c_str());
+	return true;
+}
@@ -0,0 +1,395 @@
+#include "Renderer/RendererRenderGraph.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Core/Debugging/Log.hpp"
+#include "Renderer/VulkanRenderer.hpp"
+
+using namespace Renderer;
+
+// Blocks that no graph needed for this many frames are given back to the driver
+constexpr u32 TRANSIENT_BLOCK_LIFETIME = 120;
+
+void RendererTransientPool::BeginGraph()
+{
+	for (auto& block : blocks)
+	{
+		block.busyUntil = -1;
+	}
+}
+
+u32 RendererTransientPool::Acquire(VulkanRenderer& renderer, const RenderGraphTextureDesc& desc, u32 firstPass, u32 lastPass)
+{
+	u32 result = ~0u;
+	for (u32 i = 0; i < images.size(); i++)
+	{
+		const TransientImage& image = images[i];
+		if (image.desc.format == desc.format && image.desc.resolution.x == desc.resolution.x && image.desc.resolution.y == desc.resolution.y && blocks[image.block].busyUntil < static_cast<s32>(firstPass))
+		{
+			result = i;
+			break;
+		}
+	}
+	if (result == ~0u) result = CreateImage(renderer, desc, firstPass);
+	TransientBlock& block = blocks[images[result].block];
+	block.busyUntil = static_cast<s32>(lastPass);
+	block.unusedFrames = 0;
+	return result;
+}
+
+u32 RendererTransientPool::CreateImage(VulkanRenderer& renderer, const RenderGraphTextureDesc& desc, u32 firstPass)
+{
+	TransientImage result;
+	result.desc = desc;
+
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = desc.resolution.x;
+	imageInfo.extent.height = desc.resolution.y;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = desc.format;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	VkImage image;
+	if (vkCreateImage(renderer.device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to create transient image!");
+		throw std::runtime_error("Failed to create transient image!");
+	}
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(renderer.device, image, &requirements);
+
+	// Smallest free block large enough, a new one is allocated when every compatible block is in use
+	u32 blockIndex = ~0u;
+	for (u32 i = 0; i < blocks.size(); i++)
+	{
+		const TransientBlock& block = blocks[i];
+		if (!block.memory || block.busyUntil >= static_cast<s32>(firstPass) || block.size < requirements.size || !(requirements.memoryTypeBits & (1u << block.memoryType))) continue;
+		if (blockIndex == ~0u || block.size < blocks[blockIndex].size) blockIndex = i;
+	}
+	if (blockIndex == ~0u)
+	{
+		TransientBlock block;
+		block.size = requirements.size;
+		block.memoryType = renderer.FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VkMemoryAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = block.size;
+		allocInfo.memoryTypeIndex = block.memoryType;
+		if (vkAllocateMemory(renderer.device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "Failed to allocate transient memory!");
+			throw std::runtime_error("Failed to allocate transient memory!");
+		}
+		auto freeBlock = std::find_if(blocks.begin(), blocks.end(), [](const TransientBlock& b) { return !b.memory; });
+		if (freeBlock != blocks.end())
+		{
+			*freeBlock = block;
+			blockIndex = static_cast<u32>(freeBlock - blocks.begin());
+		}
+		else
+		{
+			blockIndex = static_cast<u32>(blocks.size());
+			blocks.push_back(block);
+		}
+	}
+	vkBindImageMemory(renderer.device, image, blocks[blockIndex].memory, 0);
+	result.block = blockIndex;
+
+	RendererImageView view;
+	view.imageView = renderer.CreateImageView(image, desc.format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+	VkRenderPass renderPass = GetRenderPass(renderer, desc.format);
+	std::vector<VkImageView> attachments;
+	result.target = RendererFrameBuffer(desc.resolution, attachments, renderPass, renderer.device, image, view);
+	images.push_back(result);
+	return static_cast<u32>(images.size() - 1);
+}
+
+VkRenderPass RendererTransientPool::GetRenderPass(VulkanRenderer& renderer, VkFormat format)
+{
+	for (auto& pass : renderPasses)
+	{
+		if (pass.first == format) return pass.second;
+	}
+
+	// The graph moves the attachment in and out of this layout, and every pass covers the whole target
+	VkAttachmentDescription colorAttachment{};
+	colorAttachment.format = format;
+	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference colorReference{};
+	colorReference.attachment = 0;
+	colorReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkSubpassDescription subpass{};
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colorReference;
+
+	VkRenderPassCreateInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	renderPassInfo.attachmentCount = 1;
+	renderPassInfo.pAttachments = &colorAttachment;
+	renderPassInfo.subpassCount = 1;
+	renderPassInfo.pSubpasses = &subpass;
+
+	VkRenderPass result;
+	if (vkCreateRenderPass(renderer.device, &renderPassInfo, nullptr, &result) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to create render pass!");
+		throw std::runtime_error("failed to create render pass!");
+	}
+	renderPasses.push_back({ format, result });
+	return result;
+}
+
+void RendererTransientPool::EndFrame(VulkanRenderer& renderer)
+{
+	for (u32 i = 0; i < blocks.size(); i++)
+	{
+		TransientBlock& block = blocks[i];
+		if (!block.memory || ++block.unusedFrames < TRANSIENT_BLOCK_LIFETIME) continue;
+		auto last = std::remove_if(images.begin(), images.end(), [&renderer, i](TransientImage& image)
+		{
+			if (image.block != i) return false;
+			renderer.DeleteFrameBuffer(image.target);
+			return true;
+		});
+		images.erase(last, images.end());
+		VkDeviceMemory memory = block.memory;
+		renderer.QueueDeletion([&renderer, memory]() { vkFreeMemory(renderer.device, memory, nullptr); });
+		block = TransientBlock();
+	}
+}
+
+void RendererTransientPool::DestroyPool(VulkanRenderer& renderer)
+{
+	for (auto& image : images)
+	{
+		image.target.DeleteFrameBuffer(renderer.device);
+	}
+	for (auto& block : blocks)
+	{
+		if (block.memory) vkFreeMemory(renderer.device, block.memory, nullptr);
+	}
+	for (auto& pass : renderPasses)
+	{
+		vkDestroyRenderPass(renderer.device, pass.second, nullptr);
+	}
+	images.clear();
+	blocks.clear();
+	renderPasses.clear();
+}
+
+void RendererRenderGraph::Reset()
+{
+	resources.clear();
+	passes.clear();
+}
+
+RenderGraphResource RendererRenderGraph::CreateTexture(const RenderGraphTextureDesc& desc)
+{
+	GraphResource resource;
+	resource.desc = desc;
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+RenderGraphResource RendererRenderGraph::ImportTexture(const RendererTexture* texture, Maths::IVec2 resolution)
+{
+	GraphResource resource;
+	resource.desc.resolution = resolution;
+	resource.imported = texture;
+	resources.push_back(resource);
+	return static_cast<RenderGraphResource>(resources.size() - 1);
+}
+
+u32 RendererRenderGraph::AddPass(std::function<void()> execute)
+{
+	GraphPass pass;
+	pass.execute = std::move(execute);
+	passes.push_back(std::move(pass));
+	return static_cast<u32>(passes.size() - 1);
+}
+
+void RendererRenderGraph::Read(u32 pass, RenderGraphResource resource)
+{
+	passes[pass].reads.push_back(resource);
+}
+
+void RendererRenderGraph::Write(u32 pass, RenderGraphResource resource)
+{
+	passes[pass].writes.push_back(resource);
+	resources[resource].writers.push_back(pass);
+}
+
+void RendererRenderGraph::Extract(RenderGraphResource resource)
+{
+	resources[resource].extracted = true;
+}
+
+void RendererRenderGraph::Compile()
+{
+	for (auto& pass : passes)
+	{
+		pass.refCount = static_cast<u32>(pass.writes.size());
+		for (RenderGraphResource read : pass.reads)
+		{
+			resources[read].refCount++;
+		}
+	}
+	std::vector<RenderGraphResource> unused;
+	for (u32 i = 0; i < resources.size(); i++)
+	{
+		GraphResource& resource = resources[i];
+		if (resource.extracted) resource.refCount++;
+		if (!resource.refCount) unused.push_back(i);
+	}
+
+	// Passes lose a reference for each of their outputs nobody reads, and are culled along with their inputs once at zero
+	auto cullPass = [&](GraphPass& pass)
+	{
+		for (RenderGraphResource read : pass.reads)
+		{
+			if (--resources[read].refCount == 0) unused.push_back(read);
+		}
+	};
+	for (auto& pass : passes)
+	{
+		if (!pass.refCount) cullPass(pass);
+	}
+	while (!unused.empty())
+	{
+		GraphResource& resource = resources[unused.back()];
+		unused.pop_back();
+		for (u32 writer : resource.writers)
+		{
+			if (passes[writer].refCount && --passes[writer].refCount == 0) cullPass(passes[writer]);
+		}
+	}
+
+	for (u32 i = 0; i < passes.size(); i++)
+	{
+		if (!passes[i].refCount) continue;
+		for (const auto* list : { &passes[i].reads, &passes[i].writes })
+		{
+			for (RenderGraphResource used : *list)
+			{
+				resources[used].firstPass = std::min(resources[used].firstPass, i);
+				resources[used].lastPass = std::max(resources[used].lastPass, i);
+			}
+		}
+	}
+	for (auto& resource : resources)
+	{
+		if (resource.extracted) resource.lastPass = static_cast<u32>(passes.size());
+	}
+}
+
+void RendererRenderGraph::Execute(VulkanRenderer& renderer, RendererTransientPool& poolIn, VkCommandBuffer cmd)
+{
+	pool = &poolIn;
+	Compile();
+	pool->BeginGraph();
+	for (u32 i = 0; i < passes.size(); i++)
+	{
+		const GraphPass& pass = passes[i];
+		if (!pass.refCount) continue;
+		for (const auto* list : { &pass.reads, &pass.writes })
+		{
+			for (RenderGraphResource used : *list)
+			{
+				GraphResource& resource = resources[used];
+				if (resource.imported || resource.firstPass != i) continue;
+				resource.image = pool->Acquire(renderer, resource.desc, resource.firstPass, resource.lastPass);
+				pool->GetLayout(resource.image) = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+		}
+		TransitionResources(cmd, pass);
+		pass.execute();
+	}
+
+	GraphPass extraction;
+	for (u32 i = 0; i < resources.size(); i++)
+	{
+		if (resources[i].extracted && resources[i].image != ~0u) extraction.reads.push_back(i);
+	}
+	TransitionResources(cmd, extraction);
+}
+
+void RendererRenderGraph::TransitionResources(VkCommandBuffer cmd, const GraphPass& pass)
+{
+	std::vector<VkImageMemoryBarrier> barriers;
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+	auto addBarrier = [&](GraphResource& resource, VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+	{
+		VkImageLayout& layout = pool->GetLayout(resource.image);
+		VkImageMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.oldLayout = layout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = pool->GetFrameBuffer(resource.image).rendererTex.textureImage;
+		barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		barrier.subresourceRange.levelCount = 1;
+		barrier.subresourceRange.layerCount = 1;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barriers.push_back(barrier);
+		srcStages |= srcStage;
+		dstStages |= dstStage;
+		layout = newLayout;
+	};
+
+	for (RenderGraphResource read : pass.reads)
+	{
+		GraphResource& resource = resources[read];
+		// Textures sampled by consecutive passes keep their layout
+		if (resource.imported || pool->GetLayout(resource.image) != VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) continue;
+		addBarrier(resource, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+	for (RenderGraphResource write : pass.writes)
+	{
+		GraphResource& resource = resources[write];
+		if (resource.imported) continue;
+		switch (pool->GetLayout(resource.image))
+		{
+		case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+			addBarrier(resource, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+			break;
+		default:
+			// Written again, or first use of the block by this texture which has to wait for its previous occupant
+			addBarrier(resource, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+			break;
+		}
+	}
+	if (barriers.empty()) return;
+	vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, static_cast<u32>(barriers.size()), barriers.data());
+}
+
+const RendererTexture* RendererRenderGraph::GetTexture(RenderGraphResource resource) const
+{
+	const GraphResource& graphResource = resources[resource];
+	if (graphResource.imported) return graphResource.imported;
+	return &pool->GetFrameBuffer(graphResource.image).rendererTex;
+}
+
+RendererFrameBuffer& RendererRenderGraph::GetFrameBuffer(RenderGraphResource resource)
+{
+	return pool->GetFrameBuffer(resources[resource].image);
+}
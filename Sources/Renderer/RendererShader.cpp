@@ -52,4 +52,8 @@ namespace Renderer
 	GeometryRendererShader::GeometryRendererShader() : RendererShader(VK_SHADER_STAGE_GEOMETRY_BIT)
 	{
 	}
+
+	ComputeRendererShader::ComputeRendererShader() : RendererShader(VK_SHADER_STAGE_COMPUTE_BIT)
+	{
+	}
 }
\ No newline at end of file
@@ -1,42 +1,94 @@
 #include "Renderer/RendererVertex.hpp"
 
 #include <array>
+#include <cmath>
+#include <algorithm>
 
 namespace Renderer
 {
-	VkVertexInputBindingDescription RendererVertex::GetBindingDescription()
+	VkVertexInputBindingDescription RendererVertex::GetBindingDescription(VertexLayout layout)
 	{
 		VkVertexInputBindingDescription bindingDescription{};
 		bindingDescription.binding = 0;
-		bindingDescription.stride = sizeof(RendererVertex);
+		bindingDescription.stride = layout == VertexLayout::PACKED ? sizeof(PackedVertex) : sizeof(RendererVertex);
 		bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
 		return bindingDescription;
 	}
 
-	std::array<VkVertexInputAttributeDescription, 5> RendererVertex::GetAttributeDescriptions()
+	std::array<VkVertexInputAttributeDescription, 5> RendererVertex::GetAttributeDescriptions(VertexLayout layout)
 	{
 		std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
-		attributeDescriptions[0].binding = 0;
-		attributeDescriptions[0].location = 0;
+		for (u32 i = 0; i < attributeDescriptions.size(); i++)
+		{
+			attributeDescriptions[i].binding = 0;
+			attributeDescriptions[i].location = i;
+		}
+		if (layout == VertexLayout::PACKED)
+		{
+			attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+			attributeDescriptions[0].offset = offsetof(PackedVertex, pos);
+			attributeDescriptions[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+			attributeDescriptions[1].offset = offsetof(PackedVertex, color);
+			attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+			attributeDescriptions[2].offset = offsetof(PackedVertex, uv);
+			attributeDescriptions[3].format = VK_FORMAT_R8G8B8A8_SNORM;
+			attributeDescriptions[3].offset = offsetof(PackedVertex, normal);
+			attributeDescriptions[4].format = VK_FORMAT_R8G8B8A8_SNORM;
+			attributeDescriptions[4].offset = offsetof(PackedVertex, tangent);
+			return attributeDescriptions;
+		}
 		attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDescriptions[0].offset = offsetof(RendererVertex, pos);
-		attributeDescriptions[1].binding = 0;
-		attributeDescriptions[1].location = 1;
 		attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDescriptions[1].offset = offsetof(RendererVertex, color);
-		attributeDescriptions[2].binding = 0;
-		attributeDescriptions[2].location = 2;
 		attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
 		attributeDescriptions[2].offset = offsetof(RendererVertex, uv);
-		attributeDescriptions[3].binding = 0;
-		attributeDescriptions[3].location = 3;
 		attributeDescriptions[3].format = VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDescriptions[3].offset = offsetof(RendererVertex, normal);
-		attributeDescriptions[4].binding = 0;
-		attributeDescriptions[4].location = 4;
 		attributeDescriptions[4].format = VK_FORMAT_R32G32B32_SFLOAT;
 		attributeDescriptions[4].offset = offsetof(RendererVertex, tangent);
 		return attributeDescriptions;
 	}
+
+	void PackedVertex::PackVertices(const std::vector<RendererVertex>& vertices, std::vector<PackedVertex>& output, Maths::Vec3& center, f32& scale)
+	{
+		output.resize(vertices.size());
+		center = Maths::Vec3();
+		scale = 1.0f;
+		if (vertices.empty()) return;
+		Maths::Vec3 low = vertices[0].pos;
+		Maths::Vec3 high = low;
+		for (auto& vertex : vertices)
+		{
+			for (u32 k = 0; k < 3; k++)
+			{
+				low[k] = std::min(low[k], vertex.pos[k]);
+				high[k] = std::max(high[k], vertex.pos[k]);
+			}
+		}
+		center = (low + high) * 0.5f;
+		const Maths::Vec3 extent = (high - low) * 0.5f;
+		scale = std::max(std::max(extent.x, extent.y), extent.z);
+		if (scale <= 0.0f) scale = 1.0f;
+
+		auto Snorm8 = [](f32 value) { return static_cast<s8>(std::round(std::clamp(value, -1.0f, 1.0f) * 127.0f)); };
+		auto Unorm8 = [](f32 value) { return static_cast<u8>(std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f)); };
+		for (u64 i = 0; i < vertices.size(); i++)
+		{
+			const RendererVertex& vertex = vertices[i];
+			PackedVertex& packed = output[i];
+			for (u32 k = 0; k < 3; k++)
+			{
+				packed.pos[k] = static_cast<s16>(std::round(std::clamp((vertex.pos[k] - center[k]) / scale, -1.0f, 1.0f) * 32767.0f));
+				packed.color[k] = Unorm8(vertex.color[k]);
+				packed.normal[k] = Snorm8(vertex.normal[k]);
+				packed.tangent[k] = Snorm8(vertex.tangent[k]);
+			}
+			packed.pos[3] = 32767;
+			packed.color[3] = 255;
+			packed.uv[0] = Maths::Util::FloatToHalf(vertex.uv.x);
+			packed.uv[1] = Maths::Util::FloatToHalf(vertex.uv.y);
+		}
+	}
 }
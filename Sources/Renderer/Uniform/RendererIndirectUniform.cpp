@@ -0,0 +1,117 @@
+#include "Renderer/Uniform/RendererIndirectUniform.hpp"
+
+#include <array>
+
+#include "Core/Debugging/Log.hpp"
+#include "Renderer/Uniform/RendererMainUniform.hpp"
+
+using namespace Renderer;
+using namespace Renderer::Uniform;
+
+void RendererIndirectUniform::CreateDescriptorSetLayout(VkDevice& device, VkPhysicalDevice& physicalDevice)
+{
+    std::array<VkDescriptorSetLayoutBinding, 5> bindings = {};
+    for (u32 i = 0; i < bindings.size(); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    for (u32 i = 2; i < bindings.size(); i++)
+    {
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<u32>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        LOG(DEBUG_LEVEL::LERROR, "Failed to create descriptor set layout!");
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+
+    std::array<VkDescriptorSetLayoutBinding, 8> cullBindings = {};
+    for (u32 i = 0; i < cullBindings.size(); i++)
+    {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        cullBindings[i].pImmutableSamplers = nullptr;
+    }
+    cullBindings[7].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    layoutInfo.bindingCount = static_cast<u32>(cullBindings.size());
+    layoutInfo.pBindings = cullBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &cullSetLayout) != VK_SUCCESS)
+    {
+        LOG(DEBUG_LEVEL::LERROR, "Failed to create descriptor set layout!");
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+
+    std::array<VkDescriptorSetLayoutBinding, 2> reduceBindings = {};
+    for (u32 i = 0; i < reduceBindings.size(); i++)
+    {
+        reduceBindings[i].binding = i;
+        reduceBindings[i].descriptorCount = 1;
+        reduceBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        reduceBindings[i].pImmutableSamplers = nullptr;
+    }
+    reduceBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    reduceBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    layoutInfo.bindingCount = static_cast<u32>(reduceBindings.size());
+    layoutInfo.pBindings = reduceBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &reduceSetLayout) != VK_SUCCESS)
+    {
+        LOG(DEBUG_LEVEL::LERROR, "Failed to create descriptor set layout!");
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+
+    std::array<VkDescriptorSetLayoutBinding, 4> skinBindings = {};
+    for (u32 i = 0; i < skinBindings.size(); i++)
+    {
+        skinBindings[i].binding = i;
+        skinBindings[i].descriptorCount = 1;
+        skinBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        skinBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        skinBindings[i].pImmutableSamplers = nullptr;
+    }
+
+    layoutInfo.bindingCount = static_cast<u32>(skinBindings.size());
+    layoutInfo.pBindings = skinBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &skinSetLayout) != VK_SUCCESS)
+    {
+        LOG(DEBUG_LEVEL::LERROR, "Failed to create descriptor set layout!");
+        throw std::runtime_error("Failed to create descriptor set layout!");
+    }
+}
+
+void RendererIndirectUniform::DestroyDescriptorSetLayout(VkDevice& device)
+{
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, cullSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, reduceSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, skinSetLayout, nullptr);
+}
+
+u64 RendererIndirectUniform::GetVertexBufSize() const
+{
+    return 0;
+}
+
+u64 RendererIndirectUniform::GetFragmentBufSize() const
+{
+    return sizeof(MainFragmentUniform);
+}
@@ -40,7 +40,22 @@ void RendererLightUniform::CreateDescriptorSetLayout(VkDevice& device, VkPhysica
     posLayoutBinding.pImmutableSamplers = nullptr;
     posLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    std::array<VkDescriptorSetLayoutBinding, 4> bindings = { fragLayoutBinding, albedoLayoutBinding, normalLayoutBinding, posLayoutBinding };
+    VkDescriptorSetLayoutBinding depthLayoutBinding = posLayoutBinding;
+    depthLayoutBinding.binding = 9;
+
+    // Directional, point and spot lights, then the cluster ranges and the light index list
+    std::array<u32, 5> storageIndices = { 1, 5, 6, 7, 8 };
+    std::array<VkDescriptorSetLayoutBinding, 10> bindings = { fragLayoutBinding, albedoLayoutBinding, normalLayoutBinding, posLayoutBinding };
+    for (u64 i = 0; i < storageIndices.size(); i++)
+    {
+        VkDescriptorSetLayoutBinding& storageLayoutBinding = bindings[4 + i];
+        storageLayoutBinding.binding = storageIndices[i];
+        storageLayoutBinding.descriptorCount = 1;
+        storageLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        storageLayoutBinding.pImmutableSamplers = nullptr;
+        storageLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+    bindings.back() = depthLayoutBinding;
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<u32>(bindings.size());
@@ -33,7 +33,14 @@ void RendererPostUniform::CreateDescriptorSetLayout(VkDevice& device, VkPhysical
     glowLayoutBinding.pImmutableSamplers = nullptr;
     glowLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    std::array<VkDescriptorSetLayoutBinding, 3> bindings = { fragLayoutBinding, colorLayoutBinding, glowLayoutBinding };
+    VkDescriptorSetLayoutBinding filteredLayoutBinding{};
+    filteredLayoutBinding.binding = 4;
+    filteredLayoutBinding.descriptorCount = 1;
+    filteredLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    filteredLayoutBinding.pImmutableSamplers = nullptr;
+    filteredLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings = { fragLayoutBinding, colorLayoutBinding, glowLayoutBinding, filteredLayoutBinding };
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<u32>(bindings.size());
@@ -19,7 +19,10 @@ void RendererWindowUniform::CreateDescriptorSetLayout(VkDevice& device, VkPhysic
     samplerLayoutBinding.pImmutableSamplers = nullptr;
     samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
 
-    std::array<VkDescriptorSetLayoutBinding, 1> bindings = { samplerLayoutBinding };
+    VkDescriptorSetLayoutBinding glowLayoutBinding = samplerLayoutBinding;
+    glowLayoutBinding.binding = 1;
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings = { samplerLayoutBinding, glowLayoutBinding };
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
     layoutInfo.bindingCount = static_cast<u32>(bindings.size());
@@ -2,6 +2,8 @@
 
 #include <map>
 #include <set>
+#include <algorithm>
+#include <cstddef>
 
 #include "Core/App.hpp"
 #include "Core/Debugging/Log.hpp"
@@ -9,10 +11,13 @@
 
 #include "Renderer/RendererVertex.hpp"
 #include "Wrappers/Interfacing.hpp"
+#include "Wrappers/ShaderLoader.hpp"
+#include "Wrappers/TextureEncoder.hpp"
 
 #include "Resources/ResourceManager.hpp"
 #include "Resources/ShaderProgram.hpp"
 #include "Resources/Model.hpp"
+#include "Resources/SkinnedModel.hpp"
 #include "Resources/Mesh.hpp"
 #include "Resources/StaticTexture.hpp"
 #include "Resources/StaticCubeMap.hpp"
@@ -64,15 +69,17 @@ bool VulkanRenderer::LoadShaderProgram(Resources::ShaderProgram* p_shader, LowRe
 {
 	if (targetPass == LowRenderer::RenderPassType::ALL)
 	{
-		return CreateGraphicsPipeline(windowRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.pipeline, Renderer::PipelineParams::WINDOW);
+		return CreateGraphicsPipeline(windowRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.pipeline, static_cast<PipelineParams>(PipelineParams::WINDOW | PipelineParams::PIXEL_STAGES));
 	}
 	else if (targetPass & LowRenderer::RenderPassType::OBJECT)
 	{
-		return CreateGraphicsPipeline(objectRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.pipeline);
+		// Object variants are still stored with their programs, picking reads the id attachment of the geometry pass
+		return true;
 	}
 	else if (targetPass & LowRenderer::RenderPassType::LIGHT)
 	{
-		return 	CreateGraphicsPipeline(lightRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.pipeline, PipelineParams::LIGHT_PASS);
+		return 	CreateGraphicsPipeline(lightRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.pipeline, PipelineParams::LIGHT_PASS) &&
+			CreateGraphicsPipeline(lightRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.compactPipeline, static_cast<PipelineParams>(PipelineParams::LIGHT_PASS | PipelineParams::COMPACT_GBUFFER));
 	}
 	else if (targetPass & LowRenderer::RenderPassType::POST)
 	{
@@ -80,8 +87,11 @@ bool VulkanRenderer::LoadShaderProgram(Resources::ShaderProgram* p_shader, LowRe
 	}
 	else
 	{
-		return CreateGraphicsPipeline(geometryRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.pipeline,
-			static_cast<PipelineParams>(PipelineParams::EXTRA_ATTACHMENT | PipelineParams::STENCIL | (targetPass & LowRenderer::RenderPassType::LINE ? PipelineParams::LINE : 0) | (targetPass & LowRenderer::RenderPassType::WIRE ? PipelineParams::WIREFRAME : 0) | (targetPass & LowRenderer::RenderPassType::DEPTH ? PipelineParams::DEPTH_CLEAR : 0)));
+		PipelineParams params = static_cast<PipelineParams>(PipelineParams::EXTRA_ATTACHMENT | PipelineParams::STENCIL | (targetPass & LowRenderer::RenderPassType::LINE ? PipelineParams::LINE : 0) | (targetPass & LowRenderer::RenderPassType::WIRE ? PipelineParams::WIREFRAME : 0) | (targetPass & LowRenderer::RenderPassType::DEPTH ? PipelineParams::DEPTH_CLEAR : 0) | (p_shader->WritesObjectID() ? PipelineParams::OBJECT_ID : 0));
+		return CreateGraphicsPipeline(geometryRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.pipeline, params) &&
+			CreateGraphicsPipeline(geometryCompactRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.compactPipeline, static_cast<PipelineParams>(params | PipelineParams::COMPACT_GBUFFER)) &&
+			CreateGraphicsPipeline(geometryRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.packedPipeline, static_cast<PipelineParams>(params | PipelineParams::PACKED_VERTEX)) &&
+			CreateGraphicsPipeline(geometryCompactRenderPass, p_shader->program.vertex, p_shader->program.fragment, p_shader->program.packedCompactPipeline, static_cast<PipelineParams>(params | PipelineParams::COMPACT_GBUFFER | PipelineParams::PACKED_VERTEX));
 	}
 }
 
@@ -97,55 +107,45 @@ bool VulkanRenderer::LoadModel(Resources::Model* p_model)
 
 Renderer::VertexBuffer VulkanRenderer::CreateVertexBuffer(const RendererVertex* pVertices, const unsigned int& pVerticesCount)
 {
-	VertexBuffer buffer{};
-
-	VkDeviceSize bufferSize = sizeof(RendererVertex) * pVerticesCount;
-
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* data;
-
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	std::copy(pVertices, pVertices + pVerticesCount, reinterpret_cast<RendererVertex*>(data));
-	vkUnmapMemory(device, stagingBufferMemory);
-
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer.handle, buffer.memory);
-	CopyBuffer(stagingBuffer, buffer.handle, bufferSize);
-
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	return CreateStaticBuffer(pVertices, sizeof(RendererVertex) * pVerticesCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
 
-	return buffer;
+Renderer::VertexBuffer VulkanRenderer::CreateVertexBuffer(const PackedVertex* pVertices, const unsigned int& pVerticesCount)
+{
+	return CreateStaticBuffer(pVertices, sizeof(PackedVertex) * pVerticesCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 }
 
 Renderer::IndiceBuffer VulkanRenderer::CreateIndiceBuffer(const u32* pIndices, const unsigned int& pIndicesCount)
 {
-	IndiceBuffer buffer{};
+	return CreateStaticBuffer(pIndices, sizeof(u32) * pIndicesCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+Renderer::IndiceBuffer VulkanRenderer::CreateIndiceBuffer(const u16* pIndices, const unsigned int& pIndicesCount)
+{
+	return CreateStaticBuffer(pIndices, sizeof(u16) * pIndicesCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
 
-	VkDeviceSize bufferSize = sizeof(u32) * pIndicesCount;
+Renderer::VertexBuffer VulkanRenderer::CreateStaticBuffer(const void* pData, VkDeviceSize pSize, VkBufferUsageFlags pUsage)
+{
+	VertexBuffer buffer{};
 
 	VkBuffer stagingBuffer = VK_NULL_HANDLE;
 	VkDeviceMemory stagingBufferMemory = VK_NULL_HANDLE;
 
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	CreateBuffer(pSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
 	void* data;
 
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	std::copy(pIndices, pIndices + pIndicesCount, reinterpret_cast<u32*>(data));
+	vkMapMemory(device, stagingBufferMemory, 0, pSize, 0, &data);
+	std::copy(static_cast<const u8*>(pData), static_cast<const u8*>(pData) + pSize, static_cast<u8*>(data));
 	vkUnmapMemory(device, stagingBufferMemory);
 
-	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer.handle, buffer.memory);
-
-	CopyBuffer(stagingBuffer, buffer.handle, bufferSize);
+	CreateBuffer(pSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | pUsage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, buffer.handle, buffer.memory);
+	CopyBuffer(stagingBuffer, buffer.handle, pSize);
 
 	vkDestroyBuffer(device, stagingBuffer, nullptr);
 	vkFreeMemory(device, stagingBufferMemory, nullptr);
 
-
 	return buffer;
 }
 
@@ -153,8 +153,38 @@ bool VulkanRenderer::LoadMesh(Resources::Mesh* p_Mesh)
 {
 	if (!p_Mesh->GetVertexCount() || !p_Mesh->GetIndexCount()) return false;
 
-	p_Mesh->rendererMesh.vertexBuffer = CreateVertexBuffer(p_Mesh->vertices.data(), p_Mesh->GetVertexCount());
-	p_Mesh->rendererMesh.indexBuffer = CreateIndiceBuffer(p_Mesh->indices.data(), p_Mesh->GetIndexCount());
+	RendererMesh& rendererMesh = p_Mesh->rendererMesh;
+	std::vector<u32> indices = p_Mesh->GetRenderIndices();
+	if (p_Mesh->IsSkinned())
+	{
+		// The skinning pass reads the vertices as they are stored, so skinned meshes are never packed
+		rendererMesh.vertexBuffer = CreateStaticBuffer(p_Mesh->vertices.data(), sizeof(RendererVertex) * p_Mesh->GetVertexCount(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		rendererMesh.skinBuffer = CreateStaticBuffer(p_Mesh->skinWeights.data(), sizeof(Resources::SkinWeight) * p_Mesh->skinWeights.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+		rendererMesh.vertexLayout = VertexLayout::FULL;
+	}
+	else if (packedVertices)
+	{
+		std::vector<PackedVertex> packed;
+		PackedVertex::PackVertices(p_Mesh->vertices, packed, rendererMesh.quantizationCenter, rendererMesh.quantizationScale);
+		rendererMesh.vertexBuffer = CreateVertexBuffer(packed.data(), p_Mesh->GetVertexCount());
+		rendererMesh.vertexLayout = VertexLayout::PACKED;
+	}
+	else
+	{
+		rendererMesh.vertexBuffer = CreateVertexBuffer(p_Mesh->vertices.data(), p_Mesh->GetVertexCount());
+		rendererMesh.vertexLayout = VertexLayout::FULL;
+	}
+	if (p_Mesh->GetVertexCount() <= 0x10000)
+	{
+		std::vector<u16> shortIndices(indices.begin(), indices.end());
+		rendererMesh.indexBuffer = CreateIndiceBuffer(shortIndices.data(), static_cast<u32>(shortIndices.size()));
+		rendererMesh.indexType = VK_INDEX_TYPE_UINT16;
+	}
+	else
+	{
+		rendererMesh.indexBuffer = CreateIndiceBuffer(indices.data(), static_cast<u32>(indices.size()));
+		rendererMesh.indexType = VK_INDEX_TYPE_UINT32;
+	}
 
 	p_Mesh->isLoaded = true;
 
@@ -163,8 +193,7 @@ bool VulkanRenderer::LoadMesh(Resources::Mesh* p_Mesh)
 
 bool VulkanRenderer::LoadSkinnedModel(Resources::SkinnedModel* p_model)
 {
-	// TODO
-	return false;
+	return LoadModel(p_model);
 }
 
 bool VulkanRenderer::LoadTexture(Resources::StaticTexture* p_texture)
@@ -173,38 +202,45 @@ bool VulkanRenderer::LoadTexture(Resources::StaticTexture* p_texture)
 	{
 		return false;
 	}
-	VkBuffer stagingBuffer = {};
-	VkDeviceMemory stagingBufferMemory = {};
-
-	VkDeviceSize imageSize = (p_texture->isFloat ? sizeof(f32) * 4 : sizeof(u8) * 4) * p_texture->resolution.x * p_texture->resolution.y;
-
-	CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* data;
-
-	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-	if (p_texture->isFloat)
+	VkFormat format = GetTextureFormat(p_texture->encoding, p_texture->isFloat);
+	if (p_texture->encoding != Resources::TextureEncoding::RAW)
 	{
-		std::copy(reinterpret_cast<f32*>(p_texture->textureData), reinterpret_cast<f32*>(p_texture->textureData) + (imageSize / sizeof(f32)), static_cast<f32*>(data));
+		if (!LoadEncodedImage(p_texture->renderTexture, p_texture->textureData, p_texture->encoding, p_texture->resolution, p_texture->mipLevels, false)) return false;
 	}
 	else
 	{
-		std::copy(reinterpret_cast<u8*>(p_texture->textureData), reinterpret_cast<u8*>(p_texture->textureData) + imageSize, static_cast<u8*>(data));
-	}
-	vkUnmapMemory(device, stagingBufferMemory);
+		VkBuffer stagingBuffer = {};
+		VkDeviceMemory stagingBufferMemory = {};
 
-	CreateImage(p_texture->resolution, p_texture->mipLevels, p_texture->renderTexture.textureImage, p_texture->renderTexture.textureImageMemory, p_texture->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		VkDeviceSize imageSize = (p_texture->isFloat ? sizeof(f32) * 4 : sizeof(u8) * 4) * p_texture->resolution.x * p_texture->resolution.y;
 
-	TransitionImageLayout(p_texture->renderTexture.textureImage, p_texture->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, p_texture->mipLevels);
-	CopyBufferToImage(stagingBuffer, p_texture->renderTexture.textureImage, static_cast<u32>(p_texture->resolution.x), static_cast<u32>(p_texture->resolution.y));
+		CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
-	GenerateMipmaps(p_texture->renderTexture.textureImage, p_texture->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, p_texture->resolution, p_texture->mipLevels);
+		void* data;
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+		vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
+		if (p_texture->isFloat)
+		{
+			std::copy(reinterpret_cast<f32*>(p_texture->textureData), reinterpret_cast<f32*>(p_texture->textureData) + (imageSize / sizeof(f32)), static_cast<f32*>(data));
+		}
+		else
+		{
+			std::copy(reinterpret_cast<u8*>(p_texture->textureData), reinterpret_cast<u8*>(p_texture->textureData) + imageSize, static_cast<u8*>(data));
+		}
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		CreateImage(p_texture->resolution, p_texture->mipLevels, p_texture->renderTexture.textureImage, p_texture->renderTexture.textureImageMemory, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+		TransitionImageLayout(p_texture->renderTexture.textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, p_texture->mipLevels);
+		CopyBufferToImage(stagingBuffer, p_texture->renderTexture.textureImage, static_cast<u32>(p_texture->resolution.x), static_cast<u32>(p_texture->resolution.y));
+
+		GenerateMipmaps(p_texture->renderTexture.textureImage, format, p_texture->resolution, p_texture->mipLevels);
 
-	p_texture->renderTexture.imageView.imageView = CreateImageView(p_texture->renderTexture.textureImage, p_texture->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, p_texture->mipLevels);
-	//
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	}
+
+	p_texture->renderTexture.imageView.imageView = CreateImageView(p_texture->renderTexture.textureImage, format, VK_IMAGE_ASPECT_COLOR_BIT, p_texture->mipLevels);
 
 	if (p_texture->shouldDeleteData)
 		p_texture->DeleteTextureData();
@@ -212,44 +248,127 @@ bool VulkanRenderer::LoadTexture(Resources::StaticTexture* p_texture)
 	return true;
 }
 
-bool VulkanRenderer::LoadCubeMap(Resources::StaticCubeMap* p_cubemap)
+bool VulkanRenderer::LoadEncodedImage(RendererTexture& texture, const void* imageData, Resources::TextureEncoding encoding, Maths::IVec2 resolution, u32 mipLevels, bool cubeMap)
 {
-	if (p_cubemap->resolution.x <= 0 || p_cubemap->resolution.y <= 0 || !p_cubemap->cubeMapData)
+	if (Wrappers::TextureEncoder::IsBlockCompressed(encoding) && !hasTextureCompressionBC)
 	{
+		LOG(DEBUG_LEVEL::LWARNING, "Block compressed textures are not supported by this device !");
 		return false;
 	}
+	VkFormat format = GetTextureFormat(encoding, false);
+	u32 layers = cubeMap ? 6 : 1;
 	VkBuffer stagingBuffer = {};
 	VkDeviceMemory stagingBufferMemory = {};
 
-	VkDeviceSize imageSize = (p_cubemap->isFloat ? sizeof(f32) * 4 * 6 : sizeof(u8) * 4 * 6) * p_cubemap->resolution.x * p_cubemap->resolution.y;
+	VkDeviceSize imageSize = Wrappers::TextureEncoder::GetEncodedSize(encoding, resolution, mipLevels, layers);
 
 	CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
 	void* data;
 
 	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-	if (p_cubemap->isFloat)
+	std::copy(static_cast<const u8*>(imageData), static_cast<const u8*>(imageData) + imageSize, static_cast<u8*>(data));
+	vkUnmapMemory(device, stagingBufferMemory);
+
+	// The whole chain is precomputed, every level is copied from its offset in the staging buffer
+	std::vector<VkBufferImageCopy> regions(mipLevels);
+	VkDeviceSize offset = 0;
+	for (u32 i = 0; i < mipLevels; i++)
 	{
-		std::copy(reinterpret_cast<f32*>(p_cubemap->cubeMapData), reinterpret_cast<f32*>(p_cubemap->cubeMapData) + (imageSize / sizeof(f32)), static_cast<f32*>(data));
+		regions[i].bufferOffset = offset;
+		regions[i].imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		regions[i].imageSubresource.mipLevel = i;
+		regions[i].imageSubresource.baseArrayLayer = 0;
+		regions[i].imageSubresource.layerCount = layers;
+		regions[i].imageExtent = { static_cast<u32>(std::max(resolution.x >> i, 1)), static_cast<u32>(std::max(resolution.y >> i, 1)), 1 };
+		offset += Wrappers::TextureEncoder::GetLevelSize(encoding, resolution, i) * layers;
 	}
-	else
+
+	CreateImage(resolution, mipLevels, texture.textureImage, texture.textureImageMemory, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, cubeMap);
+
+	TransitionImageLayout(texture.textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, mipLevels, cubeMap);
+	CopyBufferToImage(stagingBuffer, texture.textureImage, regions);
+	TransitionImageLayout(texture.textureImage, format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, mipLevels, cubeMap);
+
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	return true;
+}
+
+VkFormat VulkanRenderer::GetTextureFormat(Resources::TextureEncoding encoding, bool isFloat) const
+{
+	switch (encoding)
 	{
-		std::copy(reinterpret_cast<u8*>(p_cubemap->cubeMapData), reinterpret_cast<u8*>(p_cubemap->cubeMapData) + imageSize, static_cast<u8*>(data));
+	case Resources::TextureEncoding::BC1:
+		return VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+	case Resources::TextureEncoding::BC5:
+		return VK_FORMAT_BC5_UNORM_BLOCK;
+	case Resources::TextureEncoding::BC7:
+		return VK_FORMAT_BC7_UNORM_BLOCK;
+	case Resources::TextureEncoding::RGBA8:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	case Resources::TextureEncoding::RGBA16F:
+		return VK_FORMAT_R16G16B16A16_SFLOAT;
+	case Resources::TextureEncoding::RGB9E5:
+		return VK_FORMAT_E5B9G9R9_UFLOAT_PACK32;
+	default:
+		return isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM;
 	}
-	vkUnmapMemory(device, stagingBufferMemory);
+}
+
+bool VulkanRenderer::LoadCubeMap(Resources::StaticCubeMap* p_cubemap)
+{
+	if (p_cubemap->resolution.x <= 0 || p_cubemap->resolution.y <= 0 || !p_cubemap->cubeMapData)
+	{
+		return false;
+	}
+	VkFormat format = GetTextureFormat(p_cubemap->encoding, p_cubemap->isFloat);
+	if (p_cubemap->encoding != Resources::TextureEncoding::RAW)
+	{
+		if (!LoadEncodedImage(p_cubemap->renderTexture, p_cubemap->cubeMapData, p_cubemap->encoding, p_cubemap->resolution, p_cubemap->mipLevels, true)) return false;
+	}
+	else
+	{
+		VkBuffer stagingBuffer = {};
+		VkDeviceMemory stagingBufferMemory = {};
 
-	CreateImage(p_cubemap->resolution, p_cubemap->mipLevels, p_cubemap->renderTexture.textureImage, p_cubemap->renderTexture.textureImageMemory, p_cubemap->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+		// Float cubemaps left raw by the encoder are stored as half floats too, values past the half range are clamped
+		if (p_cubemap->isFloat) format = VK_FORMAT_R16G16B16A16_SFLOAT;
+		VkDeviceSize imageSize = (p_cubemap->isFloat ? sizeof(u16) * 4 * 6 : sizeof(u8) * 4 * 6) * p_cubemap->resolution.x * p_cubemap->resolution.y;
 
-	TransitionImageLayout(p_cubemap->renderTexture.textureImage, p_cubemap->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, p_cubemap->mipLevels, true);
-	CopyBufferToImage(stagingBuffer, p_cubemap->renderTexture.textureImage, static_cast<u32>(p_cubemap->resolution.x), static_cast<u32>(p_cubemap->resolution.y), true);
+		CreateBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 
-	GenerateMipmaps(p_cubemap->renderTexture.textureImage, p_cubemap->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, p_cubemap->resolution, p_cubemap->mipLevels, true);
+		void* data;
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+		vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
+		if (p_cubemap->isFloat)
+		{
+			const f32* texels = reinterpret_cast<const f32*>(p_cubemap->cubeMapData);
+			u16* halves = static_cast<u16*>(data);
+			for (u64 i = 0; i < imageSize / sizeof(u16); i++)
+			{
+				halves[i] = Maths::Util::FloatToHalf(Maths::Util::Clamp(texels[i], -65504.0f, 65504.0f));
+			}
+		}
+		else
+		{
+			std::copy(reinterpret_cast<u8*>(p_cubemap->cubeMapData), reinterpret_cast<u8*>(p_cubemap->cubeMapData) + imageSize, static_cast<u8*>(data));
+		}
+		vkUnmapMemory(device, stagingBufferMemory);
+
+		CreateImage(p_cubemap->resolution, p_cubemap->mipLevels, p_cubemap->renderTexture.textureImage, p_cubemap->renderTexture.textureImageMemory, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, true);
+
+		TransitionImageLayout(p_cubemap->renderTexture.textureImage, format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, p_cubemap->mipLevels, true);
+		CopyBufferToImage(stagingBuffer, p_cubemap->renderTexture.textureImage, static_cast<u32>(p_cubemap->resolution.x), static_cast<u32>(p_cubemap->resolution.y), true);
 
-	p_cubemap->renderTexture.imageView.imageView = CreateImageView(p_cubemap->renderTexture.textureImage, p_cubemap->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, p_cubemap->mipLevels);
-	p_cubemap->cubeImageView.imageView.imageView = CreateImageView(p_cubemap->renderTexture.textureImage, p_cubemap->isFloat ? VK_FORMAT_R32G32B32A32_SFLOAT : VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, p_cubemap->mipLevels, true);
+		GenerateMipmaps(p_cubemap->renderTexture.textureImage, format, p_cubemap->resolution, p_cubemap->mipLevels, true);
+
+		vkDestroyBuffer(device, stagingBuffer, nullptr);
+		vkFreeMemory(device, stagingBufferMemory, nullptr);
+	}
+
+	p_cubemap->renderTexture.imageView.imageView = CreateImageView(p_cubemap->renderTexture.textureImage, format, VK_IMAGE_ASPECT_COLOR_BIT, p_cubemap->mipLevels);
+	p_cubemap->cubeImageView.imageView.imageView = CreateImageView(p_cubemap->renderTexture.textureImage, format, VK_IMAGE_ASPECT_COLOR_BIT, p_cubemap->mipLevels, true);
 
 	if (p_cubemap->shouldDeleteData)
 		p_cubemap->DeleteCubeMapData();
@@ -270,6 +389,9 @@ std::string VulkanRenderer::ReadTexture(const Resources::Texture* tex, Maths::IV
 	result.resize(bufferSize);
 	VkBuffer stagingBuffer = {};
 	VkDeviceMemory stagingBufferMemory = {};
+	// The texture was written by the previous frame, which may still be in flight
+	u32 previousFrame = (currentFrame + MAX_FRAMES_IN_FLIGHT - 1) % MAX_FRAMES_IN_FLIGHT;
+	vkWaitForFences(device, 1, &inFlightFences[previousFrame], VK_TRUE, UINT64_MAX);
 	TransitionImageLayout(tex->GetRendererTexture().textureImage, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, tex->mipLevels);
 	CreateBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
 	CopyImageToBuffer(stagingBuffer, tex->GetRendererTexture().textureImage, offset, size);
@@ -291,15 +413,20 @@ void VulkanRenderer::Init(void* window, Maths::IVec2 defaultRes, bool useVSync,
 void VulkanRenderer::CleanupBuffers()
 {
 	mainFB.DeleteData();
-	objectFrameBuffer.DeleteFrameBuffer(device);
+	vkDeviceWaitIdle(device);
+	FlushDeletionQueue(UINT64_MAX);
 }
 
 void VulkanRenderer::Cleanup()
 {
+	vkDeviceWaitIdle(device);
+	FlushDeletionQueue(UINT64_MAX);
+
 	mainUniform.DestroyDescriptorSetLayout(device);
 	lightUniform.DestroyDescriptorSetLayout(device);
 	postUniform.DestroyDescriptorSetLayout(device);
 	windowUniform.DestroyDescriptorSetLayout(device);
+	indirectUniform.DestroyDescriptorSetLayout(device);
 
 	CleanupSwapChain();
 
@@ -312,13 +439,63 @@ void VulkanRenderer::Cleanup()
 		pdescriptorPools[i].DestroyPools(device);
 		puniformPools[i].DestroyPools(device);
 		wdescriptorPools[i].DestroyPools(device);
+		idescriptorPools[i].DestroyPools(device);
+		sdescriptorPools[i].DestroyPools(device);
+		DestroyIndirectFrame(indirectFrames[i]);
+		DestroyLightFrame(lightFrames[i]);
+		vkDestroyBuffer(device, skinningMatrices[i].buffer, nullptr);
+		vkFreeMemory(device, skinningMatrices[i].memory, nullptr);
+		for (auto& recorder : commandRecorders[i])
+		{
+			recorder.descriptors.DestroyPools(device);
+			vkDestroyCommandPool(device, recorder.pool, nullptr);
+		}
+	}
+	recordThreads.Destroy();
+	geometryPool.DestroyPool(device);
+	hizBuffer.DestroyHiZBuffer(*this, false);
+	profiler.Destroy(*this);
+	transientPool.DestroyPool(*this);
+	vkDestroyBuffer(device, pickBuffer, nullptr);
+	vkFreeMemory(device, pickMemory, nullptr);
+	for (TransientGeometryBuffer& ring : transientGeometry)
+	{
+		vkDestroyBuffer(device, ring.buffer, nullptr);
+		vkFreeMemory(device, ring.memory, nullptr);
+	}
+	transientGeometry.clear();
+	for (RendererPipeline* pipeline : { &indirectPipeline, &indirectCompactPipeline, &cullPipeline, &hizPipeline, &mipDownPipeline, &mipUpPipeline, &skyResolvePipeline, &instancedWirePipeline, &instancedWireCompactPipeline, &skinPipeline })
+	{
+		vkDestroyPipeline(device, pipeline->pipeline, nullptr);
+		vkDestroyPipelineLayout(device, pipeline->pipelineLayout, nullptr);
+	}
+	indirectVertex.DeleteShader(device);
+	instancedVertex.DeleteShader(device);
+	cullShader.DeleteShader(device);
+	hizShader.DeleteShader(device);
+	skinShader.DeleteShader(device);
+	for (auto* cache : { &pixelStagePipelines, &windowStagePipelines })
+	{
+		for (auto& pipeline : *cache)
+		{
+			vkDestroyPipeline(device, pipeline.second.pipeline, nullptr);
+			vkDestroyPipelineLayout(device, pipeline.second.pipelineLayout, nullptr);
+		}
+		cache->clear();
 	}
+	postVertex.DeleteShader(device);
+	mipDownShader.DeleteShader(device);
+	mipUpShader.DeleteShader(device);
+	pixelStageShader.DeleteShader(device);
+	skyResolveShader.DeleteShader(device);
 
 	vkDestroyRenderPass(device, windowRenderPass, nullptr);
 	vkDestroyRenderPass(device, geometryRenderPass, nullptr);
+	vkDestroyRenderPass(device, geometryLoadRenderPass, nullptr);
+	vkDestroyRenderPass(device, geometryCompactRenderPass, nullptr);
+	vkDestroyRenderPass(device, geometryCompactLoadRenderPass, nullptr);
 	vkDestroyRenderPass(device, lightRenderPass, nullptr);
 	vkDestroyRenderPass(device, postRenderPass, nullptr);
-	vkDestroyRenderPass(device, objectRenderPass, nullptr);
 
 	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
@@ -336,7 +513,7 @@ void VulkanRenderer::Cleanup()
 		DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
 	}
 
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (!headless) vkDestroySurfaceKHR(instance, surface, nullptr);
 	vkDestroyInstance(instance, nullptr);
 }
 
@@ -404,24 +581,111 @@ LowRenderer::FrameBuffer Renderer::VulkanRenderer::GetMainLightBuffer() const
 	return result;
 }
 
-LowRenderer::FrameBuffer VulkanRenderer::GetMainObjectBuffer() const
+void VulkanRenderer::PickObject(Maths::IVec2 pos)
 {
-	LowRenderer::FrameBuffer result;
-	result.isLoaded = true;
-	result.hash = 1;
-	result.path = "object_framebuffer";
-	result.resolution = targetResolution;
-	if (shouldDeleteOldFB)
+	const Maths::IVec2 resolution = mainFB.GetResolution();
+	const VkOffset3D pixel = { Maths::Util::IClamp(pos.x, 0, resolution.x - 1), Maths::Util::IClamp(pos.y, 0, resolution.y - 1), 0 };
+	VkCommandBuffer cmd = commandBuffers[currentFrame];
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = mainFB.ib.texture.textureImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageOffset = pixel;
+	region.imageExtent = { 1, 1, 1 };
+	vkCmdCopyImageToBuffer(cmd, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, pickBuffer, 1, &region);
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	VkBufferMemoryBarrier hostBarrier{};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = pickBuffer;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 1, &barrier);
+
+	pickFrame = currentFrame;
+	pickPending = true;
+	pickReady = false;
+}
+
+bool VulkanRenderer::PollObjectPick(u32& index)
+{
+	// The frame recording the copy is only submitted at EndFrame, its fence is waited again when the slot comes back
+	if (pickPending && pickFrame != currentFrame && vkGetFenceStatus(device, inFlightFences[pickFrame]) == VK_SUCCESS)
 	{
-		result.db = mainFB.old_db;
-		result.lb[0] = oldObjectBuffer;
+		pickPending = false;
+		pickReady = true;
 	}
-	else
+	if (!pickReady) return false;
+	pickReady = false;
+	index = *pickData;
+	return true;
+}
+
+void VulkanRenderer::RecordFrameCapture()
+{
+	VkCommandBuffer cmd = commandBuffers[currentFrame];
+	// The window pass leaves headless images in the transfer layout already
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = swapChainFramebuffers[imageIndex].rendererTex.textureImage;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region{};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { swapChainExtent.width, swapChainExtent.height, 1 };
+	vkCmdCopyImageToBuffer(cmd, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, captureBuffer, 1, &region);
+
+	VkBufferMemoryBarrier hostBarrier{};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = captureBuffer;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+	captureFrame = currentFrame;
+	capturePending = true;
+	captureReady = false;
+}
+
+bool VulkanRenderer::ReadCapturedFrame(std::vector<u8>& pixels)
+{
+	// Once the slot of the capture has begun again its fence was already waited and reset
+	if (capturePending)
 	{
-		result.db = mainFB.db;
-		result.lb[0] = objectFrameBuffer;
+		vkWaitForFences(device, 1, &inFlightFences[captureFrame], VK_TRUE, UINT64_MAX);
+		capturePending = false;
+		captureReady = true;
 	}
-	return result;
+	if (!captureReady) return false;
+	captureReady = false;
+	pixels.assign(captureData, captureData + static_cast<u64>(swapChainExtent.width) * swapChainExtent.height * 4);
+	return true;
 }
 
 void VulkanRenderer::ResetMainFB()
@@ -434,6 +698,26 @@ void VulkanRenderer::ToggleMainFB()
 	mainFB.ToggleBuffer();
 }
 
+void VulkanRenderer::SetMainGBufferLayout(LowRenderer::GBufferLayout layout)
+{
+	if (layout == LowRenderer::GBufferLayout::COMPACT && !compactGBufferEnabled)
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "The geometry shaders were not rebuilt for the compact G-buffer, keeping the full layout");
+		layout = LowRenderer::GBufferLayout::FULL;
+	}
+	if (mainFB.gbufferLayout == layout) return;
+	mainFB.gbufferLayout = layout;
+	shouldRecreateFB = true;
+}
+
+void VulkanRenderer::DisableCompactGBuffer()
+{
+	if (!compactGBufferEnabled) return;
+	LOG(DEBUG_LEVEL::LWARNING, "A geometry shader still uses SPIR-V older than its source, the compact G-buffer is disabled");
+	compactGBufferEnabled = false;
+	SetMainGBufferLayout(LowRenderer::GBufferLayout::FULL);
+}
+
 void Renderer::VulkanRenderer::SetCurrentCamera(const LowRenderer::Rendering::Camera* pCamera)
 {
 	this->currentCameraPos = pCamera->position;
@@ -447,19 +731,43 @@ void VulkanRenderer::WaitForVSync()
 
 void VulkanRenderer::BeginFrame(Wrappers::Interfacing* pInterface)
 {
-	VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
-
-	if (result == VK_ERROR_OUT_OF_DATE_KHR)
+	if (headless)
 	{
-		RecreateSwapChain(pInterface, swapChainExtent, targetVSync);
-		return;
+		// Each frame in flight owns its offscreen image
+		imageIndex = currentFrame;
 	}
-	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+	else
 	{
-		LOG(DEBUG_LEVEL::LERROR, "Failed to acquire swap chain image!");
-		throw std::runtime_error("Failed to acquire swap chain image!");
+		VkResult result = vkAcquireNextImageKHR(device, swapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+
+		if (result == VK_ERROR_OUT_OF_DATE_KHR)
+		{
+			RecreateSwapChain(pInterface, swapChainExtent, targetVSync);
+			return;
+		}
+		else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "Failed to acquire swap chain image!");
+			throw std::runtime_error("Failed to acquire swap chain image!");
+		}
 	}
 
+	vkWaitForFences(device, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+	if (pickPending && pickFrame == currentFrame)
+	{
+		pickPending = false;
+		pickReady = true;
+	}
+	if (capturePending && captureFrame == currentFrame)
+	{
+		capturePending = false;
+		captureReady = true;
+	}
+	// Recording starts once the previous use of the frame slot has completed
+	frameBegin = std::chrono::steady_clock::now();
+	drawCallCount = 0;
+	descriptorWriteCount = 0;
+	FlushDeletionQueue(frameSubmissions[currentFrame]);
 	vkResetFences(device, 1, &inFlightFences[currentFrame]);
 	vkResetCommandBuffer(commandBuffers[currentFrame], 0);
 
@@ -469,8 +777,38 @@ void VulkanRenderer::BeginFrame(Wrappers::Interfacing* pInterface)
 	luniformPools[currentFrame].UpdatePool();
 	pdescriptorPools[currentFrame].UpdatePool(device, *this);
 	puniformPools[currentFrame].UpdatePool();
+	frameTime = Core::App::GetInstance()->GetWindow().GetWindowTime();
 	wdescriptorPools[currentFrame].UpdatePool(device, *this);
+	idescriptorPools[currentFrame].UpdatePool(device, *this);
+	sdescriptorPools[currentFrame].UpdatePool(device, *this);
+	skinningMatrixCount = 0;
+	IndirectFrameData& indirectFrame = indirectFrames[currentFrame];
+	cullingStats = std::move(indirectFrame.passInfo);
+	for (u64 i = 0; i < cullingStats.size(); i++)
+	{
+		cullingStats[i].counts = indirectFrame.stats[i];
+		indirectFrame.stats[i] = Uniform::IndirectCullStats();
+	}
+	indirectFrame.passInfo.clear();
+	LightFrameData& lightFrame = lightFrames[currentFrame];
+	lightFrame.clusterCount = 0;
+	lightFrame.indexCount = 0;
+	lightFrame.uploaded = false;
+	indirectFrame.objectCount = 0;
+	indirectFrame.batchCount = 0;
+	transientGeometry[currentFrame].used = 0;
+	indirectObjectBase = 0;
+	indirectBatchBase = 0;
+	for (auto& recorder : commandRecorders[currentFrame])
+	{
+		vkResetCommandPool(device, recorder.pool, 0);
+		recorder.usedBuffers = 0;
+		recorder.descriptors.UpdatePool(device, *this);
+	}
+	frameGraph.Reset();
+	windowDrawn = false;
 	BeginCommandBuffer();
+	profiler.BeginFrame(activeCommandBuffer, currentFrame);
 	swapBuffer.fb = swapChainFramebuffers[imageIndex];
 	swapBuffer.lb[0] = swapChainFramebuffers[imageIndex];
 	activePassParams = LowRenderer::RenderPassType::DEFAULT;
@@ -480,77 +818,84 @@ void VulkanRenderer::BeginFrame(Wrappers::Interfacing* pInterface)
 
 void VulkanRenderer::EndFrame(Wrappers::Interfacing* pInterface)
 {
-	if (!pInterface)
+	if (!pInterface && !windowDrawn)
 	{
 		swapBuffer.fb = swapChainFramebuffers[imageIndex];
 		BeginPass(&swapBuffer, LowRenderer::RenderPassType::ALL);
 		RenderToWindow();
-		EndRenderPass();
+		EndPass();
 	}
 
+	if (captureRequested && headless) RecordFrameCapture();
+	captureRequested = false;
+
 	EndCommandBuffer();
+	uniformPools[currentFrame].Flush();
+	luniformPools[currentFrame].Flush();
+	puniformPools[currentFrame].Flush();
+	const auto recordEnd = std::chrono::steady_clock::now();
 
 	if (pInterface)
 		SubmitCurrentCommandBuffer(pInterface->RecordImGuiCommandBuffer(imageIndex));
 	else
 		SubmitCurrentCommandBuffer(nullptr);
 
-	VkPresentInfoKHR presentInfo{};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	VkResult result = VK_SUCCESS;
+	if (!headless)
+	{
+		VkPresentInfoKHR presentInfo{};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
+		VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
 
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = signalSemaphores;
 
-	VkSwapchainKHR swapChains[] = { swapChain };
+		VkSwapchainKHR swapChains[] = { swapChain };
 
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = swapChains;
-	presentInfo.pImageIndices = &imageIndex;
-	presentInfo.pResults = nullptr; // Optional
-	VkResult result = vkQueuePresentKHR(presentQueue, &presentInfo);
-	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+		presentInfo.swapchainCount = 1;
+		presentInfo.pSwapchains = swapChains;
+		presentInfo.pImageIndices = &imageIndex;
+		presentInfo.pResults = nullptr; // Optional
+		result = vkQueuePresentKHR(presentQueue, &presentInfo);
+	}
+	const auto submitEnd = std::chrono::steady_clock::now();
+	frameStats.drawCalls = drawCallCount;
+	frameStats.descriptorWrites = descriptorWriteCount;
+	frameStats.recordTime = std::chrono::duration<f64>(recordEnd - frameBegin).count();
+	frameStats.submitTime = std::chrono::duration<f64>(submitEnd - recordEnd).count();
 	if (shouldDeleteOldFB)
 	{
-		WaitIdle();
 		shouldDeleteOldFB = false;
-		mainFB.old_fb.DeleteFrameBuffer(device);
-		oldObjectBuffer.DeleteFrameBuffer(device);
-		mainFB.old_db.DeleteDepthBuffer(device);
-		mainFB.old_nb.DeleteBuffer(device);
-		mainFB.old_pb.DeleteBuffer(device);
+		DeleteFrameBuffer(mainFB.old_fb);
+		DeleteBuffer(mainFB.old_ib);
+		DeleteDepthBuffer(mainFB.old_db);
+		DeleteBuffer(mainFB.old_nb);
+		DeleteBuffer(mainFB.old_pb);
 		for (u8 i = 0; i < 3; i++)
 		{
-			mainFB.old_lb[i].DeleteFrameBuffer(device);
-			mainFB.old_gb[i].DeleteBuffer(device);
+			DeleteFrameBuffer(mainFB.old_lb[i]);
+			DeleteBuffer(mainFB.old_gb[i]);
 		}
 	}
+	transientPool.EndFrame(*this);
+	currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
 	if (shouldRecreateFB)
 	{
 		shouldRecreateFB = false;
 		mainFB.old_fb = mainFB.fb;
-		oldObjectBuffer = objectFrameBuffer;
 		mainFB.old_db = mainFB.db;
 		mainFB.old_nb = mainFB.nb;
 		mainFB.old_pb = mainFB.pb;
+		mainFB.old_ib = mainFB.ib;
 		shouldDeleteOldFB = true;
-		mainFB.db = RendererDepthBuffer(targetResolution.x, targetResolution.y, device, true);
-		mainFB.nb = RendererBuffer(targetResolution.x, targetResolution.y, device, VK_FORMAT_R32G32B32A32_SFLOAT, false);
-		mainFB.pb = RendererBuffer(targetResolution.x, targetResolution.y, device, VK_FORMAT_R32G32B32A32_SFLOAT, false);
 		CreateMainFrameBuffer();
-		std::vector<RendererImageView> vec;
-		vec.push_back(mainFB.db.GetDepthImageView());
-		CreateFrameBuffer(objectFrameBuffer, vec, targetResolution, Maths::Vec4(), VK_FORMAT_R32_UINT, Resources::ShaderVariant::Object);
 		for (u8 i = 0; i < 3; i++)
 		{
 			mainFB.old_lb[i] = mainFB.lb[i];
 			mainFB.old_gb[i] = mainFB.gb[i];
-			mainFB.gb[i] = RendererBuffer(targetResolution.x, targetResolution.y, device, VK_FORMAT_R32G32B32A32_SFLOAT, true);
-			vec.clear();
-			vec.push_back(mainFB.gb[i].GetImageView());
-			CreateFrameBuffer(mainFB.lb[i], vec, targetResolution, Maths::Vec4(), VK_FORMAT_R32G32B32A32_SFLOAT, Resources::ShaderVariant::Light);
 		}
+		CreateLightBuffers(mainFB, targetResolution);
 	}
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || shouldRecreate)
 	{
@@ -568,32 +913,86 @@ void VulkanRenderer::BeginPass(LowRenderer::FrameBuffer* fb, LowRenderer::Render
 {
 	if (!fb) fb = &mainFB;
 	activePassParams = renderPass;
+	activeScissor.reset();
 	if (renderPass == LowRenderer::RenderPassType::ALL)
 	{
+		BeginProfileScope("Window");
 		BeginRenderPass(windowRenderPass, fb);
 		activePassParams = LowRenderer::RenderPassType::DEFAULT;
 	}
-	else if (renderPass & LowRenderer::RenderPassType::OBJECT)
-	{
-		BeginRenderPass(objectRenderPass, fb);
-	}
 	else if (renderPass & LowRenderer::RenderPassType::LIGHT)
 	{
+		BeginProfileScope("Light");
+		// The stencil of the depth buffer masks the sky out of the pass, and the compact layout also samples its depth
+		TransitionDepthBuffer(commandBuffers[currentFrame], fb->db, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+		bool useOld = (fb == &mainFB && shouldDeleteOldFB) || fb->resize > 3;
+		if (useOld && fb->gbufferLayout == LowRenderer::GBufferLayout::COMPACT)
+		{
+			TransitionDepthBuffer(commandBuffers[currentFrame], fb->old_db, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
+		}
 		BeginRenderPass(lightRenderPass, fb);
 	}
 	else if (renderPass & LowRenderer::RenderPassType::POST)
 	{
+		BeginProfileScope("Post");
 		BeginRenderPass(postRenderPass, fb);
 	}
 	else
 	{
-		BeginRenderPass(geometryRenderPass, fb);
+		// Scene passes are recorded first and replayed at EndPass, possibly split across the record threads
+		// Frame buffers loaded as compact before a stale geometry shader turned the layout off are rebuilt before drawing
+		if (!compactGBufferEnabled && fb != &mainFB && fb->gbufferLayout == LowRenderer::GBufferLayout::COMPACT) fb->SetGBufferLayout(LowRenderer::GBufferLayout::FULL);
+		BeginProfileScope("Geometry");
+		recordedRenderPass = &GetGeometryRenderPass(fb);
+		SetRenderTarget(fb);
+		recordingPass = true;
 	}
 }
 
 void VulkanRenderer::EndPass()
 {
-	EndRenderPass();
+	if (recordingPass)
+	{
+		FlushRecordedPass();
+	}
+	else
+	{
+		EndRenderPass();
+	}
+	EndProfileScope();
+}
+
+void VulkanRenderer::BeginProfileScope(const std::string& name, bool statistics)
+{
+	const u32 scope = profiler.PushScope(name, statistics && !recordingPass);
+	if (scope != ~0u) WriteProfileScope(scope, false);
+}
+
+void VulkanRenderer::EndProfileScope()
+{
+	const u32 scope = profiler.PopScope();
+	if (scope != ~0u) WriteProfileScope(scope, true);
+}
+
+void VulkanRenderer::WriteProfileScope(u32 scope, bool end)
+{
+	if (recordingPass)
+	{
+		RecordedCommand command;
+		command.type = RecordedCommandType::TIMESTAMP;
+		command.count = scope;
+		command.scopeEnd = end;
+		recordedCommands.push_back(std::move(command));
+	}
+	else
+	{
+		profiler.WriteScope(activeCommandBuffer, scope, end);
+	}
+}
+
+Maths::IVec2 VulkanRenderer::GetActiveResolution() const
+{
+	return activeFrameBuffer ? activeFrameBuffer->GetResolution() : targetResolution;
 }
 
 Maths::Vec3 VulkanRenderer::GetClearColor()
@@ -607,29 +1006,36 @@ void VulkanRenderer::SetClearColor(Maths::Vec4 color)
 	mainFB.UpdateClearColor();
 }
 
-void Renderer::VulkanRenderer::RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const Resources::Material* mat)
+// Point the matrix projects from, in the space it transforms from. w is 0 for orthographic projections
+static Maths::Vec4 GetViewpoint(const Maths::Mat4& projection)
+{
+	Maths::Vec4 eye = projection.CreateInverseMatrix() * Maths::Vec4(0, 0, 1, 0);
+	if (fabsf(eye.w) <= 1e-6f * eye.GetVector().GetLength()) return Maths::Vec4(0, 0, 0, 0);
+	return Maths::Vec4(eye.GetVector() / eye.w, 1.0f);
+}
+
+void Renderer::VulkanRenderer::RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const Resources::Material* mat, u32 lod, bool cullMeshlets)
 {
 	if (!mat) return;
-	VkDescriptorSet desc = descriptorPools[currentFrame].GetNext(*this);
 	auto uniform = uniformPools[currentFrame].GetNext();
 	std::vector<const RendererTexture*> textures;
 	textures.push_back(&(mat->albedo ? mat->albedo : Resources::StaticTexture::GetDefaultTexture())->GetRendererTexture());
 	textures.push_back(&(mat->normal ? mat->normal : Resources::StaticTexture::GetDefaultNormal())->GetRendererTexture());
 	textures.push_back(&(mat->height ? mat->height : Resources::StaticTexture::GetDefaultTexture())->GetRendererTexture());
-	UpdateDescriptorSet(desc, uniform.GetBuffer(), &mainUniform, true, textures, Resources::TextureSampler::GetDefaultSampler());
-	UpdateUniformBuffer(uniform, mat, m, mvp);
+	UpdateUniformBuffer(uniform, mat, mesh->rendererMesh.Dequantize(m), mesh->rendererMesh.Dequantize(mvp));
 
-	DrawIndexedMesh(mesh, desc, uniform);
+	if (cullMeshlets && lod == 0 && !mesh->meshlets.empty())
+		DrawMeshlets(mesh, m, mvp, textures, uniform);
+	else
+		DrawIndexedMesh(mesh, textures, uniform, lod);
 }
 
 void Renderer::VulkanRenderer::RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, std::vector<const RendererTexture*> textures, Resources::Material* materialOverride)
 {
-	VkDescriptorSet desc = descriptorPools[currentFrame].GetNext(*this);
 	auto uniform = uniformPools[currentFrame].GetNext();
-	UpdateDescriptorSet(desc, uniform.GetBuffer(), &mainUniform, true, textures, Resources::TextureSampler::GetDefaultSampler());
-	UpdateUniformBuffer(uniform, materialOverride, m, mvp);
+	UpdateUniformBuffer(uniform, materialOverride, mesh->rendererMesh.Dequantize(m), mesh->rendererMesh.Dequantize(mvp));
 
-	DrawIndexedMesh(mesh, desc, uniform);
+	DrawIndexedMesh(mesh, textures, uniform);
 }
 
 void VulkanRenderer::RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const Maths::Vec3& color)
@@ -639,18 +1045,88 @@ void VulkanRenderer::RenderMesh(const Resources::Mesh* mesh, const Maths::Mat4&
 	RenderMesh(mesh, m, mvp, &mat);
 }
 
-void VulkanRenderer::RenderMeshObject(const Resources::Mesh* mesh, const Maths::Mat4& mvp, u32 objectID)
+void VulkanRenderer::RenderSkinnedMesh(const Resources::Mesh* mesh, const SkinnedVertexBuffer& vertices, const Maths::Mat4& m, const Maths::Mat4& mvp, const Resources::Material* mat, u32 lod)
 {
-	VkDescriptorSet desc = descriptorPools[currentFrame].GetNext(*this);
+	if (!mat) return;
 	auto uniform = uniformPools[currentFrame].GetNext();
 	std::vector<const RendererTexture*> textures;
-	textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
-	textures.push_back(&Resources::StaticTexture::GetDefaultNormal()->GetRendererTexture());
-	textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
-	UpdateDescriptorSet(desc, uniform.GetBuffer(), &mainUniform, true, textures, Resources::TextureSampler::GetDefaultSampler());
-	UpdateUniformBuffer(uniform, mvp, objectID);
+	textures.push_back(&(mat->albedo ? mat->albedo : Resources::StaticTexture::GetDefaultTexture())->GetRendererTexture());
+	textures.push_back(&(mat->normal ? mat->normal : Resources::StaticTexture::GetDefaultNormal())->GetRendererTexture());
+	textures.push_back(&(mat->height ? mat->height : Resources::StaticTexture::GetDefaultTexture())->GetRendererTexture());
+	UpdateUniformBuffer(uniform, mat, m, mvp);
+
+	DrawIndexedMesh(mesh, textures, uniform, lod, vertices.buffer.handle);
+}
+
+bool VulkanRenderer::BeginSkinning()
+{
+	if (!skinPipeline.pipeline) return false;
+	// The previous frame may still be drawing from the buffers this one rewrites
+	vkCmdPipelineBarrier(activeCommandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+	vkCmdBindPipeline(activeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinPipeline.pipeline);
+	return true;
+}
+
+void VulkanRenderer::SkinMesh(const Resources::Mesh* mesh, const Maths::Mat4* matrices, u32 matrixCount, SkinnedVertexBuffer& output)
+{
+	const RendererMesh& rendererMesh = mesh->rendererMesh;
+	const u32 vertexCount = mesh->GetVertexCount();
+	if (!mesh->isLoaded || !rendererMesh.skinBuffer.handle || !vertexCount || !matrixCount) return;
+	if (output.vertexCount != vertexCount)
+	{
+		if (output.buffer.handle) FreeVertexBuffer(output.buffer);
+		CreateBuffer(sizeof(RendererVertex) * vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, output.buffer.handle, output.buffer.memory);
+		output.vertexCount = vertexCount;
+	}
+
+	LightStorageBuffer& storage = skinningMatrices[currentFrame];
+	if (ReserveLightStorage(storage, (skinningMatrixCount + static_cast<u64>(matrixCount)) * sizeof(Maths::Mat4))) skinningMatrixCount = 0;
+	std::copy(matrices, matrices + matrixCount, static_cast<Maths::Mat4*>(storage.data) + skinningMatrixCount);
+
+	VkDescriptorSet descriptor = sdescriptorPools[currentFrame].GetNext(*this, indirectUniform.GetSkinLayout());
+	std::array<VkDescriptorBufferInfo, 4> bufferInfos = {};
+	bufferInfos[0].buffer = rendererMesh.vertexBuffer.handle;
+	bufferInfos[1].buffer = rendererMesh.skinBuffer.handle;
+	bufferInfos[2].buffer = storage.buffer;
+	bufferInfos[3].buffer = output.buffer.handle;
+	std::array<VkWriteDescriptorSet, 4> descriptorWrites = {};
+	for (u32 i = 0; i < descriptorWrites.size(); i++)
+	{
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptor;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+	vkUpdateDescriptorSets(device, static_cast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	descriptorWriteCount += static_cast<u32>(descriptorWrites.size());
+
+	Uniform::SkinningConstants constants;
+	constants.vertexCount = vertexCount;
+	constants.matrixBase = skinningMatrixCount;
+	skinningMatrixCount += matrixCount;
+	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, skinPipeline.pipelineLayout, 0, 1, &descriptor, 0, nullptr);
+	vkCmdPushConstants(activeCommandBuffer, skinPipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Uniform::SkinningConstants), &constants);
+	vkCmdDispatch(activeCommandBuffer, (vertexCount + SKINNING_GROUP_SIZE - 1) / SKINNING_GROUP_SIZE, 1, 1);
+}
+
+void VulkanRenderer::EndSkinning()
+{
+	VkMemoryBarrier skinBarrier{};
+	skinBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	skinBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	skinBarrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(activeCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &skinBarrier, 0, nullptr, 0, nullptr);
+}
 
-	DrawIndexedMesh(mesh, desc, uniform);
+void VulkanRenderer::FreeSkinnedVertexBuffer(SkinnedVertexBuffer& buffer)
+{
+	if (buffer.buffer.handle) FreeVertexBuffer(buffer.buffer);
+	buffer.vertexCount = 0;
 }
 
 void VulkanRenderer::DrawVertices(u32 count, const Maths::Mat4& m, const Maths::Mat4& mvp)
@@ -664,50 +1140,211 @@ void VulkanRenderer::DrawVertices(u32 count, const Maths::Mat4& m, const Maths::
 
 void Renderer::VulkanRenderer::DrawVertices(u32 count, const Maths::Mat4& m, const Maths::Mat4& mvp, std::vector<const RendererTexture*> textures)
 {
-	VkDescriptorSet desc = descriptorPools[currentFrame].GetNext(*this);
 	auto uniform = uniformPools[currentFrame].GetNext();
-	UpdateDescriptorSet(desc, uniform.GetBuffer(), &mainUniform, true, textures, Resources::TextureSampler::GetDefaultSampler());
 	UpdateUniformBuffer(uniform, Resources::Material::GetDefaultMaterial(), m, mvp);
 
-	std::array<u32, 2> uniformOffsets = { static_cast<u32>(uniform.GetOffset() * mainUniform.GetTotalOffset()), static_cast<u32>(uniform.GetOffset() * mainUniform.GetTotalOffset()) };
-	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipelineLayout, 0, 1, &desc, 2, uniformOffsets.data());
-	vkCmdDraw(activeCommandBuffer, count, 1, 0, 0);
+	RecordedCommand command;
+	command.type = RecordedCommandType::DRAW;
+	command.pipeline = activePipeline;
+	command.count = count;
+	command.uniform = uniform;
+	command.textures = std::move(textures);
+	SubmitCommand(std::move(command));
 }
 
 void VulkanRenderer::DrawIndexedRenderMesh(const Renderer::RendererMesh* pRenderMesh, const Maths::Mat4& pModelMatrix, u32 pVertexCount, u32 pIndiceCount)
 {
-	VkDescriptorSet desc = descriptorPools[currentFrame].GetNext(*this);
-
-	std::vector<const RendererTexture*> textures;
+	if (!BindVertexLayout(pRenderMesh->vertexLayout)) return;
+	RecordedCommand command = CreateDrawCommand(pRenderMesh->Dequantize(pModelMatrix));
+	command.type = pIndiceCount > 0 ? RecordedCommandType::DRAW_INDEXED : RecordedCommandType::DRAW;
+	command.vertexBuffer = pRenderMesh->vertexBuffer.handle;
+	command.indexBuffer = pRenderMesh->indexBuffer.handle;
+	command.indexType = pRenderMesh->indexType;
+	command.count = pIndiceCount > 0 ? pIndiceCount : pVertexCount;
+	SubmitCommand(std::move(command));
+}
 
-	textures.reserve(3);
+void VulkanRenderer::DrawTransientGeometry(const RendererVertex* pVertices, u32 pVertexCount, const u32* pIndices, u32 pIndiceCount)
+{
+	if (!pVertexCount || !BindVertexLayout(VertexLayout::FULL)) return;
+	RecordedCommand command = CreateDrawCommand(Maths::Mat4::Identity());
+	command.type = pIndiceCount > 0 ? RecordedCommandType::DRAW_INDEXED : RecordedCommandType::DRAW;
+	command.vertexOffset = WriteTransientGeometry(pVertices, sizeof(RendererVertex) * pVertexCount);
+	command.vertexBuffer = transientGeometry[currentFrame].buffer;
+	if (pIndiceCount > 0)
+	{
+		command.indexOffset = WriteTransientGeometry(pIndices, sizeof(u32) * pIndiceCount);
+		command.indexBuffer = transientGeometry[currentFrame].buffer;
+	}
+	command.count = pIndiceCount > 0 ? pIndiceCount : pVertexCount;
+	SubmitCommand(std::move(command));
+}
 
-	textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
-	textures.push_back(&Resources::StaticTexture::GetDefaultNormal()->GetRendererTexture());
-	textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
+void VulkanRenderer::DrawInstancedRenderMesh(const Renderer::RendererMesh* pRenderMesh, const Maths::Mat4* pModelMatrices, u32 pInstanceCount, u32 pVertexCount, u32 pIndiceCount)
+{
+	// Instance matrices are not dequantized, instanced meshes keep the full layout
+	if (!pInstanceCount || pRenderMesh->vertexLayout != VertexLayout::FULL || !BindVertexLayout(VertexLayout::FULL)) return;
+	// Instances carry their own model matrix, the uniform only holds the view projection
+	RecordedCommand command = CreateDrawCommand(Maths::Mat4::Identity());
+	command.type = pIndiceCount > 0 ? RecordedCommandType::DRAW_INDEXED : RecordedCommandType::DRAW;
+	command.vertexBuffer = pRenderMesh->vertexBuffer.handle;
+	command.indexBuffer = pRenderMesh->indexBuffer.handle;
+	command.indexType = pRenderMesh->indexType;
+	command.instanceOffset = WriteTransientGeometry(pModelMatrices, sizeof(Maths::Mat4) * pInstanceCount);
+	command.instanceBuffer = transientGeometry[currentFrame].buffer;
+	command.instanceCount = pInstanceCount;
+	command.count = pIndiceCount > 0 ? pIndiceCount : pVertexCount;
+	SubmitCommand(std::move(command));
+}
 
-	auto uniform = uniformPools[currentFrame].GetNext();
+VkDeviceSize VulkanRenderer::WriteTransientGeometry(const void* data, u64 size)
+{
+	TransientGeometryBuffer& ring = transientGeometry[currentFrame];
+	// Matrices and vertices are read as 16 byte aligned attributes
+	u64 offset = (ring.used + 15) & ~15llu;
+	if (offset + size > ring.capacity)
+	{
+		u64 capacity = ring.capacity ? ring.capacity * 2 : 1 << 20;
+		while (capacity < size) capacity *= 2;
+		TransientGeometryBuffer result;
+		CreateBuffer(capacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, result.buffer, result.memory);
+		void* mapped = nullptr;
+		if (vkMapMemory(device, result.memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "Could not map transient geometry buffer !");
+			throw std::runtime_error("Could not map transient geometry buffer !");
+		}
+		result.data = static_cast<u8*>(mapped);
+		result.capacity = capacity;
+		if (ring.buffer)
+		{
+			TransientGeometryBuffer old = ring;
+			QueueDeletion([this, old]()
+			{
+				vkDestroyBuffer(device, old.buffer, nullptr);
+				vkFreeMemory(device, old.memory, nullptr);
+			});
+		}
+		ring = result;
+		offset = 0;
+	}
+	std::copy(static_cast<const u8*>(data), static_cast<const u8*>(data) + size, ring.data + offset);
+	ring.used = offset + size;
+	return offset;
+}
 
-	Maths::Mat4 mvp = this->currentCamera->GetProjectionMatrix() * this->currentCamera->GetViewMatrix() * pModelMatrix;
+VulkanRenderer::RecordedCommand VulkanRenderer::CreateDrawCommand(const Maths::Mat4& pModelMatrix)
+{
+	std::vector<const RendererTexture*> textures;
 
-	UpdateDescriptorSet(desc, uniform.GetBuffer(), &mainUniform, true, textures, Resources::TextureSampler::GetDefaultSampler());
-	UpdateUniformBuffer(uniform, Resources::Material::GetDefaultMaterial(), pModelMatrix, mvp);
+	textures.reserve(3);
 
-	std::array<u32, 2> uniformOffsets = { static_cast<u32>(uniform.GetOffset() * mainUniform.GetTotalOffset()), static_cast<u32>(uniform.GetOffset() * mainUniform.GetTotalOffset()) };
+	textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
+	textures.push_back(&Resources::StaticTexture::GetDefaultNormal()->GetRendererTexture());
+	textures.push_back(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture());
 
-	VkDeviceSize vertexbufferOffset = 0;
+	auto uniform = uniformPools[currentFrame].GetNext();
 
-	vkCmdBindVertexBuffers(activeCommandBuffer, 0, 1, &pRenderMesh->vertexBuffer.handle, &vertexbufferOffset);
+	Maths::Mat4 mvp = this->currentCamera->GetProjectionMatrix() * this->currentCamera->GetViewMatrix() * pModelMatrix;
 
-	if (pIndiceCount > 0)
-		vkCmdBindIndexBuffer(activeCommandBuffer, pRenderMesh->indexBuffer.handle, 0, VK_INDEX_TYPE_UINT32);
+	UpdateUniformBuffer(uniform, Resources::Material::GetDefaultMaterial(), pModelMatrix, mvp);
 
-	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipelineLayout, 0, 1, &desc, 2, uniformOffsets.data());
+	RecordedCommand command;
+	command.pipeline = activePipeline;
+	command.uniform = uniform;
+	command.textures = std::move(textures);
+	return command;
+}
 
-	if (pIndiceCount > 0)
-		vkCmdDrawIndexed(activeCommandBuffer, pIndiceCount, 1, 0, 0, 0);
+bool VulkanRenderer::RenderMeshIndirect(Resources::Mesh* mesh, const Resources::Material* mat, const Maths::Mat4& m, const Maths::Mat4& vp, const Maths::Frustum& frustum, bool useCulling, u32 lod)
+{
+	if (!indirectSupported || !recordingPass || !mesh || !mat) return false;
+	// Portal and picking passes depend on the draw order and stencil state, keep them on the recorded path
+	if (activePassParams & (LowRenderer::RenderPassType::OBJECT | LowRenderer::RenderPassType::SHADOWMAP | LowRenderer::RenderPassType::CUBEMAP | LowRenderer::RenderPassType::HALO | LowRenderer::RenderPassType::WIRE)) return false;
+	if (state != StencilState::DEFAULT || stencilCompareValue) return false;
+	if (indirectFrames[currentFrame].passInfo.size() >= INDIRECT_MAX_CULL_PASSES) return false;
+	if (indirectBatches.empty())
+	{
+		indirectViewProjection = vp;
+		indirectFrustum = frustum;
+	}
+	else if (!std::equal(vp.content, vp.content + 16, indirectViewProjection.content))
+	{
+		return false;
+	}
+	bool compact = activeFrameBuffer->gbufferLayout == LowRenderer::GBufferLayout::COMPACT;
+	RendererPipeline& pipeline = compact ? indirectCompactPipeline : indirectPipeline;
+	if (!pipeline.pipeline)
+	{
+		const Resources::ShaderProgram* defaultShader = Resources::ShaderProgram::GetDefaultShader();
+		if (!defaultShader || !defaultShader->program.fragment) return false;
+		if (!CreateGraphicsPipeline(GetGeometryRenderPass(activeFrameBuffer), &indirectVertex, defaultShader->program.fragment, pipeline, static_cast<PipelineParams>(PipelineParams::EXTRA_ATTACHMENT | PipelineParams::STENCIL | PipelineParams::INDIRECT | (compact ? PipelineParams::COMPACT_GBUFFER : 0) | (defaultShader->WritesObjectID() ? PipelineParams::OBJECT_ID : 0))))
+		{
+			LOG(DEBUG_LEVEL::LWARNING, "Could not create the indirect pipeline, GPU driven rendering disabled");
+			indirectSupported = false;
+			return false;
+		}
+	}
+	Renderer::RendererMesh& rendererMesh = mesh->rendererMesh;
+	if (!rendererMesh.sharedVertices.count)
+	{
+		std::vector<u32> indices = mesh->GetRenderIndices();
+		if (!geometryPool.Upload(*this, rendererMesh, mesh->vertices.data(), mesh->GetVertexCount(), indices.data(), static_cast<u32>(indices.size()))) return false;
+	}
+
+	u32 batchIndex;
+	auto found = indirectBatchLookup.find(mat);
+	if (found == indirectBatchLookup.end())
+	{
+		batchIndex = static_cast<u32>(indirectBatches.size());
+		indirectBatchLookup[mat] = batchIndex;
+		indirectBatches.push_back(IndirectBatch());
+		indirectBatches.back().material = mat;
+	}
 	else
-		vkCmdDraw(activeCommandBuffer, pVertexCount, 1, 0, 0);
+	{
+		batchIndex = found->second;
+	}
+	IndirectBatch& batch = indirectBatches[batchIndex];
+
+	IndirectFrameData& frame = indirectFrames[currentFrame];
+	// Meshlets of a mesh in view are culled one by one, a mesh out of view is rejected as a whole
+	if (useCulling && lod == 0 && !mesh->meshlets.empty() && mesh->aabb.IsOnFrustum(frustum, m))
+	{
+		ReserveIndirectObjects(frame, frame.objectCount + static_cast<u32>(mesh->meshlets.size()));
+		for (auto& meshlet : mesh->meshlets)
+		{
+			Uniform::IndirectObject& object = frame.objects[frame.objectCount++];
+			object.model = m;
+			object.boundsCenter = Maths::Vec4(meshlet.center, 1.0f);
+			object.boundsExtent = Maths::Vec4(Maths::Vec3(2 * meshlet.radius), 0.0f);
+			object.indexCount = meshlet.indexCount;
+			object.firstIndex = rendererMesh.sharedIndices.offset + meshlet.indexOffset;
+			object.vertexOffset = static_cast<s32>(rendererMesh.sharedVertices.offset);
+			object.batch = indirectBatchBase + batchIndex;
+			object.batchSlot = batch.objectCount++;
+			object.flags = Uniform::INDIRECT_CULL | Uniform::INDIRECT_CONE;
+			object.cone = meshlet.cone;
+			object.radius = meshlet.radius;
+			object.objectID = objectID;
+		}
+		return true;
+	}
+	ReserveIndirectObjects(frame, frame.objectCount + 1);
+	Uniform::IndirectObject& object = frame.objects[frame.objectCount++];
+	object.model = m;
+	object.boundsCenter = Maths::Vec4(mesh->aabb.center, 1.0f);
+	object.boundsExtent = Maths::Vec4(mesh->aabb.size, 0.0f);
+	object.indexCount = mesh->GetLod(lod).indexCount;
+	object.firstIndex = rendererMesh.sharedIndices.offset + mesh->GetLod(lod).indexOffset;
+	object.vertexOffset = static_cast<s32>(rendererMesh.sharedVertices.offset);
+	object.batch = indirectBatchBase + batchIndex;
+	object.batchSlot = batch.objectCount++;
+	object.flags = useCulling ? Uniform::INDIRECT_CULL : Uniform::INDIRECT_NONE;
+	object.cone = 0;
+	object.radius = 0.0f;
+	object.objectID = objectID;
+	return true;
 }
 
 void VulkanRenderer::ApplyLightPass(const Resources::ShaderProgram* shader)
@@ -717,26 +1354,45 @@ void VulkanRenderer::ApplyLightPass(const Resources::ShaderProgram* shader)
 	VkDescriptorSet desc = ldescriptorPools[currentFrame].GetNext(*this, Resources::ShaderVariant::Light);
 	auto elem = luniformPools[currentFrame].GetNext();
 	std::vector<const RendererTexture*> textures;
+	const RendererTexture* depth;
 	if ((activeFrameBuffer == &mainFB && shouldDeleteOldFB) || activeFrameBuffer->resize > 3)
 	{
 		textures.push_back(&activeFrameBuffer->old_fb.rendererTex);
 		textures.push_back(&activeFrameBuffer->old_nb.texture);
 		textures.push_back(&activeFrameBuffer->old_pb.texture);
+		depth = &activeFrameBuffer->old_db.texture;
 	}
 	else
 	{
 		textures.push_back(&activeFrameBuffer->fb.rendererTex);
 		textures.push_back(&activeFrameBuffer->nb.texture);
 		textures.push_back(&activeFrameBuffer->pb.texture);
+		depth = &activeFrameBuffer->db.texture;
+	}
+	// The full layout has the positions in its G-buffer, the depth buffer is only bound for its stencil
+	VkImageLayout depthLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	if (activeFrameBuffer->gbufferLayout != LowRenderer::GBufferLayout::COMPACT)
+	{
+		depth = textures.back();
+		depthLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	}
 	UpdateDescriptorSet(desc, elem.GetBuffer(), &lightUniform, false, textures, Resources::TextureSampler::GetDefaultSampler());
 	UpdateLightUniformBuffer(elem);
+	UpdateLightDescriptorSet(desc, lightFrames[currentFrame], depth, depthLayout);
 	std::array<u32, 1> uniformOffsets = { static_cast<u32>(elem.GetOffset() * lightUniform.GetTotalOffset()) };
 	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipelineLayout, 0, 1, &desc, 1, uniformOffsets.data());
 	vkCmdDraw(activeCommandBuffer, 3, 1, 0, 0);
+	drawCallCount++;
+	if (skyResolvePipeline.pipeline)
+	{
+		// Same set layout, the descriptor set stays bound
+		vkCmdBindPipeline(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, skyResolvePipeline.pipeline);
+		vkCmdDraw(activeCommandBuffer, 3, 1, 0, 0);
+		drawCallCount++;
+	}
 }
 
-void VulkanRenderer::ApplyPostProcess(const LowRenderer::PostProcess::PostProcessEffect* effect)
+void VulkanRenderer::ApplyPostProcess(const LowRenderer::PostProcess::PostProcessEffect* effect, const RendererTexture* filtered)
 {
 	if (!effect->GetShader()) return;
 	VkDescriptorSet desc = pdescriptorPools[currentFrame].GetNext(*this, Resources::ShaderVariant::PostProcess);
@@ -744,33 +1400,208 @@ void VulkanRenderer::ApplyPostProcess(const LowRenderer::PostProcess::PostProces
 	std::vector<const RendererTexture*> textures;
 	textures.push_back(&activeFrameBuffer->lb[activeFrameBuffer->actualBuffer].rendererTex);
 	textures.push_back(&activeFrameBuffer->gb[activeFrameBuffer->actualBuffer].texture);
+	textures.push_back(filtered ? filtered : textures.back());
 	UpdateDescriptorSet(desc, elem.GetBuffer(), &postUniform, false, textures, Resources::TextureSampler::GetDefaultSampler());
 	UpdatePostUniformBuffer(elem, effect);
 	BindShader(effect->GetShader()->GetShader());
 	std::array<u32, 1> uniformOffsets = { static_cast<u32>(elem.GetOffset() * postUniform.GetTotalOffset()) };
 	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipelineLayout, 0, 1, &desc, 1, uniformOffsets.data());
 	vkCmdDraw(activeCommandBuffer, 3, 1, 0, 0);
+	drawCallCount++;
+}
+
+const RendererTexture* VulkanRenderer::FilterMipChain(LowRenderer::FrameBuffer* fb, bool glow, u32 levels)
+{
+	if (!fb) fb = &mainFB;
+	if (!mipDownPipeline.pipeline || !mipUpPipeline.pipeline) return nullptr;
+	activeCommandBuffer = commandBuffers[currentFrame];
+	activeFrameBuffer = fb;
+	renderGraph.Reset();
+	auto addPass = [this](RenderGraphResource source, RenderGraphResource target, const RendererPipeline& pipeline)
+	{
+		u32 pass = renderGraph.AddPass([this, source, target, &pipeline]()
+		{
+			DrawMipChainPass(renderGraph.GetFrameBuffer(target), renderGraph.GetTexture(source), renderGraph.GetResolution(source), pipeline);
+		});
+		renderGraph.Read(pass, source);
+		renderGraph.Write(pass, target);
+	};
+
+	// Levels stop once a side reaches a single texel
+	u32 levelCount = static_cast<u32>(Maths::Util::MinI(static_cast<s32>(levels), MIP_CHAIN_MAX_LEVELS));
+	Maths::IVec2 resolution = fb->GetResolution();
+	std::vector<RenderGraphResource> chain = { renderGraph.ImportTexture(glow ? &fb->gb[fb->actualBuffer].texture : &fb->lb[fb->actualBuffer].rendererTex, resolution) };
+	while (chain.size() <= levelCount && resolution.x > 1 && resolution.y > 1)
+	{
+		resolution = Maths::IVec2(Maths::Util::MaxI(resolution.x / 2, 1), Maths::Util::MaxI(resolution.y / 2, 1));
+		RenderGraphResource target = renderGraph.CreateTexture({ resolution, hdrFormat });
+		addPass(chain.back(), target, mipDownPipeline);
+		chain.push_back(target);
+	}
+	if (chain.size() < 2) return nullptr;
+	// Each upsampled level is a new texture, the graph places it in the memory of the downsampled level it replaces
+	RenderGraphResource result = chain.back();
+	for (u64 i = chain.size() - 2; i > 0; i--)
+	{
+		RenderGraphResource target = renderGraph.CreateTexture({ renderGraph.GetResolution(chain[i]), hdrFormat });
+		addPass(result, target, mipUpPipeline);
+		result = target;
+	}
+	renderGraph.Extract(result);
+	renderGraph.Execute(*this, transientPool, activeCommandBuffer);
+	return renderGraph.GetTexture(result);
+}
+
+void VulkanRenderer::DrawMipChainPass(RendererFrameBuffer& target, const RendererTexture* source, Maths::IVec2 sourceResolution, const RendererPipeline& pipeline)
+{
+	Maths::IVec2 resolution = target.GetResolution();
+	VkRenderPassBeginInfo renderPassInfo{};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = transientPool.GetRenderPass(*this, hdrFormat);
+	renderPassInfo.framebuffer = target.buffer;
+	renderPassInfo.renderArea.extent.width = resolution.x;
+	renderPassInfo.renderArea.extent.height = resolution.y;
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	vkCmdBeginRenderPass(activeCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline);
+
+	VkViewport viewport{};
+	viewport.width = static_cast<f32>(resolution.x);
+	viewport.height = static_cast<f32>(resolution.y);
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(activeCommandBuffer, 0, 1, &viewport);
+	VkRect2D scissor{};
+	scissor.extent.width = resolution.x;
+	scissor.extent.height = resolution.y;
+	vkCmdSetScissor(activeCommandBuffer, 0, 1, &scissor);
+
+	VkDescriptorSet desc = pdescriptorPools[currentFrame].GetNext(*this, Resources::ShaderVariant::PostProcess);
+	auto elem = puniformPools[currentFrame].GetNext();
+	std::vector<const RendererTexture*> textures = { source, source, source };
+	UpdateDescriptorSet(desc, elem.GetBuffer(), &postUniform, false, textures, Resources::TextureSampler::GetDefaultSampler());
+	Uniform::PostFragmentUniform& fragmentData = *elem.GetPostFragmentUniform(*this);
+	fragmentData.paramsA = Maths::Vec4(1.0f / resolution.x, 1.0f / resolution.y, 1.0f / sourceResolution.x, 1.0f / sourceResolution.y);
+	std::array<u32, 1> uniformOffsets = { static_cast<u32>(elem.GetOffset() * postUniform.GetTotalOffset()) };
+	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipelineLayout, 0, 1, &desc, 1, uniformOffsets.data());
+	vkCmdDraw(activeCommandBuffer, 3, 1, 0, 0);
+	drawCallCount++;
+	vkCmdEndRenderPass(activeCommandBuffer);
+}
+
+const RendererPipeline* VulkanRenderer::GetPixelStagePipeline(std::unordered_map<u32, RendererPipeline>& cache, VkRenderPass& targetPass, const VertexRendererShader* vertex, const FragmentRendererShader* fragment, PipelineParams params, const Uniform::PixelStages& stages)
+{
+	auto result = cache.find(stages.GetKey());
+	if (result != cache.end()) return result->second.pipeline ? &result->second : nullptr;
+	RendererPipeline& pipeline = cache[stages.GetKey()];
+	if (!CreateGraphicsPipeline(targetPass, vertex, fragment, pipeline, static_cast<PipelineParams>(params | PipelineParams::PIXEL_STAGES), &stages))
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Could not create the pixel stage pipeline %08x", stages.GetKey());
+		return nullptr;
+	}
+	return &pipeline;
+}
+
+void VulkanRenderer::ApplyPixelStages(const Uniform::PixelStages& stages)
+{
+	const RendererPipeline* pipeline = GetPixelStagePipeline(pixelStagePipelines, postRenderPass, &postVertex, &pixelStageShader, PipelineParams::POST_PROCESS, stages);
+	if (!pipeline) return;
+	VkDescriptorSet desc = pdescriptorPools[currentFrame].GetNext(*this, Resources::ShaderVariant::PostProcess);
+	auto elem = puniformPools[currentFrame].GetNext();
+	std::vector<const RendererTexture*> textures;
+	textures.push_back(&activeFrameBuffer->lb[activeFrameBuffer->actualBuffer].rendererTex);
+	textures.push_back(&activeFrameBuffer->gb[activeFrameBuffer->actualBuffer].texture);
+	textures.push_back(textures.back());
+	UpdateDescriptorSet(desc, elem.GetBuffer(), &postUniform, false, textures, Resources::TextureSampler::GetDefaultSampler());
+
+	activePipeline = pipeline;
+	RecordedCommand bind;
+	bind.type = RecordedCommandType::BIND;
+	bind.pipeline = activePipeline;
+	bind.passParams = activePassParams;
+	bind.viewport = activeFrameBuffer->GetResolution();
+	SubmitCommand(std::move(bind));
+	std::array<u32, 1> uniformOffsets = { static_cast<u32>(elem.GetOffset() * postUniform.GetTotalOffset()) };
+	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipelineLayout, 0, 1, &desc, 1, uniformOffsets.data());
+	vkCmdPushConstants(activeCommandBuffer, activePipeline->pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(Uniform::PixelStageConstants), &stages.constants);
+	vkCmdDraw(activeCommandBuffer, 3, 1, 0, 0);
+	drawCallCount++;
 }
 
+Resources::ShaderProgram* VulkanRenderer::GetWindowProgram()
+{
+	if (!windowProgram) windowProgram = Core::App::GetInstance()->GetResources().Get<Resources::ShaderProgram>(0x6b);
+	return windowProgram;
+}
+
+bool VulkanRenderer::WindowHasPixelStages()
+{
+	Resources::ShaderProgram* program = GetWindowProgram();
+	return program && program->fragment && !program->fragment->sourcePath.empty();
+}
 
 void VulkanRenderer::RenderToWindow()
 {
-	static Resources::ShaderProgram* windowShader = Core::App::GetInstance()->GetResources().Get<Resources::ShaderProgram>(0x6b);
+	Resources::ShaderProgram* windowShader = GetWindowProgram();
 
 	VkDescriptorSet desc = wdescriptorPools[currentFrame].GetNext(*this, Resources::ShaderVariant::Window);
-	RendererTexture* texture;
-	if ((shouldDeleteOldFB) || activeFrameBuffer->resize > 3)
+	// The active frame buffer is the swap chain here, the buffer to present is the one the main frame buffer ended on
+	if ((shouldDeleteOldFB) || mainFB.resize > 3)
 	{
-		texture = &mainFB.old_lb[activeFrameBuffer->actualBuffer].rendererTex;
+		UpdateDescriptorSet(desc, &mainFB.old_lb[mainFB.actualBuffer].rendererTex, &mainFB.old_gb[mainFB.actualBuffer].texture);
 	}
 	else
 	{
-		texture = &mainFB.lb[activeFrameBuffer->actualBuffer].rendererTex;
+		UpdateDescriptorSet(desc, &mainFB.lb[mainFB.actualBuffer].rendererTex, &mainFB.gb[mainFB.actualBuffer].texture);
 	}
-	UpdateDescriptorSet(desc, texture);
 	BindShader(windowShader->GetShader());
+	if (windowPixelStages.count)
+	{
+		const Resources::ShaderProgram* program = windowShader->GetShader();
+		const RendererPipeline* pipeline = GetPixelStagePipeline(windowStagePipelines, windowRenderPass, program->program.vertex, program->program.fragment, PipelineParams::WINDOW, windowPixelStages);
+		if (pipeline)
+		{
+			activePipeline = pipeline;
+			vkCmdBindPipeline(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipeline);
+		}
+	}
 	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipelineLayout, 0, 1, &desc, 0, nullptr);
+	vkCmdPushConstants(activeCommandBuffer, activePipeline->pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(Uniform::PixelStageConstants), &windowPixelStages.constants);
 	vkCmdDraw(activeCommandBuffer, 3, 1, 0, 0);
+	drawCallCount++;
+	windowPixelStages = Uniform::PixelStages();
+}
+
+RenderGraphResource VulkanRenderer::ImportFrameBuffer(LowRenderer::FrameBuffer* fb, bool gBuffer)
+{
+	if (!fb) fb = &mainFB;
+	const RendererTexture* texture = gBuffer ? &fb->fb.rendererTex : &fb->lb[fb->actualBuffer].rendererTex;
+	return frameGraph.ImportTexture(texture, fb->GetResolution());
+}
+
+void VulkanRenderer::AddWindowPass(RenderGraphResource source)
+{
+	if (!presentsMainFrameBuffer)
+	{
+		frameGraph.Extract(source);
+		return;
+	}
+	RenderGraphResource window = frameGraph.ImportTexture(&swapBuffer.fb.rendererTex, Maths::IVec2(swapChainExtent.width, swapChainExtent.height));
+	u32 pass = frameGraph.AddPass([this]()
+	{
+		swapBuffer.fb = swapChainFramebuffers[imageIndex];
+		BeginPass(&swapBuffer, LowRenderer::RenderPassType::ALL);
+		RenderToWindow();
+		EndPass();
+		windowDrawn = true;
+	});
+	frameGraph.Read(pass, source);
+	frameGraph.Write(pass, window);
+	frameGraph.Extract(window);
+}
+
+void VulkanRenderer::ExecuteFrameGraph()
+{
+	frameGraph.Execute(*this, transientPool, commandBuffers[currentFrame]);
 }
 
 void VulkanRenderer::BindShader(const Resources::ShaderProgram* p_shader)
@@ -789,33 +1620,102 @@ void VulkanRenderer::BindShader(const Resources::ShaderProgram* p_shader)
 	{
 		activePassParams = static_cast<LowRenderer::RenderPassType>(activePassParams & (~LowRenderer::RenderPassType::WIRE));
 	}
-	activePipeline = &(p_shader->GetShader(variant)->program.pipeline);
-	vkCmdBindPipeline(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipeline);
+	const Resources::ShaderProgram* program = p_shader->GetShader(variant);
+	const bool compact = UsesCompactPipeline(program);
+	activePipeline = compact ? &program->program.compactPipeline : &program->program.pipeline;
+	const RendererPipeline* packed = compact ? &program->program.packedCompactPipeline : &program->program.packedPipeline;
+	activeLayoutPipelines = { activePipeline, packed->pipeline ? packed : nullptr };
+	boundVertexLayout = VertexLayout::FULL;
+	SubmitBind(p_shader->type != Resources::ShaderVariant::Window && !(activePassParams & (LowRenderer::RenderPassType::SHADOWMAP | LowRenderer::RenderPassType::OBJECT | LowRenderer::RenderPassType::HALO | LowRenderer::RenderPassType::LIGHT | LowRenderer::RenderPassType::POST)));
+}
+
+bool VulkanRenderer::BindInstancedWireframe(const Resources::ShaderProgram* p_shader)
+{
+	if (!instancedVertex.GetModule() || !p_shader || !p_shader->program.fragment) return false;
+	if (activePassParams & (LowRenderer::RenderPassType::SHADOWMAP | LowRenderer::RenderPassType::CUBEMAP | LowRenderer::RenderPassType::OBJECT | LowRenderer::RenderPassType::HALO)) return false;
+	bool compact = activeFrameBuffer->gbufferLayout == LowRenderer::GBufferLayout::COMPACT;
+	RendererPipeline& pipeline = compact ? instancedWireCompactPipeline : instancedWirePipeline;
+	if (!pipeline.pipeline && !CreateGraphicsPipeline(GetGeometryRenderPass(activeFrameBuffer), &instancedVertex, p_shader->program.fragment, pipeline, static_cast<PipelineParams>(PipelineParams::EXTRA_ATTACHMENT | PipelineParams::STENCIL | PipelineParams::WIREFRAME | PipelineParams::INSTANCED | (compact ? PipelineParams::COMPACT_GBUFFER : 0))))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not create the instanced wireframe pipeline");
+		instancedVertex.DeleteShader(device);
+		return false;
+	}
+	activePassParams = static_cast<LowRenderer::RenderPassType>(activePassParams | LowRenderer::RenderPassType::WIRE);
+	activePipeline = &pipeline;
+	activeLayoutPipelines = { activePipeline, nullptr };
+	boundVertexLayout = VertexLayout::FULL;
+	SubmitBind(!(activePassParams & (LowRenderer::RenderPassType::LIGHT | LowRenderer::RenderPassType::POST)));
+	return true;
+}
+
+void VulkanRenderer::SubmitBind(bool dynamicStencil)
+{
+	RecordedCommand bind;
+	bind.type = RecordedCommandType::BIND;
+	bind.pipeline = activePipeline;
+	bind.passParams = activePassParams;
+	bind.dynamicStencil = dynamicStencil;
+	bind.stencilState = state;
+	bind.stencilValue = stencilCompareValue;
+	bind.lineWidth = currentWidth;
+	bind.viewport = activeFrameBuffer->GetResolution();
+	bind.scissor = activeScissor;
+	SubmitCommand(std::move(bind));
+	activeDynamicStencil = dynamicStencil;
+}
+
+bool VulkanRenderer::BindVertexLayout(VertexLayout layout)
+{
+	if (layout == boundVertexLayout) return true;
+	const RendererPipeline* pipeline = activeLayoutPipelines[static_cast<u32>(layout)];
+	if (!pipeline) return false;
+	activePipeline = pipeline;
+	boundVertexLayout = layout;
+	SubmitBind(activeDynamicStencil);
+	return true;
+}
+
+bool VulkanRenderer::UsesCompactPipeline(const Resources::ShaderProgram* p_shader) const
+{
+	if (!activeFrameBuffer || activeFrameBuffer->gbufferLayout != LowRenderer::GBufferLayout::COMPACT || !p_shader->program.compactPipeline.pipeline) return false;
+	return !(activePassParams & (LowRenderer::RenderPassType::OBJECT | LowRenderer::RenderPassType::POST)) && p_shader->type != Resources::ShaderVariant::Window;
+}
+
+void VulkanRenderer::ApplyPipelineState(VkCommandBuffer cmd, const RecordedCommand& bind)
+{
+	vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, bind.pipeline->pipeline);
 
-	if (activePassParams & LowRenderer::RenderPassType::WIRE)
+	if (bind.passParams & LowRenderer::RenderPassType::WIRE)
 	{
-		vkCmdSetLineWidth(activeCommandBuffer, currentWidth);
+		vkCmdSetLineWidth(cmd, bind.lineWidth);
 	}
-	if (p_shader->type != Resources::ShaderVariant::Window && !(activePassParams & (LowRenderer::RenderPassType::SHADOWMAP | LowRenderer::RenderPassType::OBJECT | LowRenderer::RenderPassType::HALO | LowRenderer::RenderPassType::LIGHT | LowRenderer::RenderPassType::POST)))
+	if (bind.dynamicStencil)
 	{
-		vkCmdSetDepthWriteEnable(activeCommandBuffer, state == StencilState::GREATER ? VK_FALSE : VK_TRUE);
-		vkCmdSetStencilReference(activeCommandBuffer, VK_STENCIL_FRONT_AND_BACK, stencilCompareValue);
-		switch (state)
+		const bool sky = bind.stencilState == StencilState::SKY;
+		vkCmdSetDepthWriteEnable(cmd, bind.stencilState == StencilState::GREATER || sky ? VK_FALSE : VK_TRUE);
+		vkCmdSetStencilReference(cmd, VK_STENCIL_FRONT_AND_BACK, sky ? bind.stencilValue | SKY_STENCIL_BIT : bind.stencilValue);
+		vkCmdSetStencilCompareMask(cmd, VK_STENCIL_FRONT_AND_BACK, sky ? static_cast<u8>(~SKY_STENCIL_BIT) : 0xff);
+		vkCmdSetStencilWriteMask(cmd, VK_STENCIL_FRONT_AND_BACK, sky ? SKY_STENCIL_BIT : 0xff);
+		switch (bind.stencilState)
 		{
 		case Renderer::StencilState::DEFAULT:
-			vkCmdSetStencilOp(activeCommandBuffer, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_EQUAL);
+			vkCmdSetStencilOp(cmd, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_EQUAL);
 			break;
 		case Renderer::StencilState::INCREMENT:
-			vkCmdSetStencilOp(activeCommandBuffer, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_INCREMENT_AND_CLAMP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_EQUAL);
+			vkCmdSetStencilOp(cmd, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_INCREMENT_AND_CLAMP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_EQUAL);
 			break;
 		case Renderer::StencilState::NO_DEPTH:
-			vkCmdSetStencilOp(activeCommandBuffer, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_EQUAL);
+			vkCmdSetStencilOp(cmd, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_EQUAL);
 			break;
 		case Renderer::StencilState::GREATER:
-			vkCmdSetStencilOp(activeCommandBuffer, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_REPLACE, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_LESS);
+			vkCmdSetStencilOp(cmd, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_REPLACE, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_LESS);
+			break;
+		case Renderer::StencilState::SKY:
+			vkCmdSetStencilOp(cmd, VK_STENCIL_FRONT_AND_BACK, VK_STENCIL_OP_KEEP, VK_STENCIL_OP_REPLACE, VK_STENCIL_OP_KEEP, VK_COMPARE_OP_EQUAL);
 			break;
 		default:
-			LOG(DEBUG_LEVEL::LERROR, "Invalid stencil state %d !", state);
+			LOG(DEBUG_LEVEL::LERROR, "Invalid stencil state %d !", bind.stencilState);
 			break;
 		}
 	}
@@ -823,19 +1723,794 @@ void VulkanRenderer::BindShader(const Resources::ShaderProgram* p_shader)
 	VkViewport viewport{};
 	viewport.x = 0.0f;
 	viewport.y = 0.0f;
-	viewport.width = static_cast<f32>(activeFrameBuffer->GetResolution().x);
-	viewport.height = static_cast<f32>(activeFrameBuffer->GetResolution().y);
+	viewport.width = static_cast<f32>(bind.viewport.x);
+	viewport.height = static_cast<f32>(bind.viewport.y);
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
-	vkCmdSetViewport(activeCommandBuffer, 0, 1, &viewport);
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
 
 	VkRect2D scissor{};
 	scissor.offset = { 0, 0 };
-	scissor.extent.width = (u32)activeFrameBuffer->GetResolution().x;
-	scissor.extent.height = (u32)activeFrameBuffer->GetResolution().y;
-	vkCmdSetScissor(activeCommandBuffer, 0, 1, &scissor);
+	scissor.extent.width = (u32)bind.viewport.x;
+	scissor.extent.height = (u32)bind.viewport.y;
+	if (bind.scissor) scissor = *bind.scissor;
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+	if (bind.passParams & LowRenderer::RenderPassType::SHADOWMAP) vkCmdSetDepthBias(cmd, 0.0f, 0.0f, 0.0f);
+}
+
+void VulkanRenderer::SubmitCommand(RecordedCommand&& command)
+{
+	if (recordingPass)
+	{
+		recordedCommands.push_back(std::move(command));
+	}
+	else if (command.type == RecordedCommandType::BIND)
+	{
+		ApplyPipelineState(activeCommandBuffer, command);
+	}
+	else
+	{
+		RecordCommand(activeCommandBuffer, descriptorPools[currentFrame], command);
+	}
+}
+
+void VulkanRenderer::RecordCommand(VkCommandBuffer cmd, FrameDescriptorPool& pool, const RecordedCommand& command)
+{
+	if (command.type == RecordedCommandType::INDIRECT)
+	{
+		RecordIndirectDraws(cmd, command);
+		return;
+	}
+	if (command.type == RecordedCommandType::TIMESTAMP)
+	{
+		profiler.WriteScope(cmd, command.count, command.scopeEnd);
+		return;
+	}
+	VkDescriptorSet desc = pool.GetNext(*this);
+	UniformElement uniform = command.uniform;
+	UpdateDescriptorSet(desc, uniform.GetBuffer(), &mainUniform, true, command.textures, Resources::TextureSampler::GetDefaultSampler());
+
+	u32 uniformOffset = static_cast<u32>(uniform.GetOffset() * mainUniform.GetTotalOffset());
+	std::array<u32, 2> uniformOffsets = { uniformOffset, uniformOffset };
+	if (command.vertexBuffer)
+		vkCmdBindVertexBuffers(cmd, 0, 1, &command.vertexBuffer, &command.vertexOffset);
+	if (command.instanceBuffer)
+		vkCmdBindVertexBuffers(cmd, 1, 1, &command.instanceBuffer, &command.instanceOffset);
+
+	vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, command.pipeline->pipelineLayout, 0, 1, &desc, 2, uniformOffsets.data());
+
+	if (command.type == RecordedCommandType::DRAW_INDEXED)
+	{
+		vkCmdBindIndexBuffer(cmd, command.indexBuffer, command.indexOffset, command.indexType);
+		vkCmdDrawIndexed(cmd, command.count, command.instanceCount, 0, 0, 0);
+	}
+	else
+	{
+		vkCmdDraw(cmd, command.count, command.instanceCount, 0, 0);
+	}
+	drawCallCount++;
+}
+
+VkCommandBuffer VulkanRenderer::RecordSecondaryCommands(CommandRecorder& recorder, u64 stateIndex, u64 begin, u64 end)
+{
+	if (recorder.usedBuffers == recorder.buffers.size())
+	{
+		VkCommandBufferAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.commandPool = recorder.pool;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+		allocInfo.commandBufferCount = 1;
+		recorder.buffers.push_back(VK_NULL_HANDLE);
+		if (vkAllocateCommandBuffers(device, &allocInfo, &recorder.buffers.back()) != VK_SUCCESS)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "Failed to allocate secondary command buffer!");
+		}
+	}
+	VkCommandBuffer cmd = recorder.buffers[recorder.usedBuffers++];
+
+	VkCommandBufferInheritanceInfo inheritanceInfo{};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.renderPass = *recordedRenderPass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = activeRendererFrameBuffer.buffer;
+	inheritanceInfo.pipelineStatistics = profiler.GetStatisticFlags();
+
+	VkCommandBufferBeginInfo beginInfo{};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+	if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to begin recording secondary command buffer!");
+	}
+
+	// Dynamic state is not inherited, so restore the bind that was active when this chunk starts
+	if (stateIndex < recordedCommands.size() && recordedCommands[begin].type != RecordedCommandType::BIND)
+	{
+		ApplyPipelineState(cmd, recordedCommands[stateIndex]);
+	}
+	for (u64 i = begin; i < end; i++)
+	{
+		if (recordedCommands[i].type == RecordedCommandType::BIND)
+			ApplyPipelineState(cmd, recordedCommands[i]);
+		else
+			RecordCommand(cmd, recorder.descriptors, recordedCommands[i]);
+	}
+
+	if (vkEndCommandBuffer(cmd) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to record secondary command buffer!");
+	}
+	return cmd;
+}
+
+void VulkanRenderer::FlushRecordedPass()
+{
+	recordingPass = false;
+	// Only the main geometry pass has a depth pyramid, secondary cameras are culled against their frustum alone
+	bool occlusion = !indirectBatches.empty() && hizPipeline.pipeline && activeFrameBuffer == &mainFB && recordedRenderPass == &GetGeometryRenderPass(activeFrameBuffer);
+	if (!indirectBatches.empty())
+	{
+		PrepareIndirectCulling(occlusion);
+		DispatchIndirectCulling(0);
+		if (occlusion)
+		{
+			// Draw what was visible last frame, rebuild the pyramid from it and resume the pass with the objects it uncovered
+			BeginActiveRenderPass(*recordedRenderPass, VK_SUBPASS_CONTENTS_INLINE);
+			RecordIndirectDraws(activeCommandBuffer, CreateIndirectCommand(0));
+			EndRenderPass();
+			mainFB.db.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+			hizBuffer.Build(*this, activeCommandBuffer, mainFB.db, hizPipeline);
+			DispatchIndirectCulling(1);
+			recordedRenderPass = &GetGeometryRenderPass(activeFrameBuffer, true);
+			recordedCommands.insert(recordedCommands.begin(), CreateIndirectCommand(1));
+		}
+		else
+		{
+			recordedCommands.insert(recordedCommands.begin(), CreateIndirectCommand(0));
+		}
+	}
+	u64 commandCount = recordedCommands.size();
+	u32 chunkCount = static_cast<u32>(commandCount / RECORD_CHUNK_SIZE);
+	u32 recorderCount = static_cast<u32>(commandRecorders[currentFrame].size());
+	if (chunkCount > recorderCount) chunkCount = recorderCount;
+
+	if (chunkCount < 2)
+	{
+		BeginActiveRenderPass(*recordedRenderPass, VK_SUBPASS_CONTENTS_INLINE);
+		for (auto& command : recordedCommands)
+		{
+			if (command.type == RecordedCommandType::BIND)
+				ApplyPipelineState(activeCommandBuffer, command);
+			else
+				RecordCommand(activeCommandBuffer, descriptorPools[currentFrame], command);
+		}
+	}
+	else
+	{
+		BeginActiveRenderPass(*recordedRenderPass, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+		std::vector<u64> bounds(chunkCount + 1);
+		std::vector<u64> states(chunkCount);
+		for (u32 i = 0; i <= chunkCount; i++)
+		{
+			bounds[i] = commandCount * i / chunkCount;
+		}
+		u64 lastBind = commandCount;
+		u32 chunk = 0;
+		for (u64 i = 0; i < commandCount && chunk < chunkCount; i++)
+		{
+			if (bounds[chunk] == i) states[chunk++] = lastBind;
+			if (recordedCommands[i].type == RecordedCommandType::BIND) lastBind = i;
+		}
+
+		std::vector<VkCommandBuffer> secondaries(chunkCount);
+		auto& recorders = commandRecorders[currentFrame];
+		recordThreads.ParallelFor(chunkCount, [&](u32 index)
+		{
+			secondaries[index] = RecordSecondaryCommands(recorders[index], states[index], bounds[index], bounds[index + 1]);
+		});
+		vkCmdExecuteCommands(activeCommandBuffer, chunkCount, secondaries.data());
+	}
+	EndRenderPass();
+	activeFrameBuffer->db.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	if (occlusion)
+	{
+		// The next frame tests its first phase against the final depth of this one
+		hizBuffer.Build(*this, activeCommandBuffer, mainFB.db, hizPipeline);
+		hizBuffer.SetViewProjection(indirectViewProjection);
+	}
+	recordedCommands.clear();
+	indirectBatches.clear();
+	indirectBatchLookup.clear();
+	indirectObjectBase = indirectFrames[currentFrame].objectCount;
+	indirectBatchBase = indirectFrames[currentFrame].batchCount;
+}
+
+void VulkanRenderer::PrepareIndirectCulling(bool occlusion)
+{
+	IndirectFrameData& frame = indirectFrames[currentFrame];
+	u32 batchCount = static_cast<u32>(indirectBatches.size());
+	u32 objectCount = frame.objectCount - indirectObjectBase;
+	ReserveIndirectBatches(frame, indirectBatchBase + batchCount);
+	frame.batchCount = indirectBatchBase + batchCount;
+
+	// Each batch owns a contiguous range of command slots, large enough for all of its objects
+	u32 firstCommand = indirectObjectBase;
+	for (u32 i = 0; i < batchCount; i++)
+	{
+		IndirectBatch& batch = indirectBatches[i];
+		batch.firstCommand = firstCommand;
+		frame.batchOffsets[indirectBatchBase + i] = firstCommand;
+		firstCommand += batch.objectCount;
+
+		const Resources::Material* mat = batch.material;
+		std::vector<const RendererTexture*> textures;
+		textures.push_back(&(mat->albedo ? mat->albedo : Resources::StaticTexture::GetDefaultTexture())->GetRendererTexture());
+		textures.push_back(&(mat->normal ? mat->normal : Resources::StaticTexture::GetDefaultNormal())->GetRendererTexture());
+		textures.push_back(&(mat->height ? mat->height : Resources::StaticTexture::GetDefaultTexture())->GetRendererTexture());
+		batch.uniform = uniformPools[currentFrame].GetNext();
+		UpdateUniformBuffer(batch.uniform, mat, Maths::Mat4(1), indirectViewProjection);
+		batch.descriptor = idescriptorPools[currentFrame].GetNext(*this, indirectUniform.GetLayout());
+		UpdateIndirectDescriptorSet(batch.descriptor, frame, batch.uniform.GetBuffer(), textures);
+	}
+
+	indirectCullPass = static_cast<u32>(frame.passInfo.size());
+	frame.passInfo.push_back(CullingStats());
+	frame.passInfo.back().pass = activePassParams;
+	frame.passInfo.back().occlusion = occlusion;
+
+	Uniform::IndirectCullPass& pass = frame.passes[indirectCullPass];
+	pass.planes[0] = indirectFrustum.left;
+	pass.planes[1] = indirectFrustum.right;
+	pass.planes[2] = indirectFrustum.top;
+	pass.planes[3] = indirectFrustum.bottom;
+	pass.planes[4] = indirectFrustum.front;
+	pass.planes[5] = indirectFrustum.back;
+	pass.viewProjection = indirectViewProjection;
+	pass.cameraPosition = GetViewpoint(indirectViewProjection);
+	pass.objectBase = indirectObjectBase;
+	pass.objectCount = objectCount;
+	pass.compact = hasDrawIndirectCount ? 1 : 0;
+	pass.occlusion = Uniform::OCCLUSION_NONE;
+	if (occlusion)
+	{
+		// The pyramid of the previous frame is only usable if it was built for the same depth buffer
+		bool previousValid = hizBuffer.Prepare(*this, mainFB.db);
+		Maths::IVec2 hizResolution = hizBuffer.GetResolution();
+		pass.hizWidth = hizResolution.x;
+		pass.hizHeight = hizResolution.y;
+		pass.hizMips = hizBuffer.GetMipCount();
+		pass.occlusion = Uniform::OCCLUSION_TWO_PHASE | (previousValid ? Uniform::OCCLUSION_PREVIOUS : Uniform::OCCLUSION_NONE);
+		pass.previousViewProjection = hizBuffer.GetViewProjection();
+	}
+
+	indirectCullDescriptor = idescriptorPools[currentFrame].GetNext(*this, indirectUniform.GetCullLayout());
+	UpdateCullDescriptorSet(indirectCullDescriptor, frame);
+}
+
+void VulkanRenderer::DispatchIndirectCulling(u32 phase)
+{
+	IndirectFrameData& frame = indirectFrames[currentFrame];
+	u32 batchCount = static_cast<u32>(indirectBatches.size());
+	u32 objectCount = frame.objectCount - indirectObjectBase;
+
+	Uniform::IndirectCullConstants constants;
+	constants.pass = indirectCullPass;
+	constants.phase = phase;
+	constants.commandBase = phase ? frame.objectCapacity : 0;
+	constants.countBase = phase ? frame.batchCapacity : 0;
+
+	if (hasDrawIndirectCount)
+	{
+		vkCmdFillBuffer(activeCommandBuffer, frame.countBuffer, (constants.countBase + indirectBatchBase) * sizeof(u32), batchCount * sizeof(u32), 0);
+
+		VkMemoryBarrier clearBarrier{};
+		clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(activeCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+	}
+
+	vkCmdBindPipeline(activeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.pipeline);
+	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline.pipelineLayout, 0, 1, &indirectCullDescriptor, 0, nullptr);
+	vkCmdPushConstants(activeCommandBuffer, cullPipeline.pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(Uniform::IndirectCullConstants), &constants);
+	vkCmdDispatch(activeCommandBuffer, (objectCount + INDIRECT_CULL_GROUP_SIZE - 1) / INDIRECT_CULL_GROUP_SIZE, 1, 1);
+
+	VkMemoryBarrier cullBarrier{};
+	cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(activeCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+RecordedCommand VulkanRenderer::CreateIndirectCommand(u32 phase)
+{
+	// The culled objects are drawn first, before anything the pass recorded on the CPU
+	RecordedCommand draw;
+	draw.type = RecordedCommandType::INDIRECT;
+	draw.pipeline = activeFrameBuffer->gbufferLayout == LowRenderer::GBufferLayout::COMPACT ? &indirectCompactPipeline : &indirectPipeline;
+	draw.passParams = static_cast<LowRenderer::RenderPassType>(activePassParams & (~LowRenderer::RenderPassType::WIRE));
+	draw.dynamicStencil = true;
+	draw.stencilState = StencilState::DEFAULT;
+	draw.stencilValue = 0;
+	draw.lineWidth = currentWidth;
+	draw.viewport = activeFrameBuffer->GetResolution();
+	draw.indirectPhase = phase;
+	return draw;
+}
+
+void VulkanRenderer::RecordIndirectDraws(VkCommandBuffer cmd, const RecordedCommand& command)
+{
+	const IndirectFrameData& frame = indirectFrames[currentFrame];
+	ApplyPipelineState(cmd, command);
+	vkCmdPushConstants(cmd, command.pipeline->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(Maths::Mat4), indirectViewProjection.content);
+
+	VkBuffer vertexBuffer = geometryPool.GetVertexBuffer();
+	VkDeviceSize vertexbufferOffset = 0;
+	vkCmdBindVertexBuffers(cmd, 0, 1, &vertexBuffer, &vertexbufferOffset);
+	vkCmdBindIndexBuffer(cmd, geometryPool.GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+
+	const u32 stride = sizeof(VkDrawIndexedIndirectCommand);
+	// The second culling phase writes its commands and counts after the ones of the first
+	VkDeviceSize commandBase = command.indirectPhase ? frame.objectCapacity : 0;
+	VkDeviceSize countBase = command.indirectPhase ? frame.batchCapacity : 0;
+	for (u64 i = 0; i < indirectBatches.size(); i++)
+	{
+		UniformElement uniform = indirectBatches[i].uniform;
+		u32 uniformOffset = static_cast<u32>(uniform.GetOffset() * mainUniform.GetTotalOffset());
+		vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, command.pipeline->pipelineLayout, 0, 1, &indirectBatches[i].descriptor, 1, &uniformOffset);
+
+		VkDeviceSize commandOffset = (commandBase + indirectBatches[i].firstCommand) * stride;
+		u32 drawCount = indirectBatches[i].objectCount;
+		if (hasDrawIndirectCount)
+		{
+			vkCmdDrawIndexedIndirectCount(cmd, frame.commandBuffer, commandOffset, frame.countBuffer, (countBase + indirectBatchBase + i) * sizeof(u32), drawCount, stride);
+			drawCallCount++;
+		}
+		else if (hasMultiDrawIndirect)
+		{
+			// Culled slots are left in place with an instance count of 0
+			vkCmdDrawIndexedIndirect(cmd, frame.commandBuffer, commandOffset, drawCount, stride);
+			drawCallCount++;
+		}
+		else
+		{
+			for (u32 j = 0; j < drawCount; j++)
+			{
+				vkCmdDrawIndexedIndirect(cmd, frame.commandBuffer, commandOffset + j * stride, 1, stride);
+			}
+			drawCallCount += drawCount;
+		}
+	}
+}
+
+void VulkanRenderer::ReserveIndirectObjects(IndirectFrameData& frame, u32 objectCount)
+{
+	if (objectCount <= frame.objectCapacity) return;
+	u32 capacity = frame.objectCapacity ? frame.objectCapacity : 1024;
+	while (capacity < objectCount) capacity *= 2;
+
+	VkBuffer objectBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory objectMemory = VK_NULL_HANDLE;
+	VkBuffer commandBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory commandMemory = VK_NULL_HANDLE;
+	VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory visibilityMemory = VK_NULL_HANDLE;
+	void* mapped = nullptr;
+	CreateBuffer(capacity * sizeof(Uniform::IndirectObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, objectBuffer, objectMemory);
+	if (vkMapMemory(device, objectMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Could not map indirect object buffer !");
+		throw std::runtime_error("Could not map indirect object buffer !");
+	}
+	// Room for the commands of both culling phases
+	CreateBuffer(capacity * 2 * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, commandBuffer, commandMemory);
+	CreateBuffer(capacity * sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibilityBuffer, visibilityMemory);
+
+	if (frame.objectBuffer)
+	{
+		// Objects of the pass being recorded were written to the old buffer, earlier passes keep reading it until it is retired
+		std::copy(frame.objects, frame.objects + frame.objectCount, static_cast<Uniform::IndirectObject*>(mapped));
+		IndirectFrameData old = frame;
+		QueueDeletion([this, old]()
+		{
+			vkDestroyBuffer(device, old.objectBuffer, nullptr);
+			vkFreeMemory(device, old.objectMemory, nullptr);
+			vkDestroyBuffer(device, old.commandBuffer, nullptr);
+			vkFreeMemory(device, old.commandMemory, nullptr);
+			vkDestroyBuffer(device, old.visibilityBuffer, nullptr);
+			vkFreeMemory(device, old.visibilityMemory, nullptr);
+		});
+	}
+	frame.objectBuffer = objectBuffer;
+	frame.objectMemory = objectMemory;
+	frame.objects = static_cast<Uniform::IndirectObject*>(mapped);
+	frame.commandBuffer = commandBuffer;
+	frame.commandMemory = commandMemory;
+	frame.visibilityBuffer = visibilityBuffer;
+	frame.visibilityMemory = visibilityMemory;
+	frame.objectCapacity = capacity;
+}
+
+void VulkanRenderer::ReserveIndirectBatches(IndirectFrameData& frame, u32 batchCount)
+{
+	if (batchCount <= frame.batchCapacity) return;
+	u32 capacity = frame.batchCapacity ? frame.batchCapacity : 64;
+	while (capacity < batchCount) capacity *= 2;
+
+	VkBuffer batchBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory batchMemory = VK_NULL_HANDLE;
+	VkBuffer countBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory countMemory = VK_NULL_HANDLE;
+	void* mapped = nullptr;
+	CreateBuffer(capacity * sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, batchBuffer, batchMemory);
+	if (vkMapMemory(device, batchMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Could not map indirect batch buffer !");
+		throw std::runtime_error("Could not map indirect batch buffer !");
+	}
+	CreateBuffer(capacity * 2 * sizeof(u32), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, countBuffer, countMemory);
+
+	if (frame.batchBuffer)
+	{
+		IndirectFrameData old = frame;
+		QueueDeletion([this, old]()
+		{
+			vkDestroyBuffer(device, old.batchBuffer, nullptr);
+			vkFreeMemory(device, old.batchMemory, nullptr);
+			vkDestroyBuffer(device, old.countBuffer, nullptr);
+			vkFreeMemory(device, old.countMemory, nullptr);
+		});
+	}
+	frame.batchBuffer = batchBuffer;
+	frame.batchMemory = batchMemory;
+	frame.batchOffsets = static_cast<u32*>(mapped);
+	frame.countBuffer = countBuffer;
+	frame.countMemory = countMemory;
+	frame.batchCapacity = capacity;
+}
+
+void VulkanRenderer::DestroyIndirectFrame(IndirectFrameData& frame)
+{
+	vkDestroyBuffer(device, frame.objectBuffer, nullptr);
+	vkFreeMemory(device, frame.objectMemory, nullptr);
+	vkDestroyBuffer(device, frame.commandBuffer, nullptr);
+	vkFreeMemory(device, frame.commandMemory, nullptr);
+	vkDestroyBuffer(device, frame.batchBuffer, nullptr);
+	vkFreeMemory(device, frame.batchMemory, nullptr);
+	vkDestroyBuffer(device, frame.countBuffer, nullptr);
+	vkFreeMemory(device, frame.countMemory, nullptr);
+	vkDestroyBuffer(device, frame.visibilityBuffer, nullptr);
+	vkFreeMemory(device, frame.visibilityMemory, nullptr);
+	vkDestroyBuffer(device, frame.passBuffer, nullptr);
+	vkFreeMemory(device, frame.passMemory, nullptr);
+	vkDestroyBuffer(device, frame.statsBuffer, nullptr);
+	vkFreeMemory(device, frame.statsMemory, nullptr);
+	frame = IndirectFrameData();
+}
+
+void VulkanRenderer::CreateIndirectResources()
+{
+	indirectFrames.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& frame : indirectFrames)
+	{
+		ReserveIndirectObjects(frame, 1024);
+		ReserveIndirectBatches(frame, 64);
+
+		void* passes = nullptr;
+		void* stats = nullptr;
+		CreateBuffer(INDIRECT_MAX_CULL_PASSES * sizeof(Uniform::IndirectCullPass), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.passBuffer, frame.passMemory);
+		CreateBuffer(INDIRECT_MAX_CULL_PASSES * sizeof(Uniform::IndirectCullStats), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, frame.statsBuffer, frame.statsMemory);
+		if (vkMapMemory(device, frame.passMemory, 0, VK_WHOLE_SIZE, 0, &passes) != VK_SUCCESS || vkMapMemory(device, frame.statsMemory, 0, VK_WHOLE_SIZE, 0, &stats) != VK_SUCCESS)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "Could not map culling pass buffers !");
+			throw std::runtime_error("Could not map culling pass buffers !");
+		}
+		frame.passes = static_cast<Uniform::IndirectCullPass*>(passes);
+		frame.stats = static_cast<Uniform::IndirectCullStats*>(stats);
+		std::fill(frame.stats, frame.stats + INDIRECT_MAX_CULL_PASSES, Uniform::IndirectCullStats());
+	}
+	geometryPool.CreatePool(*this, 1 << 16, 1 << 18);
+	if (!indirectSupported)
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "drawIndirectFirstInstance is not supported, GPU driven rendering disabled");
+		return;
+	}
+	if (!cullShader.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/indirect_cull.comp"), device) ||
+		!indirectVertex.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/indirect_vertex.vert"), device) ||
+		!CreateComputePipeline(&cullShader, cullPipeline, indirectUniform.GetCullLayout(), sizeof(Uniform::IndirectCullConstants)))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not load the culling shaders, GPU driven rendering disabled");
+		indirectSupported = false;
+		return;
+	}
+	if (!hizShader.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/hiz_reduce.comp"), device) ||
+		!CreateComputePipeline(&hizShader, hizPipeline, indirectUniform.GetReduceLayout(), sizeof(Uniform::HiZReduceConstants)))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not load the depth pyramid shader, occlusion culling disabled");
+	}
+}
+
+void VulkanRenderer::CreateLightResources()
+{
+	lightFrames.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& frame : lightFrames)
+	{
+		ReserveLightStorage(frame.directionals, 16 * sizeof(Uniform::DirectionalLight));
+		ReserveLightStorage(frame.points, 256 * sizeof(Uniform::PointLight));
+		ReserveLightStorage(frame.spots, 256 * sizeof(Uniform::SpotLight));
+		ReserveLightStorage(frame.clusters, 2 * LIGHT_CLUSTER_COUNT * sizeof(Uniform::LightCluster));
+		ReserveLightStorage(frame.indices, 8 * LIGHT_CLUSTER_COUNT * sizeof(u32));
+	}
+	lightClusterCursors.resize(2 * LIGHT_CLUSTER_COUNT);
+}
+
+void VulkanRenderer::CreateSkinningResources()
+{
+	skinningMatrices.resize(MAX_FRAMES_IN_FLIGHT);
+	for (auto& matrices : skinningMatrices)
+	{
+		ReserveLightStorage(matrices, 256 * sizeof(Maths::Mat4));
+	}
+	if (!skinShader.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/skinning.comp"), device) ||
+		!CreateComputePipeline(&skinShader, skinPipeline, indirectUniform.GetSkinLayout(), sizeof(Uniform::SkinningConstants)))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not load the skinning shader, skinned meshes are drawn in their bind pose");
+		skinPipeline.pipeline = VK_NULL_HANDLE;
+	}
+}
+
+void VulkanRenderer::CreatePostResources()
+{
+	PipelineParams params = static_cast<PipelineParams>(PipelineParams::POST_PROCESS | PipelineParams::MIP_CHAIN);
+	VkRenderPass transientRenderPass = transientPool.GetRenderPass(*this, hdrFormat);
+	if (!postVertex.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/deferred_vertex.vert"), device) ||
+		!mipDownShader.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/mip_downsample.frag"), device) ||
+		!mipUpShader.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/mip_upsample.frag"), device) ||
+		!CreateGraphicsPipeline(transientRenderPass, &postVertex, &mipDownShader, mipDownPipeline, params) ||
+		!CreateGraphicsPipeline(transientRenderPass, &postVertex, &mipUpShader, mipUpPipeline, params))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not load the mip chain shaders, bloom and blur are disabled");
+	}
+	if (!postVertex.GetModule() || !pixelStageShader.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/post_pixel.frag"), device))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not load the pixel stage shader, per-pixel effects are applied one by one");
+	}
+	if (!postVertex.GetModule() || !skyResolveShader.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/sky_resolve.frag"), device) ||
+		!CreateGraphicsPipeline(lightRenderPass, &postVertex, &skyResolveShader, skyResolvePipeline, static_cast<PipelineParams>(PipelineParams::LIGHT_PASS | PipelineParams::SKY_RESOLVE)))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not load the sky resolve shader, the light pass shades the sky pixels");
+	}
+}
 
-	if (activePassParams & LowRenderer::RenderPassType::SHADOWMAP) vkCmdSetDepthBias(activeCommandBuffer, 0.0f, 0.0f, 0.0f);
+void VulkanRenderer::CreatePickResources()
+{
+	void* data = nullptr;
+	CreateBuffer(sizeof(u32), VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, pickBuffer, pickMemory);
+	if (vkMapMemory(device, pickMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Could not map pick buffer !");
+		throw std::runtime_error("Could not map pick buffer !");
+	}
+	pickData = static_cast<const u32*>(data);
+}
+
+void VulkanRenderer::CreateDebugDrawResources()
+{
+	transientGeometry.resize(MAX_FRAMES_IN_FLIGHT);
+	if (!instancedVertex.LoadShader(Wrappers::ShaderLoader::LoadCachedShader("Default_Resources/Shaders/instanced_vertex.vert"), device))
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not load the instanced vertex shader, debug geometry is drawn once per instance");
+	}
+}
+
+bool VulkanRenderer::ReserveLightStorage(LightStorageBuffer& storage, u64 size)
+{
+	if (size <= storage.capacity) return false;
+	u64 capacity = storage.capacity ? storage.capacity : 4096;
+	while (capacity < size) capacity *= 2;
+
+	LightStorageBuffer result;
+	CreateBuffer(capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, result.buffer, result.memory);
+	if (vkMapMemory(device, result.memory, 0, VK_WHOLE_SIZE, 0, &result.data) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Could not map light buffer !");
+		throw std::runtime_error("Could not map light buffer !");
+	}
+	result.capacity = capacity;
+	if (storage.buffer)
+	{
+		// Light passes recorded earlier in the frame keep reading the old buffer
+		LightStorageBuffer old = storage;
+		QueueDeletion([this, old]()
+		{
+			vkDestroyBuffer(device, old.buffer, nullptr);
+			vkFreeMemory(device, old.memory, nullptr);
+		});
+	}
+	storage = result;
+	return true;
+}
+
+void VulkanRenderer::DestroyLightFrame(LightFrameData& frame)
+{
+	for (LightStorageBuffer* storage : { &frame.directionals, &frame.points, &frame.spots, &frame.clusters, &frame.indices })
+	{
+		vkDestroyBuffer(device, storage->buffer, nullptr);
+		vkFreeMemory(device, storage->memory, nullptr);
+	}
+	frame = LightFrameData();
+}
+
+void VulkanRenderer::UploadLights(LightFrameData& frame)
+{
+	ReserveLightStorage(frame.directionals, dLights.size() * sizeof(Uniform::DirectionalLight));
+	ReserveLightStorage(frame.points, pLights.size() * sizeof(Uniform::PointLight));
+	ReserveLightStorage(frame.spots, sLights.size() * sizeof(Uniform::SpotLight));
+
+	Uniform::DirectionalLight* directionals = static_cast<Uniform::DirectionalLight*>(frame.directionals.data);
+	for (u64 i = 0; i < dLights.size(); i++)
+	{
+		directionals[i].Direction = dLights[i]->Direction;
+		directionals[i].Shininess = dLights[i]->Shininess;
+		directionals[i].Ambient = dLights[i]->AmbientColor;
+		directionals[i].Diffuse = dLights[i]->DiffuseColor;
+		directionals[i].Specular = dLights[i]->SpecularColor;
+	}
+	Uniform::PointLight* points = static_cast<Uniform::PointLight*>(frame.points.data);
+	for (u64 i = 0; i < pLights.size(); i++)
+	{
+		points[i].Position = pLights[i]->Position;
+		points[i].Shininess = pLights[i]->Shininess;
+		points[i].Ambient = pLights[i]->AmbientColor;
+		points[i].Radius = pLights[i]->Radius;
+		points[i].Diffuse = pLights[i]->DiffuseColor;
+		points[i].Linear = pLights[i]->Linear;
+		points[i].Specular = pLights[i]->SpecularColor;
+		points[i].Quadratic = pLights[i]->Quadratic;
+	}
+	Uniform::SpotLight* spots = static_cast<Uniform::SpotLight*>(frame.spots.data);
+	for (u64 i = 0; i < sLights.size(); i++)
+	{
+		spots[i].Position = sLights[i]->Position;
+		spots[i].Shininess = sLights[i]->Shininess;
+		spots[i].Ambient = sLights[i]->AmbientColor;
+		spots[i].Radius = sLights[i]->Radius;
+		spots[i].Diffuse = sLights[i]->DiffuseColor;
+		spots[i].Linear = sLights[i]->Linear;
+		spots[i].Specular = sLights[i]->SpecularColor;
+		spots[i].Quadratic = sLights[i]->Quadratic;
+		spots[i].Direction = sLights[i]->Direction;
+		spots[i].Angles = Maths::Vec2(sLights[i]->Angle, sLights[i]->Ratio);
+	}
+	frame.uploaded = true;
+}
+
+bool VulkanRenderer::GetLightClusterRange(const Maths::Vec3& center, f32 radius, const Maths::Mat4& view, const Maths::Mat4& projection, const Uniform::LightFragmentUniform& fragmentData, LightClusterRange& range)
+{
+	const f32 nearPlane = currentCamera->nearPlane;
+	const f32 farPlane = currentCamera->farPlane;
+	Maths::Vec4 viewPos = view * Maths::Vec4(center, 1.0f);
+	f32 depth = -viewPos.z;
+	if (depth + radius < nearPlane || depth - radius > farPlane) return false;
+
+	f32 minDepth = Maths::Util::MaxF(depth - radius, nearPlane);
+	f32 maxDepth = Maths::Util::MinF(depth + radius, farPlane);
+	range.min.z = Maths::Util::IClamp(static_cast<s32>(floorf(logf(minDepth) * fragmentData.sliceScale + fragmentData.sliceBias)), 0, LIGHT_CLUSTER_Z - 1);
+	range.max.z = Maths::Util::IClamp(static_cast<s32>(floorf(logf(maxDepth) * fragmentData.sliceScale + fragmentData.sliceBias)), 0, LIGHT_CLUSTER_Z - 1);
+	if (depth - radius <= nearPlane)
+	{
+		range.min.x = 0;
+		range.min.y = 0;
+		range.max.x = LIGHT_CLUSTER_X - 1;
+		range.max.y = LIGHT_CLUSTER_Y - 1;
+		return true;
+	}
+
+	// Project the view space box around the sphere, its closest and farthest faces give the widest screen extent
+	f32 nearZ = depth - radius;
+	f32 farZ = depth + radius;
+	Maths::Vec2 ndcMin;
+	Maths::Vec2 ndcMax;
+	for (u8 i = 0; i < 2; i++)
+	{
+		f32 scale = projection.at(i, i);
+		f32 low = (viewPos[i] - radius) * scale;
+		f32 high = (viewPos[i] + radius) * scale;
+		f32 a = Maths::Util::MinF(Maths::Util::MinF(low / nearZ, low / farZ), Maths::Util::MinF(high / nearZ, high / farZ));
+		f32 b = Maths::Util::MaxF(Maths::Util::MaxF(low / nearZ, low / farZ), Maths::Util::MaxF(high / nearZ, high / farZ));
+		if (a > 1.0f || b < -1.0f) return false;
+		ndcMin[i] = a;
+		ndcMax[i] = b;
+	}
+	range.min.x = Maths::Util::IClamp(static_cast<s32>(floorf((ndcMin.x * 0.5f + 0.5f) * LIGHT_CLUSTER_X)), 0, LIGHT_CLUSTER_X - 1);
+	range.max.x = Maths::Util::IClamp(static_cast<s32>(floorf((ndcMax.x * 0.5f + 0.5f) * LIGHT_CLUSTER_X)), 0, LIGHT_CLUSTER_X - 1);
+	range.min.y = Maths::Util::IClamp(static_cast<s32>(floorf((ndcMin.y * 0.5f + 0.5f) * LIGHT_CLUSTER_Y)), 0, LIGHT_CLUSTER_Y - 1);
+	range.max.y = Maths::Util::IClamp(static_cast<s32>(floorf((ndcMax.y * 0.5f + 0.5f) * LIGHT_CLUSTER_Y)), 0, LIGHT_CLUSTER_Y - 1);
+	return true;
+}
+
+void VulkanRenderer::BuildLightClusters(LightFrameData& frame, Uniform::LightFragmentUniform& fragmentData)
+{
+	const Maths::Mat4 view = currentCamera->GetViewMatrix();
+	const Maths::Mat4 projection = currentCamera->GetProjectionMatrix();
+	f32 logRange = logf(currentCamera->farPlane / currentCamera->nearPlane);
+	fragmentData.viewDir = (currentCamera->focus - currentCamera->position).UnitVector();
+	fragmentData.sliceScale = LIGHT_CLUSTER_Z / logRange;
+	fragmentData.sliceBias = -LIGHT_CLUSTER_Z * logf(currentCamera->nearPlane) / logRange;
+
+	// Count the lights of every cluster, point lights in even slots and spot lights in odd slots
+	std::fill(lightClusterCursors.begin(), lightClusterCursors.end(), 0);
+	lightRanges.resize(pLights.size() + sLights.size());
+	u32 indexTotal = 0;
+	for (u64 i = 0; i < lightRanges.size(); i++)
+	{
+		LightClusterRange& range = lightRanges[i];
+		bool visible;
+		if (i < pLights.size())
+		{
+			visible = GetLightClusterRange(pLights[i]->Position, pLights[i]->Radius, view, projection, fragmentData, range);
+		}
+		else
+		{
+			const auto* spot = sLights[i - pLights.size()];
+			visible = GetLightClusterRange(spot->Position + spot->Direction * spot->BoundOffset, spot->BoundRadius, view, projection, fragmentData, range);
+		}
+		if (!visible)
+		{
+			range.min = Maths::IVec3(1, 1, 1);
+			range.max = Maths::IVec3();
+			continue;
+		}
+		u32 slot = i < pLights.size() ? 0 : 1;
+		for (s32 z = range.min.z; z <= range.max.z; z++)
+		{
+			for (s32 y = range.min.y; y <= range.max.y; y++)
+			{
+				for (s32 x = range.min.x; x <= range.max.x; x++)
+				{
+					lightClusterCursors[((z * LIGHT_CLUSTER_Y + y) * LIGHT_CLUSTER_X + x) * 2 + slot]++;
+				}
+			}
+		}
+		indexTotal += static_cast<u32>((range.max.x - range.min.x + 1) * (range.max.y - range.min.y + 1) * (range.max.z - range.min.z + 1));
+	}
+
+	// A replaced buffer starts empty, the passes already recorded keep the old one
+	if (ReserveLightStorage(frame.clusters, (frame.clusterCount + LIGHT_CLUSTER_COUNT) * sizeof(Uniform::LightCluster))) frame.clusterCount = 0;
+	if (ReserveLightStorage(frame.indices, (frame.indexCount + indexTotal) * sizeof(u32))) frame.indexCount = 0;
+	Uniform::LightCluster* clusters = static_cast<Uniform::LightCluster*>(frame.clusters.data) + frame.clusterCount;
+	u32* indices = static_cast<u32*>(frame.indices.data);
+	u32 offset = frame.indexCount;
+	for (u32 i = 0; i < LIGHT_CLUSTER_COUNT; i++)
+	{
+		clusters[i].offset = offset;
+		clusters[i].pointCount = lightClusterCursors[i * 2];
+		clusters[i].spotCount = lightClusterCursors[i * 2 + 1];
+		lightClusterCursors[i * 2] = offset;
+		lightClusterCursors[i * 2 + 1] = offset + clusters[i].pointCount;
+		offset += clusters[i].pointCount + clusters[i].spotCount;
+	}
+	for (u64 i = 0; i < lightRanges.size(); i++)
+	{
+		const LightClusterRange& range = lightRanges[i];
+		u32 slot = i < pLights.size() ? 0 : 1;
+		u32 index = static_cast<u32>(i < pLights.size() ? i : i - pLights.size());
+		for (s32 z = range.min.z; z <= range.max.z; z++)
+		{
+			for (s32 y = range.min.y; y <= range.max.y; y++)
+			{
+				for (s32 x = range.min.x; x <= range.max.x; x++)
+				{
+					indices[lightClusterCursors[((z * LIGHT_CLUSTER_Y + y) * LIGHT_CLUSTER_X + x) * 2 + slot]++] = index;
+				}
+			}
+		}
+	}
+	fragmentData.clusterBase = frame.clusterCount;
+	frame.clusterCount += LIGHT_CLUSTER_COUNT;
+	frame.indexCount = offset;
 }
 
 #pragma region
@@ -849,8 +2524,23 @@ void VulkanRenderer::UnLoadShaderProgram(Resources::ShaderProgram* p_shader)
 	vkDestroyPipeline(device, p_shader->program.pipeline.pipeline, nullptr);
 	vkDestroyPipelineLayout(device, p_shader->program.pipeline.pipelineLayout, nullptr);
 
+	vkDestroyPipeline(device, p_shader->program.compactPipeline.pipeline, nullptr);
+	vkDestroyPipelineLayout(device, p_shader->program.compactPipeline.pipelineLayout, nullptr);
+
+	vkDestroyPipeline(device, p_shader->program.packedPipeline.pipeline, nullptr);
+	vkDestroyPipelineLayout(device, p_shader->program.packedPipeline.pipelineLayout, nullptr);
+
+	vkDestroyPipeline(device, p_shader->program.packedCompactPipeline.pipeline, nullptr);
+	vkDestroyPipelineLayout(device, p_shader->program.packedCompactPipeline.pipelineLayout, nullptr);
+
 	p_shader->program.pipeline.pipeline			= VK_NULL_HANDLE;
 	p_shader->program.pipeline.pipelineLayout	= VK_NULL_HANDLE;
+	p_shader->program.compactPipeline.pipeline			= VK_NULL_HANDLE;
+	p_shader->program.compactPipeline.pipelineLayout	= VK_NULL_HANDLE;
+	p_shader->program.packedPipeline.pipeline			= VK_NULL_HANDLE;
+	p_shader->program.packedPipeline.pipelineLayout		= VK_NULL_HANDLE;
+	p_shader->program.packedCompactPipeline.pipeline		= VK_NULL_HANDLE;
+	p_shader->program.packedCompactPipeline.pipelineLayout	= VK_NULL_HANDLE;
 }
 
 void VulkanRenderer::UnLoadModel(Resources::Model* p_model)
@@ -860,9 +2550,15 @@ void VulkanRenderer::UnLoadModel(Resources::Model* p_model)
 
 void VulkanRenderer::UnLoadTexture(Resources::StaticTexture* p_texture)
 {
-	vkDestroyImageView(device, p_texture->renderTexture.imageView.imageView, nullptr);
-	vkDestroyImage(device, p_texture->renderTexture.textureImage, nullptr);
-	vkFreeMemory(device, p_texture->renderTexture.textureImageMemory, nullptr);
+	VkImageView view = p_texture->renderTexture.imageView.imageView;
+	VkImage image = p_texture->renderTexture.textureImage;
+	VkDeviceMemory memory = p_texture->renderTexture.textureImageMemory;
+	QueueDeletion([this, view, image, memory]()
+	{
+		vkDestroyImageView(device, view, nullptr);
+		vkDestroyImage(device, image, nullptr);
+		vkFreeMemory(device, memory, nullptr);
+	});
 
 	p_texture->renderTexture.textureImageMemory		= VK_NULL_HANDLE;
 	p_texture->renderTexture.imageView.imageView	= VK_NULL_HANDLE;
@@ -876,10 +2572,17 @@ void VulkanRenderer::UnLoadTextureSampler(Resources::TextureSampler* sampler)
 
 void VulkanRenderer::UnLoadCubeMap(Resources::StaticCubeMap* p_cubemap)
 {
-	vkDestroyImageView(device, p_cubemap->renderTexture.imageView.imageView, nullptr);
-	vkDestroyImageView(device, p_cubemap->cubeImageView.imageView.imageView, nullptr);
-	vkDestroyImage(device, p_cubemap->renderTexture.textureImage, nullptr);
-	vkFreeMemory(device, p_cubemap->renderTexture.textureImageMemory, nullptr);
+	VkImageView view = p_cubemap->renderTexture.imageView.imageView;
+	VkImageView cubeView = p_cubemap->cubeImageView.imageView.imageView;
+	VkImage image = p_cubemap->renderTexture.textureImage;
+	VkDeviceMemory memory = p_cubemap->renderTexture.textureImageMemory;
+	QueueDeletion([this, view, cubeView, image, memory]()
+	{
+		vkDestroyImageView(device, view, nullptr);
+		vkDestroyImageView(device, cubeView, nullptr);
+		vkDestroyImage(device, image, nullptr);
+		vkFreeMemory(device, memory, nullptr);
+	});
 
 	p_cubemap->renderTexture.imageView.imageView = VK_NULL_HANDLE;
 	p_cubemap->cubeImageView.imageView.imageView = VK_NULL_HANDLE;
@@ -889,25 +2592,61 @@ void VulkanRenderer::UnLoadCubeMap(Resources::StaticCubeMap* p_cubemap)
 
 void VulkanRenderer::UnLoadSkinnedModel(Resources::SkinnedModel* p_model)
 {
-	// TODO
+	UnLoadModel(p_model);
 }
 
 void VulkanRenderer::UnloadMesh(Resources::Mesh* pMesh)
 {
+	geometryPool.Release(*this, pMesh->rendererMesh);
 	FreeVertexBuffer(pMesh->rendererMesh.vertexBuffer);
 	FreeIndiceBuffer(pMesh->rendererMesh.indexBuffer);
+	if (pMesh->rendererMesh.skinBuffer.handle) FreeVertexBuffer(pMesh->rendererMesh.skinBuffer);
 }
 
 void VulkanRenderer::FreeVertexBuffer(VertexBuffer& pBuffer)
 {
-	vkFreeMemory(device, pBuffer.memory, nullptr);
-	vkDestroyBuffer(device, pBuffer.handle, nullptr);
+	VertexBuffer buffer = pBuffer;
+	QueueDeletion([this, buffer]()
+	{
+		vkFreeMemory(device, buffer.memory, nullptr);
+		vkDestroyBuffer(device, buffer.handle, nullptr);
+	});
+	pBuffer.handle = VK_NULL_HANDLE;
+	pBuffer.memory = VK_NULL_HANDLE;
 }
 
 void VulkanRenderer::FreeIndiceBuffer(IndiceBuffer& pBuffer)
 {
-	vkFreeMemory(device, pBuffer.memory, nullptr);
-	vkDestroyBuffer(device, pBuffer.handle, nullptr);
+	IndiceBuffer buffer = pBuffer;
+	QueueDeletion([this, buffer]()
+	{
+		vkFreeMemory(device, buffer.memory, nullptr);
+		vkDestroyBuffer(device, buffer.handle, nullptr);
+	});
+	pBuffer.handle = VK_NULL_HANDLE;
+	pBuffer.memory = VK_NULL_HANDLE;
+}
+
+void VulkanRenderer::QueueDeletion(std::function<void()> deletion)
+{
+	std::lock_guard lock(deletionMutex);
+	// The next submission is the last one that may still reference the resource, whether it is being recorded or not
+	deletionQueue.push_back({ submittedFrames + 1, std::move(deletion) });
+}
+
+void VulkanRenderer::FlushDeletionQueue(u64 completedFrame)
+{
+	std::vector<PendingDeletion> ready;
+	{
+		std::lock_guard lock(deletionMutex);
+		auto retired = std::stable_partition(deletionQueue.begin(), deletionQueue.end(), [completedFrame](const PendingDeletion& pending) { return pending.frame <= completedFrame; });
+		ready.assign(std::make_move_iterator(deletionQueue.begin()), std::make_move_iterator(retired));
+		deletionQueue.erase(deletionQueue.begin(), retired);
+	}
+	for (auto& pending : ready)
+	{
+		pending.deletion();
+	}
 }
 
 #pragma endregion Unload Functions
@@ -932,7 +2671,24 @@ void VulkanRenderer::CleanupSwapChain()
 	{
 		framebuffer.DeleteFrameBuffer(device, false);
 	}
-	vkDestroySwapchainKHR(device, swapChain, nullptr);
+	if (!headless)
+	{
+		vkDestroySwapchainKHR(device, swapChain, nullptr);
+		return;
+	}
+	for (u64 i = 0; i < offscreenMemory.size(); i++)
+	{
+		vkDestroyImage(device, swapChainFramebuffers[i].rendererTex.textureImage, nullptr);
+		vkFreeMemory(device, offscreenMemory[i], nullptr);
+	}
+	offscreenMemory.clear();
+	vkDestroyBuffer(device, captureBuffer, nullptr);
+	vkFreeMemory(device, captureMemory, nullptr);
+	captureBuffer = VK_NULL_HANDLE;
+	captureMemory = VK_NULL_HANDLE;
+	captureData = nullptr;
+	capturePending = false;
+	captureReady = false;
 }
 
 void VulkanRenderer::PreInit()
@@ -945,6 +2701,7 @@ void VulkanRenderer::InitVulkan(GLFWwindow* window, Maths::IVec2 defaultResoluti
 {
 	if(!pInitEditor)
 		enableValidationLayers = false;
+	presentsMainFrameBuffer = !pInitEditor;
 	targetResolution = defaultResolution;
 	targetVSync = defaultVSync;
 	PickPhysicalDevice();
@@ -953,18 +2710,29 @@ void VulkanRenderer::InitVulkan(GLFWwindow* window, Maths::IVec2 defaultResoluti
 	CreateImageViews();
 
 	VkImageLayout windowImageLayout = pInitEditor ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	if (headless) windowImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 	
 	CreateRenderPass(windowRenderPass, windowImageLayout, swapChainImageFormat, 1, false, false, true);
 
-	CreateRenderPass(geometryRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FORMAT_R32G32B32A32_SFLOAT, 3, true, true, true);
-	CreateRenderPass(lightRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FORMAT_R32G32B32A32_SFLOAT, 2, false, false, false);
-	CreateRenderPass(postRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FORMAT_R32G32B32A32_SFLOAT, 2, false, false, false);
-	CreateRenderPass(objectRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_FORMAT_R32_UINT, 1);
+	// The last attachment holds the id of the object drawn on each pixel, cleared to 0 for none
+	std::vector<VkFormat> fullFormats = { VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT, VK_FORMAT_R32_UINT };
+	CreateRenderPass(geometryRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, fullFormats, true, true, true);
+	CreateRenderPass(geometryLoadRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, fullFormats, true, true, false);
+	// Compact layout : sRGB albedo, octahedral normal and packed material parameters
+	compactNormalFormat = FindSupportedFormat({ VK_FORMAT_R16G16_SNORM, VK_FORMAT_R16G16_SFLOAT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+	std::vector<VkFormat> compactFormats = { VK_FORMAT_R8G8B8A8_SRGB, compactNormalFormat, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R32_UINT };
+	CreateRenderPass(geometryCompactRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, compactFormats, true, true, true);
+	CreateRenderPass(geometryCompactLoadRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, compactFormats, true, true, false);
+	// Lighting and post-process targets only need half precision, full floats are kept as a fallback
+	hdrFormat = FindSupportedFormat({ VK_FORMAT_R16G16B16A16_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT }, VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BLEND_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
+	CreateRenderPass(lightRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, hdrFormat, 2, true, true, false, true);
+	CreateRenderPass(postRenderPass, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, hdrFormat, 2, false, false, false);
 	//CreateShadowPass();
 	mainUniform.CreateDescriptorSetLayout(device, physicalDevice);
 	lightUniform.CreateDescriptorSetLayout(device, physicalDevice);
 	postUniform.CreateDescriptorSetLayout(device, physicalDevice);
 	windowUniform.CreateDescriptorSetLayout(device, physicalDevice);
+	indirectUniform.CreateDescriptorSetLayout(device, physicalDevice);
 
 	//CreateShadowPipeline();
 	CreateCommandPool(&graphicCommandPool, queueFamilyIndices.graphicsFamily.value());
@@ -1012,8 +2780,11 @@ void VulkanRenderer::PickPhysicalDevice()
 u32 VulkanRenderer::RateDeviceSuitability(VkPhysicalDevice device)
 {
 	if (!CheckDeviceExtensionSupport(device)) return 0;
-	SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
-	if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) return 0;
+	if (!headless)
+	{
+		SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
+		if (swapChainSupport.formats.empty() || swapChainSupport.presentModes.empty()) return 0;
+	}
 
 	QueueFamilyIndices indices = FindQueueFamilies(device);
 
@@ -1024,7 +2795,12 @@ u32 VulkanRenderer::RateDeviceSuitability(VkPhysicalDevice device)
 	VkPhysicalDeviceFeatures deviceFeatures;
 	vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
 
-	if (!deviceFeatures.geometryShader || !deviceFeatures.samplerAnisotropy || !deviceFeatures.fillModeNonSolid || !deviceFeatures.wideLines || !deviceFeatures.shaderFloat64)
+	if (!deviceFeatures.samplerAnisotropy || !deviceFeatures.fillModeNonSolid || !deviceFeatures.shaderFloat64)
+	{
+		return 0;
+	}
+	// Software rasterizers may lack them, headless rendering only loses the debug line widths
+	if (!headless && (!deviceFeatures.geometryShader || !deviceFeatures.wideLines))
 	{
 		return 0;
 	}
@@ -1056,7 +2832,8 @@ QueueFamilyIndices VulkanRenderer::FindQueueFamilies(VkPhysicalDevice device)
 	for (const auto& queueFamily : queueFamilies)
 	{
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+		if (headless) presentSupport = (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+		else vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
 		if (presentSupport)
 		{
 			indices.presentFamily = i;
@@ -1075,6 +2852,8 @@ QueueFamilyIndices VulkanRenderer::FindQueueFamilies(VkPhysicalDevice device)
 		}
 		i++;
 	}
+	// Devices without a dedicated transfer family upload from the graphics queue
+	if (headless && !indices.transferFamily.has_value()) indices.transferFamily = indices.graphicsFamily;
 	return indices;
 }
 
@@ -1096,11 +2875,55 @@ void VulkanRenderer::CreateLogicalDevice()
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	// The 1.2 feature structure is only known to devices exposing 1.2, older ones draw without the count buffer
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	bool hasVulkan12 = deviceProperties.apiVersion >= VK_API_VERSION_1_2;
+	VkPhysicalDeviceVulkan12Features supported12{};
+	supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	VkPhysicalDeviceFeatures2 supported{};
+	supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	supported.pNext = hasVulkan12 ? &supported12 : nullptr;
+	if (deviceProperties.apiVersion >= VK_API_VERSION_1_1)
+	{
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+	}
+	else
+	{
+		vkGetPhysicalDeviceFeatures(physicalDevice, &supported.features);
+	}
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 	deviceFeatures.fillModeNonSolid = VK_TRUE;
-	deviceFeatures.wideLines = VK_TRUE;
+	deviceFeatures.wideLines = supported.features.wideLines;
 	deviceFeatures.shaderFloat64 = VK_TRUE;
+	if (!supported.features.wideLines)
+	{
+		lineRange = Maths::Vec2(1.0f);
+		currentWidth = 1.0f;
+	}
+	// GPU driven draws index the object buffer with firstInstance, the count buffer and multi draw only remove extra work
+	deviceFeatures.drawIndirectFirstInstance = supported.features.drawIndirectFirstInstance;
+	deviceFeatures.multiDrawIndirect = supported.features.multiDrawIndirect;
+	indirectSupported = supported.features.drawIndirectFirstInstance;
+	hasMultiDrawIndirect = supported.features.multiDrawIndirect;
+	deviceFeatures.textureCompressionBC = supported.features.textureCompressionBC;
+	hasTextureCompressionBC = supported.features.textureCompressionBC;
+	hasDrawIndirectCount = hasVulkan12 && supported12.drawIndirectCount;
+	// The profiler statistics query stays active while the secondary command buffers of a pass execute
+	deviceFeatures.pipelineStatisticsQuery = supported.features.pipelineStatisticsQuery && supported.features.inheritedQueries;
+	deviceFeatures.inheritedQueries = deviceFeatures.pipelineStatisticsQuery;
+	hasPipelineStatistics = deviceFeatures.pipelineStatisticsQuery;
+
+	VkPhysicalDeviceVulkan12Features features12{};
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	features12.drawIndirectCount = hasDrawIndirectCount;
+
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = hasVulkan12 ? &features12 : nullptr;
+	features.features = deviceFeatures;
 
 	VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -1108,9 +2931,18 @@ void VulkanRenderer::CreateLogicalDevice()
 	createInfo.queueCreateInfoCount = static_cast<u32>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-	createInfo.pEnabledFeatures = &deviceFeatures;
+	// Devices older than 1.1 do not read a features structure from the chain
+	if (deviceProperties.apiVersion >= VK_API_VERSION_1_1)
+	{
+		createInfo.pNext = &features;
+		createInfo.pEnabledFeatures = nullptr;
+	}
+	else
+	{
+		createInfo.pEnabledFeatures = &features.features;
+	}
 
-	createInfo.enabledExtensionCount = static_cast<u32>(deviceExtensions.size());
+	createInfo.enabledExtensionCount = headless ? 0 : static_cast<u32>(deviceExtensions.size());
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
 	if (enableValidationLayers)
@@ -1251,6 +3083,8 @@ bool VulkanRenderer::CheckValidationLayerSupport()
 
 bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice device)
 {
+	// The swap chain is the only required extension
+	if (headless) return true;
 	u32 extensionCount;
 	vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
 
@@ -1290,11 +3124,14 @@ void VulkanRenderer::SetupDebugMessenger()
 
 std::vector<const char*> VulkanRenderer::GetRequiredExtensions()
 {
-	u32 glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	std::vector<const char*> extensions;
+	if (!headless)
+	{
+		u32 glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	if (enableValidationLayers)
 	{
@@ -1376,6 +3213,11 @@ VkExtent2D VulkanRenderer::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capa
 
 void VulkanRenderer::CreateSwapChain(VkExtent2D resolution, bool defaultVSync)
 {
+	if (headless)
+	{
+		CreateOffscreenImages(resolution);
+		return;
+	}
 	SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(physicalDevice);
 
 	VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
@@ -1435,25 +3277,35 @@ void VulkanRenderer::CreateSwapChain(VkExtent2D resolution, bool defaultVSync)
 	swapChainExtent = extent;
 }
 
+void VulkanRenderer::CreateOffscreenImages(VkExtent2D resolution)
+{
+	imageCount = MAX_FRAMES_IN_FLIGHT;
+	swapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	swapChainExtent = resolution;
+	swapChainFramebuffers.resize(imageCount);
+	offscreenMemory.resize(imageCount);
+	for (u32 i = 0; i < imageCount; i++)
+	{
+		CreateImage(Maths::IVec2(resolution.width, resolution.height), 1, swapChainFramebuffers[i].rendererTex.textureImage, offscreenMemory[i], swapChainImageFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+
+	void* data = nullptr;
+	CreateBuffer(static_cast<VkDeviceSize>(resolution.width) * resolution.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, captureBuffer, captureMemory);
+	if (vkMapMemory(device, captureMemory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Could not map capture buffer !");
+		throw std::runtime_error("Could not map capture buffer !");
+	}
+	captureData = static_cast<const u8*>(data);
+}
+
 void VulkanRenderer::InitRendererData()
 {
-	mainFB.db = RendererDepthBuffer(targetResolution.x, targetResolution.y, device, true);
-	mainFB.nb = RendererBuffer(targetResolution.x, targetResolution.y, device, VK_FORMAT_R32G32B32A32_SFLOAT, false);
-	mainFB.pb = RendererBuffer(targetResolution.x, targetResolution.y, device, VK_FORMAT_R32G32B32A32_SFLOAT, false);
 	CreateSCFramebuffers();
 	CreateMainFrameBuffer();
 	mainFB.renderer = this;
 	mainFB.fb.rendererTex.isValid = false;
-	std::vector<RendererImageView> vec;
-	vec.push_back(mainFB.db.GetDepthImageView());
-	CreateFrameBuffer(objectFrameBuffer, vec, targetResolution, Maths::Vec4(), VK_FORMAT_R32_UINT, Resources::ShaderVariant::Object);
-	for (u8 i = 0; i < 3; i++)
-	{
-		mainFB.gb[i] = RendererBuffer(targetResolution.x, targetResolution.y, device, VK_FORMAT_R32G32B32A32_SFLOAT, true);
-		vec.clear();
-		vec.push_back(mainFB.gb[i].GetImageView());
-		CreateFrameBuffer(mainFB.lb[i], vec, targetResolution, Maths::Vec4(), VK_FORMAT_R32G32B32A32_SFLOAT, Resources::ShaderVariant::Light);
-	}
+	CreateLightBuffers(mainFB, targetResolution);
 	descriptorPools.resize(MAX_FRAMES_IN_FLIGHT);
 	uniformPools.resize(MAX_FRAMES_IN_FLIGHT);
 	ldescriptorPools.resize(MAX_FRAMES_IN_FLIGHT);
@@ -1461,6 +3313,8 @@ void VulkanRenderer::InitRendererData()
 	pdescriptorPools.resize(MAX_FRAMES_IN_FLIGHT);
 	puniformPools.resize(MAX_FRAMES_IN_FLIGHT);
 	wdescriptorPools.resize(MAX_FRAMES_IN_FLIGHT);
+	idescriptorPools.resize(MAX_FRAMES_IN_FLIGHT);
+	sdescriptorPools.resize(MAX_FRAMES_IN_FLIGHT);
 	for (s32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
 	{
 		descriptorPools[i] = FrameDescriptorPool();
@@ -1468,19 +3322,31 @@ void VulkanRenderer::InitRendererData()
 		uniformPools[i] = UniformBufferPool();
 		uniformPools[i].CreatePools(*this, 1024, &mainUniform);
 		ldescriptorPools[i] = FrameDescriptorPool();
-		ldescriptorPools[i].CreatePools(*this, 32, 1, 3);
+		ldescriptorPools[i].CreatePools(*this, 32, 1, 4, 5);
 		luniformPools[i] = UniformBufferPool();
 		luniformPools[i].CreatePools(*this, 32, &lightUniform);
 		pdescriptorPools[i] = FrameDescriptorPool();
-		pdescriptorPools[i].CreatePools(*this, 1024, 1, 2);
+		pdescriptorPools[i].CreatePools(*this, 1024, 1, 3);
 		puniformPools[i] = UniformBufferPool();
 		puniformPools[i].CreatePools(*this, 1024, &postUniform);
 		wdescriptorPools[i] = FrameDescriptorPool();
-		wdescriptorPools[i].CreatePools(*this, 1024, 0, 1);
+		wdescriptorPools[i].CreatePools(*this, 1024, 0, 2);
+		idescriptorPools[i] = FrameDescriptorPool();
+		idescriptorPools[i].CreatePools(*this, 256, 1, 4, 8);
+		sdescriptorPools[i] = FrameDescriptorPool();
+		sdescriptorPools[i].CreatePools(*this, 64, 0, 1, 4);
 	}
 
 	CreateSyncObjects();
 	CreateCommandBuffers();
+	CreateCommandRecorders();
+	CreateIndirectResources();
+	CreateLightResources();
+	CreateSkinningResources();
+	CreatePostResources();
+	CreatePickResources();
+	CreateDebugDrawResources();
+	profiler.Create(*this);
 }
 
 void VulkanRenderer::CreateImageViews()
@@ -1491,10 +3357,37 @@ void VulkanRenderer::CreateImageViews()
 	}
 }
 
-bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const VertexRendererShader* vertex, const FragmentRendererShader* fragment, RendererPipeline& pipeline, PipelineParams params)
+bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const VertexRendererShader* vertex, const FragmentRendererShader* fragment, RendererPipeline& pipeline, PipelineParams params, const Uniform::PixelStages* stages)
 {
 	std::vector<VkPipelineShaderStageCreateInfo> shaderStages = { vertex->GetStageInfo(), fragment->GetStageInfo() };
 
+	// Fragment shaders select their G-buffer encoding with specialization constant 0, the SPIR-V is shared by both layouts
+	// Constants 1 to MAX_PIXEL_STAGES hold the fused per-pixel operations, left to NONE by every other pipeline
+	struct
+	{
+		VkBool32 compactGBuffer;
+		u32 operations[Uniform::MAX_PIXEL_STAGES];
+	} specializationData = {};
+	specializationData.compactGBuffer = params & PipelineParams::COMPACT_GBUFFER ? VK_TRUE : VK_FALSE;
+	std::array<VkSpecializationMapEntry, 1 + Uniform::MAX_PIXEL_STAGES> specializationEntries{};
+	specializationEntries[0].constantID = 0;
+	specializationEntries[0].offset = 0;
+	specializationEntries[0].size = sizeof(VkBool32);
+	for (u32 i = 0; i < Uniform::MAX_PIXEL_STAGES; i++)
+	{
+		if (stages && i < stages->count) specializationData.operations[i] = static_cast<u32>(stages->operations[i]);
+		specializationEntries[i + 1].constantID = i + 1;
+		specializationEntries[i + 1].offset = static_cast<u32>(offsetof(decltype(specializationData), operations) + i * sizeof(u32));
+		specializationEntries[i + 1].size = sizeof(u32);
+	}
+
+	VkSpecializationInfo specializationInfo{};
+	specializationInfo.mapEntryCount = static_cast<u32>(specializationEntries.size());
+	specializationInfo.pMapEntries = specializationEntries.data();
+	specializationInfo.dataSize = sizeof(specializationData);
+	specializationInfo.pData = &specializationData;
+	shaderStages[1].pSpecializationInfo = &specializationInfo;
+
 	std::vector<VkDynamicState> dynamicStates =
 	{
 		VK_DYNAMIC_STATE_VIEWPORT,
@@ -1503,6 +3396,8 @@ bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const Vert
 	if (params & PipelineParams::STENCIL)
 	{
 		dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_REFERENCE);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK);
+		dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_WRITE_MASK);
 		dynamicStates.push_back(VK_DYNAMIC_STATE_STENCIL_OP);
 		dynamicStates.push_back(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE);
 	}
@@ -1514,14 +3409,25 @@ bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const Vert
 	dynamicState.dynamicStateCount = static_cast<u32>(dynamicStates.size());
 	dynamicState.pDynamicStates = dynamicStates.data();
 
-	auto bindingDescription = RendererVertex::GetBindingDescription();
-	auto attributeDescriptions = RendererVertex::GetAttributeDescriptions();
+	const VertexLayout layout = params & PipelineParams::PACKED_VERTEX ? VertexLayout::PACKED : VertexLayout::FULL;
+	std::vector<VkVertexInputBindingDescription> bindingDescriptions = { RendererVertex::GetBindingDescription(layout) };
+	auto vertexAttributes = RendererVertex::GetAttributeDescriptions(layout);
+	std::vector<VkVertexInputAttributeDescription> attributeDescriptions(vertexAttributes.begin(), vertexAttributes.end());
+	if (params & PipelineParams::INSTANCED)
+	{
+		// The model matrix of each instance follows the vertex attributes, one column per location
+		bindingDescriptions.push_back({ 1, sizeof(Maths::Mat4), VK_VERTEX_INPUT_RATE_INSTANCE });
+		for (u32 i = 0; i < 4; i++)
+		{
+			attributeDescriptions.push_back({ static_cast<u32>(vertexAttributes.size()) + i, 1, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<u32>(i * sizeof(Maths::Vec4)) });
+		}
+	}
 
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
 	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexBindingDescriptionCount = params & (PipelineParams::LIGHT_PASS | PipelineParams::POST_PROCESS | PipelineParams::WINDOW) ? 0 : 1;
+	vertexInputInfo.vertexBindingDescriptionCount = params & (PipelineParams::LIGHT_PASS | PipelineParams::POST_PROCESS | PipelineParams::WINDOW) ? 0 : static_cast<u32>(bindingDescriptions.size());
 	vertexInputInfo.vertexAttributeDescriptionCount = params & (PipelineParams::LIGHT_PASS | PipelineParams::POST_PROCESS | PipelineParams::WINDOW) ? 0 : static_cast<u32>(attributeDescriptions.size());
-	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
@@ -1570,7 +3476,7 @@ bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const Vert
 	multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
 	multisampling.alphaToOneEnable = VK_FALSE; // Optional
 
-	std::array<VkPipelineColorBlendAttachmentState, 3> colorBlendAttachment;
+	std::array<VkPipelineColorBlendAttachmentState, 4> colorBlendAttachment;
 	for (u32 i = 0; i < colorBlendAttachment.size(); i++)
 	{
 		colorBlendAttachment[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -1582,24 +3488,37 @@ bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const Vert
 		colorBlendAttachment[i].dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO; // Optional
 		colorBlendAttachment[i].alphaBlendOp = VK_BLEND_OP_ADD; // Optional
 	}
+	// Shaders that do not write the object id leave the one of the surface behind
+	colorBlendAttachment[3].colorWriteMask = params & PipelineParams::OBJECT_ID ? VK_COLOR_COMPONENT_R_BIT : 0;
 
 	VkPipelineColorBlendStateCreateInfo colorBlending{};
 	colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
 	colorBlending.logicOpEnable = VK_FALSE;
 	colorBlending.logicOp = VK_LOGIC_OP_COPY; // Optional
-	colorBlending.attachmentCount = params & PipelineParams::SHADOW ? 0 : (params & (PipelineParams::LIGHT_PASS | PipelineParams::POST_PROCESS) ? 2 : (params & PipelineParams::EXTRA_ATTACHMENT ? static_cast<u32>(colorBlendAttachment.size()) : 1));
+	colorBlending.attachmentCount = params & PipelineParams::SHADOW ? 0 : (params & PipelineParams::MIP_CHAIN ? 1 : (params & (PipelineParams::LIGHT_PASS | PipelineParams::POST_PROCESS) ? 2 : (params & PipelineParams::EXTRA_ATTACHMENT ? static_cast<u32>(colorBlendAttachment.size()) : 1)));
 	colorBlending.pAttachments = colorBlendAttachment.data();
 	colorBlending.blendConstants[0] = 0.0f; // Optional
 	colorBlending.blendConstants[1] = 0.0f; // Optional
 	colorBlending.blendConstants[2] = 0.0f; // Optional
 	colorBlending.blendConstants[3] = 0.0f; // Optional
 
+	// Indirect draws receive the view projection as a push constant, the model matrices are read from the object buffer
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(Maths::Mat4);
+	if (params & PipelineParams::PIXEL_STAGES)
+	{
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.size = sizeof(Uniform::PixelStageConstants);
+	}
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
-	pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
+	pipelineLayoutInfo.pushConstantRangeCount = params & (PipelineParams::INDIRECT | PipelineParams::PIXEL_STAGES) ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = params & (PipelineParams::INDIRECT | PipelineParams::PIXEL_STAGES) ? &pushConstantRange : nullptr;
 	pipelineLayoutInfo.setLayoutCount = 1;
-	pipelineLayoutInfo.pSetLayouts = params & PipelineParams::LIGHT_PASS ? &lightUniform.GetLayout() : (params & PipelineParams::POST_PROCESS ? &postUniform.GetLayout() : (params & PipelineParams::WINDOW ? &windowUniform.GetLayout() : &mainUniform.GetLayout()));
+	pipelineLayoutInfo.pSetLayouts = params & PipelineParams::LIGHT_PASS ? &lightUniform.GetLayout() : (params & PipelineParams::POST_PROCESS ? &postUniform.GetLayout() : (params & PipelineParams::WINDOW ? &windowUniform.GetLayout() : (params & PipelineParams::INDIRECT ? &indirectUniform.GetLayout() : &mainUniform.GetLayout())));
 
 	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipeline.pipelineLayout) != VK_SUCCESS)
 	{
@@ -1623,6 +3542,16 @@ bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const Vert
 	depthStencil.back.compareMask = 0xff;
 	depthStencil.back.writeMask = 0xff;
 	depthStencil.back.reference = 0;
+	if (params & PipelineParams::LIGHT_PASS)
+	{
+		// The depth buffer is bound read-only, its stencil splits the pixels between the light shader and the sky resolve
+		depthStencil.depthTestEnable = VK_FALSE;
+		depthStencil.depthWriteEnable = VK_FALSE;
+		depthStencil.stencilTestEnable = skyResolvePipeline.pipeline || (params & PipelineParams::SKY_RESOLVE) ? VK_TRUE : VK_FALSE;
+		depthStencil.back.compareMask = SKY_STENCIL_BIT;
+		depthStencil.back.writeMask = 0;
+		depthStencil.back.reference = params & PipelineParams::SKY_RESOLVE ? SKY_STENCIL_BIT : 0;
+	}
 	depthStencil.front = depthStencil.back;
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{};
@@ -1652,10 +3581,51 @@ bool VulkanRenderer::CreateGraphicsPipeline(VkRenderPass& targetPass, const Vert
 	return true;
 }
 
-void VulkanRenderer::CreateRenderPass(VkRenderPass& targetPass, VkImageLayout finalLayout, VkFormat format, u32 attCount, bool hasDepth, bool hasStencil, bool clearBuffers)
+bool VulkanRenderer::CreateComputePipeline(const ComputeRendererShader* compute, RendererPipeline& pipeline, const VkDescriptorSetLayout& layout, u32 pushConstantSize)
+{
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantSize ? &pushConstantRange : nullptr;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &layout;
+
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipeline.pipelineLayout) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to create compute pipeline layout!");
+		return false;
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = compute->GetStageInfo();
+	pipelineInfo.layout = pipeline.pipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline.pipeline) != VK_SUCCESS)
+	{
+		LOG(DEBUG_LEVEL::LERROR, "Failed to create compute pipeline!");
+		return false;
+	}
+	return true;
+}
+
+void VulkanRenderer::CreateRenderPass(VkRenderPass& targetPass, VkImageLayout finalLayout, VkFormat format, u32 attCount, bool hasDepth, bool hasStencil, bool clearBuffers, bool readOnlyDepth)
 {
+	CreateRenderPass(targetPass, finalLayout, std::vector<VkFormat>(attCount, format), hasDepth, hasStencil, clearBuffers, readOnlyDepth);
+}
+
+void VulkanRenderer::CreateRenderPass(VkRenderPass& targetPass, VkImageLayout finalLayout, const std::vector<VkFormat>& formats, bool hasDepth, bool hasStencil, bool clearBuffers, bool readOnlyDepth)
+{
+	u32 attCount = static_cast<u32>(formats.size());
 	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = format;
+	colorAttachment.format = formats[0];
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	colorAttachment.loadOp = clearBuffers ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
@@ -1668,11 +3638,18 @@ void VulkanRenderer::CreateRenderPass(VkRenderPass& targetPass, VkImageLayout fi
 	depthAttachment.format = FindDepthFormat();
 	depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
 	depthAttachment.loadOp = clearBuffers ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
-	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	// Scene passes keep their depth, it is reduced into the depth pyramid for occlusion culling
+	depthAttachment.storeOp = hasStencil ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.stencilLoadOp = hasStencil ? (clearBuffers ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD) : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	depthAttachment.stencilStoreOp = hasStencil ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
 	depthAttachment.initialLayout = clearBuffers ? VK_IMAGE_LAYOUT_UNDEFINED : finalLayout;
 	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	if (readOnlyDepth)
+	{
+		// Tested but never written, it can be sampled by the same pass
+		depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+		depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+	}
 
 	std::vector<VkAttachmentReference> colorAtt;
 	colorAtt.resize(attCount);
@@ -1686,7 +3663,7 @@ void VulkanRenderer::CreateRenderPass(VkRenderPass& targetPass, VkImageLayout fi
 
 	VkAttachmentReference depthAttachmentRef{};
 	depthAttachmentRef.attachment = 1;
-	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachmentRef.layout = readOnlyDepth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
 	VkSubpassDescription subpass{};
 	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
@@ -1700,6 +3677,7 @@ void VulkanRenderer::CreateRenderPass(VkRenderPass& targetPass, VkImageLayout fi
 	for (u32 i = 1; i < attCount; i++)
 	{
 		attachments.push_back(colorAttachment);
+		attachments.back().format = formats[i];
 	}
 	VkRenderPassCreateInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -1712,12 +3690,23 @@ void VulkanRenderer::CreateRenderPass(VkRenderPass& targetPass, VkImageLayout fi
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
 	dependency.dstSubpass = 0;
 	dependency.srcAccessMask = 0;
-	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	// Post-process targets are written right after being sampled by the previous pass
+	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
 	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
-	renderPassInfo.dependencyCount = 1;
-	renderPassInfo.pDependencies = &dependency;
+	// And sampled by the next one
+	VkSubpassDependency outDependency{};
+	outDependency.srcSubpass = 0;
+	outDependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+	outDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	outDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	outDependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	outDependency.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	std::array<VkSubpassDependency, 2> dependencies = { dependency, outDependency };
+	renderPassInfo.dependencyCount = static_cast<u32>(dependencies.size());
+	renderPassInfo.pDependencies = dependencies.data();
 
 	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &targetPass) != VK_SUCCESS)
 	{
@@ -1762,9 +3751,6 @@ void VulkanRenderer::CreateFrameBuffer(RendererFrameBuffer& buf, const std::vect
 	case Resources::ShaderVariant::ShadowCube:
 		// TODO
 		break;
-	case Resources::ShaderVariant::Object:
-		buf = RendererFrameBuffer(resolution, attachments, objectRenderPass, device, format);
-		break;
 	case Resources::ShaderVariant::Halo:
 		// TODO
 		break;
@@ -1772,7 +3758,7 @@ void VulkanRenderer::CreateFrameBuffer(RendererFrameBuffer& buf, const std::vect
 		buf = RendererFrameBuffer(resolution, attachments, lightRenderPass, device, format, true);
 		break;
 	case Resources::ShaderVariant::PostProcess:
-		buf = RendererFrameBuffer(resolution, attachments, postRenderPass, device, format);
+		buf = RendererFrameBuffer(resolution, attachments, postRenderPass, device, format, true);
 		break;
 	default:
 		break;
@@ -1783,15 +3769,48 @@ void VulkanRenderer::CreateFrameBuffer(RendererFrameBuffer& buf, const std::vect
 
 void VulkanRenderer::CreateMainFrameBuffer()
 {
+	CreateGeometryBuffers(mainFB, targetResolution, true);
+}
+
+void VulkanRenderer::CreateGeometryBuffers(LowRenderer::FrameBuffer& frameBuffer, Maths::IVec2 resolution, bool transitDepth)
+{
+	bool compact = frameBuffer.gbufferLayout == LowRenderer::GBufferLayout::COMPACT;
+	frameBuffer.db = RendererDepthBuffer(resolution.x, resolution.y, device, transitDepth);
+	frameBuffer.nb = RendererBuffer(resolution.x, resolution.y, device, compact ? compactNormalFormat : VK_FORMAT_R32G32B32A32_SFLOAT, false);
+	frameBuffer.pb = RendererBuffer(resolution.x, resolution.y, device, compact ? VK_FORMAT_R8G8B8A8_UNORM : VK_FORMAT_R32G32B32A32_SFLOAT, false);
+	frameBuffer.ib = RendererBuffer(resolution.x, resolution.y, device, VK_FORMAT_R32_UINT, false);
 	std::vector<VkImageView> attachments =
 	{
-		mainFB.db.GetDepthImageView().imageView,
-		mainFB.nb.GetImageView().imageView,
-		mainFB.pb.GetImageView().imageView,
+		frameBuffer.db.GetDepthImageView().imageView,
+		frameBuffer.nb.GetImageView().imageView,
+		frameBuffer.pb.GetImageView().imageView,
+		frameBuffer.ib.GetImageView().imageView,
 	};
-	mainFB.fb = RendererFrameBuffer(targetResolution, attachments, geometryRenderPass, device, VK_FORMAT_R32G32B32A32_SFLOAT);
-	mainFB.fb.rendererTex.CreateGuiView(Resources::TextureSampler::GetDefaultSampler()->renderSampler);
-	mainFB.UpdateClearColor();
+	frameBuffer.fb = RendererFrameBuffer(resolution, attachments, GetGeometryRenderPass(&frameBuffer), device, compact ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R32G32B32A32_SFLOAT);
+	frameBuffer.fb.rendererTex.CreateGuiView(Resources::TextureSampler::GetDefaultSampler()->renderSampler);
+	frameBuffer.UpdateClearColor();
+}
+
+void VulkanRenderer::CreateLightBuffers(LowRenderer::FrameBuffer& frameBuffer, Maths::IVec2 resolution)
+{
+	std::vector<RendererImageView> vec;
+	for (u8 i = 0; i < 3; i++)
+	{
+		CreateBuffer(frameBuffer.gb[i], resolution, true);
+		vec.clear();
+		if (i == 0) vec.push_back(frameBuffer.db.GetDepthImageView());
+		vec.push_back(frameBuffer.gb[i].GetImageView());
+		CreateFrameBuffer(frameBuffer.lb[i], vec, resolution, Maths::Vec4(), hdrFormat, i == 0 ? Resources::ShaderVariant::Light : Resources::ShaderVariant::PostProcess);
+	}
+}
+
+VkRenderPass& VulkanRenderer::GetGeometryRenderPass(const LowRenderer::FrameBuffer* frameBuffer, bool load)
+{
+	if (frameBuffer && frameBuffer->gbufferLayout == LowRenderer::GBufferLayout::COMPACT)
+	{
+		return load ? geometryCompactLoadRenderPass : geometryCompactRenderPass;
+	}
+	return load ? geometryLoadRenderPass : geometryRenderPass;
 }
 
 void VulkanRenderer::CreateDepthBuffer(Renderer::RendererDepthBuffer& db, Maths::IVec2 resolution)
@@ -1801,22 +3820,25 @@ void VulkanRenderer::CreateDepthBuffer(Renderer::RendererDepthBuffer& db, Maths:
 
 void VulkanRenderer::CreateBuffer(Renderer::RendererBuffer& b, Maths::IVec2 resolution, bool transitLayout)
 {
-	b = RendererBuffer(resolution.x, resolution.y, device, VK_FORMAT_R32G32B32A32_SFLOAT, transitLayout);
+	b = RendererBuffer(resolution.x, resolution.y, device, hdrFormat, transitLayout);
 }
 
 void VulkanRenderer::DeleteFrameBuffer(Renderer::RendererFrameBuffer& buf)
 {
-	buf.DeleteFrameBuffer(device);
+	RendererFrameBuffer old = buf;
+	QueueDeletion([this, old]() mutable { old.DeleteFrameBuffer(device); });
 }
 
 void VulkanRenderer::DeleteDepthBuffer(Renderer::RendererDepthBuffer& buf)
 {
-	buf.DeleteDepthBuffer(device);
+	RendererDepthBuffer old = buf;
+	QueueDeletion([this, old]() mutable { old.DeleteDepthBuffer(device); });
 }
 
 void VulkanRenderer::DeleteBuffer(Renderer::RendererBuffer& buf)
 {
-	buf.DeleteBuffer(device);
+	RendererBuffer old = buf;
+	QueueDeletion([this, old]() mutable { old.DeleteBuffer(device); });
 }
 
 void VulkanRenderer::CreateCommandPool(VkCommandPool* cmdPool, u32 index)
@@ -1849,6 +3871,21 @@ void VulkanRenderer::CreateCommandBuffers()
 	}
 }
 
+void VulkanRenderer::CreateCommandRecorders()
+{
+	recordThreads.Init();
+	commandRecorders.resize(MAX_FRAMES_IN_FLIGHT);
+	for (s32 i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+	{
+		commandRecorders[i].resize(recordThreads.GetThreadCount());
+		for (auto& recorder : commandRecorders[i])
+		{
+			CreateCommandPool(&recorder.pool, queueFamilyIndices.graphicsFamily.value());
+			recorder.descriptors.CreatePools(*this, 256);
+		}
+	}
+}
+
 void VulkanRenderer::BeginCommandBuffer()
 {
 	VkCommandBufferBeginInfo beginInfo{};
@@ -1860,15 +3897,13 @@ void VulkanRenderer::BeginCommandBuffer()
 		LOG(DEBUG_LEVEL::LERROR, "Failed to begin recording command buffer!");
 		throw std::runtime_error("Failed to begin recording command buffer!");
 	}
+	activeCommandBuffer = commandBuffers[currentFrame];
 }
 
-void VulkanRenderer::BeginRenderPass(VkRenderPass& targetPass, LowRenderer::FrameBuffer* frameBuffer)
+void VulkanRenderer::SetRenderTarget(LowRenderer::FrameBuffer* frameBuffer)
 {
 	switch (activePassParams)
 	{
-	case LowRenderer::OBJECT:
-		activeRendererFrameBuffer = objectFrameBuffer;
-		break;
 	case LowRenderer::LIGHT:
 		activeRendererFrameBuffer = frameBuffer->lb[0];
 		break;
@@ -1879,32 +3914,124 @@ void VulkanRenderer::BeginRenderPass(VkRenderPass& targetPass, LowRenderer::Fram
 		activeRendererFrameBuffer = frameBuffer->fb;
 		break;
 	}
+	activeCommandBuffer = commandBuffers[currentFrame];
+	activeFrameBuffer = frameBuffer;
+}
+
+void VulkanRenderer::TransitionDepthBuffer(VkCommandBuffer cmd, RendererDepthBuffer& db, VkImageLayout newLayout)
+{
+	if (db.layout == newLayout) return;
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = db.layout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = db.texture.textureImage;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+	// The depth pyramid may have been reduced from it in between
+	vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+	db.layout = newLayout;
+}
+
+void VulkanRenderer::BeginRenderPass(VkRenderPass& targetPass, LowRenderer::FrameBuffer* frameBuffer)
+{
+	SetRenderTarget(frameBuffer);
+	BeginActiveRenderPass(targetPass, VK_SUBPASS_CONTENTS_INLINE);
+}
+
+void VulkanRenderer::BeginActiveRenderPass(VkRenderPass& targetPass, VkSubpassContents contents)
+{
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassInfo.renderPass = targetPass;
 	renderPassInfo.framebuffer = activeRendererFrameBuffer.buffer;
-	renderPassInfo.renderArea.extent.width = frameBuffer->GetResolution().x;
-	renderPassInfo.renderArea.extent.height = frameBuffer->GetResolution().y;
+	renderPassInfo.renderArea.extent.width = activeFrameBuffer->GetResolution().x;
+	renderPassInfo.renderArea.extent.height = activeFrameBuffer->GetResolution().y;
 	renderPassInfo.renderArea.offset = { 0, 0 };
 
 	renderPassInfo.clearValueCount = (u32)activeRendererFrameBuffer.GetClearValue().size();
 	renderPassInfo.pClearValues = activeRendererFrameBuffer.GetClearValue().data();
-	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	activeCommandBuffer = commandBuffers[currentFrame];
-	activeFrameBuffer = frameBuffer;
+	vkCmdBeginRenderPass(commandBuffers[currentFrame], &renderPassInfo, contents);
+}
+
+void VulkanRenderer::DrawIndexedMesh(const Resources::Mesh* mesh, const std::vector<const RendererTexture*>& textures, UniformElement& uniformE, u32 lod, VkBuffer vertices)
+{
+	if (!BindVertexLayout(mesh->rendererMesh.vertexLayout)) return;
+	RecordedCommand command;
+	command.type = RecordedCommandType::DRAW_INDEXED;
+	command.pipeline = activePipeline;
+	command.vertexBuffer = vertices ? vertices : mesh->rendererMesh.vertexBuffer.handle;
+	command.indexBuffer = mesh->rendererMesh.indexBuffer.handle;
+	command.indexType = mesh->rendererMesh.indexType;
+	command.indexOffset = mesh->rendererMesh.GetIndexSize() * mesh->GetLod(lod).indexOffset;
+	command.count = mesh->GetLod(lod).indexCount;
+	command.uniform = uniformE;
+	command.textures = textures;
+	SubmitCommand(std::move(command));
 }
 
-void VulkanRenderer::DrawIndexedMesh(const Resources::Mesh* mesh, VkDescriptorSet& meshDescriptor, UniformElement& uniformE)
+void VulkanRenderer::DrawMeshlets(const Resources::Mesh* mesh, const Maths::Mat4& m, const Maths::Mat4& mvp, const std::vector<const RendererTexture*>& textures, UniformElement& uniformE)
 {
-	VkBuffer vertexBuffers[] = { mesh->rendererMesh.vertexBuffer.handle };
-	VkDeviceSize offsets[] = { 0 };
-	std::array<u32, 2> uniformOffsets = { static_cast<u32>(uniformE.GetOffset() * mainUniform.GetTotalOffset()), static_cast<u32>(uniformE.GetOffset() * mainUniform.GetTotalOffset()) };
+	// Clip planes in object space, a visible point has x and y within w and z between 0 and w
+	Maths::Vec4 rows[4];
+	for (u8 i = 0; i < 4; i++)
+	{
+		rows[i] = Maths::Vec4(mvp.content[i], mvp.content[4 + i], mvp.content[8 + i], mvp.content[12 + i]);
+	}
+	const Maths::Vec4 planes[6] = { rows[3] + rows[0], rows[3] - rows[0], rows[3] + rows[1], rows[3] - rows[1], rows[2], rows[3] - rows[2] };
+	f32 planeScales[6];
+	for (u8 i = 0; i < 6; i++) planeScales[i] = planes[i].GetVector().GetLength();
 
-	vkCmdBindVertexBuffers(activeCommandBuffer, 0, 1, vertexBuffers, offsets);
-	vkCmdBindIndexBuffer(activeCommandBuffer, mesh->rendererMesh.indexBuffer.handle, 0, VK_INDEX_TYPE_UINT32);
-	vkCmdBindDescriptorSets(activeCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, activePipeline->pipelineLayout, 0, 1, &meshDescriptor, 2, uniformOffsets.data());
+	// Cones only hold for passes culling back faces, and for models that do not mirror the winding
+	const Maths::Vec4 viewpoint = GetViewpoint(mvp);
+	const f32 determinant = m.content[0] * (m.content[5] * m.content[10] - m.content[6] * m.content[9]) - m.content[4] * (m.content[1] * m.content[10] - m.content[2] * m.content[9]) + m.content[8] * (m.content[1] * m.content[6] - m.content[2] * m.content[5]);
+	const bool testCones = viewpoint.w != 0 && determinant > 0 && !(activePassParams & (LowRenderer::RenderPassType::SHADOWMAP | LowRenderer::RenderPassType::CUBEMAP | LowRenderer::RenderPassType::HALO | LowRenderer::RenderPassType::WIRE | LowRenderer::RenderPassType::LINE));
+
+	visibleMeshletIndices.clear();
+	u32 visibleMeshlets = 0;
+	for (auto& meshlet : mesh->meshlets)
+	{
+		bool visible = true;
+		for (u8 i = 0; i < 6 && visible; i++)
+		{
+			visible = planes[i].GetVector().DotProduct(meshlet.center) + planes[i].w >= -meshlet.radius * planeScales[i];
+		}
+		if (visible && testCones)
+		{
+			const Maths::Vec4 cone = meshlet.GetCone();
+			const Maths::Vec3 view = meshlet.center - viewpoint.GetVector();
+			visible = cone.w >= 1.0f || view.DotProduct(cone.GetVector().UnitVector()) < cone.w * view.GetLength() + meshlet.radius;
+		}
+		if (!visible) continue;
+		visibleMeshlets++;
+		visibleMeshletIndices.insert(visibleMeshletIndices.end(), mesh->indices.begin() + meshlet.indexOffset, mesh->indices.begin() + meshlet.indexOffset + meshlet.indexCount);
+	}
+	if (!visibleMeshlets) return;
+	if (visibleMeshlets == mesh->meshlets.size())
+	{
+		DrawIndexedMesh(mesh, textures, uniformE);
+		return;
+	}
 
-	vkCmdDrawIndexed(activeCommandBuffer, static_cast<u32>(mesh->GetIndexCount()), 1, 0, 0, 0);
+	// The visible ranges are copied as 32 bit indices whatever the type of the mesh index buffer
+	if (!BindVertexLayout(mesh->rendererMesh.vertexLayout)) return;
+	RecordedCommand command;
+	command.type = RecordedCommandType::DRAW_INDEXED;
+	command.pipeline = activePipeline;
+	command.vertexBuffer = mesh->rendererMesh.vertexBuffer.handle;
+	command.indexOffset = WriteTransientGeometry(visibleMeshletIndices.data(), sizeof(u32) * visibleMeshletIndices.size());
+	command.indexBuffer = transientGeometry[currentFrame].buffer;
+	command.count = static_cast<u32>(visibleMeshletIndices.size());
+	command.uniform = uniformE;
+	command.textures = textures;
+	SubmitCommand(std::move(command));
 }
 
 
@@ -2034,6 +4161,19 @@ void VulkanRenderer::SetStencilState(u8 compareValue, StencilState stateIn)
 	state = stateIn;
 }
 
+void VulkanRenderer::SetScissor(const Maths::Vec4& screenBounds)
+{
+	Maths::IVec2 res = activeFrameBuffer ? activeFrameBuffer->GetResolution() : targetResolution;
+	s32 minX = Maths::Util::IClamp(static_cast<s32>(floorf((screenBounds.x * 0.5f + 0.5f) * res.x)), 0, res.x);
+	s32 minY = Maths::Util::IClamp(static_cast<s32>(floorf((screenBounds.y * 0.5f + 0.5f) * res.y)), 0, res.y);
+	s32 maxX = Maths::Util::IClamp(static_cast<s32>(ceilf((screenBounds.z * 0.5f + 0.5f) * res.x)), minX, res.x);
+	s32 maxY = Maths::Util::IClamp(static_cast<s32>(ceilf((screenBounds.w * 0.5f + 0.5f) * res.y)), minY, res.y);
+	VkRect2D rect{};
+	rect.offset = { minX, minY };
+	rect.extent = { static_cast<u32>(maxX - minX), static_cast<u32>(maxY - minY) };
+	activeScissor = rect;
+}
+
 u32 VulkanRenderer::FindMemoryType(u32 typeFilter, VkMemoryPropertyFlags properties)
 {
 	VkPhysicalDeviceMemoryProperties memProperties;
@@ -2154,11 +4294,13 @@ void VulkanRenderer::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, V
 	vkBindBufferMemory(device, buffer, bufferMemory, 0);
 }
 
-void VulkanRenderer::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void VulkanRenderer::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset)
 {
 	VkCommandBuffer commandBuffer = BeginSingleTimeCommands(transferCommandPool);
 
 	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = srcOffset;
+	copyRegion.dstOffset = dstOffset;
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
 
@@ -2206,6 +4348,13 @@ void VulkanRenderer::CopyBufferToImage(VkBuffer buffer, VkImage image, u32 width
 	EndSingleTimeCommands(commandBuffer, transferCommandPool, transferQueue);
 }
 
+void VulkanRenderer::CopyBufferToImage(VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions)
+{
+	VkCommandBuffer commandBuffer = BeginSingleTimeCommands(transferCommandPool);
+	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<u32>(regions.size()), regions.data());
+	EndSingleTimeCommands(commandBuffer, transferCommandPool, transferQueue);
+}
+
 void VulkanRenderer::CopyImageToBuffer(VkBuffer buffer, VkImage image, Maths::IVec2 offset, Maths::IVec2 size)
 {
 	VkCommandBuffer commandBuffer = BeginSingleTimeCommands(transferCommandPool);
@@ -2466,75 +4615,31 @@ void VulkanRenderer::GenerateMipmaps(VkImage image, VkFormat imageFormat, Maths:
 
 void VulkanRenderer::UpdateUniformBuffer(UniformElement& element, const Resources::Material* mat, const Maths::Mat4& modelMatrix, const Maths::Mat4& mvp)
 {
-	Uniform::MainVertexUniform& vertexData = *element.GetVertexUniform(*this);
+	// Built on the stack and copied whole, the mapped memory is usually write combined
+	Uniform::MainVertexUniform vertexData;
 	vertexData.model = modelMatrix;
 	vertexData.mvp = mvp;
 	vertexData.cameraPos = currentCameraPos;
-	Uniform::MainFragmentUniform& fragmentData = *element.GetFragmentUniform(*this);
+	vertexData.objectID = objectID;
+	Uniform::MainFragmentUniform fragmentData;
 	fragmentData.matAmbient = mat->ambientColor;
 	fragmentData.matShininess = mat->shininess;
-	fragmentData.iTime = Core::App::GetInstance()->GetWindow().GetWindowTime();
-	// Not exactly sure why I don't need to flush theses buffers...
-	//FlushMappedMemory(element.GetMemory(), mainUniform.GetTotalOffset() * element.GetOffset(), mainUniform.GetTotalOffset());
-}
-
-void VulkanRenderer::UpdateUniformBuffer(UniformElement& element, const Maths::Mat4& mvp, u32 objectIndex)
-{
-	Uniform::MainVertexUniform& vertexData = *element.GetVertexUniform(*this);
-	vertexData.mvp = mvp;
-	vertexData.cameraPos = currentCameraPos;
-	Uniform::MainFragmentUniform& fragmentData = *element.GetFragmentUniform(*this);
-	fragmentData.matAmbient = Maths::Vec3();
-	fragmentData.iTime = Core::App::GetInstance()->GetWindow().GetWindowTime();
-	*reinterpret_cast<u32*>(&fragmentData.matAmbient.x) = objectIndex;
-
-	//FlushMappedMemory(element.GetMemory(), mainUniform.GetTotalOffset() * element.GetOffset(), mainUniform.GetTotalOffset());
+	fragmentData.iTime = frameTime;
+	*element.GetVertexUniform(*this) = vertexData;
+	*element.GetFragmentUniform(*this) = fragmentData;
 }
 
 void VulkanRenderer::UpdateLightUniformBuffer(UniformElement& element)
 {
 	Uniform::LightFragmentUniform& fragmentData = *element.GetLightFragmentUniform(*this);
+	LightFrameData& frame = lightFrames[currentFrame];
+	if (!frame.uploaded) UploadLights(frame);
 	fragmentData.viewPos = currentCameraPos;
-	fragmentData.dCount = dLights.size() < MAX_DIR_LIGHT ? (u32)dLights.size() : MAX_DIR_LIGHT;
-	for (u32 i = 0; i < fragmentData.dCount; i++)
-	{
-		fragmentData.dlights[i].Direction = dLights[i]->Direction;
-		fragmentData.dlights[i].Shininess = dLights[i]->Shininess;
-		fragmentData.dlights[i].Ambient = dLights[i]->AmbientColor;
-		fragmentData.dlights[i].Diffuse = dLights[i]->DiffuseColor;
-		fragmentData.dlights[i].Specular = dLights[i]->SpecularColor;
-	}
-	//if (fragmentData.dCount) FlushMappedMemory(element.GetMemory(), lightUniform.GetTotalOffset() * element.GetOffset(), sizeof(Uniform::DirectionalLight) * fragmentData.dCount);
-	fragmentData.pCount = pLights.size() < MAX_POINT_LIGHT ? (u32)pLights.size() : MAX_POINT_LIGHT;
-	for (u32 i = 0; i < fragmentData.pCount; i++)
-	{
-		f32 radius = (-pLights[i]->Linear + std::sqrtf(pLights[i]->Linear * pLights[i]->Linear - 4 * pLights[i]->Quadratic * (1.0f - (f32)(256.0 / 5.0) * 1.0f))) / (2 * pLights[i]->Quadratic);
-		fragmentData.plights[i].Position = pLights[i]->Position;
-		fragmentData.plights[i].Shininess = pLights[i]->Shininess;
-		fragmentData.plights[i].Ambient = pLights[i]->AmbientColor;
-		fragmentData.plights[i].Radius = radius;
-		fragmentData.plights[i].Diffuse = pLights[i]->DiffuseColor;
-		fragmentData.plights[i].Linear = pLights[i]->Linear;
-		fragmentData.plights[i].Specular = pLights[i]->SpecularColor;
-		fragmentData.plights[i].Quadratic = pLights[i]->Quadratic;
-	}
-	//if (fragmentData.pCount) FlushMappedMemory(element.GetMemory(), lightUniform.GetTotalOffset() * element.GetOffset() + sizeof(Uniform::DirectionalLight) * MAX_DIR_LIGHT, sizeof(Uniform::PointLight) * fragmentData.pCount);
-	fragmentData.sCount = sLights.size() < MAX_SPOT_LIGHT ? (u32)sLights.size() : MAX_SPOT_LIGHT;
-	for (u32 i = 0; i < fragmentData.sCount; i++)
-	{
-		f32 radius = (-sLights[i]->Linear + std::sqrtf(sLights[i]->Linear * sLights[i]->Linear - 4 * sLights[i]->Quadratic * (1.0f - (f32)(256.0 / 5.0) * 1.0f))) / (2 * sLights[i]->Quadratic);
-		fragmentData.slights[i].Position = sLights[i]->Position;
-		fragmentData.slights[i].Shininess = sLights[i]->Shininess;
-		fragmentData.slights[i].Ambient = sLights[i]->AmbientColor;
-		fragmentData.slights[i].Radius = radius;
-		fragmentData.slights[i].Diffuse = sLights[i]->DiffuseColor;
-		fragmentData.slights[i].Linear = sLights[i]->Linear;
-		fragmentData.slights[i].Specular = sLights[i]->SpecularColor;
-		fragmentData.slights[i].Quadratic = sLights[i]->Quadratic;
-		fragmentData.slights[i].Direction = sLights[i]->Direction;
-		fragmentData.slights[i].Angles = Maths::Vec2(sLights[i]->Angle, sLights[i]->Ratio);
-	}
-	//if (fragmentData.sCount) FlushMappedMemory(element.GetMemory(), lightUniform.GetTotalOffset() * element.GetOffset() + sizeof(Uniform::DirectionalLight) * MAX_DIR_LIGHT + sizeof(Uniform::PointLight) * MAX_POINT_LIGHT, sizeof(Uniform::SpotLight) * fragmentData.sCount); // TODO
+	fragmentData.dCount = static_cast<u32>(dLights.size());
+	fragmentData.pCount = static_cast<u32>(pLights.size());
+	fragmentData.sCount = static_cast<u32>(sLights.size());
+	fragmentData.inverseViewProjection = (currentCamera->GetProjectionMatrix() * currentCamera->GetViewMatrix()).CreateInverseMatrix();
+	BuildLightClusters(frame, fragmentData);
 }
 
 void VulkanRenderer::UpdatePostUniformBuffer(UniformElement& element, const LowRenderer::PostProcess::PostProcessEffect* effect)
@@ -2543,18 +4648,24 @@ void VulkanRenderer::UpdatePostUniformBuffer(UniformElement& element, const LowR
 	effect->FillBuffer(&fragmentData);
 }
 
-bool VulkanRenderer::CreateDescriptorPool(VkDescriptorPool& targetPool, u32 size, u32 uniformBuf, u32 images)
+bool VulkanRenderer::CreateDescriptorPool(VkDescriptorPool& targetPool, u32 size, u32 uniformBuf, u32 images, u32 storageBuf)
 {
 	std::vector<VkDescriptorPoolSize> poolSizes{};
 	if (uniformBuf)
 	{
 		poolSizes.push_back(VkDescriptorPoolSize());
 		poolSizes.back().type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
-		poolSizes.back().descriptorCount = uniformBuf;
+		poolSizes.back().descriptorCount = uniformBuf * size;
+	}
+	if (storageBuf)
+	{
+		poolSizes.push_back(VkDescriptorPoolSize());
+		poolSizes.back().type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		poolSizes.back().descriptorCount = storageBuf * size;
 	}
 	poolSizes.push_back(VkDescriptorPoolSize());
 	poolSizes.back().type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes.back().descriptorCount = images;
+	poolSizes.back().descriptorCount = images * size;
 
 	VkDescriptorPoolCreateInfo poolInfo{};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
@@ -2572,12 +4683,17 @@ bool VulkanRenderer::CreateDescriptorPool(VkDescriptorPool& targetPool, u32 size
 }
 
 bool VulkanRenderer::CreateDescriptorSet(VkDescriptorPool& targetPool, VkDescriptorSet& descriptor, Resources::ShaderVariant targetShader)
+{
+	return CreateDescriptorSet(targetPool, descriptor, targetShader == Resources::ShaderVariant::Light ? lightUniform.GetLayout() : (targetShader == Resources::ShaderVariant::PostProcess ? postUniform.GetLayout() : (targetShader == Resources::ShaderVariant::Window ? windowUniform.GetLayout() : mainUniform.GetLayout())));
+}
+
+bool VulkanRenderer::CreateDescriptorSet(VkDescriptorPool& targetPool, VkDescriptorSet& descriptor, const VkDescriptorSetLayout& layout)
 {
 	VkDescriptorSetAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = targetPool;
 	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = targetShader == Resources::ShaderVariant::Light ? &lightUniform.GetLayout() : (targetShader == Resources::ShaderVariant::PostProcess ? &postUniform.GetLayout() : (targetShader == Resources::ShaderVariant::Window ? &windowUniform.GetLayout() : &mainUniform.GetLayout()));
+	allocInfo.pSetLayouts = &layout;
 	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptor) != VK_SUCCESS)
 	{
 		//LOG(DEBUG_LEVEL::LERROR, "Failed to allocate descriptor sets!");
@@ -2595,22 +4711,27 @@ RendererImageView VulkanRenderer::GetValidImage(const RendererTexture* tex)
 	return tex->imageView;
 }
 
-void VulkanRenderer::UpdateDescriptorSet(VkDescriptorSet& descriptor, const RendererTexture* tex)
+void VulkanRenderer::UpdateDescriptorSet(VkDescriptorSet& descriptor, const RendererTexture* color, const RendererTexture* glow)
 {
-	VkDescriptorImageInfo imageInfo;
-	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageInfo.imageView = GetValidImage(tex).imageView;
-	imageInfo.sampler = Resources::TextureSampler::GetDefaultSampler()->renderSampler.GetSampler();
-	VkWriteDescriptorSet descriptorWrite = {};
-	descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrite.dstSet = descriptor;
-	descriptorWrite.dstBinding = 0;
-	descriptorWrite.dstArrayElement = 0;
-	descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrite.descriptorCount = 1;
-	descriptorWrite.pImageInfo = &imageInfo;
+	std::array<VkDescriptorImageInfo, 2> imageInfos;
+	std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+	const RendererTexture* textures[2] = { color, glow };
+	for (u32 i = 0; i < 2; i++)
+	{
+		imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfos[i].imageView = GetValidImage(textures[i]).imageView;
+		imageInfos[i].sampler = Resources::TextureSampler::GetDefaultSampler()->renderSampler.GetSampler();
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptor;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pImageInfo = &imageInfos[i];
+	}
 
-	vkUpdateDescriptorSets(device, static_cast<u32>(1), &descriptorWrite, 0, nullptr);
+	vkUpdateDescriptorSets(device, static_cast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	descriptorWriteCount += static_cast<u32>(descriptorWrites.size());
 }
 
 void VulkanRenderer::UpdateDescriptorSet(VkDescriptorSet& descriptor, VkBuffer& uniformBuff, Renderer::Uniform::RendererUniformObject* uniform, bool hasVertexInfo, const std::vector<const RendererTexture*> textures, const Resources::TextureSampler* sampler)
@@ -2671,6 +4792,143 @@ void VulkanRenderer::UpdateDescriptorSet(VkDescriptorSet& descriptor, VkBuffer&
 	}
 
 	vkUpdateDescriptorSets(device, static_cast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	descriptorWriteCount += static_cast<u32>(descriptorWrites.size());
+}
+
+void VulkanRenderer::UpdateLightDescriptorSet(VkDescriptorSet& descriptor, const LightFrameData& frame, const RendererTexture* depth, VkImageLayout depthLayout)
+{
+	std::array<std::pair<u32, const LightStorageBuffer*>, 5> storages = { {
+		{ 1, &frame.directionals },
+		{ 5, &frame.points },
+		{ 6, &frame.spots },
+		{ 7, &frame.clusters },
+		{ 8, &frame.indices },
+	} };
+	std::array<VkDescriptorBufferInfo, 5> bufferInfos{};
+	std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
+	for (u64 i = 0; i < storages.size(); i++)
+	{
+		bufferInfos[i].buffer = storages[i].second->buffer;
+		bufferInfos[i].offset = 0;
+		bufferInfos[i].range = VK_WHOLE_SIZE;
+
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptor;
+		descriptorWrites[i].dstBinding = storages[i].first;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[i].descriptorCount = 1;
+		descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	VkDescriptorImageInfo depthInfo{};
+	depthInfo.imageLayout = depthLayout;
+	depthInfo.imageView = depth->imageView.imageView;
+	depthInfo.sampler = Resources::TextureSampler::GetDefaultSampler()->renderSampler.GetSampler();
+
+	VkWriteDescriptorSet& depthWrite = descriptorWrites.back();
+	depthWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	depthWrite.dstSet = descriptor;
+	depthWrite.dstBinding = 9;
+	depthWrite.dstArrayElement = 0;
+	depthWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	depthWrite.descriptorCount = 1;
+	depthWrite.pImageInfo = &depthInfo;
+
+	vkUpdateDescriptorSets(device, static_cast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	descriptorWriteCount += static_cast<u32>(descriptorWrites.size());
+}
+
+void VulkanRenderer::UpdateIndirectDescriptorSet(VkDescriptorSet& descriptor, const IndirectFrameData& frame, VkBuffer& uniformBuff, const std::vector<const RendererTexture*>& textures)
+{
+	VkDescriptorBufferInfo objectBufferInfo{};
+	objectBufferInfo.buffer = frame.objectBuffer;
+	objectBufferInfo.offset = 0;
+	objectBufferInfo.range = VK_WHOLE_SIZE;
+
+	VkDescriptorBufferInfo fragBufferInfo{};
+	fragBufferInfo.buffer = uniformBuff;
+	fragBufferInfo.offset = mainUniform.GetFragmentOffset();
+	fragBufferInfo.range = mainUniform.GetFragmentBufSize();
+
+	std::vector<VkDescriptorImageInfo> imageInfos;
+	for (auto& tex : textures)
+	{
+		imageInfos.push_back(VkDescriptorImageInfo());
+		imageInfos.back().imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfos.back().imageView = GetValidImage(tex).imageView;
+		imageInfos.back().sampler = Resources::TextureSampler::GetDefaultSampler()->renderSampler.GetSampler();
+	}
+
+	std::vector<VkWriteDescriptorSet> descriptorWrites(2 + imageInfos.size(), VkWriteDescriptorSet());
+	for (u32 i = 0; i < descriptorWrites.size(); i++)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptor;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorCount = 1;
+		if (i > 1)
+		{
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			descriptorWrites[i].pImageInfo = &imageInfos[i - 2];
+		}
+	}
+	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	descriptorWrites[0].pBufferInfo = &objectBufferInfo;
+	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	descriptorWrites[1].pBufferInfo = &fragBufferInfo;
+
+	vkUpdateDescriptorSets(device, static_cast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	descriptorWriteCount += static_cast<u32>(descriptorWrites.size());
+}
+
+void VulkanRenderer::UpdateCullDescriptorSet(VkDescriptorSet& descriptor, const IndirectFrameData& frame)
+{
+	std::array<VkDescriptorBufferInfo, 7> bufferInfos = {};
+	bufferInfos[0].buffer = frame.objectBuffer;
+	bufferInfos[1].buffer = frame.batchBuffer;
+	bufferInfos[2].buffer = frame.commandBuffer;
+	bufferInfos[3].buffer = frame.countBuffer;
+	bufferInfos[4].buffer = frame.passBuffer;
+	bufferInfos[5].buffer = frame.visibilityBuffer;
+	bufferInfos[6].buffer = frame.statsBuffer;
+
+	// Passes without a depth pyramid never sample it, but the binding still has to be valid
+	VkDescriptorImageInfo pyramidInfo{};
+	pyramidInfo.sampler = Resources::TextureSampler::GetDefaultSampler()->renderSampler.GetSampler();
+	if (hizBuffer.IsCreated())
+	{
+		pyramidInfo.imageView = hizBuffer.GetImageView();
+		pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+	}
+	else
+	{
+		pyramidInfo.imageView = GetValidImage(&Resources::StaticTexture::GetDefaultTexture()->GetRendererTexture()).imageView;
+		pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	}
+
+	std::array<VkWriteDescriptorSet, 8> descriptorWrites = {};
+	for (u32 i = 0; i < descriptorWrites.size(); i++)
+	{
+		descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[i].dstSet = descriptor;
+		descriptorWrites[i].dstBinding = i;
+		descriptorWrites[i].dstArrayElement = 0;
+		descriptorWrites[i].descriptorCount = 1;
+		if (i < bufferInfos.size())
+		{
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+			descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			descriptorWrites[i].pBufferInfo = &bufferInfos[i];
+		}
+	}
+	descriptorWrites[7].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptorWrites[7].pImageInfo = &pyramidInfo;
+
+	vkUpdateDescriptorSets(device, static_cast<u32>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	descriptorWriteCount += static_cast<u32>(descriptorWrites.size());
 }
 
 Renderer::FrameDescriptorPool::FrameDescriptorPool()
@@ -2681,31 +4939,41 @@ Renderer::FrameDescriptorPool::~FrameDescriptorPool()
 {
 }
 
-void FrameDescriptorPool::CreatePools(VulkanRenderer& renderer, u32 count, u32 uniformBuf, u32 images)
+void FrameDescriptorPool::CreatePools(VulkanRenderer& renderer, u32 count, u32 uniformBuf, u32 images, u32 storageBuf)
 {
-	for (u32 i = 0; i < DESCRIPTOR_POOL_SIZE; i++)
-	{
-		renderer.CreateDescriptorPool(framePool[i], count, uniformBuf, images);
-		poolState[i] = false;
-	}
+	setCount = count;
+	uniformCount = uniformBuf;
+	imageCount = images;
+	storageCount = storageBuf;
+	framePools.resize(1);
+	renderer.CreateDescriptorPool(framePools[0], setCount, uniformCount, imageCount, storageCount);
+	currentPos = 0;
 }
 
 void FrameDescriptorPool::DestroyPools(VkDevice& device)
 {
-	for (u32 i = 0; i < DESCRIPTOR_POOL_SIZE; i++)
+	for (auto& pool : framePools)
 	{
-		vkDestroyDescriptorPool(device, framePool[i], nullptr);
+		vkDestroyDescriptorPool(device, pool, nullptr);
 	}
+	framePools.clear();
 }
 
 VkDescriptorSet FrameDescriptorPool::GetNext(VulkanRenderer& renderer, Resources::ShaderVariant variant)
+{
+	return GetNext(renderer, variant == Resources::ShaderVariant::Light ? renderer.lightUniform.GetLayout() : (variant == Resources::ShaderVariant::PostProcess ? renderer.postUniform.GetLayout() : (variant == Resources::ShaderVariant::Window ? renderer.windowUniform.GetLayout() : renderer.mainUniform.GetLayout())));
+}
+
+VkDescriptorSet FrameDescriptorPool::GetNext(VulkanRenderer& renderer, const VkDescriptorSetLayout& layout)
 {
 	VkDescriptorSet result = {};
-	while (!renderer.CreateDescriptorSet(framePool[currentPos], result, variant))
+	while (!renderer.CreateDescriptorSet(framePools[currentPos], result, layout))
 	{
-		poolState[currentPos] = true;
-		currentPos = (currentPos + 1) % DESCRIPTOR_POOL_SIZE;
-		if (poolState[currentPos])
+		currentPos++;
+		if (currentPos < framePools.size()) continue;
+		LOG(DEBUG_LEVEL::LINFO, "Growing descriptor pool to %u sets", setCount * (currentPos + 1));
+		framePools.push_back(VK_NULL_HANDLE);
+		if (!renderer.CreateDescriptorPool(framePools.back(), setCount, uniformCount, imageCount, storageCount))
 		{
 			Wrappers::WindowManager::OpenPopup("Fatal Error", "Out of descriptor sets!", Wrappers::PopupParam::BUTTON_RETRY_CANCEL | Wrappers::PopupParam::ICON_WARNING);
 			abort();
@@ -2716,14 +4984,12 @@ VkDescriptorSet FrameDescriptorPool::GetNext(VulkanRenderer& renderer, Resources
 
 void FrameDescriptorPool::UpdatePool(VkDevice& device, VulkanRenderer& renderer)
 {
-	for (u32 i = 0; i < DESCRIPTOR_POOL_SIZE; i++)
+	// The previous use of the frame slot has completed, none of its sets are referenced anymore
+	for (u32 i = 0; i <= currentPos && i < framePools.size(); i++)
 	{
-		if (poolState[i])
-		{
-			vkResetDescriptorPool(device, framePool[i], 0);
-			poolState[i] = false;
-		}
+		vkResetDescriptorPool(device, framePools[i], 0);
 	}
+	currentPos = 0;
 }
 
 void VulkanRenderer::SubmitCurrentCommandBuffer(void* buffer)
@@ -2741,7 +5007,8 @@ void VulkanRenderer::SubmitCurrentCommandBuffer(void* buffer)
 	VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 
-	submitInfo.waitSemaphoreCount = 1;
+	// Nothing is acquired or presented without a swap chain
+	submitInfo.waitSemaphoreCount = headless ? 0 : 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = static_cast<u32>(submitCommandBuffers.size());
@@ -2749,7 +5016,7 @@ void VulkanRenderer::SubmitCurrentCommandBuffer(void* buffer)
 
 	VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
 
-	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.signalSemaphoreCount = headless ? 0 : 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
@@ -2757,6 +5024,8 @@ void VulkanRenderer::SubmitCurrentCommandBuffer(void* buffer)
 		LOG(DEBUG_LEVEL::LERROR, "Failed to submit draw command buffer!");
 		throw std::runtime_error("Failed to submit draw command buffer!");
 	}
+	std::lock_guard lock(deletionMutex);
+	frameSubmissions[currentFrame] = ++submittedFrames;
 }
 
 UniformBufferPool::UniformBufferPool()
@@ -2767,38 +5036,63 @@ UniformBufferPool::~UniformBufferPool()
 {
 }
 
-void UniformBufferPool::CreatePools(VulkanRenderer& renderer, u32 countIn, Renderer::Uniform::RendererUniformObject* uniform)
+void UniformBufferPool::CreatePools(VulkanRenderer& rendererIn, u32 countIn, Renderer::Uniform::RendererUniformObject* uniform)
+{
+	renderer = &rendererIn;
+	stride = uniform->GetTotalOffset();
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(renderer->physicalDevice, &properties);
+	atomSize = properties.limits.nonCoherentAtomSize;
+	CreateBlock(countIn);
+}
+
+void UniformBufferPool::CreateBlock(u64 countIn)
 {
 	count = countIn;
-	bufferSize = count * uniform->GetTotalOffset();
-	for (u32 i = 0; i < DESCRIPTOR_POOL_SIZE; ++i)
+	renderer->CreateBuffer(count * stride, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, block.buffer, block.memory);
+	if (vkMapMemory(renderer->device, block.memory, 0, VK_WHOLE_SIZE, 0, &block.mappedMemory) != VK_SUCCESS)
 	{
-		renderer.CreateBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, framePool[i].buffer, framePool[i].memory);
-		if (vkMapMemory(renderer.device, framePool[i].memory, 0, VK_WHOLE_SIZE, 0, &framePool[i].mappedMemory) != VK_SUCCESS)
-		{
-			LOG(DEBUG_LEVEL::LERROR, "Could not map uniform buffer !");
-		}
+		LOG(DEBUG_LEVEL::LERROR, "Could not map uniform buffer !");
+		throw std::runtime_error("Could not map uniform buffer !");
 	}
+	// Same lookup as CreateBuffer, to know whether the memory it picked needs explicit flushes
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(renderer->device, block.buffer, &requirements);
+	VkPhysicalDeviceMemoryProperties memProperties;
+	vkGetPhysicalDeviceMemoryProperties(renderer->physicalDevice, &memProperties);
+	u32 type = renderer->FindMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+	coherent = memProperties.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
 }
 
 void UniformBufferPool::DestroyPools(VkDevice& device)
 {
-	for (u32 i = 0; i < DESCRIPTOR_POOL_SIZE; ++i)
-	{
-		vkDestroyBuffer(device, framePool[i].buffer, nullptr);
-		vkFreeMemory(device, framePool[i].memory, nullptr);
-	}
+	vkDestroyBuffer(device, block.buffer, nullptr);
+	vkFreeMemory(device, block.memory, nullptr);
+	block = {};
 }
 
 UniformElement UniformBufferPool::GetNext()
 {
+	if (currentPos >= count)
+	{
+		// Elements already handed out keep their buffer, it is only released once the frame is retired
+		UniformBufferObject old = block;
+		FlushBlock(old, currentPos * stride);
+		VkDevice device = renderer->device;
+		renderer->QueueDeletion([device, old]()
+		{
+			vkDestroyBuffer(device, old.buffer, nullptr);
+			vkFreeMemory(device, old.memory, nullptr);
+		});
+		LOG(DEBUG_LEVEL::LINFO, "Growing uniform buffer to %llu elements", count * 2);
+		CreateBlock(count * 2);
+		currentPos = 0;
+	}
 	UniformElement result = {};
-	u32 poolIndex = static_cast<u32>(currentPos / count);
-	assert(poolIndex < DESCRIPTOR_POOL_SIZE);
-	result.buffer = framePool[poolIndex].buffer;
-	result.memory = framePool[poolIndex].memory;
-	result.index = currentPos - poolIndex * 1llu * count;
-	result.mappedPointer = framePool[poolIndex].mappedMemory;
+	result.buffer = block.buffer;
+	result.memory = block.memory;
+	result.index = currentPos;
+	result.mappedPointer = block.mappedMemory;
 	currentPos++;
 	return result;
 }
@@ -2808,6 +5102,18 @@ void UniformBufferPool::UpdatePool()
 	currentPos = 0;
 }
 
+void UniformBufferPool::Flush()
+{
+	FlushBlock(block, currentPos * stride);
+}
+
+void UniformBufferPool::FlushBlock(const UniformBufferObject& target, u64 size)
+{
+	if (coherent || size == 0) return;
+	u64 range = (size + atomSize - 1) / atomSize * atomSize;
+	renderer->FlushMappedMemory(target.memory, 0, range >= count * stride ? VK_WHOLE_SIZE : range);
+}
+
 Renderer::UniformElement::UniformElement(void* ptr, u64 id, VkBuffer buf, VkDeviceMemory mem) : mappedPointer(ptr), index(id), buffer(buf), memory(mem)
 {
 }
@@ -8,10 +8,51 @@ Mesh::~Mesh()
 {
 }
 
+#define LOD_HYSTERESIS 0.25f
+
 void Mesh::UpdateVectors()
 {
 	verticeCount = static_cast<u32>(vertices.size());
 	indiceCount = static_cast<u32>(indices.size());
+	// Levels of detail are offset by the full resolution indices, they are dropped when those change
+	if (lods.empty() || lods[0].indexCount != indiceCount)
+	{
+		lodIndices.clear();
+		lods.clear();
+		lods.push_back({ 0, indiceCount, 0.0f });
+		meshlets.clear();
+	}
+}
+
+Maths::Vec4 Meshlet::GetCone() const
+{
+	Maths::Vec4 result;
+	for (u32 i = 0; i < 4; i++)
+	{
+		result[i] = std::max(static_cast<s8>((cone >> (8 * i)) & 0xff) / 127.0f, -1.0f);
+	}
+	return result;
+}
+
+u32 Mesh::SelectLod(f32 screenSize, u32 current, f32 pixelError) const
+{
+	u32 result = 0;
+	for (u32 i = 1; i < lods.size(); i++)
+	{
+		const f32 bound = i > current ? pixelError * (1.0f - LOD_HYSTERESIS) : pixelError * (1.0f + LOD_HYSTERESIS);
+		if (lods[i].error * screenSize > bound) break;
+		result = i;
+	}
+	return result;
+}
+
+std::vector<u32> Mesh::GetRenderIndices() const
+{
+	std::vector<u32> result;
+	result.reserve(indices.size() + lodIndices.size());
+	result.insert(result.end(), indices.begin(), indices.end());
+	result.insert(result.end(), lodIndices.begin(), lodIndices.end());
+	return result;
 }
 
 u32 Mesh::GetVertexCount() const 
@@ -28,9 +69,15 @@ void Resources::Mesh::DeleteData()
 {
 	vertices.clear();
 	indices.clear();
+	lodIndices.clear();
+	lods.clear();
+	meshlets.clear();
+	skinWeights.clear();
+	bones.clear();
 
 	vertices.shrink_to_fit();
 	indices.shrink_to_fit();
+	lodIndices.shrink_to_fit();
 
 	app->GetRenderer().UnloadMesh(this);
 }
@@ -54,6 +101,39 @@ void Mesh::Write(Serializer& sr)
 		sr.Write(vertex.normal);
 		sr.Write(vertex.tangent);
 	}
+	sr.Write(lods.size());
+	for (auto& lod : lods)
+	{
+		sr.Write(lod.indexOffset);
+		sr.Write(lod.indexCount);
+		sr.Write(lod.error);
+	}
+	sr.Write(lodIndices.size());
+	for (auto& index : lodIndices)
+	{
+		sr.Write(index);
+	}
+	sr.Write(meshlets.size());
+	for (auto& meshlet : meshlets)
+	{
+		sr.Write(meshlet.center);
+		sr.Write(meshlet.radius);
+		sr.Write(meshlet.cone);
+		sr.Write(meshlet.indexOffset);
+		sr.Write(meshlet.indexCount);
+	}
+	sr.Write(skinWeights.size());
+	for (auto& skin : skinWeights)
+	{
+		sr.Write(skin.bones, sizeof(skin.bones));
+		sr.Write(skin.weights, sizeof(skin.weights));
+	}
+	sr.Write(bones.size());
+	for (auto& bone : bones)
+	{
+		sr.Write(bone.node);
+		sr.Write(bone.offset);
+	}
 }
 
 void Mesh::Load(Deserializer& dr)
@@ -77,6 +157,51 @@ void Mesh::Load(Deserializer& dr)
 		dr.Read(vertex.normal);
 		dr.Read(vertex.tangent);
 	}
+	// Meshes cached before levels of detail existed end here
+	if (dr.Read(size))
+	{
+		lods.resize(size);
+		for (auto& lod : lods)
+		{
+			dr.Read(lod.indexOffset);
+			dr.Read(lod.indexCount);
+			dr.Read(lod.error);
+		}
+		dr.Read(size);
+		lodIndices.resize(size);
+		for (auto& index : lodIndices)
+		{
+			dr.Read(index);
+		}
+	}
+	if (dr.Read(size))
+	{
+		meshlets.resize(size);
+		for (auto& meshlet : meshlets)
+		{
+			dr.Read(meshlet.center);
+			dr.Read(meshlet.radius);
+			dr.Read(meshlet.cone);
+			dr.Read(meshlet.indexOffset);
+			dr.Read(meshlet.indexCount);
+		}
+	}
+	if (dr.Read(size))
+	{
+		skinWeights.resize(size);
+		for (auto& skin : skinWeights)
+		{
+			dr.Read(skin.bones, sizeof(skin.bones));
+			dr.Read(skin.weights, sizeof(skin.weights));
+		}
+		dr.Read(size);
+		bones.resize(size);
+		for (auto& bone : bones)
+		{
+			dr.Read(bone.node);
+			dr.Read(bone.offset);
+		}
+	}
 	UpdateVectors();
 	isLoaded = app->GetRenderer().LoadMesh(this);
 }
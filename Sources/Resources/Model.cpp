@@ -13,7 +13,7 @@ using namespace Core::FileManager;
 
 void Model::Write(Serializer& sr)
 {
-	sr.Write(static_cast<u8>(ObjectType::ModelType));
+	sr.Write(static_cast<u8>(GetType()));
 	IResource::Write(sr);
 	sr.Write(meshes.size());
 	for (auto& mesh : meshes)
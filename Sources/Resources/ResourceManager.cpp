@@ -4,6 +4,7 @@
 #include "Core/Serialization/Serializer.hpp"
 #include "Core/Serialization/Deserializer.hpp"
 #include "Resources/Model.hpp"
+#include "Resources/SkinnedModel.hpp"
 #include "Resources/StaticTexture.hpp"
 #include "Resources/StaticCubeMap.hpp"
 #include "LowRenderer/FrameBuffer.hpp"
@@ -47,9 +48,9 @@ IResource* ResourceManager::Load(u64 hashIn, bool isHidden)
         res = std::make_unique<Model>();
         if (!isHidden) modelCached.push_back(reinterpret_cast<Model*>(res.get()));
         break;
-    case ObjectType::SkinnedModelType: // TODO
-        //res = std::make_unique<Model>();
-        //if (!isHidden) modelCached.push_back(reinterpret_cast<Model*>(res.get()));
+    case ObjectType::SkinnedModelType:
+        res = std::make_unique<SkinnedModel>();
+        if (!isHidden) skinnedModelCached.push_back(reinterpret_cast<SkinnedModel*>(res.get()));
         break;
     case ObjectType::TextureSamplerType:
         res = std::make_unique<TextureSampler>();
@@ -169,6 +170,7 @@ void ResourceManager::DeleteAllResources()
     geometryShaderCached.clear();
     meshCached.clear();
     modelCached.clear();
+    skinnedModelCached.clear();
     textureCached.clear();
     samplerCached.clear();
     shaderProgramCached.clear();
@@ -206,6 +208,17 @@ void ResourceManager::DeleteResource(IResource* res)
         }
         break;
     case ObjectType::SkinnedModelType:
+        for (u64 i = 0; i < skinnedModelCached.size(); i++)
+        {
+            if (res == skinnedModelCached[i])
+            {
+                for (u64 j = i; j < skinnedModelCached.size() - 1; j++)
+                {
+                    skinnedModelCached[j] = skinnedModelCached[j + 1];
+                }
+                skinnedModelCached.pop_back();
+            }
+        }
         break;
     case ObjectType::TextureSamplerType:
         for (u64 i = 0; i < samplerCached.size(); i++)
@@ -388,6 +401,10 @@ std::vector<Model*>& ResourceManager::GetModelList()
 {
     return modelCached;
 }
+std::vector<SkinnedModel*>& ResourceManager::GetSkinnedModelList()
+{
+    return skinnedModelCached;
+}
 std::vector<ShaderProgram*>& ResourceManager::GetShaderProgramList()
 {
     return shaderProgramCached;
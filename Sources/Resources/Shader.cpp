@@ -1,9 +1,22 @@
 #include "Resources/Shader.hpp"
 
+#include <filesystem>
+
 #include "Renderer/VulkanRenderer.hpp"
 #include "Core/App.hpp"
+#include "Core/Debugging/Log.hpp"
+#include "Wrappers/ShaderLoader.hpp"
 using namespace Resources;
 
+namespace
+{
+	// Shipped GLSL whose outputs changed after the SPIR-V of the assets built from it was cached, other assets keep their SPIR-V
+	constexpr const char* updatedShaderSources[] = {
+		"Default_Resources/Shaders/height_fragment.frag",
+		"Resources/Shaders/fragment_clipped.frag",
+	};
+}
+
 FragmentShader::FragmentShader()
 {
 }
@@ -64,6 +77,43 @@ void Shader::Load(Core::Serialization::Deserializer& dr)
 {
 	IResource::Load(dr);
 	dr.Read(shaderData);
+	// The SPIR-V of an asset is not rebuilt when its source changes, shaders that still have their source follow it
+	std::string source = FindSource();
+	if (!source.empty() && LoadSource(source)) return;
+	// The updated engine shaders all write the G-buffer, their cached SPIR-V only knows the full layout
+	if (!source.empty()) app->GetRenderer().DisableCompactGBuffer();
+	isLoaded = app->GetRenderer().LoadShader(this);
+}
+
+std::string Shader::FindSource()
+{
+	const char* extension = GetType() == ObjectType::VertexShaderType ? ".vert" : GetType() == ObjectType::GeometryShaderType ? ".geom" : ".frag";
+	std::filesystem::path name = std::filesystem::path(path).filename();
+	if (name.empty()) return "";
+	if (name.extension() != extension) name += extension;
+	for (const char* source : updatedShaderSources)
+	{
+		std::filesystem::path file = source;
+		if (file.filename() != name) continue;
+		std::error_code error;
+		if (std::filesystem::exists(file, error)) return file.generic_string();
+	}
+	return "";
+}
+
+bool Shader::LoadSource(const std::string& source)
+{
+	if (source == sourcePath) return isLoaded;
+	std::string data = Wrappers::ShaderLoader::LoadCachedShader(source.c_str());
+	if (data.empty())
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Could not build %s from %s, keeping its cached SPIR-V", path.c_str(), source.c_str());
+		return false;
+	}
+	if (isLoaded) app->GetRenderer().UnLoadShader(this);
+	shaderData = std::move(data);
+	sourcePath = source;
 	isLoaded = app->GetRenderer().LoadShader(this);
+	return isLoaded;
 }
 	
@@ -3,11 +3,45 @@
 #include "Core/Debugging/Log.hpp"
 #include "Renderer/VulkanRenderer.hpp"
 #include "Core/App.hpp"
+#include "Wrappers/WindowManager.hpp"
 using namespace Resources;
 using namespace Core::Serialization;
 
 ShaderProgram* ShaderProgram::defaultShaderProgram = nullptr;
 
+namespace
+{
+	// What happens when the GLSL of an engine program does not compile and its stale SPIR-V is all there is
+	enum class StaleSource : u8
+	{
+		KEEP,
+		FATAL,
+		// Geometry shaders, their cached SPIR-V writes the full attachment set so compact frame buffers are turned off
+		FULL_GBUFFER,
+	};
+
+	struct ProgramSource
+	{
+		u64 hash;
+		// Vertex stage passing the object id to the fragment stage, which writes it to the id attachment
+		const char* vertex;
+		const char* fragment;
+		StaleSource stale;
+	};
+
+	// Engine programs whose fragment stage is built from its GLSL, the SPIR-V stored in their assets predates the source
+	constexpr ProgramSource engineProgramSources[] = {
+		{ 0x19, "Default_Resources/Shaders/vertex.vert", "Default_Resources/Shaders/fragment.frag", StaleSource::FULL_GBUFFER },
+		// The cached light shader predates the cluster and light storage bindings
+		{ 0x20, nullptr, "Default_Resources/Shaders/deferred_fragment.frag", StaleSource::FATAL },
+		{ 0x24, nullptr, "Default_Resources/Shaders/bloom_fragment.frag", StaleSource::KEEP },
+		{ 0x26, nullptr, "Default_Resources/Shaders/blur_fragment.frag", StaleSource::KEEP },
+		{ 0x29, nullptr, "Default_Resources/Shaders/wire_fragment.frag", StaleSource::FULL_GBUFFER },
+		// The window checks it was rebuilt before taking post-process stages
+		{ 0x6b, nullptr, "Default_Resources/Shaders/window_fragment.frag", StaleSource::KEEP },
+	};
+}
+
 void ShaderProgram::CreateShaderProgram(VertexShader* vertexIn, FragmentShader* fragmentIn, GeometryShader* geometryIn, ShaderVariant variant)
 {
 	type = variant;
@@ -184,6 +218,23 @@ void Resources::ShaderProgram::Load(Deserializer& dr)
 		dr.Read(hash);
 		haloVariant = app->GetResources().Get<ShaderProgram>(hash);
 	}
+	for (const ProgramSource& source : engineProgramSources)
+	{
+		if (source.hash != IResource::hash || !fragment) continue;
+		// The rebuilt fragment stage reads the object id of the vertex stage, it stays stale along with it
+		if ((!source.vertex || (vertex && vertex->LoadSource(source.vertex))) && fragment->LoadSource(source.fragment))
+		{
+			writesObjectID = source.vertex != nullptr;
+			continue;
+		}
+		if (source.stale == StaleSource::FATAL)
+		{
+			LOG(DEBUG_LEVEL::LERROR, "%s could not be built from %s and its cached SPIR-V does not match the renderer, glslc is required", path.c_str(), source.fragment);
+			Wrappers::WindowManager::OpenPopup("Fatal Error", "Could not build " + path + " from " + source.fragment + "!", Wrappers::PopupParam::BUTTON_OK | Wrappers::PopupParam::ICON_STOP);
+			abort();
+		}
+		if (source.stale == StaleSource::FULL_GBUFFER) app->GetRenderer().DisableCompactGBuffer();
+	}
 	CreateShaderProgram(vertex, fragment, geometry, type);
 
 	app->GetRenderer().LoadShaderProgram(this, GetRenderPass());
@@ -0,0 +1,185 @@
+#include "Resources/SkinnedModel.hpp"
+
+#include <algorithm>
+
+#include "Core/Serialization/Serializer.hpp"
+
+using namespace Core::Serialization;
+using namespace Resources;
+
+namespace
+{
+	// Index of the last key at or before the time, the keys are sorted
+	template<typename T>
+	u64 FindKey(const std::vector<T>& keys, f32 time)
+	{
+		auto next = std::upper_bound(keys.begin(), keys.end(), time, [](f32 t, const T& key) { return t < key.time; });
+		return next == keys.begin() ? 0 : static_cast<u64>(next - keys.begin()) - 1;
+	}
+
+	template<typename T>
+	f32 GetKeyDelta(const std::vector<T>& keys, u64 index, f32 time)
+	{
+		if (index + 1 >= keys.size()) return 0.0f;
+		f32 length = keys[index + 1].time - keys[index].time;
+		return length > 0.0f ? Maths::Util::Clamp((time - keys[index].time) / length, 0.0f, 1.0f) : 0.0f;
+	}
+
+	Maths::Vec3 SampleVector(const std::vector<VectorKey>& keys, f32 time)
+	{
+		u64 index = FindKey(keys, time);
+		if (index + 1 >= keys.size()) return keys[index].value;
+		return Maths::Util::Lerp(keys[index].value, keys[index + 1].value, GetKeyDelta(keys, index, time));
+	}
+
+	Maths::Quat SampleRotation(const std::vector<QuatKey>& keys, f32 time)
+	{
+		u64 index = FindKey(keys, time);
+		if (index + 1 >= keys.size()) return keys[index].value;
+		return Maths::Quat::Slerp(keys[index].value, keys[index + 1].value, GetKeyDelta(keys, index, time)).Normalize();
+	}
+
+	void WriteKeys(Serializer& sr, const std::vector<VectorKey>& keys)
+	{
+		sr.Write(keys.size());
+		for (auto& key : keys)
+		{
+			sr.Write(key.time);
+			sr.Write(key.value);
+		}
+	}
+
+	void ReadKeys(Deserializer& dr, std::vector<VectorKey>& keys)
+	{
+		u64 size = 0;
+		dr.Read(size);
+		keys.resize(size);
+		for (auto& key : keys)
+		{
+			dr.Read(key.time);
+			dr.Read(key.value);
+		}
+	}
+}
+
+SkinnedModel::SkinnedModel() : Model()
+{
+}
+
+void SkinnedModel::DeleteData()
+{
+	Model::DeleteData();
+	nodes.clear();
+	animations.clear();
+}
+
+void SkinnedModel::Write(Serializer& sr)
+{
+	Model::Write(sr);
+	sr.Write(nodes.size());
+	for (auto& node : nodes)
+	{
+		sr.Write(node.name);
+		sr.Write(node.parent);
+		sr.Write(node.local);
+	}
+	sr.Write(animations.size());
+	for (auto& animation : animations)
+	{
+		sr.Write(animation.name);
+		sr.Write(animation.duration);
+		sr.Write(animation.channels.size());
+		for (auto& channel : animation.channels)
+		{
+			sr.Write(channel.node);
+			WriteKeys(sr, channel.positions);
+			sr.Write(channel.rotations.size());
+			for (auto& key : channel.rotations)
+			{
+				sr.Write(key.time);
+				sr.Write(key.value);
+			}
+			WriteKeys(sr, channel.scales);
+		}
+	}
+}
+
+void SkinnedModel::Load(Deserializer& dr)
+{
+	Model::Load(dr);
+	u64 size = 0;
+	dr.Read(size);
+	nodes.resize(size);
+	for (auto& node : nodes)
+	{
+		dr.Read(node.name);
+		dr.Read(node.parent);
+		dr.Read(node.local);
+	}
+	dr.Read(size);
+	animations.resize(size);
+	for (auto& animation : animations)
+	{
+		dr.Read(animation.name);
+		dr.Read(animation.duration);
+		dr.Read(size);
+		animation.channels.resize(size);
+		for (auto& channel : animation.channels)
+		{
+			dr.Read(channel.node);
+			ReadKeys(dr, channel.positions);
+			dr.Read(size);
+			channel.rotations.resize(size);
+			for (auto& key : channel.rotations)
+			{
+				dr.Read(key.time);
+				dr.Read(key.value);
+			}
+			ReadKeys(dr, channel.scales);
+		}
+	}
+}
+
+void SkinnedModel::WindowCreateResource(bool& open)
+{
+
+}
+
+void SkinnedModel::EvaluatePose(u32 animation, f32 time, std::vector<Maths::Mat4>& pose) const
+{
+	pose.resize(nodes.size());
+	for (u64 i = 0; i < nodes.size(); i++)
+	{
+		pose[i] = nodes[i].local;
+	}
+	if (animation < animations.size())
+	{
+		const Animation& current = animations[animation];
+		if (current.duration > 0.0f) time = Maths::Util::Mod(time, current.duration);
+		for (auto& channel : current.channels)
+		{
+			if (channel.node >= nodes.size()) continue;
+			Maths::Vec3 position = channel.positions.empty() ? nodes[channel.node].local.GetPositionFromTranslation() : SampleVector(channel.positions, time);
+			Maths::Quat rotation = channel.rotations.empty() ? Maths::Quat(nodes[channel.node].local) : SampleRotation(channel.rotations, time);
+			Maths::Vec3 scale = channel.scales.empty() ? nodes[channel.node].local.GetScaleFromTranslation() : SampleVector(channel.scales, time);
+			pose[channel.node] = Maths::Mat4::CreateTransformMatrix(position, rotation, scale);
+		}
+	}
+	if (pose.empty()) return;
+	// Static meshes are imported without the transform of the root, skinned ones are placed the same way
+	pose[0] = nodes[0].local.CreateInverseMatrix() * pose[0];
+	for (u64 i = 1; i < nodes.size(); i++)
+	{
+		if (nodes[i].parent >= 0) pose[i] = pose[nodes[i].parent] * pose[i];
+	}
+}
+
+void SkinnedModel::GetBoneMatrices(const Mesh* mesh, const std::vector<Maths::Mat4>& pose, std::vector<Maths::Mat4>& matrices) const
+{
+	matrices.resize(mesh->bones.size());
+	for (u64 i = 0; i < mesh->bones.size(); i++)
+	{
+		const MeshBone& bone = mesh->bones[i];
+		matrices[i] = bone.node < pose.size() ? pose[bone.node] * bone.offset : bone.offset;
+	}
+}
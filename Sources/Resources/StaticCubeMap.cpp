@@ -3,6 +3,7 @@
 #include <filesystem>
 
 #include "Wrappers/ImageLoader.hpp"
+#include "Wrappers/TextureEncoder.hpp"
 #include "Core/Serialization/Serializer.hpp"
 #include "Core/FileManager.hpp"
 #include "Resources/ResourceManager.hpp"
@@ -39,8 +40,13 @@ void StaticCubeMap::Write(Serializer& sr)
 {
 	sr.Write(static_cast<u8>(ObjectType::CubeMapType));
 	CubeMap::Write(sr);
-	sr.Write(isFloat);
-	if (isFloat)
+	// Stored as the former float flag, encoded data follows it
+	sr.Write(static_cast<u8>(encoding == TextureEncoding::RAW ? isFloat : static_cast<u8>(encoding) + 1));
+	if (encoding != TextureEncoding::RAW)
+	{
+		sr.Write(reinterpret_cast<u8*>(cubeMapData), Wrappers::TextureEncoder::GetEncodedSize(encoding, resolution, mipLevels, 6));
+	}
+	else if (isFloat)
 	{
 		for (u64 i = 0; i < 6 * 4llu * resolution.x * resolution.y; i++)
 		{
@@ -56,8 +62,18 @@ void StaticCubeMap::Write(Serializer& sr)
 void StaticCubeMap::Load(Deserializer& dr)
 {
 	CubeMap::Load(dr);
-	dr.Read(isFloat);
-	if (isFloat)
+	u8 storage = 0;
+	dr.Read(storage);
+	isFloat = storage == 1;
+	encoding = storage > 1 ? static_cast<TextureEncoding>(storage - 1) : TextureEncoding::RAW;
+	UpdateMipLevel();
+	if (encoding != TextureEncoding::RAW)
+	{
+		u64 size = Wrappers::TextureEncoder::GetEncodedSize(encoding, resolution, mipLevels, 6);
+		cubeMapData = malloc(size);
+		dr.Read(reinterpret_cast<u8*>(cubeMapData), size);
+	}
+	else if (isFloat)
 	{
 		cubeMapData = malloc(sizeof(f32) * 6 * 4llu * resolution.x * resolution.y);
 		for (u64 i = 0; i < 6 * 4llu * resolution.x * resolution.y; i++)
@@ -70,7 +86,6 @@ void StaticCubeMap::Load(Deserializer& dr)
 		cubeMapData = malloc(6 * 4llu * resolution.x * resolution.y);
 		dr.Read(reinterpret_cast<u8*>(cubeMapData), 6 * 4llu * resolution.x * resolution.y);
 	}
-	UpdateMipLevel();
 	isLoaded = app->GetRenderer().LoadCubeMap(this);
 }
 
@@ -3,6 +3,7 @@
 #include <filesystem>
 
 #include "Wrappers/ImageLoader.hpp"
+#include "Wrappers/TextureEncoder.hpp"
 #include "Core/Serialization/Serializer.hpp"
 #include "Core/FileManager.hpp"
 #include "Resources/ResourceManager.hpp"
@@ -40,8 +41,13 @@ void StaticTexture::Write(Serializer& sr)
 {
 	sr.Write(static_cast<u8>(ObjectType::TextureType));
 	Texture::Write(sr);
-	sr.Write(isFloat);
-	if (isFloat)
+	// Stored as the former float flag, encoded data follows it
+	sr.Write(static_cast<u8>(encoding == TextureEncoding::RAW ? isFloat : static_cast<u8>(encoding) + 1));
+	if (encoding != TextureEncoding::RAW)
+	{
+		sr.Write(reinterpret_cast<u8*>(textureData), Wrappers::TextureEncoder::GetEncodedSize(encoding, resolution, mipLevels));
+	}
+	else if (isFloat)
 	{
 		for (u64 i = 0; i < 4llu * resolution.x * resolution.y; i++)
 		{
@@ -57,8 +63,18 @@ void StaticTexture::Write(Serializer& sr)
 void StaticTexture::Load(Deserializer& dr)
 {
 	Texture::Load(dr);
-	dr.Read(isFloat);
-	if (isFloat)
+	u8 storage = 0;
+	dr.Read(storage);
+	isFloat = storage == 1;
+	encoding = storage > 1 ? static_cast<TextureEncoding>(storage - 1) : TextureEncoding::RAW;
+	UpdateMipLevel();
+	if (encoding != TextureEncoding::RAW)
+	{
+		u64 size = Wrappers::TextureEncoder::GetEncodedSize(encoding, resolution, mipLevels);
+		textureData = malloc(size);
+		dr.Read(reinterpret_cast<u8*>(textureData), size);
+	}
+	else if (isFloat)
 	{
 		textureData = malloc(sizeof(f32) * 4llu * resolution.x * resolution.y);
 		for (u64 i = 0; i < 4llu * resolution.x * resolution.y; i++)
@@ -71,7 +87,6 @@ void StaticTexture::Load(Deserializer& dr)
 		textureData = malloc(4llu * resolution.x * resolution.y);
 		dr.Read(reinterpret_cast<u8*>(textureData), 4llu * resolution.x * resolution.y);
 	}
-	UpdateMipLevel();
 	isLoaded = app->GetRenderer().LoadTexture(this);
 }
 
@@ -4,6 +4,9 @@
 
 #include "Core/Debugging/Log.hpp"
 #include "Core/FileManager.hpp"
+#include "Core/App.hpp"
+#include "Renderer/VulkanRenderer.hpp"
+#include "Wrappers/TextureEncoder.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -78,6 +81,7 @@ namespace Wrappers
 		switch (args)
 		{
 		case TextureLoadingArg::DEFAULT:
+		case TextureLoadingArg::NORMAL:
 			pOutput->textureData = ImageLoader::LoadStbi(pFilePath, &pOutput->resolution.x, &pOutput->resolution.y, &texChannels);
 			pOutput->isFloat = false;
 			break;
@@ -100,6 +104,8 @@ namespace Wrappers
 		}
 
 		pOutput->UpdateMipLevel();
+		pOutput->encoding = Resources::TextureEncoding::RAW;
+		TextureEncoder::EncodeTexture(pOutput, args == TextureLoadingArg::NORMAL, Core::App::GetInstance()->GetRenderer().SupportsBlockCompression());
 		return true;
 	}
 
@@ -223,6 +229,8 @@ namespace Wrappers
 
 		}
 		pOutput->UpdateMipLevel();
+		pOutput->encoding = Resources::TextureEncoding::RAW;
+		TextureEncoder::EncodeCubeMap(pOutput, Core::App::GetInstance()->GetRenderer().SupportsBlockCompression());
 		return true;
 	}
 }
\ No newline at end of file
@@ -52,10 +52,11 @@ constexpr std::array<const char*, (int)Resources::ObjectType::Size> dragDropReso
 	IMGUI_DRAG_DROP_SOUND_DATA_PAYLOAD,
 	IMGUI_DRAG_DROP_SCENE_PAYLOAD,
 };
-std::vector<const char*> nameResourceList{ "Model", "Texture", "CubeMap", "Material", "Mesh", "VertexShader", "FragmentShader", "GeometryShader", "ShaderProgram", "TextureSampler", "Sound", "SoundData", "Scenes"};
+std::vector<const char*> nameResourceList{ "Model", "SkinnedModel", "Texture", "CubeMap", "Material", "Mesh", "VertexShader", "FragmentShader", "GeometryShader", "ShaderProgram", "TextureSampler", "Sound", "SoundData", "Scenes"};
 std::vector<const char*> nameCreateResourceList{ "Material", "Texture Sampler", "Shader Program", "Sound", "Scene"};
 std::vector<Resources::ObjectType> typeList{
 	Resources::ObjectType::ModelType,
+	Resources::ObjectType::SkinnedModelType,
 	Resources::ObjectType::TextureType,
 	Resources::ObjectType::CubeMapType,
 	Resources::ObjectType::MaterialType,
@@ -259,7 +260,9 @@ namespace Wrappers
 
 	void Interfacing::CreateImGuiCommandBuffers()
 	{
-		imguiCommandBuffers.resize(vulkanRenderer->swapChainFramebuffers.size());
+		size_t bufferCount = vulkanRenderer->swapChainFramebuffers.size();
+		if (bufferCount < MAX_FRAMES_IN_FLIGHT) bufferCount = MAX_FRAMES_IN_FLIGHT;
+		imguiCommandBuffers.resize(bufferCount);
 
 		VkCommandBufferAllocateInfo allocInfo{};
 		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -306,6 +309,8 @@ namespace Wrappers
 		info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 		info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 		vkBeginCommandBuffer(imguiCommandBuffers[currentFrame], &info);
+		Renderer::RendererProfiler& profiler = vulkanRenderer->GetProfiler();
+		profiler.WriteScope(imguiCommandBuffers[currentFrame], profiler.PushScope("ImGui", true), false);
 
 		VkRenderPassBeginInfo renderPassInfo = {};
 		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -322,6 +327,7 @@ namespace Wrappers
 		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), imguiCommandBuffers[currentFrame]);
 
 		vkCmdEndRenderPass(imguiCommandBuffers[currentFrame]);
+		profiler.WriteScope(imguiCommandBuffers[currentFrame], profiler.PopScope(), true);
 		vkEndCommandBuffer(imguiCommandBuffers[currentFrame]);
 
 		return imguiCommandBuffers[currentFrame];
@@ -373,6 +379,66 @@ namespace Wrappers
 				ImGui::PlotHistogram("Frames", frames.data(), static_cast<s32>(frames.size()), 0, "", 0.0f, 0.1f, ImVec2(ImGui::GetWindowWidth() - 10, 100));
 				ImGui::Text("FPS: %.2f", average);
 				ImGui::Text("Frames: %lu", frameCounter);
+				if (ImGui::CollapsingHeader("Culling"))
+				{
+					for (auto& stats : vulkanRenderer->GetCullingStats())
+					{
+						ImGui::Text("%s pass: %u objects, %u frustum culled, %u backfacing, %u occluded, %u disoccluded", stats.pass & LowRenderer::RenderPassType::SECONDARY ? "Camera" : "Main", stats.counts.objects, stats.counts.frustumCulled, stats.counts.backfacing, stats.counts.occluded, stats.counts.redrawn);
+					}
+				}
+				if (ImGui::CollapsingHeader("GPU passes"))
+				{
+					Renderer::RendererProfiler& profiler = vulkanRenderer->GetProfiler();
+					if (!profiler.IsSupported())
+					{
+						ImGui::Text("Timestamps are not supported by the device");
+					}
+					else
+					{
+						bool enabled = profiler.IsEnabled();
+						if (ImGui::Checkbox("Enabled", &enabled)) profiler.SetEnabled(enabled);
+						ImGui::SameLine();
+						if (ImGui::Button("Export")) profiler.ExportCSV("gpu_profile.csv");
+						const bool statistics = profiler.HasStatistics();
+						if (ImGui::BeginTable("GPU passes", statistics ? 7 : 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit))
+						{
+							ImGui::TableSetupColumn("Scope", ImGuiTableColumnFlags_WidthStretch);
+							ImGui::TableSetupColumn("Last ms");
+							ImGui::TableSetupColumn("Avg ms");
+							ImGui::TableSetupColumn("Max ms");
+							if (statistics)
+							{
+								ImGui::TableSetupColumn("Primitives");
+								ImGui::TableSetupColumn("Vertex inv.");
+								ImGui::TableSetupColumn("Fragment inv.");
+							}
+							ImGui::TableHeadersRow();
+							for (auto& result : profiler.GetResults())
+							{
+								ImGui::TableNextRow();
+								ImGui::TableNextColumn();
+								ImGui::Indent(result.depth * 10.0f + 1.0f);
+								if (result.count > 1) ImGui::Text("%s (x%u)", result.name.c_str(), result.count);
+								else ImGui::TextUnformatted(result.name.c_str());
+								ImGui::Unindent(result.depth * 10.0f + 1.0f);
+								ImGui::TableNextColumn();
+								ImGui::Text("%.3f", result.time);
+								ImGui::TableNextColumn();
+								ImGui::Text("%.3f", result.averageTime);
+								ImGui::TableNextColumn();
+								ImGui::Text("%.3f", result.maxTime);
+								if (!statistics || !result.hasStatistics) continue;
+								ImGui::TableNextColumn();
+								ImGui::Text("%llu", static_cast<unsigned long long>(result.statistics.inputPrimitives));
+								ImGui::TableNextColumn();
+								ImGui::Text("%llu", static_cast<unsigned long long>(result.statistics.vertexInvocations));
+								ImGui::TableNextColumn();
+								ImGui::Text("%llu", static_cast<unsigned long long>(result.statistics.fragmentInvocations));
+							}
+							ImGui::EndTable();
+						}
+					}
+				}
 			}
 			ImGui::End();
 		}
@@ -1011,6 +1077,48 @@ namespace Wrappers
 		return false;
 	}
 
+	bool Interfacing::SkinnedModelListCombo(Resources::SkinnedModel** pOutSelectedModel, const char* id)
+	{
+		Text("Model  : ");
+		SameLine();
+
+		const char* defaultText = !(*pOutSelectedModel) ? "missingno" : (*pOutSelectedModel)->path.c_str();
+
+		PushId(++internalIDStack);
+
+		if (BeginCombo(id, defaultText, 0))
+		{
+			for (Resources::SkinnedModel* model : appInstance->GetResources().GetSkinnedModelList())
+			{
+				if (Selectable(model->path.c_str()))
+				{
+					*pOutSelectedModel = model;
+
+					EndCombo();
+					PopId();
+					return true;
+				}
+			}
+			EndCombo();
+		}
+
+		if (ImGui::BeginDragDropTarget())
+		{
+			const ImGuiPayload* payload = ImGui::AcceptDragDropPayload(IMGUI_DRAG_DROP_SKINNED_MODEL_PAYLOAD);
+
+			if (payload != nullptr)
+			{
+				*pOutSelectedModel = *(Resources::SkinnedModel**)payload->Data;
+				ImGui::EndDragDropTarget();
+				PopId();
+				return true;
+			}
+			ImGui::EndDragDropTarget();
+		}
+		PopId();
+		return false;
+	}
+
 	bool Interfacing::MaterialListCombo(Resources::Material** pOutSelectedMaterial, const char* id)
 	{
 		const char* defaultText = !(*pOutSelectedMaterial) ? "missingno" : (*pOutSelectedMaterial)->path.c_str();
@@ -2000,7 +2108,7 @@ namespace Wrappers
 					{
 						if (Button("Save"))
 						{
-							if (Id == Resources::ObjectType::ModelType)
+							if (Id == Resources::ObjectType::ModelType || Id == Resources::ObjectType::SkinnedModelType)
 							{
 								tempModel = reinterpret_cast<Resources::Model*>(resource);
 								for (auto mesh : tempModel->meshes)
@@ -2074,7 +2182,10 @@ namespace Wrappers
 			}
 			break;
 		case Resources::ObjectType::SkinnedModelType:
-			// TODO
+			for (Resources::SkinnedModel* model : appInstance->GetResources().GetSkinnedModelList())
+			{
+				IconResource(iconObj_Fbx, model->path, false, resourceId, model, ++index);
+			}
 			break;
 		case Resources::ObjectType::TextureSamplerType:
 			for (Resources::TextureSampler* sampler : appInstance->GetResources().GetTextureSamplerList())
@@ -2180,11 +2291,13 @@ namespace Wrappers
 		}
 		else if (extension == "obj" || extension == "fbx" || extension == "blend" || extension == "smd" || extension == "dae" || extension == "gltf" || extension == "glb" || extension == "3ds" || extension == "ase" || extension == "ifc" || extension == "dxf" || extension == "x" || extension == "ms3d")
 		{
-			Resources::Model* newModel = appInstance->GetResources().CreateResource<Resources::Model>("newModel");
-			ModelLoader::AssimpModelLoader::ParseModel(path.c_str(), newModel);
-			appInstance->GetRenderer().LoadModel(newModel);
-			appInstance->GetResources().Load(newModel->hash);
-			newModel->isSaved = false;
+			Resources::Model* newModel = ModelLoader::AssimpModelLoader::ImportModel(path.c_str(), "newModel");
+			if (newModel)
+			{
+				appInstance->GetRenderer().LoadModel(newModel);
+				appInstance->GetResources().Load(newModel->hash);
+				newModel->isSaved = false;
+			}
 		}
 		else if (extension == "cbm")
 		{
@@ -0,0 +1,299 @@
+#include "Wrappers/MeshOptimizer.hpp"
+
+#include <algorithm>
+
+#include "Core/Debugging/Log.hpp"
+
+// Dead ends closer than this to the start of the current cluster do not start a new one for the overdraw sort
+#define MESH_CLUSTER_MIN_TRIANGLES 64
+
+namespace Wrappers
+{
+	namespace
+	{
+		// Tipsify, from "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (Sander, Nehab, Barczak).
+		// Ranges are renumbered locally so meshlets of a large mesh do not pay for the whole vertex buffer each time
+		class CacheOptimizer
+		{
+		public:
+			CacheOptimizer(u32 vertexCount) : localIds(vertexCount, ~0u) {}
+
+			void Optimize(u32* indices, u32 indexCount, std::vector<u32>* clusterStarts)
+			{
+				const u32 triangleCount = indexCount / 3;
+				if (clusterStarts) clusterStarts->assign(1, 0);
+				if (triangleCount < 2) return;
+
+				globalIds.clear();
+				local.resize(triangleCount * 3);
+				for (u32 i = 0; i < triangleCount * 3; i++)
+				{
+					u32& id = localIds[indices[i]];
+					if (id == ~0u)
+					{
+						id = static_cast<u32>(globalIds.size());
+						globalIds.push_back(indices[i]);
+					}
+					local[i] = id;
+				}
+				for (auto vertex : globalIds) localIds[vertex] = ~0u;
+				const u32 vertexCount = static_cast<u32>(globalIds.size());
+
+				offsets.assign(vertexCount + 1, 0);
+				for (u32 i = 0; i < triangleCount * 3; i++) offsets[local[i] + 1]++;
+				live.resize(vertexCount);
+				for (u32 i = 0; i < vertexCount; i++)
+				{
+					live[i] = offsets[i + 1];
+					offsets[i + 1] += offsets[i];
+				}
+				adjacency.resize(triangleCount * 3);
+				fill.assign(offsets.begin(), offsets.end() - 1);
+				for (u32 i = 0; i < triangleCount * 3; i++) adjacency[fill[local[i]]++] = i / 3;
+
+				cacheTime.assign(vertexCount, 0);
+				emitted.assign(triangleCount, false);
+				deadEnds.clear();
+				output.clear();
+				u32 time = MESH_CACHE_SIZE + 1;
+				u32 cursor = 0;
+				u32 clusterStart = 0;
+				s64 fan = 0;
+				while (fan >= 0)
+				{
+					candidates.clear();
+					for (u32 i = offsets[fan]; i < offsets[fan + 1]; i++)
+					{
+						const u32 triangle = adjacency[i];
+						if (emitted[triangle]) continue;
+						emitted[triangle] = true;
+						for (u32 k = 0; k < 3; k++)
+						{
+							const u32 vertex = local[triangle * 3 + k];
+							output.push_back(vertex);
+							deadEnds.push_back(vertex);
+							candidates.push_back(vertex);
+							live[vertex]--;
+							if (time - cacheTime[vertex] > MESH_CACHE_SIZE) cacheTime[vertex] = time++;
+						}
+					}
+
+					// Fan around the vertex that stays in the cache the longest while all of its triangles are emitted
+					s64 next = -1;
+					s64 best = -1;
+					for (auto vertex : candidates)
+					{
+						if (!live[vertex]) continue;
+						s64 priority = 0;
+						if (time - cacheTime[vertex] + 2 * live[vertex] <= MESH_CACHE_SIZE) priority = time - cacheTime[vertex];
+						if (priority > best)
+						{
+							best = priority;
+							next = vertex;
+						}
+					}
+					if (next < 0)
+					{
+						while (!deadEnds.empty() && next < 0)
+						{
+							const u32 vertex = deadEnds.back();
+							deadEnds.pop_back();
+							if (live[vertex]) next = vertex;
+						}
+						while (next < 0 && cursor < vertexCount)
+						{
+							if (live[cursor]) next = cursor;
+							else cursor++;
+						}
+						const u32 emittedIndices = static_cast<u32>(output.size());
+						if (next >= 0 && clusterStarts && emittedIndices - clusterStart >= 3 * MESH_CLUSTER_MIN_TRIANGLES)
+						{
+							clusterStart = emittedIndices;
+							clusterStarts->push_back(clusterStart);
+						}
+					}
+					fan = next;
+				}
+				for (u32 i = 0; i < triangleCount * 3; i++) indices[i] = globalIds[output[i]];
+			}
+
+		private:
+			std::vector<u32> localIds;
+			std::vector<u32> globalIds;
+			std::vector<u32> local;
+			std::vector<u32> offsets;
+			std::vector<u32> fill;
+			std::vector<u32> adjacency;
+			std::vector<u32> live;
+			std::vector<u32> cacheTime;
+			std::vector<bool> emitted;
+			std::vector<u32> deadEnds;
+			std::vector<u32> candidates;
+			std::vector<u32> output;
+		};
+
+		struct Cluster
+		{
+			u32 indexOffset = 0;
+			u32 indexCount = 0;
+			// Meshlet the cluster comes from
+			u32 source = 0;
+			f32 occlusion = 0.0f;
+		};
+
+		// Area weighted centroid and normal of the triangles
+		void GetSurface(const std::vector<Renderer::RendererVertex>& vertices, const u32* indices, u32 indexCount, Maths::Vec3& centroid, Maths::Vec3& normal, f32& area)
+		{
+			centroid = Maths::Vec3();
+			normal = Maths::Vec3();
+			area = 0.0f;
+			for (u32 i = 0; i + 2 < indexCount; i += 3)
+			{
+				const Maths::Vec3& a = vertices[indices[i]].pos;
+				const Maths::Vec3& b = vertices[indices[i + 1]].pos;
+				const Maths::Vec3& c = vertices[indices[i + 2]].pos;
+				const Maths::Vec3 cross = (b - a).CrossProduct(c - a);
+				const f32 triangleArea = cross.GetLength() * 0.5f;
+				centroid += (a + b + c) * (triangleArea / 3.0f);
+				normal += cross * 0.5f;
+				area += triangleArea;
+			}
+			if (area > 0.0f) centroid = centroid / area;
+		}
+
+		// Clusters facing away from the center of the mesh are more likely to hide the others, so they are drawn first
+		void SortClusters(const std::vector<Renderer::RendererVertex>& vertices, std::vector<u32>& indices, std::vector<Cluster>& clusters)
+		{
+			Maths::Vec3 meshCentroid;
+			Maths::Vec3 meshNormal;
+			f32 meshArea;
+			GetSurface(vertices, indices.data(), static_cast<u32>(indices.size()), meshCentroid, meshNormal, meshArea);
+			for (auto& cluster : clusters)
+			{
+				Maths::Vec3 centroid;
+				Maths::Vec3 normal;
+				f32 area;
+				GetSurface(vertices, indices.data() + cluster.indexOffset, cluster.indexCount, centroid, normal, area);
+				const f32 length = normal.GetLength();
+				cluster.occlusion = length > 0.0f ? (centroid - meshCentroid).DotProduct(normal / length) : 0.0f;
+			}
+			std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.occlusion > b.occlusion; });
+
+			std::vector<u32> result;
+			result.reserve(indices.size());
+			for (auto& cluster : clusters)
+			{
+				const u32 offset = static_cast<u32>(result.size());
+				result.insert(result.end(), indices.begin() + cluster.indexOffset, indices.begin() + cluster.indexOffset + cluster.indexCount);
+				cluster.indexOffset = offset;
+			}
+			indices = std::move(result);
+		}
+
+		// Renumbers the vertices in the order the indices first reference them, unreferenced vertices are dropped
+		void OptimizeVertexFetch(Resources::Mesh* mesh)
+		{
+			std::vector<u32> remap(mesh->vertices.size(), ~0u);
+			std::vector<Renderer::RendererVertex> vertices;
+			std::vector<Resources::SkinWeight> skinWeights;
+			vertices.reserve(mesh->vertices.size());
+			skinWeights.reserve(mesh->skinWeights.size());
+			for (std::vector<u32>* indices : { &mesh->indices, &mesh->lodIndices })
+			{
+				for (auto& index : *indices)
+				{
+					if (remap[index] == ~0u)
+					{
+						remap[index] = static_cast<u32>(vertices.size());
+						vertices.push_back(mesh->vertices[index]);
+						if (mesh->IsSkinned()) skinWeights.push_back(mesh->skinWeights[index]);
+					}
+					index = remap[index];
+				}
+			}
+			mesh->vertices = std::move(vertices);
+			mesh->skinWeights = std::move(skinWeights);
+		}
+	}
+
+	void MeshOptimizer::OptimizeMesh(Resources::Mesh* mesh)
+	{
+		const u32 vertexCount = static_cast<u32>(mesh->vertices.size());
+		const u32 indexCount = static_cast<u32>(mesh->indices.size());
+		if (indexCount < 6 || !vertexCount) return;
+		const VertexCacheStats before = AnalyzeVertexCache(mesh->indices.data(), indexCount, vertexCount);
+
+		CacheOptimizer optimizer(vertexCount);
+		std::vector<Cluster> clusters;
+		if (mesh->meshlets.empty())
+		{
+			std::vector<u32> clusterStarts;
+			optimizer.Optimize(mesh->indices.data(), indexCount, &clusterStarts);
+			for (u64 i = 0; i < clusterStarts.size(); i++)
+			{
+				const u32 end = i + 1 < clusterStarts.size() ? clusterStarts[i + 1] : indexCount;
+				clusters.push_back({ clusterStarts[i], end - clusterStarts[i], 0 });
+			}
+			SortClusters(mesh->vertices, mesh->indices, clusters);
+		}
+		else
+		{
+			for (u64 i = 0; i < mesh->meshlets.size(); i++)
+			{
+				const Resources::Meshlet& meshlet = mesh->meshlets[i];
+				optimizer.Optimize(mesh->indices.data() + meshlet.indexOffset, meshlet.indexCount, nullptr);
+				clusters.push_back({ meshlet.indexOffset, meshlet.indexCount, static_cast<u32>(i) });
+			}
+			SortClusters(mesh->vertices, mesh->indices, clusters);
+			std::vector<Resources::Meshlet> meshlets;
+			meshlets.reserve(clusters.size());
+			for (auto& cluster : clusters)
+			{
+				meshlets.push_back(mesh->meshlets[cluster.source]);
+				meshlets.back().indexOffset = cluster.indexOffset;
+			}
+			mesh->meshlets = std::move(meshlets);
+		}
+
+		// Levels of detail are only reordered for the cache, they are drawn far away where overdraw costs little
+		for (u64 i = 1; i < mesh->lods.size(); i++)
+		{
+			const Resources::MeshLod& lod = mesh->lods[i];
+			optimizer.Optimize(mesh->lodIndices.data() + (lod.indexOffset - indexCount), lod.indexCount, nullptr);
+		}
+
+		OptimizeVertexFetch(mesh);
+		mesh->UpdateVectors();
+		const VertexCacheStats after = AnalyzeVertexCache(mesh->indices.data(), indexCount, static_cast<u32>(mesh->vertices.size()));
+		LOG(DEBUG_LEVEL::LINFO, "Optimized %u triangles, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", indexCount / 3, before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+
+	void MeshOptimizer::OptimizeVertexCache(u32* indices, u32 indexCount, u32 vertexCount, std::vector<u32>* clusterStarts)
+	{
+		CacheOptimizer optimizer(vertexCount);
+		optimizer.Optimize(indices, indexCount, clusterStarts);
+	}
+
+	VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount)
+	{
+		VertexCacheStats result;
+		if (indexCount < 3 || !vertexCount) return result;
+		std::vector<u32> cacheTime(vertexCount, 0);
+		u32 time = MESH_CACHE_SIZE + 1;
+		u32 misses = 0;
+		u32 uniqueVertices = 0;
+		for (u32 i = 0; i < indexCount; i++)
+		{
+			u32& vertexTime = cacheTime[indices[i]];
+			if (!vertexTime) uniqueVertices++;
+			if (time - vertexTime > MESH_CACHE_SIZE)
+			{
+				vertexTime = time++;
+				misses++;
+			}
+		}
+		result.acmr = static_cast<f32>(misses) / (indexCount / 3);
+		result.atvr = static_cast<f32>(misses) / uniqueVertices;
+		return result;
+	}
+}
@@ -0,0 +1,369 @@
+#include "Wrappers/MeshSimplifier.hpp"
+
+#include <queue>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+
+#include "Core/Debugging/Log.hpp"
+
+#define LOD_MIN_TRIANGLES 128
+
+namespace Wrappers
+{
+	namespace
+	{
+		// Sum of the squared distances to a set of planes, weighted by the area of the triangles they come from
+		struct Quadric
+		{
+			f64 m[10] = {};
+			f64 weight = 0;
+
+			void AddPlane(const f64* normal, f64 distance, f64 area)
+			{
+				const f64 plane[4] = { normal[0], normal[1], normal[2], distance };
+				u32 k = 0;
+				for (u32 i = 0; i < 4; i++)
+				{
+					for (u32 j = i; j < 4; j++) m[k++] += area * plane[i] * plane[j];
+				}
+				weight += area;
+			}
+
+			void Add(const Quadric& other)
+			{
+				for (u32 i = 0; i < 10; i++) m[i] += other.m[i];
+				weight += other.weight;
+			}
+
+			// Mean squared distance of the point to the planes
+			f64 Evaluate(const f64* position) const
+			{
+				if (weight <= 0) return 0;
+				const f64 point[4] = { position[0], position[1], position[2], 1.0 };
+				f64 result = 0;
+				u32 k = 0;
+				for (u32 i = 0; i < 4; i++)
+				{
+					for (u32 j = i; j < 4; j++) result += (i == j ? 1.0 : 2.0) * m[k++] * point[i] * point[j];
+				}
+				return std::max(result, 0.0) / weight;
+			}
+		};
+
+		struct Collapse
+		{
+			f64 cost = 0;
+			u32 from = 0;
+			u32 to = 0;
+			u32 fromVersion = 0;
+			u32 toVersion = 0;
+
+			// Cheapest collapse first in the priority queue
+			bool operator<(const Collapse& other) const { return cost > other.cost; }
+		};
+
+		void Cross(const f64* a, const f64* b, const f64* c, f64* result)
+		{
+			const f64 u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const f64 v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			result[0] = u[1] * v[2] - u[2] * v[1];
+			result[1] = u[2] * v[0] - u[0] * v[2];
+			result[2] = u[0] * v[1] - u[1] * v[0];
+		}
+
+		// Vertices sharing a position with another one (UV or normal seams) and vertices on open borders are locked,
+		// collapses only remove interior vertices and never move a seam
+		class Simplifier
+		{
+		public:
+			Simplifier(const std::vector<Renderer::RendererVertex>& vertices, const std::vector<u32>& indices);
+
+			f64 Reduce(u32 targetTriangles, f64 maxError);
+			void GetIndices(std::vector<u32>& indices) const;
+			u32 GetTriangleCount() const { return liveTriangles; }
+
+		private:
+			const f64* GetPosition(u32 vertex) const { return &positions[3llu * vertex]; }
+			void Push(u32 from, u32 to);
+			void PushEdges(u32 vertex);
+			bool CanCollapse(u32 from, u32 to) const;
+			void Apply(const Collapse& collapse);
+
+			std::vector<f64> positions;
+			std::vector<u32> canonical;
+			std::vector<bool> locked;
+			std::vector<bool> shared;
+			std::vector<bool> removed;
+			std::vector<u32> versions;
+			std::vector<Quadric> quadrics;
+			std::vector<u32> triangles;
+			std::vector<bool> liveTriangle;
+			std::vector<std::vector<u32>> vertexTriangles;
+			std::priority_queue<Collapse> queue;
+			u32 liveTriangles = 0;
+			f64 maxCost = 0;
+		};
+
+		Simplifier::Simplifier(const std::vector<Renderer::RendererVertex>& vertices, const std::vector<u32>& indices)
+		{
+			const u32 vertexCount = static_cast<u32>(vertices.size());
+			positions.resize(3llu * vertexCount);
+			for (u32 i = 0; i < vertexCount; i++)
+			{
+				positions[3llu * i] = vertices[i].pos.x;
+				positions[3llu * i + 1] = vertices[i].pos.y;
+				positions[3llu * i + 2] = vertices[i].pos.z;
+			}
+
+			// Welds the vertices by position
+			std::vector<u32> order(vertexCount);
+			for (u32 i = 0; i < vertexCount; i++) order[i] = i;
+			std::sort(order.begin(), order.end(), [this](u32 a, u32 b)
+			{
+				return std::lexicographical_compare(GetPosition(a), GetPosition(a) + 3, GetPosition(b), GetPosition(b) + 3);
+			});
+			canonical.resize(vertexCount);
+			shared.assign(vertexCount, false);
+			for (u32 i = 0; i < vertexCount; i++)
+			{
+				const bool same = i > 0 && std::equal(GetPosition(order[i]), GetPosition(order[i]) + 3, GetPosition(order[i - 1]));
+				canonical[order[i]] = same ? canonical[order[i - 1]] : order[i];
+				if (same)
+				{
+					shared[order[i]] = true;
+					shared[order[i - 1]] = true;
+				}
+			}
+
+			for (u64 i = 0; i + 2 < indices.size(); i += 3)
+			{
+				const u32 a = indices[i], b = indices[i + 1], c = indices[i + 2];
+				if (a >= vertexCount || b >= vertexCount || c >= vertexCount || a == b || b == c || a == c) continue;
+				triangles.insert(triangles.end(), { a, b, c });
+			}
+			liveTriangles = static_cast<u32>(triangles.size() / 3);
+			liveTriangle.assign(liveTriangles, true);
+
+			// Edges used by a single triangle are on a border of the mesh
+			std::unordered_map<u64, u32> edges;
+			for (u64 i = 0; i < triangles.size(); i++)
+			{
+				u32 a = canonical[triangles[i]];
+				u32 b = canonical[triangles[i % 3 == 2 ? i - 2 : i + 1]];
+				if (a > b) std::swap(a, b);
+				edges[static_cast<u64>(a) << 32 | b]++;
+			}
+			std::vector<bool> border(vertexCount, false);
+			for (auto& edge : edges)
+			{
+				if (edge.second != 1) continue;
+				border[edge.first >> 32] = true;
+				border[edge.first & 0xffffffff] = true;
+			}
+			locked.resize(vertexCount);
+			for (u32 i = 0; i < vertexCount; i++) locked[i] = shared[i] || border[canonical[i]];
+
+			removed.assign(vertexCount, false);
+			versions.assign(vertexCount, 0);
+			quadrics.resize(vertexCount);
+			vertexTriangles.resize(vertexCount);
+			for (u32 t = 0; t < liveTriangles; t++)
+			{
+				const u32* triangle = &triangles[3llu * t];
+				f64 normal[3];
+				Cross(GetPosition(triangle[0]), GetPosition(triangle[1]), GetPosition(triangle[2]), normal);
+				const f64 length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+				for (u32 k = 0; k < 3; k++) vertexTriangles[triangle[k]].push_back(t);
+				if (length <= 0) continue;
+				for (u32 k = 0; k < 3; k++) normal[k] /= length;
+				const f64* p = GetPosition(triangle[0]);
+				const f64 distance = -(normal[0] * p[0] + normal[1] * p[1] + normal[2] * p[2]);
+				for (u32 k = 0; k < 3; k++) quadrics[triangle[k]].AddPlane(normal, distance, length * 0.5);
+			}
+			for (u32 i = 0; i < vertexCount; i++) PushEdges(i);
+		}
+
+		void Simplifier::Push(u32 from, u32 to)
+		{
+			if (removed[from] || removed[to] || locked[from] || shared[to]) return;
+			Quadric quadric = quadrics[from];
+			quadric.Add(quadrics[to]);
+			queue.push({ quadric.Evaluate(GetPosition(to)), from, to, versions[from], versions[to] });
+		}
+
+		void Simplifier::PushEdges(u32 vertex)
+		{
+			for (u32 t : vertexTriangles[vertex])
+			{
+				if (!liveTriangle[t]) continue;
+				for (u32 k = 0; k < 3; k++)
+				{
+					const u32 other = triangles[3llu * t + k];
+					if (other == vertex) continue;
+					Push(vertex, other);
+					Push(other, vertex);
+				}
+			}
+		}
+
+		bool Simplifier::CanCollapse(u32 from, u32 to) const
+		{
+			// Both ends may only share the neighbours of the triangles around the edge, more would pinch the surface
+			std::vector<u32> fromNeighbours, toNeighbours;
+			u32 edgeTriangles = 0;
+			for (u32 t : vertexTriangles[from])
+			{
+				if (!liveTriangle[t]) continue;
+				const u32* triangle = &triangles[3llu * t];
+				bool hasTo = false;
+				for (u32 k = 0; k < 3; k++)
+				{
+					if (triangle[k] == to) hasTo = true;
+					else if (triangle[k] != from) fromNeighbours.push_back(canonical[triangle[k]]);
+				}
+				if (hasTo)
+				{
+					edgeTriangles++;
+					continue;
+				}
+				// The triangles kept must not flip over or turn by more than 60 degrees
+				f64 before[3], after[3];
+				const f64* corners[3] = { GetPosition(triangle[0]), GetPosition(triangle[1]), GetPosition(triangle[2]) };
+				Cross(corners[0], corners[1], corners[2], before);
+				for (u32 k = 0; k < 3; k++)
+				{
+					if (triangle[k] == from) corners[k] = GetPosition(to);
+				}
+				Cross(corners[0], corners[1], corners[2], after);
+				const f64 dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+				const f64 lengths = (before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) * (after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+				if (dot <= 0 || dot * dot < 0.25 * lengths) return false;
+			}
+			for (u32 t : vertexTriangles[to])
+			{
+				if (!liveTriangle[t]) continue;
+				for (u32 k = 0; k < 3; k++)
+				{
+					const u32 other = triangles[3llu * t + k];
+					if (other != to && other != from) toNeighbours.push_back(canonical[other]);
+				}
+			}
+			std::sort(fromNeighbours.begin(), fromNeighbours.end());
+			fromNeighbours.erase(std::unique(fromNeighbours.begin(), fromNeighbours.end()), fromNeighbours.end());
+			std::sort(toNeighbours.begin(), toNeighbours.end());
+			toNeighbours.erase(std::unique(toNeighbours.begin(), toNeighbours.end()), toNeighbours.end());
+			std::vector<u32> common;
+			std::set_intersection(fromNeighbours.begin(), fromNeighbours.end(), toNeighbours.begin(), toNeighbours.end(), std::back_inserter(common));
+			return edgeTriangles > 0 && common.size() <= edgeTriangles;
+		}
+
+		void Simplifier::Apply(const Collapse& collapse)
+		{
+			for (u32 t : vertexTriangles[collapse.from])
+			{
+				if (!liveTriangle[t]) continue;
+				u32* triangle = &triangles[3llu * t];
+				if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to)
+				{
+					liveTriangle[t] = false;
+					liveTriangles--;
+					continue;
+				}
+				for (u32 k = 0; k < 3; k++)
+				{
+					if (triangle[k] == collapse.from) triangle[k] = collapse.to;
+				}
+				vertexTriangles[collapse.to].push_back(t);
+			}
+			vertexTriangles[collapse.from].clear();
+			quadrics[collapse.to].Add(quadrics[collapse.from]);
+			removed[collapse.from] = true;
+			versions[collapse.to]++;
+			maxCost = std::max(maxCost, collapse.cost);
+			PushEdges(collapse.to);
+		}
+
+		f64 Simplifier::Reduce(u32 targetTriangles, f64 maxError)
+		{
+			const f64 limit = maxError * maxError;
+			while (liveTriangles > targetTriangles && !queue.empty())
+			{
+				const Collapse collapse = queue.top();
+				if (removed[collapse.from] || removed[collapse.to] || versions[collapse.from] != collapse.fromVersion || versions[collapse.to] != collapse.toVersion)
+				{
+					queue.pop();
+					continue;
+				}
+				if (collapse.cost > limit) break;
+				queue.pop();
+				if (CanCollapse(collapse.from, collapse.to)) Apply(collapse);
+			}
+			return std::sqrt(maxCost);
+		}
+
+		void Simplifier::GetIndices(std::vector<u32>& indices) const
+		{
+			indices.clear();
+			indices.reserve(3llu * liveTriangles);
+			for (u64 t = 0; t < liveTriangle.size(); t++)
+			{
+				if (liveTriangle[t]) indices.insert(indices.end(), triangles.begin() + 3 * t, triangles.begin() + 3 * t + 3);
+			}
+		}
+	}
+
+	void MeshSimplifier::GenerateLods(Resources::Mesh* mesh, u32 maxLods, f32 maxError)
+	{
+		// Only the previous levels are dropped, the full resolution indices and their meshlets are kept
+		mesh->UpdateVectors();
+		mesh->lodIndices.clear();
+		mesh->lods.resize(1);
+		const u32 indexCount = mesh->GetIndexCount();
+		if (indexCount < 3 * LOD_MIN_TRIANGLES || mesh->vertices.empty()) return;
+
+		Maths::Vec3 low = mesh->vertices[0].pos;
+		Maths::Vec3 high = low;
+		for (auto& vertex : mesh->vertices)
+		{
+			for (u32 k = 0; k < 3; k++)
+			{
+				low[k] = std::min(low[k], vertex.pos[k]);
+				high[k] = std::max(high[k], vertex.pos[k]);
+			}
+		}
+		const f64 extent = std::max(std::max(high.x - low.x, high.y - low.y), high.z - low.z);
+		if (extent <= 0) return;
+
+		Simplifier simplifier(mesh->vertices, mesh->indices);
+		u32 previous = simplifier.GetTriangleCount();
+		std::vector<u32> indices;
+		for (u32 i = 0; i < maxLods && previous >= LOD_MIN_TRIANGLES; i++)
+		{
+			const f64 error = simplifier.Reduce(previous / 2, maxError * extent);
+			const u32 count = simplifier.GetTriangleCount();
+			// Levels removing less than a fifth of the triangles are not worth their memory
+			if (count * 5llu > previous * 4llu) break;
+			simplifier.GetIndices(indices);
+			Resources::MeshLod lod;
+			lod.indexOffset = indexCount + static_cast<u32>(mesh->lodIndices.size());
+			lod.indexCount = static_cast<u32>(indices.size());
+			lod.error = static_cast<f32>(error / extent);
+			mesh->lods.push_back(lod);
+			mesh->lodIndices.insert(mesh->lodIndices.end(), indices.begin(), indices.end());
+			previous = count;
+		}
+		if (mesh->lods.size() > 1)
+		{
+			LOG(DEBUG_LEVEL::LINFO, "Generated %u levels of detail down to %u triangles", static_cast<u32>(mesh->lods.size() - 1), previous);
+		}
+	}
+
+	f32 MeshSimplifier::Simplify(const std::vector<Renderer::RendererVertex>& vertices, std::vector<u32>& indices, u32 targetIndexCount, f32 maxError)
+	{
+		Simplifier simplifier(vertices, indices);
+		const f64 error = simplifier.Reduce(targetIndexCount / 3, maxError);
+		simplifier.GetIndices(indices);
+		return static_cast<f32>(error);
+	}
+}
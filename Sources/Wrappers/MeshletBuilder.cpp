@@ -0,0 +1,173 @@
+#include "Wrappers/MeshletBuilder.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include "Core/Debugging/Log.hpp"
+
+namespace Wrappers
+{
+	namespace
+	{
+		u32 PackSnorm(const Maths::Vec4& value)
+		{
+			u32 result = 0;
+			for (u32 i = 0; i < 4; i++)
+			{
+				const s32 quantized = static_cast<s32>(std::round(std::clamp(value[i], -1.0f, 1.0f) * 127.0f));
+				result |= static_cast<u32>(quantized & 0xff) << (8 * i);
+			}
+			return result;
+		}
+
+		void ComputeBounds(const std::vector<Renderer::RendererVertex>& vertices, const u32* indices, u32 count, Resources::Meshlet& meshlet)
+		{
+			Maths::Vec3 min = vertices[indices[0]].pos;
+			Maths::Vec3 max = min;
+			for (u32 i = 1; i < count; i++)
+			{
+				const Maths::Vec3& pos = vertices[indices[i]].pos;
+				for (u32 j = 0; j < 3; j++)
+				{
+					min[j] = std::min(min[j], pos[j]);
+					max[j] = std::max(max[j], pos[j]);
+				}
+			}
+			meshlet.center = (min + max) * 0.5f;
+			meshlet.radius = 0.0f;
+			for (u32 i = 0; i < count; i++)
+			{
+				meshlet.radius = std::max(meshlet.radius, (vertices[indices[i]].pos - meshlet.center).GetLength());
+			}
+
+			std::vector<Maths::Vec3> normals;
+			normals.reserve(count / 3);
+			Maths::Vec3 axis;
+			for (u32 i = 0; i + 2 < count; i += 3)
+			{
+				const Maths::Vec3& a = vertices[indices[i]].pos;
+				Maths::Vec3 normal = (vertices[indices[i + 1]].pos - a).CrossProduct(vertices[indices[i + 2]].pos - a);
+				const f32 length = normal.GetLength();
+				if (length <= 1e-12f) continue;
+				normals.push_back(normal / length);
+				axis += normals.back();
+			}
+			meshlet.cone = PackSnorm(Maths::Vec4(0, 0, 0, 1));
+			if (normals.empty() || axis.GetLength() < 1e-6f) return;
+
+			// Bound the normals with the axis as the shaders will decode it, so quantization never culls a visible triangle
+			const u32 packedAxis = PackSnorm(Maths::Vec4(axis.UnitVector(), 0.0f));
+			Maths::Vec3 decoded;
+			for (u32 i = 0; i < 3; i++) decoded[i] = static_cast<s8>((packedAxis >> (8 * i)) & 0xff) / 127.0f;
+			if (decoded.GetLength() < 1e-6f) return;
+			decoded = decoded.UnitVector();
+			f32 minDot = 1.0f;
+			for (auto& normal : normals) minDot = std::min(minDot, normal.DotProduct(decoded));
+			// Cones wider than about 84 degrees only cull from viewpoints that barely exist
+			if (minDot <= 0.1f) return;
+			const f32 cutoff = std::sqrt(1.0f - minDot * minDot);
+			const s32 quantizedCutoff = std::min(static_cast<s32>(std::ceil(cutoff * 127.0f)), 127);
+			meshlet.cone = (packedAxis & 0x00ffffff) | static_cast<u32>(quantizedCutoff) << 24;
+		}
+	}
+
+	void MeshletBuilder::BuildMeshlets(Resources::Mesh* mesh)
+	{
+		mesh->meshlets.clear();
+		const std::vector<u32>& indices = mesh->indices;
+		const u32 triangleCount = static_cast<u32>(indices.size() / 3);
+		const u32 vertexCount = static_cast<u32>(mesh->vertices.size());
+		if (triangleCount < MESHLET_MIN_COUNT * MESHLET_MAX_TRIANGLES) return;
+
+		// Triangles around each vertex
+		std::vector<u32> adjacencyOffsets(vertexCount + 1, 0);
+		for (u32 i = 0; i < triangleCount * 3; i++) adjacencyOffsets[indices[i] + 1]++;
+		for (u32 i = 0; i < vertexCount; i++) adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		std::vector<u32> adjacency(triangleCount * 3);
+		std::vector<u32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (u32 i = 0; i < triangleCount * 3; i++) adjacency[fill[indices[i]]++] = i / 3;
+
+		std::vector<bool> emitted(triangleCount, false);
+		// Meshlet each vertex was last added to
+		std::vector<u32> vertexMeshlet(vertexCount, ~0u);
+		std::vector<u32> result;
+		result.reserve(triangleCount * 3);
+		// Candidates by the number of vertices they would add, entries are checked again when popped. Taking the oldest
+		// first grows the cluster in rings around its seed instead of strips
+		std::vector<u32> candidates[4];
+		u32 heads[4] = {};
+		u32 scan = 0;
+
+		auto Score = [&](u32 triangle, u32 meshletIndex)
+		{
+			u32 score = 0;
+			for (u32 i = 0; i < 3; i++) score += vertexMeshlet[indices[triangle * 3 + i]] != meshletIndex;
+			return score;
+		};
+
+		while (result.size() < triangleCount * 3)
+		{
+			const u32 meshletIndex = static_cast<u32>(mesh->meshlets.size());
+			Resources::Meshlet meshlet;
+			meshlet.indexOffset = static_cast<u32>(result.size());
+			u32 meshletVertices = 0;
+			u32 meshletTriangles = 0;
+			for (auto& bucket : candidates) bucket.clear();
+			std::fill(heads, heads + 4, 0);
+
+			while (meshletTriangles < MESHLET_MAX_TRIANGLES)
+			{
+				u32 triangle = ~0u;
+				u32 score = 0;
+				for (u32 bucket = 0; bucket < 4 && triangle == ~0u; bucket++)
+				{
+					while (heads[bucket] < candidates[bucket].size())
+					{
+						const u32 candidate = candidates[bucket][heads[bucket]++];
+						// Stale entries were pushed again with their lower score
+						if (emitted[candidate] || Score(candidate, meshletIndex) != bucket) continue;
+						triangle = candidate;
+						score = bucket;
+						break;
+					}
+				}
+				// Nothing left around the cluster, continue with the first triangle not emitted yet
+				if (triangle == ~0u)
+				{
+					while (scan < triangleCount && emitted[scan]) scan++;
+					if (scan == triangleCount) break;
+					triangle = scan;
+					score = Score(triangle, meshletIndex);
+				}
+				if (meshletVertices + score > MESHLET_MAX_VERTICES) break;
+
+				emitted[triangle] = true;
+				meshletTriangles++;
+				meshletVertices += score;
+				for (u32 i = 0; i < 3; i++)
+				{
+					const u32 vertex = indices[triangle * 3 + i];
+					result.push_back(vertex);
+					vertexMeshlet[vertex] = meshletIndex;
+				}
+				for (u32 i = 0; i < 3; i++)
+				{
+					const u32 vertex = indices[triangle * 3 + i];
+					for (u32 j = adjacencyOffsets[vertex]; j < adjacencyOffsets[vertex + 1]; j++)
+					{
+						if (!emitted[adjacency[j]]) candidates[Score(adjacency[j], meshletIndex)].push_back(adjacency[j]);
+					}
+				}
+			}
+			meshlet.indexCount = static_cast<u32>(result.size()) - meshlet.indexOffset;
+			mesh->meshlets.push_back(meshlet);
+		}
+
+		mesh->indices = std::move(result);
+		for (auto& meshlet : mesh->meshlets)
+		{
+			ComputeBounds(mesh->vertices, mesh->indices.data() + meshlet.indexOffset, meshlet.indexCount, meshlet);
+		}
+		LOG(DEBUG_LEVEL::LINFO, "Split %u triangles into %u meshlets", triangleCount, static_cast<u32>(mesh->meshlets.size()));
+	}
+}
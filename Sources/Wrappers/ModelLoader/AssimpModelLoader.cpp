@@ -1,5 +1,8 @@
 #include <vector>
 #include <filesystem>
+#include <array>
+#include <algorithm>
+#include <unordered_map>
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
@@ -13,6 +16,9 @@
 #include "Core/App.hpp"
 #include "Wrappers/ModelLoader/AssimpModelLoader.hpp"
 #include "Wrappers/ImageLoader.hpp"
+#include "Wrappers/MeshSimplifier.hpp"
+#include "Wrappers/MeshletBuilder.hpp"
+#include "Wrappers/MeshOptimizer.hpp"
 
 #include "Resources/ResourceManager.hpp"
 
@@ -20,19 +26,73 @@
 #pragma warning(disable : 26812)
 #endif
 
+// Bones a skinned mesh can index, SkinWeight stores them on 8 bits
+#define MAX_MESH_BONES 256
+// Ticks per second of the animations that do not give it
+#define DEFAULT_TICKS_PER_SECOND 25.0
+
 using namespace Wrappers::ModelLoader;
 
+namespace
+{
+	// aiMatrix4x4 is row major, Mat4 is column major
+	Maths::Mat4 ToMat4(const aiMatrix4x4& in)
+	{
+		Maths::Mat4 result;
+		for (u32 row = 0; row < 4; row++)
+		{
+			for (u32 col = 0; col < 4; col++)
+			{
+				result.content[col * 4 + row] = in[row][col];
+			}
+		}
+		return result;
+	}
+}
+
 Resources::ResourceManager* AssimpModelLoader::resources = nullptr;
 Renderer::VulkanRenderer* AssimpModelLoader::renderer = nullptr;
 
 void AssimpModelLoader::ParseModel(const char* pModelFilePath, Resources::Model* pModelOutput)
+{
+	Assimp::Importer importer;
+	const aiScene* scene = ReadScene(importer, pModelFilePath);
+	if (scene == nullptr) return;
+	std::string path = std::filesystem::path(pModelFilePath).parent_path().string();
+	AssimpModelLoader::ProcessAssimpScene(scene, pModelOutput, path);
+}
+
+Resources::Model* AssimpModelLoader::ImportModel(const char* pModelFilePath, const std::string& name)
+{
+	Assimp::Importer importer;
+	const aiScene* scene = ReadScene(importer, pModelFilePath);
+	if (scene == nullptr) return nullptr;
+	bool hasBones = false;
+	for (u32 i = 0; i < scene->mNumMeshes; i++)
+	{
+		if (scene->mMeshes[i]->HasBones()) hasBones = true;
+	}
+	Resources::Model* model = nullptr;
+	if (hasBones)
+	{
+		model = resources->CreateResource<Resources::SkinnedModel>(name);
+	}
+	else
+	{
+		model = resources->CreateResource<Resources::Model>(name);
+	}
+	std::string path = std::filesystem::path(pModelFilePath).parent_path().string();
+	AssimpModelLoader::ProcessAssimpScene(scene, model, path);
+	return model;
+}
+
+const aiScene* AssimpModelLoader::ReadScene(Assimp::Importer& importer, const char* pModelFilePath)
 {
 	if (!resources)
 	{
 		resources = &Core::App::GetInstance()->GetResources();
 		renderer = &Core::App::GetInstance()->GetRenderer();
 	}
-	Assimp::Importer importer;
 
 	/*
 	* 
@@ -53,18 +113,15 @@ void AssimpModelLoader::ParseModel(const char* pModelFilePath, Resources::Model*
 		aiProcess_JoinIdenticalVertices |
 		aiProcess_CalcTangentSpace |
 		aiProcess_GenBoundingBoxes |
+		aiProcess_LimitBoneWeights |
 		aiProcess_FlipUVs
 	);
 
 	if (scene == nullptr)
 	{
 		LOG(DEBUG_LEVEL::LERROR, importer.GetErrorString());
-		return;
 	}
-	std::string path = std::filesystem::path(pModelFilePath).parent_path().string();
-	AssimpModelLoader::ProcessAssimpScene(scene, pModelOutput, path);
-
-	return;
+	return scene;
 }
 
 void AssimpModelLoader::ProcessAssimpScene(const aiScene* pScene, Resources::Model* pModelOutput, const std::string& path)
@@ -79,6 +136,10 @@ void AssimpModelLoader::ProcessAssimpScene(const aiScene* pScene, Resources::Mod
 
 	pModelOutput->shader = Resources::ShaderProgram::GetDefaultShader();
 
+	Resources::SkinnedModel* skinnedModel = dynamic_cast<Resources::SkinnedModel*>(pModelOutput);
+	std::vector<u32> meshNodes;
+	if (skinnedModel) ReadSkeleton(pScene, skinnedModel, meshNodes);
+
 	LOG_DEFAULT("Model Loader : Number of meshes : %i", pScene->mNumMeshes);
 
 	for (u32 i = 0; i < pScene->mNumMeshes; i++)
@@ -108,9 +169,82 @@ void AssimpModelLoader::ProcessAssimpScene(const aiScene* pScene, Resources::Mod
 		meshes[i]->aabb.center = meshes[i]->aabb.size / 2 + currentMesh->mAABB.mMin;
 		ReadMaterialProperties(materials[i], mat, meshName, path);
 
-		ReadMeshVertices(meshes[i], currentMesh);
+		ReadMeshVertices(meshes[i], currentMesh, skinnedModel, skinnedModel ? meshNodes[i] : 0);
 	}
 
+	if (skinnedModel) ReadAnimations(pScene, skinnedModel);
+}
+
+void AssimpModelLoader::ReadSkeleton(const aiScene* pScene, Resources::SkinnedModel* pModelOutput, std::vector<u32>& meshNodes)
+{
+	std::vector<Resources::SkeletonNode>& nodes = pModelOutput->nodes;
+	nodes.clear();
+	meshNodes.assign(pScene->mNumMeshes, 0);
+	// Depth first, so every parent is stored before its children
+	std::vector<std::pair<const aiNode*, s32>> stack = { { pScene->mRootNode, -1 } };
+	while (!stack.empty())
+	{
+		auto [node, parent] = stack.back();
+		stack.pop_back();
+		const u32 index = static_cast<u32>(nodes.size());
+		nodes.push_back({ node->mName.C_Str(), parent, ToMat4(node->mTransformation) });
+		for (u32 i = 0; i < node->mNumMeshes; i++)
+		{
+			if (node->mMeshes[i] < pScene->mNumMeshes) meshNodes[node->mMeshes[i]] = index;
+		}
+		for (u32 i = node->mNumChildren; i > 0; i--)
+		{
+			stack.push_back({ node->mChildren[i - 1], static_cast<s32>(index) });
+		}
+	}
+	LOG_DEFAULT("Model Loader : Number of skeleton nodes : %i", static_cast<u32>(nodes.size()));
+}
+
+void AssimpModelLoader::ReadAnimations(const aiScene* pScene, Resources::SkinnedModel* pModelOutput)
+{
+	std::unordered_map<std::string, u32> nodeIndices;
+	for (u32 i = 0; i < pModelOutput->nodes.size(); i++)
+	{
+		nodeIndices.emplace(pModelOutput->nodes[i].name, i);
+	}
+	pModelOutput->animations.resize(pScene->mNumAnimations);
+	for (u32 i = 0; i < pScene->mNumAnimations; i++)
+	{
+		const aiAnimation* animIn = pScene->mAnimations[i];
+		Resources::Animation& animation = pModelOutput->animations[i];
+		const f64 ticksPerSecond = animIn->mTicksPerSecond > 0 ? animIn->mTicksPerSecond : DEFAULT_TICKS_PER_SECOND;
+		animation.name = animIn->mName.length ? animIn->mName.C_Str() : "Animation " + std::to_string(i);
+		animation.duration = static_cast<f32>(animIn->mDuration / ticksPerSecond);
+		for (u32 j = 0; j < animIn->mNumChannels; j++)
+		{
+			const aiNodeAnim* channelIn = animIn->mChannels[j];
+			auto node = nodeIndices.find(channelIn->mNodeName.C_Str());
+			if (node == nodeIndices.end())
+			{
+				LOG(DEBUG_LEVEL::LWARNING, "Animation %s moves unknown node %s", animation.name.c_str(), channelIn->mNodeName.C_Str());
+				continue;
+			}
+			Resources::AnimationChannel& channel = animation.channels.emplace_back();
+			channel.node = node->second;
+			channel.positions.resize(channelIn->mNumPositionKeys);
+			for (u32 k = 0; k < channelIn->mNumPositionKeys; k++)
+			{
+				channel.positions[k] = { static_cast<f32>(channelIn->mPositionKeys[k].mTime / ticksPerSecond), channelIn->mPositionKeys[k].mValue };
+			}
+			channel.rotations.resize(channelIn->mNumRotationKeys);
+			for (u32 k = 0; k < channelIn->mNumRotationKeys; k++)
+			{
+				const aiQuaternion& q = channelIn->mRotationKeys[k].mValue;
+				channel.rotations[k] = { static_cast<f32>(channelIn->mRotationKeys[k].mTime / ticksPerSecond), Maths::Quat(Maths::Vec3(q.x, q.y, q.z), q.w) };
+			}
+			channel.scales.resize(channelIn->mNumScalingKeys);
+			for (u32 k = 0; k < channelIn->mNumScalingKeys; k++)
+			{
+				channel.scales[k] = { static_cast<f32>(channelIn->mScalingKeys[k].mTime / ticksPerSecond), channelIn->mScalingKeys[k].mValue };
+			}
+		}
+	}
+	LOG_DEFAULT("Model Loader : Number of animations : %i", pScene->mNumAnimations);
 }
 
 void AssimpModelLoader::ReadTexture(Resources::StaticTexture*& texture, const std::string& folder, const char* path, bool isNormal)
@@ -125,7 +259,7 @@ void AssimpModelLoader::ReadTexture(Resources::StaticTexture*& texture, const st
 		}
 	}
 	texture = resources->CreateResource<Resources::StaticTexture>(p.filename().string());
-	if (Wrappers::ImageLoader::ParseTexture(p.string().c_str(), texture))
+	if (Wrappers::ImageLoader::ParseTexture(p.string().c_str(), texture, isNormal ? Wrappers::TextureLoadingArg::NORMAL : Wrappers::TextureLoadingArg::DEFAULT))
 	{
 		texture->isLoaded = renderer->LoadTexture(texture);
 	}
@@ -220,7 +354,7 @@ void AssimpModelLoader::ReadMaterialProperties(Resources::Material*& modelMat, a
 	}
 }
 
-void AssimpModelLoader::ReadMeshVertices(Resources::Mesh*& modelMesh, const aiMesh* meshIn)
+void AssimpModelLoader::ReadMeshVertices(Resources::Mesh*& modelMesh, const aiMesh* meshIn, const Resources::SkinnedModel* skeleton, u32 meshNode)
 {
 	std::vector<Renderer::RendererVertex> vertices(meshIn->mNumVertices);
 
@@ -290,5 +424,94 @@ void AssimpModelLoader::ReadMeshVertices(Resources::Mesh*& modelMesh, const aiMe
 
 	modelMesh->vertices = std::move(vertices);
 	modelMesh->indices = std::move(indices); 
+	if (skeleton) ReadSkinWeights(modelMesh, meshIn, skeleton, meshNode);
 	modelMesh->UpdateVectors();
+	// Meshlets are built last since they reorder the full resolution indices, the optimizer then keeps them whole
+	Wrappers::MeshSimplifier::GenerateLods(modelMesh);
+	Wrappers::MeshletBuilder::BuildMeshlets(modelMesh);
+	Wrappers::MeshOptimizer::OptimizeMesh(modelMesh);
+	if (modelMesh->meshlets.empty() && modelMesh->GetIndexCount() >= 3 * MESHLET_MIN_COUNT * MESHLET_MAX_TRIANGLES)
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Mesh %s lost its meshlets during import", meshIn->mName.C_Str());
+	}
+}
+
+void AssimpModelLoader::ReadSkinWeights(Resources::Mesh* modelMesh, const aiMesh* meshIn, const Resources::SkinnedModel* skeleton, u32 meshNode)
+{
+	std::unordered_map<std::string, u32> nodeIndices;
+	for (u32 i = 0; i < skeleton->nodes.size(); i++)
+	{
+		nodeIndices.emplace(skeleton->nodes[i].name, i);
+	}
+	// A mesh without bones follows the node it is attached to
+	if (!meshIn->HasBones())
+	{
+		modelMesh->bones = { { meshNode, Maths::Mat4(1) } };
+		modelMesh->skinWeights.assign(meshIn->mNumVertices, { { 0, 0, 0, 0 }, { 255, 0, 0, 0 } });
+		return;
+	}
+
+	const u32 boneCount = std::min(meshIn->mNumBones, static_cast<u32>(MAX_MESH_BONES));
+	if (meshIn->mNumBones > MAX_MESH_BONES)
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "Mesh %s has %u bones, only the first %u are kept", modelMesh->path.c_str(), meshIn->mNumBones, MAX_MESH_BONES);
+	}
+	struct Influence
+	{
+		u32 bone = 0;
+		f32 weight = 0.0f;
+	};
+	std::vector<std::array<Influence, 4>> influences(meshIn->mNumVertices);
+	modelMesh->bones.resize(boneCount);
+	for (u32 i = 0; i < boneCount; i++)
+	{
+		const aiBone* boneIn = meshIn->mBones[i];
+		auto node = nodeIndices.find(boneIn->mName.C_Str());
+		if (node == nodeIndices.end())
+		{
+			LOG(DEBUG_LEVEL::LWARNING, "Bone %s of mesh %s is not in the skeleton", boneIn->mName.C_Str(), modelMesh->path.c_str());
+		}
+		modelMesh->bones[i] = { node == nodeIndices.end() ? meshNode : node->second, ToMat4(boneIn->mOffsetMatrix) };
+		for (u32 j = 0; j < boneIn->mNumWeights; j++)
+		{
+			const aiVertexWeight& weight = boneIn->mWeights[j];
+			if (weight.mVertexId >= meshIn->mNumVertices) continue;
+			// Keeps the four strongest influences, sorted by decreasing weight
+			auto& slots = influences[weight.mVertexId];
+			if (weight.mWeight <= slots[3].weight) continue;
+			slots[3] = { i, weight.mWeight };
+			for (u32 k = 3; k > 0 && slots[k].weight > slots[k - 1].weight; k--)
+			{
+				std::swap(slots[k], slots[k - 1]);
+			}
+		}
+	}
+
+	u32 unweighted = 0;
+	modelMesh->skinWeights.resize(meshIn->mNumVertices);
+	for (u32 i = 0; i < meshIn->mNumVertices; i++)
+	{
+		const auto& slots = influences[i];
+		Resources::SkinWeight& skin = modelMesh->skinWeights[i];
+		const f32 total = slots[0].weight + slots[1].weight + slots[2].weight + slots[3].weight;
+		if (total <= 0.0f)
+		{
+			skin.weights[0] = 255;
+			unweighted++;
+			continue;
+		}
+		// Rounds every weight and gives the rounding error to the strongest one so they sum to 255
+		u32 sum = 0;
+		for (u32 k = 0; k < 4; k++)
+		{
+			skin.bones[k] = static_cast<u8>(slots[k].bone);
+			skin.weights[k] = static_cast<u8>(slots[k].weight / total * 255.0f + 0.5f);
+			sum += skin.weights[k];
+		}
+		skin.weights[0] = static_cast<u8>(static_cast<s32>(skin.weights[0]) + 255 - static_cast<s32>(sum));
+	}
+	if (unweighted)
+	{
+		LOG(DEBUG_LEVEL::LWARNING, "%u vertices of mesh %s have no bone weight, they follow its first bone", unweighted, modelMesh->path.c_str());
+	}
 }
@@ -18,7 +18,6 @@ namespace Wrappers::PhysicsEngine
 		Vertex vertex = { JPH::Float3(0, 0, 0), JPH::Float3(1, 0, 0), JPH::Float2(0, 0), JPH::Color::sWhite };
 		u32 indices[] = { 0,1,2 };
 		mEmptyBatch = CreateTriangleBatch(&vertex, 1, indices, 3);
-		mLines = Core::App::GetInstance()->GetResources().CreateFixedResource<Resources::Mesh>("line_mesh", 0xf, false);
 	}
 
 	void						VulkanColliderRenderer::Render()
@@ -53,13 +52,11 @@ namespace Wrappers::PhysicsEngine
 		vertex.color	= inColor;
 		vertex.pos		= Maths::Vec3(inFrom.x,  inFrom.y,  inFrom.z);
 
-		mLines->vertices.push_back(vertex);
-		mLines->indices.push_back(mLines->indices.size());
+		mLines.push_back(vertex);
 
 		vertex.pos		= Maths::Vec3(inTo.x, inTo.y, inTo.z);
 
-		mLines->vertices.push_back(vertex);
-		mLines->indices.push_back(mLines->indices.size());
+		mLines.push_back(vertex);
 	}
 
 	///Realisticly, this will most likely never be called, it looks like jolt prefer to use triagnle batches for almost everything
@@ -73,15 +70,15 @@ namespace Wrappers::PhysicsEngine
 
 		vertex.pos = Maths::Vec3(inV1.GetX(), inV1.GetY(), inV1.GetZ());
 
-		mTriangles.vertices.push_back(vertex);
+		mTriangles.push_back(vertex);
 
 		vertex.pos = Maths::Vec3(inV2.GetX(), inV2.GetY(), inV2.GetZ());
 
-		mTriangles.vertices.push_back(vertex);
+		mTriangles.push_back(vertex);
 
 		vertex.pos = Maths::Vec3(inV3.GetX(), inV3.GetY(), inV3.GetZ());
 
-		mTriangles.vertices.push_back(vertex);
+		mTriangles.push_back(vertex);
 	}
 
 	JPH::DebugRenderer::Batch	VulkanColliderRenderer::CreateTriangleBatch(const Triangle* inTriangles, int inTriangleCount)
@@ -136,45 +133,52 @@ namespace Wrappers::PhysicsEngine
 	void						VulkanColliderRenderer::DrawLines()
 	{
 		std::lock_guard lock(mLinesLock);
-		mLines->UpdateVectors();
-		if (mLines->GetVertexCount() > 0)
-		{	
-			if (mLines->isLoaded)
-			{
-				mRenderer->UnloadMesh(mLines);
-				mLines->isLoaded = false;
-			}
-			mLines->isLoaded = mRenderer->LoadMesh(mLines);
-			if (mLines->isLoaded) mRenderer->DrawIndexedRenderMesh(&mLines->rendererMesh, Maths::Mat4::Identity(), mLines->GetVertexCount(), mLines->GetIndexCount());
-
-		}
+		mRenderer->DrawTransientGeometry(mLines.data(), static_cast<u32>(mLines.size()), nullptr, 0);
 	}
 
 	void						VulkanColliderRenderer::DrawTriangles()
 	{	
 		std::lock_guard	lock(mWireFrameLock);
 
-		for (InstanceMap::value_type instance : mWireframeInstances)
+		Resources::ShaderProgram* wire = Core::App::GetInstance()->GetResources().Get<Resources::ShaderProgram>(0x29);
+		bool instanced = !mWireframeInstances.empty() && mRenderer->BindInstancedWireframe(wire);
+
+		for (InstanceMap::value_type& instance : mWireframeInstances)
 		{
 			Geometry* geometry = instance.first.GetPtr();
+			BatchImpl* triangleBatch = nullptr;
 			for (InstanceInfo& infos : instance.second)
 			{
-				BatchImpl* triangleBatch = static_cast<BatchImpl*>(geometry->mLODs[infos.mLOD].mTriangleBatch.GetPtr());
-				mRenderer->DrawIndexedRenderMesh(triangleBatch, infos.mModelMatrix, triangleBatch->GetVertexCount(), triangleBatch->GetIndiceCount());
+				BatchImpl* batch = static_cast<BatchImpl*>(geometry->mLODs[infos.mLOD].mTriangleBatch.GetPtr());
+				if (batch != triangleBatch)
+				{
+					DrawInstances(triangleBatch, instanced);
+					triangleBatch = batch;
+				}
+				mInstanceMatrices.push_back(infos.mModelMatrix);
 			}
+			DrawInstances(triangleBatch, instanced);
 		}
 
+		if (instanced)
+			mRenderer->BindShader(wire);
+
 		std::lock_guard triangleLock(mTrianglesLock);
+		mRenderer->DrawTransientGeometry(mTriangles.data(), static_cast<u32>(mTriangles.size()), nullptr, 0);
+	}
 
-		if (mTriangles.GetVertexCount() > 0)
+	void						VulkanColliderRenderer::DrawInstances(BatchImpl* pBatch, bool pInstanced)
+	{
+		if (pBatch && pInstanced)
 		{
-
-			mRenderer->LoadMesh(&mTriangles);
-
-			mRenderer->DrawIndexedRenderMesh(&mTriangles.rendererMesh, Maths::Mat4::Identity(), mTriangles.GetVertexCount(), mTriangles.GetIndexCount() );
-
-			mRenderer->UnloadMesh(&mTriangles);
+			mRenderer->DrawInstancedRenderMesh(pBatch, mInstanceMatrices.data(), static_cast<u32>(mInstanceMatrices.size()), pBatch->GetVertexCount(), pBatch->GetIndiceCount());
+		}
+		else if (pBatch)
+		{
+			for (const Maths::Mat4& modelMatrix : mInstanceMatrices)
+				mRenderer->DrawIndexedRenderMesh(pBatch, modelMatrix, pBatch->GetVertexCount(), pBatch->GetIndiceCount());
 		}
+		mInstanceMatrices.clear();
 	}
 
 	void						VulkanColliderRenderer::CleanBuffers()
@@ -190,14 +194,13 @@ namespace Wrappers::PhysicsEngine
 	{
 		std::lock_guard lock(mLinesLock);
 
-		mLines->vertices.clear();
-		mLines->indices.clear();
+		mLines.clear();
 	}
 
 	void						VulkanColliderRenderer::CleanTriangles()
 	{
 		std::lock_guard lock(mTrianglesLock);
 
-		mTriangles.vertices.clear();
+		mTriangles.clear();
 	}
 }
\ No newline at end of file
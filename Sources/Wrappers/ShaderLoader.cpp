@@ -17,6 +17,17 @@ std::string exec(const std::string& program, const std::string& arg)
     return Core::FileManager::LoadFile("output.txt");
 }
 
+// Cached SPIR-V is named after the whole source path, shaders sharing a file name in different folders do not overwrite each other
+std::string GetCachedPath(const std::filesystem::path& source)
+{
+    std::string name = source.lexically_normal().generic_string();
+    for (char& c : name)
+    {
+        if (c == '/' || c == '\\' || c == ':') c = '_';
+    }
+    return std::filesystem::current_path().string() + "/Cache/Shaders/" + name + ".spv";
+}
+
 std::string Wrappers::ShaderLoader::LoadCompileShader(char const* filename)
 {
     std::filesystem::path p = filename;
@@ -33,7 +44,10 @@ std::string Wrappers::ShaderLoader::LoadCompileShader(char const* filename)
 #else
     program = "/bin/glslc\"";
 #endif
-    std::string output = std::filesystem::current_path().string() + "/Cache/Shaders/" + p.filename().string() + ".spv";
+    std::string output = GetCachedPath(p);
+    // A failed build must not hand back the SPIR-V of an older version of the source
+    std::error_code error;
+    std::filesystem::remove(output, error);
     cmd += " \"";
     if (p.is_relative())
     {
@@ -57,3 +71,15 @@ std::string Wrappers::ShaderLoader::LoadCompileShader(char const* filename)
 
 	return Core::FileManager::LoadFile(output.c_str());
 }
+
+std::string Wrappers::ShaderLoader::LoadCachedShader(char const* filename)
+{
+    std::filesystem::path p = filename;
+    std::filesystem::path cached = GetCachedPath(p);
+    std::error_code error;
+    if (std::filesystem::exists(cached) && (!std::filesystem::exists(p) || std::filesystem::last_write_time(cached, error) >= std::filesystem::last_write_time(p, error)))
+    {
+        return Core::FileManager::LoadFile(cached.string().c_str());
+    }
+    return LoadCompileShader(filename);
+}
\ No newline at end of file
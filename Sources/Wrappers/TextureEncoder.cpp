@@ -0,0 +1,542 @@
+#include "Wrappers/TextureEncoder.hpp"
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "Core/Debugging/Log.hpp"
+#include "Wrappers/ImageLoader.hpp"
+
+namespace Wrappers
+{
+	namespace
+	{
+		// Little-endian bit fields, in the order the BC7 specification lists them
+		struct BlockWriter
+		{
+			u8* output = nullptr;
+			u32 position = 0;
+
+			void Write(u32 value, u32 bits)
+			{
+				for (u32 i = 0; i < bits; i++, position++)
+				{
+					output[position >> 3] |= static_cast<u8>(((value >> i) & 1) << (position & 7));
+				}
+			}
+		};
+
+		// Extremes of the block along the main axis of its colours, found by power iteration on their covariance
+		void GetBlockEndpoints(const u8* texels, u32 channels, f32* low, f32* high)
+		{
+			f32 mean[4] = {};
+			for (u32 i = 0; i < 16; i++)
+			{
+				for (u32 c = 0; c < channels; c++) mean[c] += texels[i * 4 + c] / 16.0f;
+			}
+			f32 covariance[4][4] = {};
+			for (u32 i = 0; i < 16; i++)
+			{
+				for (u32 a = 0; a < channels; a++)
+				{
+					for (u32 b = 0; b < channels; b++)
+					{
+						covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+					}
+				}
+			}
+			f32 axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			for (u32 iteration = 0; iteration < 8; iteration++)
+			{
+				f32 next[4] = {};
+				f32 largest = 0.0f;
+				for (u32 a = 0; a < channels; a++)
+				{
+					for (u32 b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+					largest = std::max(largest, std::fabs(next[a]));
+				}
+				if (largest <= 0.0f) break;
+				for (u32 a = 0; a < channels; a++) axis[a] = next[a] / largest;
+			}
+			f32 length = 0.0f;
+			for (u32 c = 0; c < channels; c++) length += axis[c] * axis[c];
+			length = std::sqrt(length);
+			f32 minT = 0.0f;
+			f32 maxT = 0.0f;
+			if (length > 0.0f)
+			{
+				for (u32 c = 0; c < channels; c++) axis[c] /= length;
+				for (u32 i = 0; i < 16; i++)
+				{
+					f32 t = 0.0f;
+					for (u32 c = 0; c < channels; c++) t += (texels[i * 4 + c] - mean[c]) * axis[c];
+					minT = std::min(minT, t);
+					maxT = std::max(maxT, t);
+				}
+			}
+			for (u32 c = 0; c < channels; c++)
+			{
+				low[c] = std::clamp(mean[c] + axis[c] * minT, 0.0f, 255.0f);
+				high[c] = std::clamp(mean[c] + axis[c] * maxT, 0.0f, 255.0f);
+			}
+		}
+
+		u16 Pack565(const f32* color)
+		{
+			u16 r = static_cast<u16>(std::lround(color[0] * 31.0f / 255.0f));
+			u16 g = static_cast<u16>(std::lround(color[1] * 63.0f / 255.0f));
+			u16 b = static_cast<u16>(std::lround(color[2] * 31.0f / 255.0f));
+			return static_cast<u16>((r << 11) | (g << 5) | b);
+		}
+
+		void Unpack565(u16 packed, s32* color)
+		{
+			s32 r = (packed >> 11) & 0x1f;
+			s32 g = (packed >> 5) & 0x3f;
+			s32 b = packed & 0x1f;
+			color[0] = (r << 3) | (r >> 2);
+			color[1] = (g << 2) | (g >> 4);
+			color[2] = (b << 3) | (b >> 2);
+		}
+
+		void EncodeBC4Block(const u8* texels, u32 channel, u8* output)
+		{
+			u8 minValue = 255;
+			u8 maxValue = 0;
+			for (u32 i = 0; i < 16; i++)
+			{
+				minValue = std::min(minValue, texels[i * 4 + channel]);
+				maxValue = std::max(maxValue, texels[i * 4 + channel]);
+			}
+			// The first endpoint being the largest selects the 8 value palette
+			output[0] = maxValue;
+			output[1] = minValue;
+			u64 bits = 0;
+			if (maxValue > minValue)
+			{
+				for (u32 i = 0; i < 16; i++)
+				{
+					s32 step = static_cast<s32>(std::lround((texels[i * 4 + channel] - minValue) * 7.0f / (maxValue - minValue)));
+					u64 index = step == 7 ? 0 : (step == 0 ? 1 : 8 - step);
+					bits |= index << (3 * i);
+				}
+			}
+			for (u32 i = 0; i < 6; i++) output[2 + i] = static_cast<u8>(bits >> (8 * i));
+		}
+
+		// Quantizes an endpoint to 7 bits per channel, picking the shared low bit closest to it
+		void QuantizeBC7Endpoint(const f32* color, u32* quantized, u32& pBit)
+		{
+			f32 bestError = -1.0f;
+			for (u32 p = 0; p < 2; p++)
+			{
+				u32 values[4];
+				f32 error = 0.0f;
+				for (u32 c = 0; c < 4; c++)
+				{
+					values[c] = static_cast<u32>(std::clamp(std::lround((color[c] - p) / 2.0f), 0l, 127l));
+					f32 delta = static_cast<f32>((values[c] << 1) | p) - color[c];
+					error += delta * delta;
+				}
+				if (bestError < 0.0f || error < bestError)
+				{
+					bestError = error;
+					pBit = p;
+					std::copy(values, values + 4, quantized);
+				}
+			}
+		}
+
+		// Box filter of the previous level for each layer, normal maps are averaged as vectors and renormalized
+		void DownsampleLevel(const std::vector<f32>& source, Maths::IVec2 sourceRes, std::vector<f32>& result, Maths::IVec2 resultRes, u32 layers, bool normalMap)
+		{
+			u64 sourceLayer = 4llu * sourceRes.x * sourceRes.y;
+			u64 resultLayer = 4llu * resultRes.x * resultRes.y;
+			result.resize(resultLayer * layers);
+			for (u32 layer = 0; layer < layers; layer++)
+			{
+				for (s32 y = 0; y < resultRes.y; y++)
+				{
+					const f32* row0 = &source[sourceLayer * layer + 4llu * std::min(2 * y, sourceRes.y - 1) * sourceRes.x];
+					const f32* row1 = &source[sourceLayer * layer + 4llu * std::min(2 * y + 1, sourceRes.y - 1) * sourceRes.x];
+					f32* output = &result[resultLayer * layer + 4llu * y * resultRes.x];
+					for (s32 x = 0; x < resultRes.x; x++)
+					{
+						u64 x0 = 4llu * std::min(2 * x, sourceRes.x - 1);
+						u64 x1 = 4llu * std::min(2 * x + 1, sourceRes.x - 1);
+						f32* texel = output + 4llu * x;
+						for (u32 c = 0; c < 4; c++) texel[c] = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+						if (!normalMap) continue;
+						f32 n[3];
+						f32 length = 0.0f;
+						for (u32 c = 0; c < 3; c++)
+						{
+							n[c] = texel[c] * 2.0f - 1.0f;
+							length += n[c] * n[c];
+						}
+						length = length > 0.0f ? std::sqrt(length) : 1.0f;
+						for (u32 c = 0; c < 3; c++) texel[c] = (n[c] / length + 1.0f) * 0.5f;
+					}
+				}
+			}
+		}
+
+		f32 SrgbToLinear(f32 value)
+		{
+			return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		f32 LinearToSrgb(f32 value)
+		{
+			return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+		}
+
+		u8 QuantizeUnorm(f32 value)
+		{
+			return static_cast<u8>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+		}
+
+		Resources::TextureEncoding SelectEncoding(const void* data, bool isFloat, u64 texelCount, bool normalMap, bool blockCompression)
+		{
+			if (!isFloat)
+			{
+				const u8* texels = static_cast<const u8*>(data);
+				bool opaque = true;
+				for (u64 i = 3; i < 4 * texelCount && opaque; i += 4)
+				{
+					opaque = texels[i] == 255;
+				}
+				if (!blockCompression) return Resources::TextureEncoding::RGBA8;
+				return normalMap ? Resources::TextureEncoding::BC5 : (opaque ? Resources::TextureEncoding::BC1 : Resources::TextureEncoding::BC7);
+			}
+			const f32* texels = static_cast<const f32*>(data);
+			bool opaque = true;
+			f32 minValue = 0.0f;
+			f32 maxValue = 0.0f;
+			for (u64 i = 0; i < 4 * texelCount; i += 4)
+			{
+				for (u32 c = 0; c < 3; c++)
+				{
+					// Also rejects NaN, which compares false on both sides
+					if (!(std::fabs(texels[i + c]) <= 65504.0f)) return Resources::TextureEncoding::RAW;
+					minValue = std::min(minValue, texels[i + c]);
+					maxValue = std::max(maxValue, texels[i + c]);
+				}
+				if (!(std::fabs(texels[i + 3]) <= 65504.0f)) return Resources::TextureEncoding::RAW;
+				opaque = opaque && texels[i + 3] == 1.0f;
+			}
+			return opaque && minValue >= 0.0f && maxValue <= 65408.0f ? Resources::TextureEncoding::RGB9E5 : Resources::TextureEncoding::RGBA16F;
+		}
+
+		// Writes one layer of a level, the level holding normalized values for LDR images
+		u8* EncodeLevel(const f32* level, Maths::IVec2 levelRes, Resources::TextureEncoding encoding, u8* output)
+		{
+			u64 texelCount = static_cast<u64>(levelRes.x) * levelRes.y;
+			switch (encoding)
+			{
+			case Resources::TextureEncoding::RGBA8:
+				for (u64 i = 0; i < 4 * texelCount; i++) *output++ = QuantizeUnorm(level[i]);
+				return output;
+			case Resources::TextureEncoding::RGBA16F:
+				for (u64 i = 0; i < 4 * texelCount; i++)
+				{
+					u16 half = Maths::Util::FloatToHalf(level[i]);
+					std::memcpy(output, &half, sizeof(u16));
+					output += sizeof(u16);
+				}
+				return output;
+			case Resources::TextureEncoding::RGB9E5:
+				for (u64 i = 0; i < texelCount; i++)
+				{
+					u32 packed = TextureEncoder::PackRGB9E5(level + 4 * i);
+					std::memcpy(output, &packed, sizeof(u32));
+					output += sizeof(u32);
+				}
+				return output;
+			default:
+				break;
+			}
+			u64 blockSize = TextureEncoder::GetBlockSize(encoding);
+			for (s32 by = 0; by < levelRes.y; by += 4)
+			{
+				for (s32 bx = 0; bx < levelRes.x; bx += 4)
+				{
+					// Texels past the edge repeat the last row and column
+					u8 texels[64];
+					for (s32 i = 0; i < 16; i++)
+					{
+						s32 x = std::min(bx + (i & 3), levelRes.x - 1);
+						s32 y = std::min(by + (i >> 2), levelRes.y - 1);
+						for (u32 c = 0; c < 4; c++) texels[i * 4 + c] = QuantizeUnorm(level[4llu * (y * levelRes.x + x) + c]);
+					}
+					std::memset(output, 0, blockSize);
+					switch (encoding)
+					{
+					case Resources::TextureEncoding::BC1:
+						TextureEncoder::EncodeBC1Block(texels, output);
+						break;
+					case Resources::TextureEncoding::BC5:
+						TextureEncoder::EncodeBC5Block(texels, output);
+						break;
+					default:
+						TextureEncoder::EncodeBC7Block(texels, output);
+						break;
+					}
+					output += blockSize;
+				}
+			}
+			return output;
+		}
+
+		// Returns the encoded chain of every layer, or nullptr when the data is better kept as it is
+		void* EncodeLayers(const void* data, bool isFloat, Maths::IVec2 resolution, u32 mipLevels, u32 layers, bool normalMap, bool blockCompression, Resources::TextureEncoding& encoding)
+		{
+			u64 layerSize = 4llu * resolution.x * resolution.y;
+			encoding = SelectEncoding(data, isFloat, layerSize / 4 * layers, normalMap, blockCompression);
+			if (encoding == Resources::TextureEncoding::RAW) return nullptr;
+			u8* result = static_cast<u8*>(malloc(TextureEncoder::GetEncodedSize(encoding, resolution, mipLevels, layers)));
+			if (!result)
+			{
+				LOG(DEBUG_LEVEL::LERROR, "Could not allocate the encoded texture !");
+				return nullptr;
+			}
+
+			std::vector<f32> level(layerSize * layers);
+			if (isFloat)
+			{
+				std::copy_n(static_cast<const f32*>(data), level.size(), level.data());
+			}
+			else
+			{
+				const u8* texels = static_cast<const u8*>(data);
+				for (u64 i = 0; i < level.size(); i++) level[i] = texels[i] / 255.0f;
+			}
+			// LDR colour images are sRGB encoded, their mips are filtered in linear space and encoded back before quantization
+			bool srgb = !isFloat && !normalMap;
+			if (srgb)
+			{
+				for (u64 i = 0; i < level.size(); i++) if ((i & 3) != 3) level[i] = SrgbToLinear(level[i]);
+			}
+			std::vector<f32> next;
+			std::vector<f32> encoded;
+			u8* output = result;
+			for (u32 l = 0; l < mipLevels; l++)
+			{
+				Maths::IVec2 levelRes = Maths::IVec2(std::max(resolution.x >> l, 1), std::max(resolution.y >> l, 1));
+				if (l)
+				{
+					DownsampleLevel(level, Maths::IVec2(std::max(resolution.x >> (l - 1), 1), std::max(resolution.y >> (l - 1), 1)), next, levelRes, layers, normalMap);
+					level.swap(next);
+				}
+				const std::vector<f32>* source = &level;
+				if (srgb)
+				{
+					encoded.resize(level.size());
+					for (u64 i = 0; i < encoded.size(); i++) encoded[i] = (i & 3) != 3 ? LinearToSrgb(level[i]) : level[i];
+					source = &encoded;
+				}
+				for (u32 layer = 0; layer < layers; layer++)
+				{
+					output = EncodeLevel(source->data() + 4llu * levelRes.x * levelRes.y * layer, levelRes, encoding, output);
+				}
+			}
+			return result;
+		}
+	}
+
+	bool TextureEncoder::EncodeTexture(Resources::StaticTexture* texture, bool normalMap, bool blockCompression)
+	{
+		if (texture->encoding != Resources::TextureEncoding::RAW || !texture->textureData) return false;
+		Resources::TextureEncoding encoding;
+		void* result = EncodeLayers(texture->textureData, texture->isFloat, texture->resolution, texture->mipLevels, 1, normalMap, blockCompression, encoding);
+		if (!result) return false;
+		ImageLoader::FreeStbi(texture->textureData);
+		texture->textureData = result;
+		texture->encoding = encoding;
+		return true;
+	}
+
+	bool TextureEncoder::EncodeCubeMap(Resources::StaticCubeMap* cubeMap, bool blockCompression)
+	{
+		if (cubeMap->encoding != Resources::TextureEncoding::RAW || !cubeMap->cubeMapData) return false;
+		Resources::TextureEncoding encoding;
+		void* result = EncodeLayers(cubeMap->cubeMapData, cubeMap->isFloat, cubeMap->resolution, cubeMap->mipLevels, 6, false, blockCompression, encoding);
+		if (!result) return false;
+		ImageLoader::FreeStbi(cubeMap->cubeMapData);
+		cubeMap->cubeMapData = result;
+		cubeMap->encoding = encoding;
+		return true;
+	}
+
+	bool TextureEncoder::IsBlockCompressed(Resources::TextureEncoding encoding)
+	{
+		return encoding == Resources::TextureEncoding::BC1 || encoding == Resources::TextureEncoding::BC5 || encoding == Resources::TextureEncoding::BC7;
+	}
+
+	u64 TextureEncoder::GetBlockSize(Resources::TextureEncoding encoding)
+	{
+		switch (encoding)
+		{
+		case Resources::TextureEncoding::BC1:
+		case Resources::TextureEncoding::RGBA16F:
+			return 8;
+		case Resources::TextureEncoding::BC5:
+		case Resources::TextureEncoding::BC7:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	u64 TextureEncoder::GetLevelSize(Resources::TextureEncoding encoding, Maths::IVec2 resolution, u32 level)
+	{
+		u64 width = std::max(resolution.x >> level, 1);
+		u64 height = std::max(resolution.y >> level, 1);
+		if (!IsBlockCompressed(encoding)) return width * height * GetBlockSize(encoding);
+		return ((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(encoding);
+	}
+
+	u64 TextureEncoder::GetEncodedSize(Resources::TextureEncoding encoding, Maths::IVec2 resolution, u32 mipLevels, u32 layers)
+	{
+		u64 size = 0;
+		for (u32 l = 0; l < mipLevels; l++) size += GetLevelSize(encoding, resolution, l);
+		return size * layers;
+	}
+
+	void TextureEncoder::EncodeBC1Block(const u8* texels, u8* output)
+	{
+		f32 low[4];
+		f32 high[4];
+		GetBlockEndpoints(texels, 3, low, high);
+		u16 color0 = Pack565(high);
+		u16 color1 = Pack565(low);
+		// The first endpoint being the largest selects the 4 colour palette without transparency
+		if (color0 < color1) std::swap(color0, color1);
+		u32 indices = 0;
+		if (color0 != color1)
+		{
+			s32 palette[4][3];
+			Unpack565(color0, palette[0]);
+			Unpack565(color1, palette[1]);
+			for (u32 c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			for (u32 i = 0; i < 16; i++)
+			{
+				u32 best = 0;
+				s32 bestError = -1;
+				for (u32 k = 0; k < 4; k++)
+				{
+					s32 error = 0;
+					for (u32 c = 0; c < 3; c++)
+					{
+						s32 delta = texels[i * 4 + c] - palette[k][c];
+						error += delta * delta;
+					}
+					if (bestError < 0 || error < bestError)
+					{
+						bestError = error;
+						best = k;
+					}
+				}
+				indices |= best << (2 * i);
+			}
+		}
+		output[0] = static_cast<u8>(color0);
+		output[1] = static_cast<u8>(color0 >> 8);
+		output[2] = static_cast<u8>(color1);
+		output[3] = static_cast<u8>(color1 >> 8);
+		for (u32 i = 0; i < 4; i++) output[4 + i] = static_cast<u8>(indices >> (8 * i));
+	}
+
+	void TextureEncoder::EncodeBC5Block(const u8* texels, u8* output)
+	{
+		EncodeBC4Block(texels, 0, output);
+		EncodeBC4Block(texels, 1, output + 8);
+	}
+
+	void TextureEncoder::EncodeBC7Block(const u8* texels, u8* output)
+	{
+		static const s32 weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+		f32 low[4];
+		f32 high[4];
+		GetBlockEndpoints(texels, 4, low, high);
+		u32 endpoints[2][4];
+		u32 pBits[2];
+		QuantizeBC7Endpoint(low, endpoints[0], pBits[0]);
+		QuantizeBC7Endpoint(high, endpoints[1], pBits[1]);
+
+		s32 palette[16][4];
+		for (u32 c = 0; c < 4; c++)
+		{
+			s32 e0 = static_cast<s32>((endpoints[0][c] << 1) | pBits[0]);
+			s32 e1 = static_cast<s32>((endpoints[1][c] << 1) | pBits[1]);
+			for (u32 k = 0; k < 16; k++) palette[k][c] = ((64 - weights[k]) * e0 + weights[k] * e1 + 32) >> 6;
+		}
+		u32 indices[16];
+		for (u32 i = 0; i < 16; i++)
+		{
+			s32 bestError = -1;
+			for (u32 k = 0; k < 16; k++)
+			{
+				s32 error = 0;
+				for (u32 c = 0; c < 4; c++)
+				{
+					s32 delta = texels[i * 4 + c] - palette[k][c];
+					error += delta * delta;
+				}
+				if (bestError < 0 || error < bestError)
+				{
+					bestError = error;
+					indices[i] = k;
+				}
+			}
+		}
+		// The most significant bit of the first index is implicit and must be 0
+		if (indices[0] & 8)
+		{
+			std::swap(endpoints[0], endpoints[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (u32 i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+		}
+
+		BlockWriter writer;
+		writer.output = output;
+		writer.Write(1 << 6, 7);
+		for (u32 c = 0; c < 4; c++)
+		{
+			writer.Write(endpoints[0][c], 7);
+			writer.Write(endpoints[1][c], 7);
+		}
+		writer.Write(pBits[0], 1);
+		writer.Write(pBits[1], 1);
+		writer.Write(indices[0], 3);
+		for (u32 i = 1; i < 16; i++) writer.Write(indices[i], 4);
+	}
+
+	u32 TextureEncoder::PackRGB9E5(const f32* color)
+	{
+		// Largest value with a 9 bit mantissa and a maximum biased exponent of 31, the bias being 15
+		const f32 maxValue = 65408.0f;
+		f32 clamped[3];
+		f32 largest = 0.0f;
+		for (u32 c = 0; c < 3; c++)
+		{
+			clamped[c] = std::clamp(color[c], 0.0f, maxValue);
+			largest = std::max(largest, clamped[c]);
+		}
+		if (largest <= 0.0f) return 0;
+		s32 exponent = std::max(-16, static_cast<s32>(std::floor(std::log2(largest)))) + 16;
+		if (std::lround(largest / std::ldexp(1.0f, exponent - 24)) == 512) exponent++;
+		f32 scale = std::ldexp(1.0f, 24 - exponent);
+		u32 packed = static_cast<u32>(exponent) << 27;
+		for (u32 c = 0; c < 3; c++)
+		{
+			packed |= static_cast<u32>(std::min(std::lround(clamped[c] * scale), 511l)) << (9 * c);
+		}
+		return packed;
+	}
+}